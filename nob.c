@@ -8,6 +8,12 @@
 #define SRC_FOLDER "src/"
 #define SHADERS_DIR "shaders"
 #define SPV_DIR "compiledshaders"
+// `./nob golden`: see build.sh, same render and threshold, and likewise opt-in (skipped) until a
+// reference is committed
+#define GOLDEN_REF "golden/pathtrace_cornell_512_64spp.png"
+#define GOLDEN_SAMPLES "64"
+
+#include "src/shader_archive.h"
 
 static bool has_shader_ext(const char *name) {
 	const char *dot = strrchr(name, '.');
@@ -32,7 +38,8 @@ static bool compile_shaders_in_dir(const char *dir) {
 			const char *base = nob_path_name(path);
 			const char *out = nob_temp_sprintf(SPV_DIR "/%s.spv", base);
 			Cmd glslc = {0};
-			cmd_append(&glslc, "glslc", path, "-o", out);
+			// the instance's apiVersion: subgroup operations need SPIR-V 1.3, not glslc's vulkan1.0 default
+			cmd_append(&glslc, "glslc", "--target-env=vulkan1.3", path, "-o", out);
 			nob_log(NOB_INFO, "glslc %s -> %s", path, out);
 			if (!cmd_run(&glslc)) { ok = false; }
 		}
@@ -42,6 +49,88 @@ static bool compile_shaders_in_dir(const char *dir) {
 	return ok;
 }
 
+// Stage, binding count and workgroup size straight from the SPIR-V words
+static void reflect_spirv(const u32 *words, size_t count, ShaderArchiveEntry *e) {
+	// execution model -> VkShaderStageFlagBits (vertex, tess control, tess eval, geometry, fragment, compute)
+	static const u32 stages[] = {0x1, 0x2, 0x4, 0x8, 0x10, 0x20};
+	for (size_t i = 5; i < count;) {
+		u32 op = words[i] & 0xffff, length = words[i] >> 16;
+		if (length == 0 || i + length > count) break;
+		if (op == 15 && length > 1 && words[i + 1] < ARRAYSIZE(stages)) e->stage = stages[words[i + 1]]; // OpEntryPoint
+		if (op == 16 && length >= 6 && words[i + 2] == 17) {                                            // OpExecutionMode LocalSize
+			e->localSize[0] = words[i + 3];
+			e->localSize[1] = words[i + 4];
+			e->localSize[2] = words[i + 5];
+		}
+		if (op == 71 && length >= 3 && words[i + 2] == 33) e->bindingCount++; // OpDecorate Binding
+		i += length;
+	}
+}
+
+static int compare_entries(const void *a, const void *b) {
+	u64 ha = ((const ShaderArchiveEntry *)a)->nameHash, hb = ((const ShaderArchiveEntry *)b)->nameHash;
+	return ha < hb ? -1 : ha > hb;
+}
+
+// Packs every SPV_DIR/*.spv into SHADER_ARCHIVE_PATH (layout in src/shader_archive.h)
+static bool pack_shader_archive(void) {
+	Nob_File_Paths children = {0};
+	if (!nob_read_entire_dir(SPV_DIR, &children)) return false;
+	ShaderArchiveEntry *entries = calloc(children.count, sizeof(ShaderArchiveEntry));
+	Nob_String_Builder *blobs = calloc(children.count, sizeof(Nob_String_Builder));
+	u32 count = 0;
+	bool ok = true;
+	for (size_t i = 0; i < children.count && ok; ++i) {
+		const char *name = children.items[i];
+		const char *dot = strrchr(name, '.');
+		if (name[0] == '.' || !dot || strcmp(dot, ".spv") != 0) continue;
+		const char *path = nob_temp_sprintf(SPV_DIR "/%s", name);
+		if (!nob_read_entire_file(path, &blobs[count])) { ok = false; break; }
+		if (blobs[count].count % 4 != 0) { nob_log(NOB_ERROR, "%s is not SPIR-V", path); ok = false; break; }
+		ShaderArchiveEntry *e = &entries[count];
+		e->nameHash = shader_archive_hash(path);
+		e->size = (u32)blobs[count].count;
+		reflect_spirv((const u32 *)blobs[count].items, blobs[count].count / 4, e);
+		for (u32 j = 0; j < count; ++j)
+			if (entries[j].nameHash == e->nameHash) { nob_log(NOB_ERROR, "shader archive: hash collision on %s", path); ok = false; }
+		count++;
+	}
+
+	Nob_String_Builder out = {0};
+	if (ok) {
+		// entries are sorted by hash, the blobs stay in directory order: remember each one's index
+		for (u32 i = 0; i < count; ++i) entries[i].reserved = i;
+		qsort(entries, count, sizeof(ShaderArchiveEntry), compare_entries);
+		ShaderArchiveHeader header = {SHADER_ARCHIVE_MAGIC, SHADER_ARCHIVE_VERSION, count, 0};
+		size_t offset = sizeof(header) + count * sizeof(ShaderArchiveEntry);
+		for (u32 i = 0; i < count; ++i) {
+			offset = (offset + SHADER_ARCHIVE_ALIGN - 1) & ~(size_t)(SHADER_ARCHIVE_ALIGN - 1);
+			entries[i].offset = (u32)offset;
+			offset += entries[i].size;
+		}
+		nob_sb_append_buf(&out, &header, sizeof(header));
+		for (u32 i = 0; i < count; ++i) {
+			ShaderArchiveEntry e = entries[i];
+			e.reserved = 0;
+			nob_sb_append_buf(&out, &e, sizeof(e));
+		}
+		for (u32 i = 0; i < count; ++i) {
+			while (out.count < entries[i].offset) nob_da_append(&out, 0);
+			Nob_String_Builder *blob = &blobs[entries[i].reserved];
+			nob_sb_append_buf(&out, blob->items, blob->count);
+		}
+		ok = nob_write_entire_file(SHADER_ARCHIVE_PATH, out.items, out.count);
+		if (ok) nob_log(NOB_INFO, "packed %u shaders -> " SHADER_ARCHIVE_PATH " (%zu KB)", count, out.count / 1024);
+	}
+
+	for (u32 i = 0; i < count; ++i) nob_sb_free(blobs[i]);
+	nob_sb_free(out);
+	free(blobs);
+	free(entries);
+	nob_da_free(children);
+	return ok;
+}
+
 int main(int argc, char** argv)
 {
 	NOB_GO_REBUILD_URSELF(argc, argv);
@@ -60,6 +149,7 @@ int main(int argc, char** argv)
 			nob_log(NOB_WARNING, "glslc not found; skipping shader compilation");
 		} else {
 			if (!compile_shaders_in_dir(SHADERS_DIR)) return 1;
+			if (!pack_shader_archive()) return 1;
 		}
 	}
 
@@ -69,6 +159,31 @@ int main(int argc, char** argv)
 		SRC_FOLDER "ext.c",
 		SRC_FOLDER "initialise.c",
 		SRC_FOLDER "helpers.c",
+		SRC_FOLDER "texture.c",
+		SRC_FOLDER "bvh.c",
+		SRC_FOLDER "job.c",
+		SRC_FOLDER "command_pools.c",
+		SRC_FOLDER "scene_pass.c",
+		SRC_FOLDER "pathtracer.c",
+		SRC_FOLDER "pipeline_manager.c",
+		SRC_FOLDER "render_graph.c",
+		SRC_FOLDER "bloom.c",
+		SRC_FOLDER "dof.c",
+		SRC_FOLDER "tonemap.c",
+		SRC_FOLDER "fft.c",
+		SRC_FOLDER "water.c",
+		SRC_FOLDER "gpu_sort.c",
+		SRC_FOLDER "particles.c",
+		SRC_FOLDER "shader_reload.c",
+		SRC_FOLDER "shader_archive.c",
+		SRC_FOLDER "autotune.c",
+		SRC_FOLDER "material.c",
+		SRC_FOLDER "render_queue.c",
+		SRC_FOLDER "uniform_ring.c",
+		SRC_FOLDER "task.c",
+		SRC_FOLDER "task_zpl.c",
+		SRC_FOLDER "world_stream.c",
+		SRC_FOLDER "overlay.c",
 		"external/SPIRV-Reflect/spirv_reflect.c"
 	};
 	const char* cpp_src_files[] = {
@@ -114,11 +229,37 @@ int main(int argc, char** argv)
 	Cmd link = {0};
 	cmd_append(&link, "g++", "-o", output);
 	// Add all object files from build folder (simple enumeration of known ones)
-	cmd_append(&link, BUILD_FOLDER "main.o", BUILD_FOLDER "ext.o", BUILD_FOLDER "initialise.o", BUILD_FOLDER "helpers.o", BUILD_FOLDER "spirv_reflect.o", BUILD_FOLDER "vma.o");
+	cmd_append(&link, BUILD_FOLDER "main.o", BUILD_FOLDER "ext.o", BUILD_FOLDER "initialise.o", BUILD_FOLDER "helpers.o", BUILD_FOLDER "texture.o", BUILD_FOLDER "bvh.o", BUILD_FOLDER "job.o", BUILD_FOLDER "command_pools.o", BUILD_FOLDER "scene_pass.o", BUILD_FOLDER "pathtracer.o", BUILD_FOLDER "pipeline_manager.o", BUILD_FOLDER "render_graph.o", BUILD_FOLDER "bloom.o", BUILD_FOLDER "dof.o", BUILD_FOLDER "tonemap.o", BUILD_FOLDER "fft.o", BUILD_FOLDER "water.o", BUILD_FOLDER "gpu_sort.o", BUILD_FOLDER "particles.o", BUILD_FOLDER "shader_reload.o", BUILD_FOLDER "shader_archive.o", BUILD_FOLDER "autotune.o", BUILD_FOLDER "material.o", BUILD_FOLDER "render_queue.o", BUILD_FOLDER "uniform_ring.o", BUILD_FOLDER "task.o", BUILD_FOLDER "task_zpl.o", BUILD_FOLDER "world_stream.o", BUILD_FOLDER "overlay.o", BUILD_FOLDER "spirv_reflect.o", BUILD_FOLDER "vma.o");
 	cmd_append(&link, "-lvulkan", "-lm", "-lglfw", "-lpthread", "-ldl");
 	if (!cmd_run(&link)) return 1;
 
 	nob_log(NOB_INFO, "Build complete → %stri", BUILD_FOLDER);
 
+	// Offline asset bake tool (no Vulkan device needed)
+	Cmd bake = {0};
+	cmd_append(&bake, "gcc", "-O2", SRC_FOLDER "bake.c", SRC_FOLDER "bc_encode.c", SRC_FOLDER "mesh_bake.c", "-o", BUILD_FOLDER "bake");
+	cmd_append(&bake, "-D_DEBUG", "-DVK_USE_PLATFORM_WAYLAND_KHR", "-std=c99", "-IVulkanMemoryAllocator/include");
+	cmd_append(&bake, "-lm", "-lpthread");
+	if (!cmd_run(&bake)) return 1;
+
+	nob_log(NOB_INFO, "Build complete → %sbake", BUILD_FOLDER);
+
+	// Golden image test: the offline path tracer against the reference once there is one; --compare
+	// exits non-zero below the PSNR threshold, which fails this command too
+	if (argc > 1 && strcmp(argv[1], "golden") == 0) {
+		if (file_exists(GOLDEN_REF) != 1) {
+			nob_log(NOB_WARNING, "golden test skipped: no " GOLDEN_REF " yet, render one with ./nob golden-update on a machine with a GPU");
+			return 0;
+		}
+		Cmd golden = {0};
+		cmd_append(&golden, output, "--pathtrace-offline", GOLDEN_SAMPLES, BUILD_FOLDER "golden.png", "--compare", GOLDEN_REF);
+		if (!cmd_run(&golden)) return 1;
+	} else if (argc > 1 && strcmp(argv[1], "golden-update") == 0) {
+		if (!mkdir_if_not_exists("golden")) return 1;
+		Cmd golden = {0};
+		cmd_append(&golden, output, "--pathtrace-offline", GOLDEN_SAMPLES, GOLDEN_REF);
+		if (!cmd_run(&golden)) return 1;
+	}
+
 	return 0;
 }
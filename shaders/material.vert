@@ -0,0 +1,27 @@
+#version 450
+// Material system vertex shader: indexed 2D meshes placed by a per-object uniform block.
+// Sets follow material.h: 0 globals, 2 the material's parameters (fragment stage), 3 the
+// object's block in the uniform ring, selected by a dynamic offset.
+
+layout(location = 0) in vec2 a_position; // mesh space, -1..1
+
+layout(set = 0, binding = 0) uniform Globals {
+    vec4 viewport; // width, height, 1 / width, 1 / height
+    vec4 time;     // x: seconds
+} globals;
+
+layout(set = 3, binding = 0) uniform Object {
+    vec4 rect;  // xy center, zw half extent, NDC
+    vec4 color;
+} object;
+
+layout(location = 0) out vec3 v_color;
+layout(location = 1) out vec2 v_local;
+
+void main() {
+    // square pixels whatever the aspect: the half extent is in units of the viewport height
+    vec2 extent = object.rect.zw * vec2(globals.viewport.y * globals.viewport.z, 1.0);
+    gl_Position = vec4(object.rect.xy + a_position * extent, 0.0, 1.0);
+    v_color = object.color.rgb;
+    v_local = a_position;
+}
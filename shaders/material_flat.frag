@@ -0,0 +1,13 @@
+#version 450
+// Flat material: the object's colour through the instance's tint
+layout(location = 0) in vec3 v_color;
+layout(location = 1) in vec2 v_local;
+layout(location = 0) out vec4 out_color;
+
+layout(set = 2, binding = 0) uniform Params {
+    vec4 tint;
+} params;
+
+void main() {
+    out_color = vec4(v_color * params.tint.rgb, 1.0);
+}
@@ -0,0 +1,23 @@
+#version 450
+// Ring material: the mesh cut down to a pulsing ring, tinted per instance
+layout(location = 0) in vec3 v_color;
+layout(location = 1) in vec2 v_local;
+layout(location = 0) out vec4 out_color;
+
+layout(set = 0, binding = 0) uniform Globals {
+    vec4 viewport;
+    vec4 time; // x: seconds
+} globals;
+
+layout(set = 2, binding = 0) uniform Params {
+    vec4 tint;
+    vec4 ring; // x: inner radius, y: pulse rate, z: pulse phase
+} params;
+
+void main() {
+    float r = length(v_local);
+    float inner = params.ring.x * (0.8 + 0.2 * sin(globals.time.x * params.ring.y + params.ring.z));
+    if (r > 1.0 || r < inner)
+        discard;
+    out_color = vec4(v_color * params.tint.rgb, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 450
+// Vertex shader for baked meshes: decodes the 16 byte QuantizedVertex of src/mesh_bake.h
+//   bytes 0-7   position: u16 x, y, z, pad as R16G16B16A16_UNORM, so in_pos.xyz arrives in [0, 1]
+//               and becomes posOffset + in_pos * posScale (MeshQuantization of the file header)
+//   bytes 8-11  normal: i16 x, y as R16G16_SNORM, an octahedral encoding unfolded by oct_decode
+//   bytes 12-15 uv: two half floats as R16G16_SFLOAT
+// The vertex fetch hardware does the unorm/snorm/half conversion. v_color is the world space
+// normal as a colour, so tri.frag can shade it; v_uv is for fragment shaders that texture it.
+layout(location = 0) in vec4 in_pos;    // R16G16B16A16_UNORM, w unused
+layout(location = 1) in vec2 in_normal; // R16G16_SNORM, octahedral
+layout(location = 2) in vec2 in_uv;     // R16G16_SFLOAT
+
+layout(push_constant) uniform MeshPush {
+    mat4 viewProj;
+    vec4 posOffset; // MeshQuantization.offset in xyz
+    vec4 posScale;  // MeshQuantization.scale in xyz
+} pc;
+
+layout(location = 0) out vec3 v_color; // world space normal, so tri.frag can be reused
+layout(location = 1) out vec2 v_uv;
+
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec3 pos = pc.posOffset.xyz + in_pos.xyz * pc.posScale.xyz;
+    gl_Position = pc.viewProj * vec4(pos, 1.0);
+    v_color = oct_decode(in_normal) * 0.5 + 0.5;
+    v_uv = in_uv;
+}
@@ -0,0 +1,19 @@
+#version 450
+// Debug overlay fragment shader: one draw for the whole overlay, so Nuklear's per-command
+// scissor rectangles are applied here instead.
+
+layout(location = 0) in vec2 v_uv;
+layout(location = 1) in vec4 v_color;
+layout(location = 2) flat in vec4 v_clip;
+
+layout(set = 0, binding = 0) uniform sampler2D fontAtlas;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    if (any(lessThan(gl_FragCoord.xy, v_clip.xy)) || any(greaterThanEqual(gl_FragCoord.xy, v_clip.zw)))
+        discard;
+    // the atlas is white with coverage in alpha, its white texel included: premultiplied, that
+    // scales all four channels
+    outColor = v_color * texture(fontAtlas, v_uv).a;
+}
@@ -0,0 +1,28 @@
+#version 450
+// Debug overlay vertex shader: Nuklear's vertices in pixels, top left origin, plus the clip
+// rectangle of the command each vertex belongs to (overlay.h).
+
+layout(location = 0) in vec2 a_position;
+layout(location = 1) in vec2 a_uv;
+layout(location = 2) in vec4 a_color; // sRGB encoded, straight alpha
+layout(location = 3) in vec4 a_clip;  // x0, y0, x1, y1 in pixels
+
+layout(push_constant) uniform Push {
+    vec2 scale;     // 2 / extent
+    uint linearize; // the target format applies the sRGB curve itself
+} push;
+
+layout(location = 0) out vec2 v_uv;
+layout(location = 1) out vec4 v_color;
+layout(location = 2) flat out vec4 v_clip;
+
+void main() {
+    gl_Position = vec4(a_position * push.scale - 1.0, 0.0, 1.0);
+    v_uv = a_uv;
+    vec3 rgb = a_color.rgb;
+    if (push.linearize != 0u)
+        rgb = mix(rgb / 12.92, pow((rgb + 0.055) / 1.055, vec3(2.4)), step(vec3(0.04045), rgb));
+    // premultiplied for the blend state
+    v_color = vec4(rgb * a_color.a, a_color.a);
+    v_clip = a_clip;
+}
@@ -0,0 +1,12 @@
+#version 450
+// Soft round sprite, premultiplied alpha in linear HDR.
+
+layout(location = 0) in vec2 v_corner;
+layout(location = 1) in vec4 v_color;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float coverage = v_color.a * (1.0 - smoothstep(0.3, 1.0, length(v_corner)));
+    outColor = vec4(v_color.rgb * coverage, coverage);
+}
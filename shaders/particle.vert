@@ -0,0 +1,48 @@
+#version 450
+// One camera facing quad per sorted particle (a 4 vertex strip, instanced by the GPU written
+// draw arguments), coloured by age: white hot at birth, cooling to a dim red as it fades.
+
+layout(std430, set = 0, binding = 0) readonly buffer Positions {
+    vec4 positions[];
+};
+layout(std430, set = 0, binding = 1) readonly buffer Velocities {
+    vec4 velocities[];
+};
+layout(std430, set = 0, binding = 2) readonly buffer Lifetimes {
+    float lifetimes[];
+};
+layout(std430, set = 0, binding = 6) readonly buffer Pairs {
+    uvec2 pairs[];
+};
+
+layout(push_constant) uniform Push {
+    vec4 cameraPosition; // w: tan(fovY / 2)
+    vec4 cameraRight;    // w: aspect
+    vec4 cameraUp;       // w: near
+    vec4 cameraForward;  // w: far
+} pc;
+
+layout(location = 0) out vec2 v_corner;
+layout(location = 1) out vec4 v_color;
+
+void main() {
+    uint slot = pairs[gl_InstanceIndex].y;
+    vec4 position = positions[slot];
+    float life = clamp(velocities[slot].w / lifetimes[slot], 0.0, 1.0);
+    vec2 corner = vec2(float(gl_VertexIndex & 1), float(gl_VertexIndex >> 1)) * 2.0 - 1.0;
+
+    vec3 world = position.xyz + (pc.cameraRight.xyz * corner.x + pc.cameraUp.xyz * corner.y) * position.w;
+    vec3 rel = world - pc.cameraPosition.xyz;
+    float x = dot(rel, pc.cameraRight.xyz);
+    float y = dot(rel, pc.cameraUp.xyz);
+    float z = dot(rel, pc.cameraForward.xyz);
+    float tanHalf = pc.cameraPosition.w;
+    float near = pc.cameraUp.w;
+    float far = pc.cameraForward.w;
+    gl_Position = vec4(x / (tanHalf * pc.cameraRight.w), -y / tanHalf, (z - near) * far / (far - near), z);
+
+    vec3 hot = vec3(4.0, 3.2, 2.4);
+    vec3 cool = vec3(0.6, 0.08, 0.02);
+    v_color = vec4(mix(hot, cool, sqrt(life)), 0.6 * (1.0 - life * life));
+    v_corner = corner;
+}
@@ -0,0 +1,256 @@
+// Progressive path tracer: one sample per pixel per dispatch, running mean kept in the image.
+// Alpha holds the running mean of the primary hit's view depth, for depth of field.
+// Persistent threads pull 8x8 pixel tiles from an atomic counter.
+// Included by pathtrace.comp (SUBGROUP_CLAIM 1: one atomic per subgroup, needs basic + ballot in
+// compute) and pathtrace_atomic.comp (SUBGROUP_CLAIM 0: one atomic per invocation).
+
+#define TILE 8
+#define BVH_MAX_DEPTH 32 // bvh.h: the builder keeps every leaf within it, pathtracer.c checks
+#define FLT_MAX 3.402823466e+38
+#define MISS_DEPTH 1.0e4
+
+layout(local_size_x = 64) in;
+
+layout(set = 0, binding = 0, rgba32f) uniform image2D accumImage;
+
+struct BvhNode
+{
+    vec3 boundsMin;
+    uint leftOrFirst; // interior: right child (left is this + 1), leaf: first triangle
+    vec3 boundsMax;
+    uint count;       // 0 = interior
+};
+
+struct BvhTriangle
+{
+    vec4 v0; // w: primitive id bits
+    vec4 v1;
+    vec4 v2;
+};
+
+struct Material
+{
+    vec4 albedo;
+    vec4 emission;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Nodes { BvhNode nodes[]; };
+layout(std430, set = 0, binding = 2) readonly buffer Triangles { BvhTriangle triangles[]; };
+layout(std430, set = 0, binding = 3) readonly buffer MaterialIds { uint materialIds[]; };
+layout(std430, set = 0, binding = 4) readonly buffer Materials { Material materials[]; };
+layout(std430, set = 0, binding = 5) buffer WorkCounter { uint nextItem; };
+
+layout(push_constant) uniform Push {
+    vec4 cameraPosition;
+    vec4 cameraRight;   // scaled by tan(fovY / 2) * aspect
+    vec4 cameraUp;      // scaled by tan(fovY / 2)
+    vec4 cameraForward;
+    uvec2 extent;
+    uint sampleIndex;
+    uint maxBounces;
+} pc;
+
+// --- RNG (PCG) ---
+
+uint pcg(inout uint state)
+{
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float rand(inout uint state)
+{
+    return float(pcg(state) >> 8) * (1.0 / 16777216.0);
+}
+
+// --- Traversal ---
+
+float ray_aabb(vec3 bmin, vec3 bmax, vec3 origin, vec3 invDir, float tMax)
+{
+    vec3 t0 = (bmin - origin) * invDir;
+    vec3 t1 = (bmax - origin) * invDir;
+    vec3 tsmall = min(t0, t1);
+    vec3 tbig = max(t0, t1);
+    float tmin = max(max(tsmall.x, tsmall.y), max(tsmall.z, 0.0));
+    float tmax = min(min(tbig.x, tbig.y), min(tbig.z, tMax));
+    return tmin <= tmax ? tmin : FLT_MAX;
+}
+
+// Möller-Trumbore, returns t or FLT_MAX
+float ray_triangle(BvhTriangle tri, vec3 o, vec3 d)
+{
+    vec3 e1 = tri.v1.xyz - tri.v0.xyz;
+    vec3 e2 = tri.v2.xyz - tri.v0.xyz;
+    vec3 p = cross(d, e2);
+    float det = dot(e1, p);
+    if (abs(det) < 1e-12)
+        return FLT_MAX;
+    float inv = 1.0 / det;
+    vec3 s = o - tri.v0.xyz;
+    float u = dot(s, p) * inv;
+    if (u < 0.0 || u > 1.0)
+        return FLT_MAX;
+    vec3 q = cross(s, e1);
+    float v = dot(d, q) * inv;
+    if (v < 0.0 || u + v > 1.0)
+        return FLT_MAX;
+    float t = dot(e2, q) * inv;
+    return t > 1e-5 ? t : FLT_MAX;
+}
+
+// Closest hit, returns the triangle slot or -1
+int trace(vec3 origin, vec3 dir, out float tHit)
+{
+    vec3 invDir = 1.0 / mix(dir, vec3(1e-20), equal(dir, vec3(0.0)));
+    tHit = FLT_MAX;
+    int hit = -1;
+    if (ray_aabb(nodes[0].boundsMin, nodes[0].boundsMax, origin, invDir, tHit) == FLT_MAX)
+        return -1;
+
+    uint stack[BVH_MAX_DEPTH]; // one far child per level at most
+    uint sp = 0;
+    uint index = 0;
+    for (;;)
+    {
+        BvhNode node = nodes[index];
+        if (node.count > 0)
+        {
+            for (uint i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+            {
+                float t = ray_triangle(triangles[i], origin, dir);
+                if (t < tHit)
+                {
+                    tHit = t;
+                    hit = int(i);
+                }
+            }
+            if (sp == 0)
+                break;
+            index = stack[--sp];
+            continue;
+        }
+
+        uint near = index + 1;
+        uint far = node.leftOrFirst;
+        float dNear = ray_aabb(nodes[near].boundsMin, nodes[near].boundsMax, origin, invDir, tHit);
+        float dFar = ray_aabb(nodes[far].boundsMin, nodes[far].boundsMax, origin, invDir, tHit);
+        if (dNear > dFar)
+        {
+            uint ti = near; near = far; far = ti;
+            float td = dNear; dNear = dFar; dFar = td;
+        }
+        if (dNear == FLT_MAX)
+        {
+            if (sp == 0)
+                break;
+            index = stack[--sp];
+            continue;
+        }
+        index = near;
+        if (dFar != FLT_MAX)
+            stack[sp++] = far;
+    }
+    return hit;
+}
+
+// --- Shading ---
+
+vec3 cosine_hemisphere(vec3 n, inout uint rng)
+{
+    float r1 = rand(rng);
+    float r2 = rand(rng);
+    float phi = 6.28318531 * r1;
+    float r = sqrt(r2);
+    vec3 t = normalize(abs(n.x) > 0.5 ? cross(n, vec3(0.0, 1.0, 0.0)) : cross(n, vec3(1.0, 0.0, 0.0)));
+    vec3 b = cross(n, t);
+    return normalize(t * (r * cos(phi)) + b * (r * sin(phi)) + n * sqrt(max(0.0, 1.0 - r2)));
+}
+
+// depth: distance of the first hit along the ray (MISS_DEPTH if nothing was hit)
+vec3 radiance(vec3 origin, vec3 dir, inout uint rng, out float depth)
+{
+    depth = MISS_DEPTH;
+    vec3 result = vec3(0.0);
+    vec3 throughput = vec3(1.0);
+    for (uint bounce = 0; bounce <= pc.maxBounces; ++bounce)
+    {
+        float t;
+        int slot = trace(origin, dir, t);
+        if (slot < 0)
+            break; // closed scenes only, no sky
+        if (bounce == 0)
+            depth = t;
+
+        BvhTriangle tri = triangles[slot];
+        Material mat = materials[materialIds[floatBitsToUint(tri.v0.w)]];
+        result += throughput * mat.emission.rgb;
+
+        vec3 n = normalize(cross(tri.v1.xyz - tri.v0.xyz, tri.v2.xyz - tri.v0.xyz));
+        if (dot(n, dir) > 0.0)
+            n = -n;
+        throughput *= mat.albedo.rgb;
+
+        // russian roulette once the path had a chance to pick up some light
+        if (bounce >= 3)
+        {
+            float p = max(throughput.r, max(throughput.g, throughput.b));
+            if (rand(rng) > p)
+                break;
+            throughput /= p;
+        }
+        origin = origin + dir * t + n * 1e-4;
+        dir = cosine_hemisphere(n, rng);
+    }
+    return result;
+}
+
+void main()
+{
+    uvec2 tiles = (pc.extent + uvec2(TILE - 1)) / TILE;
+    uint totalItems = tiles.x * tiles.y * TILE * TILE;
+
+    for (;;)
+    {
+#if SUBGROUP_CLAIM
+        // one atomic per subgroup; ballot prefix instead of gl_SubgroupInvocationID so lanes that
+        // left the loop or diverged never leave holes in the item sequence
+        uvec4 active = subgroupBallot(true);
+        uint lane = subgroupBallotExclusiveBitCount(active);
+        uint base = 0;
+        if (subgroupElect())
+            base = atomicAdd(nextItem, subgroupBallotBitCount(active));
+        uint item = subgroupBroadcastFirst(base) + lane;
+#else
+        uint item = atomicAdd(nextItem, 1u);
+#endif
+        if (item >= totalItems)
+            break;
+
+        uint tile = item / (TILE * TILE);
+        uint inTile = item % (TILE * TILE);
+        uvec2 pixel = uvec2(tile % tiles.x, tile / tiles.x) * TILE + uvec2(inTile % TILE, inTile / TILE);
+        if (pixel.x < pc.extent.x && pixel.y < pc.extent.y)
+        {
+            uint rng = (pixel.y * pc.extent.x + pixel.x) * 9781u + pc.sampleIndex * 6271u + 1u;
+            pcg(rng);
+            vec2 jitter = vec2(rand(rng), rand(rng));
+            vec2 ndc = (vec2(pixel) + jitter) / vec2(pc.extent) * 2.0 - 1.0;
+            vec3 dir = normalize(pc.cameraForward.xyz + ndc.x * pc.cameraRight.xyz - ndc.y * pc.cameraUp.xyz);
+            float hitDistance;
+            vec3 color = radiance(pc.cameraPosition.xyz, dir, rng, hitDistance);
+            float depth = min(hitDistance * dot(dir, pc.cameraForward.xyz), MISS_DEPTH);
+
+            ivec2 p = ivec2(pixel);
+            if (pc.sampleIndex == 0)
+            {
+                imageStore(accumImage, p, vec4(color, depth));
+            }
+            else
+            {
+                vec4 previous = imageLoad(accumImage, p);
+                imageStore(accumImage, p, mix(previous, vec4(color, depth), 1.0 / float(pc.sampleIndex + 1)));
+            }
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#version 450
+// Round variant of the scene quads: cuts the quad down to its inscribed circle
+layout(location = 0) in vec3 v_color;
+layout(location = 1) in vec2 v_local;
+layout(location = 0) out vec4 out_color;
+void main() {
+    if (dot(v_local, v_local) > 1.0)
+        discard;
+    out_color = vec4(v_color, 1.0);
+}
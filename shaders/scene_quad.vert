@@ -0,0 +1,18 @@
+#version 450
+// One screen-space quad per draw (4 vertex strip). Everything comes from push constants so a
+// draw costs one push + one vkCmdDraw to record, which is what the parallel recording stresses.
+
+layout(push_constant) uniform Push {
+    vec4 rect;  // xy center, zw half extent, NDC
+    vec4 color;
+} pc;
+
+layout(location = 0) out vec3 v_color;
+layout(location = 1) out vec2 v_local; // -1..1 across the quad
+
+void main() {
+    vec2 corner = vec2(float(gl_VertexIndex & 1), float(gl_VertexIndex >> 1)) * 2.0 - 1.0;
+    gl_Position = vec4(pc.rect.xy + corner * pc.rect.zw, 0.0, 1.0);
+    v_color = pc.color.rgb;
+    v_local = corner;
+}
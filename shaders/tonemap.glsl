@@ -0,0 +1,166 @@
+// Output transform: the only pass that touches the swapchain. One read of the HDR image, one
+// write of the presented image:
+// - exposure from the previous frame's histogram (tonemap_exposure.comp), so auto-exposure adds
+//   no extra read of the image
+// - tonemap: ACES (Hill's RRT+ODT fit) or AgX (Sobotka's curve, polynomial fit)
+// - triangular dither of one output LSB, then sRGB or HDR10 (Rec.2020 + PQ) encoding
+// - every pixel also lands in this frame's log luminance histogram; with SUBGROUP_MERGE lanes of a
+//   subgroup that fall into the same bin are merged before touching shared memory, and each group
+//   flushes its shared histogram to the global one with one atomic per non-empty bin
+// Included by tonemap.comp (SUBGROUP_MERGE 1, needs basic + ballot in compute) and
+// tonemap_atomic.comp (SUBGROUP_MERGE 0: one shared atomic per pixel).
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+#define HISTOGRAM_BINS 256
+#define TONEMAP_ACES 0u
+#define TONEMAP_AGX 1u
+#define ENCODE_SRGB 0u   // UNORM swapchain, the shader applies the sRGB curve
+#define ENCODE_LINEAR 1u // sRGB-format target, the hardware applies it
+#define ENCODE_HDR10 2u
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(set = 0, binding = 1) uniform writeonly image2D dst; // swapchain: BGRA8, RGBA8 or A2B10G10R10
+
+layout(std430, set = 0, binding = 2) buffer Exposure {
+    float exposure;
+    float averageLuminance;
+    uint histogram[HISTOGRAM_BINS];
+};
+
+layout(push_constant) uniform Push {
+    ivec2 size;
+    uint tonemapper;
+    uint encoding;
+    float minLog2Luminance;
+    float log2LuminanceRange;
+    float deltaTime;
+    float adaptationRate;
+    float paperWhiteNits;
+    float peakNits;
+    uint frame;
+    float ditherBits; // output precision: 8 or 10
+} pc;
+
+shared uint bins[HISTOGRAM_BINS];
+
+float luminance(vec3 c) {
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// bin 0 holds black and anything below the range; it is left out of the average
+uint luminance_bin(float lum) {
+    if (lum < 1e-5)
+        return 0u;
+    float t = clamp((log2(lum) - pc.minLog2Luminance) / pc.log2LuminanceRange, 0.0, 1.0);
+    return uint(t * float(HISTOGRAM_BINS - 2) + 1.0);
+}
+
+vec3 aces(vec3 c) {
+    const mat3 inputMatrix = mat3(0.59719, 0.07600, 0.02840, 0.35458, 0.90834, 0.13383, 0.04823, 0.01566, 0.83777);
+    const mat3 outputMatrix = mat3(1.60475, -0.10208, -0.00327, -0.53108, 1.10813, -0.07276, -0.07367, -0.00605, 1.07602);
+    c = inputMatrix * c;
+    vec3 a = c * (c + 0.0245786) - 0.000090537;
+    vec3 b = c * (0.983729 * c + 0.4329510) + 0.238081;
+    return clamp(outputMatrix * (a / b), 0.0, 1.0);
+}
+
+vec3 agx(vec3 c) {
+    const mat3 inset = mat3(0.842479062253094, 0.0423282422610123, 0.0423756549057051,
+                            0.0784335999999992, 0.878468636469772, 0.0784336,
+                            0.0792237451477643, 0.0791661274605434, 0.879142973793104);
+    const mat3 outset = mat3(1.19687900512017, -0.0528968517574562, -0.0529716355144438,
+                             -0.0980208811401368, 1.15190312990417, -0.0980434501171241,
+                             -0.0990297440797205, -0.0989611768448433, 1.15107367264116);
+    const float minEv = -12.47393;
+    const float maxEv = 4.026069;
+    c = inset * c;
+    c = clamp((log2(max(c, 1e-10)) - minEv) / (maxEv - minEv), 0.0, 1.0);
+    // sigmoid fit, result is display encoded
+    vec3 x2 = c * c;
+    vec3 x4 = x2 * x2;
+    c = 15.5 * x4 * x2 - 40.14 * x4 * c + 31.96 * x4 - 6.868 * x2 * c + 0.4298 * x2 + 0.1191 * c - 0.00232;
+    c = outset * c;
+    return clamp(pow(max(c, 0.0), vec3(2.2)), 0.0, 1.0); // back to linear for the encoders
+}
+
+vec3 srgb_encode(vec3 c) {
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, greaterThan(c, vec3(0.0031308)));
+}
+
+vec3 pq_encode(vec3 nits) {
+    const float m1 = 0.1593017578125;
+    const float m2 = 78.84375;
+    const float c1 = 0.8359375;
+    const float c2 = 18.8515625;
+    const float c3 = 18.6875;
+    vec3 y = pow(clamp(nits / 10000.0, 0.0, 1.0), vec3(m1));
+    return pow((c1 + c2 * y) / (1.0 + c3 * y), vec3(m2));
+}
+
+// HDR keeps highlights up to the display peak: Reinhard on luminance, shoulder at peak
+vec3 hdr_tonemap(vec3 c) {
+    float peak = pc.peakNits / pc.paperWhiteNits;
+    float l = luminance(c);
+    float mapped = l * (1.0 + l / (peak * peak)) / (1.0 + l);
+    return c * (l > 0.0 ? mapped / l : 0.0);
+}
+
+float hash(uvec2 p, uint frame) {
+    uint h = p.x * 1973u + p.y * 9277u + frame * 26699u;
+    h = (h ^ (h >> 15)) * 0x2c1b3c6du;
+    h = (h ^ (h >> 12)) * 0x297a2d39u;
+    h ^= h >> 15;
+    return float(h >> 8) * (1.0 / 16777216.0);
+}
+
+void main() {
+    uint local = gl_LocalInvocationIndex;
+    bins[local] = 0u;
+    barrier();
+
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = p.x < pc.size.x && p.y < pc.size.y;
+    vec3 hdr = inside ? texelFetch(source, p, 0).rgb : vec3(0.0);
+
+    uint bin = luminance_bin(luminance(hdr));
+#if SUBGROUP_MERGE
+    // peel off one bin per iteration: the first still active lane picks it, the lanes sharing it
+    // are counted with a ballot and leave the loop together
+    bool pending = inside;
+    while (pending) {
+        uint current = subgroupBroadcastFirst(bin);
+        uvec4 same = subgroupBallot(bin == current);
+        if (bin == current) {
+            if (subgroupElect())
+                atomicAdd(bins[current], subgroupBallotBitCount(same));
+            pending = false;
+        }
+    }
+#else
+    if (inside)
+        atomicAdd(bins[bin], 1u);
+#endif
+
+    if (inside) {
+        vec3 c = hdr * exposure;
+        vec3 encoded;
+        if (pc.encoding == ENCODE_HDR10) {
+            const mat3 rec709to2020 = mat3(0.6274040, 0.0690970, 0.0163916, 0.3292820, 0.9195400, 0.0880132, 0.0433136, 0.0113612, 0.8955950);
+            encoded = pq_encode(rec709to2020 * hdr_tonemap(c) * pc.paperWhiteNits);
+        } else {
+            vec3 ldr = pc.tonemapper == TONEMAP_AGX ? agx(c) : aces(c);
+            encoded = pc.encoding == ENCODE_SRGB ? srgb_encode(ldr) : ldr;
+        }
+        // triangular noise in [-1, 1] LSB hides banding in gradients
+        float lsb = 1.0 / (exp2(pc.ditherBits) - 1.0);
+        float noise = hash(uvec2(p), pc.frame) + hash(uvec2(p) + 7919u, pc.frame) - 1.0;
+        if (pc.encoding != ENCODE_LINEAR)
+            encoded = clamp(encoded + noise * lsb, 0.0, 1.0);
+        imageStore(dst, p, vec4(encoded, 1.0));
+    }
+
+    barrier();
+    if (bins[local] != 0u)
+        atomicAdd(histogram[local], bins[local]);
+}
@@ -0,0 +1,66 @@
+#version 450
+// Ocean shading in linear HDR: normal from the summed cascade slopes, Fresnel blend of a deep
+// water colour and an analytic sky, a sun highlight, foam on top, and haze towards the horizon.
+
+layout(set = 0, binding = 1) uniform sampler2DArray normalMap;
+
+layout(push_constant) uniform Push {
+    vec4 cameraPosition;
+    vec4 cameraRight;
+    vec4 cameraUp;
+    vec4 cameraForward;
+    vec4 patchSizes;
+    float gridSpacing;
+    uint gridQuads;
+    uint cascades;
+    float time;
+} pc;
+
+layout(location = 0) in vec3 v_world;
+layout(location = 1) in vec2 v_grid;
+
+layout(location = 0) out vec4 outColor;
+
+const vec3 SUN_DIRECTION = vec3(0.3313, 0.4417, -0.8336); // normalized (0.3, 0.4, -0.755)
+const vec3 SUN_COLOR = vec3(12.0, 10.5, 9.0);
+const vec3 DEEP_COLOR = vec3(0.004, 0.016, 0.032);
+const vec3 SCATTER_COLOR = vec3(0.01, 0.06, 0.05);
+
+vec3 sky(vec3 d) {
+    float up = clamp(d.y, 0.0, 1.0);
+    vec3 horizon = vec3(0.55, 0.65, 0.75);
+    vec3 zenith = vec3(0.12, 0.28, 0.55);
+    return mix(horizon, zenith, sqrt(up));
+}
+
+void main() {
+    vec3 slopeFoam = vec3(0.0);
+    for (uint c = 0u; c < pc.cascades; ++c) {
+        vec3 s = texture(normalMap, vec3(v_grid / pc.patchSizes[c], float(c))).xyz;
+        slopeFoam.xy += s.xy;
+        slopeFoam.z = max(slopeFoam.z, s.z);
+    }
+    vec3 n = normalize(vec3(-slopeFoam.x, 1.0, -slopeFoam.y));
+    vec3 toCamera = pc.cameraPosition.xyz - v_world;
+    float dist = length(toCamera);
+    vec3 v = toCamera / dist;
+    if (dot(n, v) < 0.0)
+        n = normalize(n + v * (0.01 - dot(n, v))); // back-facing slopes seen at grazing angles
+
+    float cosTheta = clamp(dot(n, v), 0.0, 1.0);
+    float fresnel = 0.02 + 0.98 * pow(1.0 - cosTheta, 5.0);
+    vec3 r = reflect(-v, n);
+    r.y = abs(r.y);
+    vec3 reflected = sky(r) + SUN_COLOR * pow(max(dot(r, SUN_DIRECTION), 0.0), 800.0);
+    // light scattered in the water shows through wave crests
+    float crest = clamp(v_world.y * 0.3 + 0.3, 0.0, 1.0) * clamp(dot(SUN_DIRECTION, -v) * 0.5 + 0.5, 0.0, 1.0);
+    vec3 refracted = DEEP_COLOR + SCATTER_COLOR * crest;
+    vec3 color = mix(refracted, reflected, fresnel);
+
+    float foam = slopeFoam.z;
+    color = mix(color, vec3(0.8) * (0.3 + 0.7 * max(dot(n, SUN_DIRECTION), 0.0)), foam);
+
+    float haze = 1.0 - exp(-dist * 0.0004);
+    color = mix(color, sky(vec3(0.0, 0.02, 0.0)), haze);
+    outColor = vec4(color, 1.0);
+}
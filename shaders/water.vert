@@ -0,0 +1,76 @@
+#version 450
+// Ocean surface as a clipmap: gl_InstanceIndex is the level, each level a grid of GRID x GRID
+// quads (6 vertices per quad, no vertex buffer) with twice the spacing of the one inside it.
+// - a level snaps to twice its spacing, so the finer level's bounds land on its quad edges and
+//   the quads under the finer level are collapsed to a point instead of drawn twice
+// - near the outer edge odd vertices slide onto their even neighbours, so the edge matches the
+//   coarser level's vertices and there are no T-junction cracks
+// - height and choppy displacement are the sum of every cascade, sampled at the grid position
+
+layout(set = 0, binding = 0) uniform sampler2DArray displacementMap;
+
+layout(push_constant) uniform Push {
+    vec4 cameraPosition; // w: tan(fovY / 2)
+    vec4 cameraRight;    // w: aspect
+    vec4 cameraUp;       // w: near
+    vec4 cameraForward;  // w: far
+    vec4 patchSizes;
+    float gridSpacing;   // level 0
+    uint gridQuads;
+    uint cascades;
+    float time;
+} pc;
+
+layout(location = 0) out vec3 v_world;
+layout(location = 1) out vec2 v_grid;
+
+const vec2 corners[6] = vec2[](vec2(0, 0), vec2(0, 1), vec2(1, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1));
+
+vec2 level_origin(float spacing) {
+    return floor(pc.cameraPosition.xz / (2.0 * spacing)) * (2.0 * spacing);
+}
+
+void main() {
+    uint level = uint(gl_InstanceIndex);
+    uint quad = uint(gl_VertexIndex) / 6u;
+    vec2 corner = corners[uint(gl_VertexIndex) % 6u];
+    float halfQuads = float(pc.gridQuads / 2u);
+    float spacing = pc.gridSpacing * exp2(float(level));
+    vec2 origin = level_origin(spacing);
+    vec2 quadMin = origin + (vec2(quad % pc.gridQuads, quad / pc.gridQuads) - halfQuads) * spacing;
+
+    if (level > 0u) {
+        float fine = spacing * 0.5;
+        vec2 fineOrigin = level_origin(fine);
+        vec2 fineMin = fineOrigin - halfQuads * fine;
+        vec2 fineMax = fineOrigin + halfQuads * fine;
+        float eps = fine * 0.01;
+        if (all(greaterThanEqual(quadMin, fineMin - eps)) && all(lessThanEqual(quadMin + spacing, fineMax + eps))) {
+            gl_Position = vec4(0.0, 0.0, 2.0, 1.0); // degenerate, and outside the depth range
+            return;
+        }
+    }
+
+    vec2 p = quadMin + corner * spacing;
+    vec2 cell = (p - origin) / spacing + halfQuads; // 0..gridQuads
+    float edge = min(min(cell.x, cell.y), min(float(pc.gridQuads) - cell.x, float(pc.gridQuads) - cell.y));
+    float morph = clamp(1.0 - edge / (float(pc.gridQuads) * 0.125), 0.0, 1.0);
+    vec2 odd = mod(round(p / spacing), 2.0);
+    p -= odd * spacing * morph;
+
+    vec3 displacement = vec3(0.0);
+    for (uint c = 0u; c < pc.cascades; ++c)
+        displacement += textureLod(displacementMap, vec3(p / pc.patchSizes[c], float(c)), 0.0).xyz;
+    vec3 world = vec3(p.x, 0.0, p.y) + displacement;
+
+    vec3 rel = world - pc.cameraPosition.xyz;
+    float x = dot(rel, pc.cameraRight.xyz);
+    float y = dot(rel, pc.cameraUp.xyz);
+    float z = dot(rel, pc.cameraForward.xyz);
+    float tanHalf = pc.cameraPosition.w;
+    float near = pc.cameraUp.w;
+    float far = pc.cameraForward.w;
+    gl_Position = vec4(x / (tanHalf * pc.cameraRight.w), -y / tanHalf, (z - near) * far / (far - near), z);
+    v_world = world;
+    v_grid = p;
+}
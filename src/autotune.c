@@ -0,0 +1,331 @@
+#include "autotune.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Candidates: square tiles, wide rows (coalesced writes) and tall columns
+static const u32 shapes[][2] = {
+    {8, 8}, {16, 8}, {8, 16}, {16, 16}, {32, 4}, {32, 8}, {8, 32}, {32, 16}, {32, 32}, {64, 1}, {64, 2}, {64, 4}, {128, 1}, {256, 1},
+};
+static const u32 sizes[][2] = {
+    {512, 512}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160},
+};
+
+// Every line of path, whichever device it is for
+static void read_results(const char* path, AutotuneTable* table)
+{
+	memset(table, 0, sizeof(*table));
+	FILE* f = fopen(path, "r");
+	if (!f)
+		return;
+	char line[256];
+	while (table->count < AUTOTUNE_MAX_RESULTS && fgets(line, sizeof(line), f))
+	{
+		AutotuneResult* r = &table->results[table->count];
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%x:%x %31s %u %u %u %u %f", &r->vendorID, &r->deviceID, r->pass, &r->width, &r->height, &r->localSize[0],
+		        &r->localSize[1], &r->ms) == 8 &&
+		    r->localSize[0] > 0 && r->localSize[1] > 0)
+			table->count++;
+	}
+	fclose(f);
+}
+
+void autotune_load(AutotuneTable* table, const char* path, VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	read_results(path, table);
+	u32 kept = 0;
+	for (u32 i = 0; i < table->count; ++i)
+	{
+		if (table->results[i].vendorID == props.vendorID && table->results[i].deviceID == props.deviceID)
+			table->results[kept++] = table->results[i];
+	}
+	table->count = kept;
+	if (kept > 0)
+		printf("[Autotune] %u tuned sizes for %s from %s\n", kept, props.deviceName, path);
+}
+
+bool autotune_best(const AutotuneTable* table, const char* pass, u32 width, u32 height, u32 localSize[2])
+{
+	double pixels = (double)MAX(width, 1u) * MAX(height, 1u);
+	double bestDistance = INFINITY;
+	for (u32 i = 0; i < table->count; ++i)
+	{
+		const AutotuneResult* r = &table->results[i];
+		if (strcmp(r->pass, pass) != 0)
+			continue;
+		// ratio, not difference: 720p is as far from 1080p as 1080p is from 1620p
+		double distance = fabs(log(pixels / ((double)MAX(r->width, 1u) * MAX(r->height, 1u))));
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			localSize[0] = r->localSize[0];
+			localSize[1] = r->localSize[1];
+		}
+	}
+	return bestDistance < INFINITY;
+}
+
+// Other devices' lines, then this run's; written next to path and renamed over it
+static bool write_results(const char* path, const VkPhysicalDeviceProperties* props, const AutotuneTable* run)
+{
+	AutotuneTable* file = malloc(sizeof(AutotuneTable));
+	read_results(path, file);
+	char tmp[256];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	FILE* f = fopen(tmp, "w");
+	if (!f)
+	{
+		free(file);
+		return false;
+	}
+	fprintf(f, "# vendor:device pass width height local_x local_y ms\n");
+	for (u32 i = 0; i < file->count; ++i)
+	{
+		const AutotuneResult* r = &file->results[i];
+		bool replaced = false;
+		for (u32 j = 0; j < run->count && !replaced; ++j)
+			replaced = r->vendorID == props->vendorID && r->deviceID == props->deviceID && strcmp(r->pass, run->results[j].pass) == 0;
+		if (!replaced)
+			fprintf(f, "%04x:%04x %s %u %u %u %u %.4f\n", r->vendorID, r->deviceID, r->pass, r->width, r->height, r->localSize[0], r->localSize[1], r->ms);
+	}
+	fprintf(f, "# %s\n", props->deviceName);
+	for (u32 i = 0; i < run->count; ++i)
+	{
+		const AutotuneResult* r = &run->results[i];
+		fprintf(f, "%04x:%04x %s %u %u %u %u %.4f\n", r->vendorID, r->deviceID, r->pass, r->width, r->height, r->localSize[0], r->localSize[1], r->ms);
+	}
+	bool ok = fclose(f) == 0 && rename(tmp, path) == 0;
+	free(file);
+	return ok;
+}
+
+static void begin(VkCommandBuffer cmd)
+{
+	VK_CHECK(vkResetCommandBuffer(cmd, 0));
+	VkCommandBufferBeginInfo beginInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+	VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+}
+
+static void submit_and_wait(const Application* app, VkQueue queue, VkCommandBuffer cmd, VkFence fence)
+{
+	VK_CHECK(vkEndCommandBuffer(cmd));
+	VkCommandBufferSubmitInfo cmdInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+	    .commandBuffer = cmd};
+	VkSubmitInfo2 submit = {
+	    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+	    .commandBufferInfoCount = 1,
+	    .pCommandBufferInfos = &cmdInfo};
+	VK_CHECK(vkQueueSubmit2(queue, 1, &submit, fence));
+	VK_CHECK(vkWaitForFences(app->device, 1, &fence, VK_TRUE, UINT64_MAX));
+	VK_CHECK(vkResetFences(app->device, 1, &fence));
+}
+
+// Each dispatch waits for the last, as consecutive passes of a frame would
+static void write_after_write(VkCommandBuffer cmd, VkImage image)
+{
+	VkImageMemoryBarrier2 barrier = imageBarrier(image,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+	    VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	pipelineBarrier(cmd, 0, 0, NULL, 1, &barrier);
+}
+
+typedef struct AutotuneContext
+{
+	const Application* app;
+	PipelineManager* pipelines;
+	VkQueue queue;
+	VkCommandBuffer cmd;
+	VkFence fence;
+	VkQueryPool timestamps; // VK_NULL_HANDLE: submit time instead
+	float timestampPeriod;
+	u32 iterations;
+} AutotuneContext;
+
+// Milliseconds per dispatch of variant over width x height, fastest of AUTOTUNE_REPEATS
+static double time_variant(AutotuneContext* ctx, const AutotunePass* pass, PipelineHandle variant, VkImage image, u32 width, u32 height)
+{
+	double best = INFINITY;
+	for (u32 r = 0; r < AUTOTUNE_REPEATS; ++r)
+	{
+		begin(ctx->cmd);
+		if (ctx->timestamps)
+			vkCmdResetQueryPool(ctx->cmd, ctx->timestamps, 0, 2);
+		pass->bind(pass->user, ctx->cmd);
+		// one untimed dispatch so the first timed one doesn't pay for cold caches
+		pipeline_dispatch(ctx->pipelines, ctx->cmd, variant, width, height, 1);
+		write_after_write(ctx->cmd, image);
+		if (ctx->timestamps)
+			vkCmdWriteTimestamp2(ctx->cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, ctx->timestamps, 0);
+		for (u32 i = 0; i < ctx->iterations; ++i)
+		{
+			pipeline_dispatch(ctx->pipelines, ctx->cmd, variant, width, height, 1);
+			write_after_write(ctx->cmd, image);
+		}
+		if (ctx->timestamps)
+			vkCmdWriteTimestamp2(ctx->cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, ctx->timestamps, 1);
+		double start = now_ms();
+		submit_and_wait(ctx->app, ctx->queue, ctx->cmd, ctx->fence);
+		double ms = now_ms() - start;
+		u64 ticks[2];
+		if (ctx->timestamps &&
+		    vkGetQueryPoolResults(ctx->app->device, ctx->timestamps, 0, 2, sizeof(ticks), ticks, sizeof(u64), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+			ms = (double)(ticks[1] - ticks[0]) * ctx->timestampPeriod * 1e-6;
+		best = MIN(best, ms / ctx->iterations);
+	}
+	return best;
+}
+
+// Sweeps every allowed shape at one size; false if none could be measured
+static bool tune_size(AutotuneContext* ctx, const AutotunePass* pass, const VkPhysicalDeviceLimits* limits, u32 width, u32 height, AutotuneResult* out)
+{
+	VkImageCreateInfo imageInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+	    .imageType = VK_IMAGE_TYPE_2D,
+	    .format = pass->format,
+	    .extent = {width, height, 1},
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .samples = VK_SAMPLE_COUNT_1_BIT,
+	    .tiling = VK_IMAGE_TILING_OPTIMAL,
+	    .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+	};
+	VmaAllocationCreateInfo allocInfo = {.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+	AllocatedImage target = {.imageFormat = pass->format, .imageExtent = imageInfo.extent};
+	if (vmaCreateImage(ctx->app->allocator, &imageInfo, &allocInfo, &target.image, &target.allocation, NULL) != VK_SUCCESS)
+	{
+		printf("[Autotune] %s: no %ux%u image, skipped\n", pass->name, width, height);
+		return false;
+	}
+	target.imageView = createImageView(ctx->app->device, target.image, pass->format, VK_IMAGE_VIEW_TYPE_2D, 0, 1, 0, 1);
+	pass->prepare(pass->user, target.imageView, width, height);
+	begin(ctx->cmd);
+	VkImageMemoryBarrier2 toGeneral = imageBarrier(target.image,
+	    VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+	    VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	pipelineBarrier(ctx->cmd, 0, 0, NULL, 1, &toGeneral);
+	submit_and_wait(ctx->app, ctx->queue, ctx->cmd, ctx->fence);
+
+	const PipelineEntry* base = &ctx->pipelines->entries[pass->base];
+	u32 constants[PIPELINE_MAX_SPEC_CONSTANTS] = {0};
+	u32 constantCount = MAX(base->desc.specConstantCount, 2u);
+	memcpy(constants, base->desc.specConstants, base->desc.specConstantCount * sizeof(u32));
+	double baseMs = INFINITY;
+	*out = (AutotuneResult){.width = width, .height = height, .ms = INFINITY};
+	for (u32 s = 0; s < ARRAYSIZE(shapes); ++s)
+	{
+		u32 x = shapes[s][0], y = shapes[s][1];
+		if (x * y > limits->maxComputeWorkGroupInvocations || x > limits->maxComputeWorkGroupSize[0] || y > limits->maxComputeWorkGroupSize[1])
+			continue;
+		constants[PIPELINE_SPEC_LOCAL_SIZE_X] = x;
+		constants[PIPELINE_SPEC_LOCAL_SIZE_Y] = y;
+		PipelineHandle variant = pipeline_variant(ctx->pipelines, pass->base, constants, constantCount);
+		if (!pipeline_compile(ctx->pipelines, variant))
+		{
+			printf("[Autotune] %s %ux%u: %ux%u failed to compile, skipped\n", pass->name, width, height, x, y);
+			continue;
+		}
+		double ms = time_variant(ctx, pass, variant, target.image, width, height);
+		printf("[Autotune] %s %ux%u: %3ux%-3u %.4f ms\n", pass->name, width, height, x, y, ms);
+		if (ms < out->ms)
+		{
+			out->ms = (float)ms;
+			out->localSize[0] = x;
+			out->localSize[1] = y;
+		}
+		if (x == base->localSize[0] && y == base->localSize[1])
+			baseMs = ms;
+	}
+	if (out->ms < INFINITY)
+	{
+		if (baseMs < INFINITY)
+			printf("[Autotune] %s %ux%u: best %ux%u, %.2fx the default %ux%u\n", pass->name, width, height, out->localSize[0], out->localSize[1],
+			    baseMs / out->ms, base->localSize[0], base->localSize[1]);
+		else
+			printf("[Autotune] %s %ux%u: best %ux%u\n", pass->name, width, height, out->localSize[0], out->localSize[1]);
+	}
+
+	vkDestroyImageView(ctx->app->device, target.imageView, NULL);
+	vmaDestroyImage(ctx->app->allocator, target.image, target.allocation);
+	return out->ms < INFINITY;
+}
+
+int autotune_run(const Application* app, PipelineManager* pipelines, const AutotunePass* passes, u32 passCount, u32 iterations, const char* path)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	AutotuneContext ctx = {
+	    .app = app,
+	    .pipelines = pipelines,
+	    .iterations = MAX(iterations, 1u),
+	    .timestampPeriod = props.limits.timestampComputeAndGraphics ? props.limits.timestampPeriod : 0.0f,
+	};
+	vkGetDeviceQueue(app->device, find_graphics_queue_family_index(app->physicaldevice), 0, &ctx.queue);
+	VkCommandPool commandPool = createCommandBufferPool(app->device, app->physicaldevice);
+	ctx.cmd = createCommandBuffer(app->device, commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	ctx.fence = CreateFence(app->device);
+	VK_CHECK(vkResetFences(app->device, 1, &ctx.fence));
+	if (ctx.timestampPeriod > 0.0f)
+	{
+		VkQueryPoolCreateInfo queryInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+		    .queryCount = 2,
+		};
+		VK_CHECK(vkCreateQueryPool(app->device, &queryInfo, NULL, &ctx.timestamps));
+	}
+	else
+	{
+		printf("[Autotune] no compute timestamps on %s, timing whole submissions\n", props.deviceName);
+	}
+
+	AutotuneTable* run = malloc(sizeof(AutotuneTable));
+	memset(run, 0, sizeof(*run));
+	for (u32 p = 0; p < passCount; ++p)
+	{
+		const AutotunePass* pass = &passes[p];
+		if (!pipeline_compile(pipelines, pass->base) || !pipelines->entries[pass->base].desc.computeShader)
+		{
+			printf("[Autotune] %s: base pipeline unavailable, skipped\n", pass->name);
+			continue;
+		}
+		for (u32 s = 0; s < ARRAYSIZE(sizes) && run->count < AUTOTUNE_MAX_RESULTS; ++s)
+		{
+			if (sizes[s][0] > props.limits.maxImageDimension2D || sizes[s][1] > props.limits.maxImageDimension2D)
+				continue;
+			AutotuneResult* r = &run->results[run->count];
+			if (!tune_size(&ctx, pass, &props.limits, sizes[s][0], sizes[s][1], r))
+				continue;
+			r->vendorID = props.vendorID;
+			r->deviceID = props.deviceID;
+			snprintf(r->pass, sizeof(r->pass), "%s", pass->name);
+			run->count++;
+		}
+	}
+
+	int result = run->count > 0 ? 0 : 1;
+	if (run->count > 0)
+	{
+		if (write_results(path, &props, run))
+			printf("[Autotune] %u results for %s (%04x:%04x) written to %s\n", run->count, props.deviceName, props.vendorID, props.deviceID, path);
+		else
+		{
+			printf("[Autotune] Failed to write %s\n", path);
+			result = 1;
+		}
+	}
+	free(run);
+	if (ctx.timestamps)
+		vkDestroyQueryPool(app->device, ctx.timestamps, NULL);
+	vkDestroyFence(app->device, ctx.fence, NULL);
+	vkDestroyCommandPool(app->device, commandPool, NULL);
+	return result;
+}
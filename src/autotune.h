@@ -0,0 +1,60 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "pipeline_manager.h"
+
+// Workgroup size autotuner for 2D image compute passes (--autotune)
+// - a pass is a registered compute pipeline that takes its workgroup size from constant_id 0 and
+//   1 (pipeline_manager.h), plus callbacks that point it at a storage image and bind its state
+// - autotune_run sweeps every shape in the candidate list that the device allows, at every
+//   image size, as pipeline_variant specializations; each is timed with timestamp queries over
+//   dependent dispatches and the fastest shape per size is kept
+// - results go to AUTOTUNE_PATH as text, one line per device (vendor:device id), pass and size;
+//   other devices' lines are kept, so one file serves every GPU it has been run on
+// - autotune_load reads the lines for this device at startup and autotune_best picks the shape
+//   tuned at the size closest to the one asked for
+
+#define AUTOTUNE_PATH "autotune.txt"
+#define AUTOTUNE_MAX_RESULTS 128
+#define AUTOTUNE_DEFAULT_ITERATIONS 32
+#define AUTOTUNE_REPEATS 3 // submissions per shape and size, the fastest counts
+
+typedef struct AutotunePass
+{
+	const char* name;
+	PipelineHandle base; // its specialization constants are kept, 0 and 1 replaced per shape
+	VkFormat format;     // of the storage image the pass writes
+	void* user;
+	// before recording: point the pass's descriptors at target (GENERAL layout)
+	void (*prepare)(void* user, VkImageView target, u32 width, u32 height);
+	// while recording, before the dispatch: bind descriptor sets, push constants
+	void (*bind)(void* user, VkCommandBuffer cmd);
+} AutotunePass;
+
+typedef struct AutotuneResult
+{
+	u32 vendorID;
+	u32 deviceID;
+	char pass[32];
+	u32 width;
+	u32 height;
+	u32 localSize[2];
+	float ms; // per dispatch
+} AutotuneResult;
+
+typedef struct AutotuneTable
+{
+	AutotuneResult results[AUTOTUNE_MAX_RESULTS];
+	u32 count;
+} AutotuneTable;
+
+// Lines of path for this device; an empty table when there is no file
+void autotune_load(AutotuneTable* table, const char* path, VkPhysicalDevice physicalDevice);
+// Shape tuned for pass at the size closest to width x height (by pixel count); false if untuned
+bool autotune_best(const AutotuneTable* table, const char* pass, u32 width, u32 height, u32 localSize[2]);
+
+// Sweeps shapes and sizes for every pass, prints a table per pass and rewrites path with this
+// device's results replaced. Returns 0 on success.
+int autotune_run(const Application* app, PipelineManager* pipelines, const AutotunePass* passes, u32 passCount, u32 iterations, const char* path);
+
+#endif // AUTOTUNE_H
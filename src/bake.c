@@ -0,0 +1,481 @@
+// Offline asset bake tool (build/bake)
+//   bake texture <in.png|jpg|tga> <out.dds> [bc1|bc3|bc5|bc7] [--linear] [--normal] [--threads N]
+//   bake mesh <in.gltf|glb> <out.mesh>
+// Output is deterministic for a given input and options so it can be cached by content hash.
+#include "bc_encode.h"
+#include "mesh_bake.h"
+#include <math.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../external/stb/stb_image.h"
+#define CGLTF_IMPLEMENTATION
+#include "../external/cgltf/cgltf.h"
+
+// --- Mip generation ---
+
+// 2:1 decimation, separable, 6 taps at +-0.5, +-1.5, +-2.5 source texels around each destination
+// texel. The weights are Lanczos-3 evaluated in destination texels (+-0.25, +-0.75, +-1.25): the
+// main lobe plus the start of the first negative one, truncated there and renormalized, so the
+// outer taps are slightly negative and results are clamped to [0, 1]. sRGB colour is filtered in
+// linear light; alpha is filtered as stored (not premultiplied). Sharper than a box, less aliasing.
+#define MIP_TAPS 6
+
+static void mip_kernel(float weights[MIP_TAPS])
+{
+	float sum = 0.0f;
+	for (int i = 0; i < MIP_TAPS; ++i)
+	{
+		double x = ((double)i - 2.5) / 2.0; // distance in destination texels
+		double w = 1.0;
+		if (x != 0.0)
+		{
+			double px = 3.14159265358979323846 * x;
+			w = (sin(px) / px) * (sin(px / 3.0) / (px / 3.0));
+		}
+		weights[i] = (float)w;
+		sum += weights[i];
+	}
+	for (int i = 0; i < MIP_TAPS; ++i)
+		weights[i] /= sum;
+}
+
+static float srgb_to_linear(float c)
+{
+	return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_srgb(float c)
+{
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// src: w x h RGBA float, dst: max(1,w/2) x max(1,h/2)
+static void downsample(const float* src, u32 w, u32 h, float* dst, const float weights[MIP_TAPS])
+{
+	u32 dw = MAX(w / 2, 1u), dh = MAX(h / 2, 1u);
+	float* tmp = malloc((size_t)dw * h * 4 * sizeof(float));
+
+	// horizontal
+	for (u32 y = 0; y < h; ++y)
+	{
+		for (u32 x = 0; x < dw; ++x)
+		{
+			float acc[4] = {0};
+			for (int t = 0; t < MIP_TAPS; ++t)
+			{
+				i32 sx = (i32)(x * 2) + t - 2;
+				sx = w == 1 ? 0 : CLAMP(sx, 0, (i32)w - 1);
+				for (u32 c = 0; c < 4; ++c)
+					acc[c] += weights[t] * src[((size_t)y * w + (u32)sx) * 4 + c];
+			}
+			memcpy(&tmp[((size_t)y * dw + x) * 4], acc, sizeof(acc));
+		}
+	}
+	// vertical
+	for (u32 y = 0; y < dh; ++y)
+	{
+		for (u32 x = 0; x < dw; ++x)
+		{
+			float acc[4] = {0};
+			for (int t = 0; t < MIP_TAPS; ++t)
+			{
+				i32 sy = (i32)(y * 2) + t - 2;
+				sy = h == 1 ? 0 : CLAMP(sy, 0, (i32)h - 1);
+				for (u32 c = 0; c < 4; ++c)
+					acc[c] += weights[t] * tmp[((size_t)sy * dw + x) * 4 + c];
+			}
+			for (u32 c = 0; c < 4; ++c)
+				dst[((size_t)y * dw + x) * 4 + c] = CLAMP(acc[c], 0.0f, 1.0f);
+		}
+	}
+	free(tmp);
+}
+
+static void float_to_rgba8(const float* src, u32 count, bool srgb, bool normal, u8* dst)
+{
+	for (u32 i = 0; i < count; ++i)
+	{
+		float v[4] = {src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2], src[i * 4 + 3]};
+		if (normal)
+		{
+			// filtered normals shrink, push them back onto the unit sphere
+			float x = v[0] * 2.0f - 1.0f, y = v[1] * 2.0f - 1.0f, z = v[2] * 2.0f - 1.0f;
+			float len = sqrtf(x * x + y * y + z * z);
+			if (len > 1e-6f)
+			{
+				v[0] = (x / len) * 0.5f + 0.5f;
+				v[1] = (y / len) * 0.5f + 0.5f;
+				v[2] = (z / len) * 0.5f + 0.5f;
+			}
+		}
+		for (u32 c = 0; c < 4; ++c)
+		{
+			float f = (srgb && c < 3) ? linear_to_srgb(v[c]) : v[c];
+			dst[i * 4 + c] = (u8)(CLAMP(f, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+}
+
+// --- DDS output (DX10 header so sRGB and BC7 are expressible; dds-ktx reads it in place) ---
+
+enum
+{
+	DXGI_FORMAT_BC1_UNORM = 71,
+	DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+	DXGI_FORMAT_BC3_UNORM = 77,
+	DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+	DXGI_FORMAT_BC5_UNORM = 83,
+	DXGI_FORMAT_BC7_UNORM = 98,
+	DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+};
+
+static u32 dxgi_format(BcFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BC_FORMAT_BC1:
+		return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case BC_FORMAT_BC3:
+		return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case BC_FORMAT_BC5:
+		return DXGI_FORMAT_BC5_UNORM;
+	case BC_FORMAT_BC7:
+	default:
+		return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	}
+}
+
+static void write_u32(FILE* f, u32 v)
+{
+	u8 b[4] = {(u8)v, (u8)(v >> 8), (u8)(v >> 16), (u8)(v >> 24)};
+	fwrite(b, 1, 4, f);
+}
+
+static void write_dds_header(FILE* f, BcFormat format, bool srgb, u32 width, u32 height, u32 mipCount)
+{
+	fwrite("DDS ", 1, 4, f);
+	// DDS_HEADER
+	write_u32(f, 124);
+	write_u32(f, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000); // CAPS|HEIGHT|WIDTH|PIXELFORMAT|MIPMAPCOUNT|LINEARSIZE
+	write_u32(f, height);
+	write_u32(f, width);
+	write_u32(f, (u32)bc_compressed_size(format, width, height));
+	write_u32(f, 0); // depth
+	write_u32(f, mipCount);
+	for (int i = 0; i < 11; ++i)
+		write_u32(f, 0);
+	// DDS_PIXELFORMAT
+	write_u32(f, 32);
+	write_u32(f, 0x4); // DDPF_FOURCC
+	fwrite("DX10", 1, 4, f);
+	for (int i = 0; i < 5; ++i)
+		write_u32(f, 0);
+	write_u32(f, 0x1000 | 0x400000 | 0x8); // TEXTURE|MIPMAP|COMPLEX
+	for (int i = 0; i < 4; ++i)
+		write_u32(f, 0);
+	// DDS_HEADER_DXT10
+	write_u32(f, dxgi_format(format, srgb));
+	write_u32(f, 3); // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+	write_u32(f, 0);
+	write_u32(f, 1); // array size
+	write_u32(f, 0);
+}
+
+static int bake_texture(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: bake texture <in> <out.dds> [bc1|bc3|bc5|bc7] [--linear] [--normal] [--threads N]\n");
+		return 1;
+	}
+	const char* inPath = argv[0];
+	const char* outPath = argv[1];
+	BcFormat format = BC_FORMAT_BC7;
+	bool srgb = true, normal = false;
+	u32 threads = 0;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "bc1") == 0)
+			format = BC_FORMAT_BC1;
+		else if (strcmp(argv[i], "bc3") == 0)
+			format = BC_FORMAT_BC3;
+		else if (strcmp(argv[i], "bc5") == 0)
+			format = BC_FORMAT_BC5;
+		else if (strcmp(argv[i], "bc7") == 0)
+			format = BC_FORMAT_BC7;
+		else if (strcmp(argv[i], "--linear") == 0)
+			srgb = false;
+		else if (strcmp(argv[i], "--normal") == 0)
+			normal = true;
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = (u32)atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "[Bake] unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (format == BC_FORMAT_BC5 || normal)
+		srgb = false; // data textures are never sRGB
+
+	int w, h, n;
+	stbi_uc* pixels = stbi_load(inPath, &w, &h, &n, 4);
+	if (!pixels)
+	{
+		fprintf(stderr, "[Bake] %s: %s\n", inPath, stbi_failure_reason());
+		return 1;
+	}
+	// BC1 has at best 1-bit alpha: anything with real alpha keeps it in BC3 instead. The mips
+	// are normalized filters of the top level, so an opaque top level stays opaque.
+	if (format == BC_FORMAT_BC1)
+	{
+		for (size_t i = 3; i < (size_t)w * h * 4; i += 4)
+		{
+			if (pixels[i] != 255)
+			{
+				printf("[Bake] %s has alpha, writing BC3 instead of BC1\n", inPath);
+				format = BC_FORMAT_BC3;
+				break;
+			}
+		}
+	}
+
+	u32 mipCount = 1;
+	while (((u32)w >> mipCount) || ((u32)h >> mipCount))
+		mipCount++;
+
+	float* level = malloc((size_t)w * h * 4 * sizeof(float));
+	for (size_t i = 0; i < (size_t)w * h * 4; ++i)
+	{
+		float c = pixels[i] / 255.0f;
+		level[i] = (srgb && (i & 3) != 3) ? srgb_to_linear(c) : c;
+	}
+	stbi_image_free(pixels);
+
+	FILE* f = fopen(outPath, "wb");
+	if (!f)
+	{
+		fprintf(stderr, "[Bake] cannot write %s\n", outPath);
+		free(level);
+		return 1;
+	}
+	write_dds_header(f, format, srgb, (u32)w, (u32)h, mipCount);
+
+	float weights[MIP_TAPS];
+	mip_kernel(weights);
+	u32 mw = (u32)w, mh = (u32)h;
+	u8* rgba = malloc((size_t)mw * mh * 4);
+	u8* blocks = malloc(bc_compressed_size(format, mw, mh));
+	size_t totalBytes = 0;
+	for (u32 m = 0; m < mipCount; ++m)
+	{
+		float_to_rgba8(level, mw * mh, srgb, normal, rgba);
+		bc_compress_image(format, rgba, mw, mh, blocks, threads);
+		size_t bytes = bc_compressed_size(format, mw, mh);
+		fwrite(blocks, 1, bytes, f);
+		totalBytes += bytes;
+
+		if (m + 1 < mipCount)
+		{
+			u32 nw = MAX(mw / 2, 1u), nh = MAX(mh / 2, 1u);
+			float* next = malloc((size_t)nw * nh * 4 * sizeof(float));
+			downsample(level, mw, mh, next, weights);
+			free(level);
+			level = next;
+			mw = nw;
+			mh = nh;
+		}
+	}
+	fclose(f);
+	free(level);
+	free(rgba);
+	free(blocks);
+
+	static const char* names[BC_FORMAT_COUNT] = {"BC1", "BC3", "BC5", "BC7"};
+	size_t rawBytes = (size_t)w * h * 4 * 4 / 3;
+	printf("[Bake] %s -> %s: %dx%d, %u mips, %s%s, %zu KB (%.1fx smaller than RGBA8)\n",
+	    inPath, outPath, w, h, mipCount, names[format], srgb ? " sRGB" : "",
+	    totalBytes / 1024, (double)rawBytes / (double)totalBytes);
+	return 0;
+}
+
+// --- Meshes ---
+
+static const cgltf_accessor* find_attribute(const cgltf_primitive* prim, cgltf_attribute_type type)
+{
+	for (cgltf_size i = 0; i < prim->attributes_count; ++i)
+	{
+		if (prim->attributes[i].type == type && prim->attributes[i].index == 0)
+			return prim->attributes[i].data;
+	}
+	return NULL;
+}
+
+// Flattens every triangle primitive of every node into one vertex/index list in world space
+static bool gather_gltf(const cgltf_data* data, MeshVertex** outVertices, size_t* outVertexCount, u32** outIndices, size_t* outIndexCount)
+{
+	size_t vertexCount = 0, indexCount = 0;
+	for (cgltf_size n = 0; n < data->nodes_count; ++n)
+	{
+		const cgltf_mesh* mesh = data->nodes[n].mesh;
+		if (!mesh)
+			continue;
+		for (cgltf_size p = 0; p < mesh->primitives_count; ++p)
+		{
+			const cgltf_primitive* prim = &mesh->primitives[p];
+			const cgltf_accessor* pos = find_attribute(prim, cgltf_attribute_type_position);
+			if (prim->type != cgltf_primitive_type_triangles || !pos)
+				continue;
+			vertexCount += pos->count;
+			indexCount += prim->indices ? prim->indices->count : pos->count;
+		}
+	}
+	if (indexCount == 0)
+		return false;
+
+	MeshVertex* vertices = calloc(vertexCount, sizeof(MeshVertex));
+	u32* indices = malloc(indexCount * sizeof(u32));
+	size_t vbase = 0, ibase = 0;
+	for (cgltf_size n = 0; n < data->nodes_count; ++n)
+	{
+		const cgltf_node* node = &data->nodes[n];
+		if (!node->mesh)
+			continue;
+		float m[16]; // column major
+		cgltf_node_transform_world(node, m);
+
+		for (cgltf_size p = 0; p < node->mesh->primitives_count; ++p)
+		{
+			const cgltf_primitive* prim = &node->mesh->primitives[p];
+			const cgltf_accessor* pos = find_attribute(prim, cgltf_attribute_type_position);
+			if (prim->type != cgltf_primitive_type_triangles || !pos)
+				continue;
+			const cgltf_accessor* nrm = find_attribute(prim, cgltf_attribute_type_normal);
+			const cgltf_accessor* uv = find_attribute(prim, cgltf_attribute_type_texcoord);
+
+			for (cgltf_size i = 0; i < pos->count; ++i)
+			{
+				MeshVertex* v = &vertices[vbase + i];
+				float p3[3] = {0}, n3[3] = {0, 0, 1};
+				cgltf_accessor_read_float(pos, i, p3, 3);
+				if (nrm)
+					cgltf_accessor_read_float(nrm, i, n3, 3);
+				if (uv)
+					cgltf_accessor_read_float(uv, i, v->uv, 2);
+				for (u32 r = 0; r < 3; ++r)
+				{
+					v->position[r] = m[r] * p3[0] + m[4 + r] * p3[1] + m[8 + r] * p3[2] + m[12 + r];
+					// upper 3x3 then renormalise, fine as long as scales are close to uniform
+					v->normal[r] = m[r] * n3[0] + m[4 + r] * n3[1] + m[8 + r] * n3[2];
+				}
+				float len = sqrtf(v->normal[0] * v->normal[0] + v->normal[1] * v->normal[1] + v->normal[2] * v->normal[2]);
+				for (u32 r = 0; r < 3; ++r)
+					v->normal[r] = len > 0.0f ? v->normal[r] / len : 0.0f;
+			}
+
+			size_t count = prim->indices ? prim->indices->count : pos->count;
+			for (size_t i = 0; i < count; ++i)
+				indices[ibase + i] = (u32)vbase + (prim->indices ? (u32)cgltf_accessor_read_index(prim->indices, i) : (u32)i);
+			vbase += pos->count;
+			ibase += count;
+		}
+	}
+
+	*outVertices = vertices;
+	*outVertexCount = vertexCount;
+	*outIndices = indices;
+	*outIndexCount = indexCount;
+	return true;
+}
+
+static int bake_mesh(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: bake mesh <in.gltf|glb> <out.mesh>\n");
+		return 1;
+	}
+	const char* inPath = argv[0];
+	const char* outPath = argv[1];
+
+	cgltf_options options = {0};
+	cgltf_data* data = NULL;
+	if (cgltf_parse_file(&options, inPath, &data) != cgltf_result_success || cgltf_load_buffers(&options, data, inPath) != cgltf_result_success)
+	{
+		fprintf(stderr, "[Bake] failed to load %s\n", inPath);
+		cgltf_free(data);
+		return 1;
+	}
+
+	MeshVertex* vertices;
+	u32* indices;
+	size_t vertexCount, indexCount;
+	bool ok = gather_gltf(data, &vertices, &vertexCount, &indices, &indexCount);
+	cgltf_free(data);
+	if (!ok)
+	{
+		fprintf(stderr, "[Bake] %s has no triangle meshes\n", inPath);
+		return 1;
+	}
+
+	float acmrBefore = mesh_acmr(indices, indexCount, vertexCount, 16);
+	mesh_optimize_vertex_cache(indices, indexCount, vertexCount);
+	float acmrAfter = mesh_acmr(indices, indexCount, vertexCount, 16);
+	size_t usedVertices = mesh_optimize_vertex_fetch(vertices, vertexCount, indices, indexCount);
+
+	MeshFileHeader header = {
+	    .magic = MESH_FILE_MAGIC,
+	    .vertexCount = (u32)usedVertices,
+	    .indexCount = (u32)indexCount,
+	    .indexSize = usedVertices <= 65536 ? 2 : 4,
+	    .quantization = mesh_compute_quantization(vertices, usedVertices),
+	};
+	QuantizedVertex* quantized = malloc(usedVertices * sizeof(QuantizedVertex));
+	mesh_quantize(vertices, usedVertices, &header.quantization, quantized);
+
+	FILE* f = fopen(outPath, "wb");
+	if (!f)
+	{
+		fprintf(stderr, "[Bake] cannot write %s\n", outPath);
+		free(quantized);
+		free(vertices);
+		free(indices);
+		return 1;
+	}
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(quantized, sizeof(QuantizedVertex), usedVertices, f);
+	if (header.indexSize == 2)
+	{
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			u16 index = (u16)indices[i];
+			fwrite(&index, sizeof(index), 1, f);
+		}
+	}
+	else
+	{
+		fwrite(indices, sizeof(u32), indexCount, f);
+	}
+	fclose(f);
+
+	printf("[Bake] %s -> %s: %zu vertices (%zu unused dropped), %zu triangles, ACMR %.3f -> %.3f, vertex data %zu KB (was %zu KB)\n",
+	    inPath, outPath, usedVertices, vertexCount - usedVertices, indexCount / 3, acmrBefore, acmrAfter,
+	    usedVertices * sizeof(QuantizedVertex) / 1024, usedVertices * sizeof(MeshVertex) / 1024);
+	free(quantized);
+	free(vertices);
+	free(indices);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "texture") == 0)
+		return bake_texture(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "mesh") == 0)
+		return bake_mesh(argc - 2, argv + 2);
+
+	fprintf(stderr, "usage: bake texture <in> <out.dds> [bc1|bc3|bc5|bc7] [--linear] [--normal] [--threads N]\n");
+	fprintf(stderr, "       bake mesh <in.gltf|glb> <out.mesh>\n");
+	return 1;
+}
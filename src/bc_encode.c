@@ -0,0 +1,556 @@
+#include "bc_encode.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+u32 bc_block_bytes(BcFormat format)
+{
+	return format == BC_FORMAT_BC1 ? 8u : 16u;
+}
+
+size_t bc_compressed_size(BcFormat format, u32 width, u32 height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bc_block_bytes(format);
+}
+
+// --- Index assignment (the hot loop, SIMD) ---
+
+// For each of the 16 pixels pick the palette entry with the smallest squared RGBA distance.
+// Ties go to the lower index in both paths. Returns the summed error.
+static u32 assign_indices(const u8 px[64], const i32 palette[][4], u32 paletteCount, u8 indices[16])
+{
+#if defined(__SSE2__)
+	__m128i bestDist[4], bestIdx[4];
+	__m128i zero = _mm_setzero_si128();
+	__m128i pix[4][2];
+	for (u32 g = 0; g < 4; ++g)
+	{
+		__m128i p = _mm_loadu_si128((const __m128i*)(px + g * 16));
+		pix[g][0] = _mm_unpacklo_epi8(p, zero); // pixels 4g+0, 4g+1 as i16
+		pix[g][1] = _mm_unpackhi_epi8(p, zero); // pixels 4g+2, 4g+3
+		bestDist[g] = _mm_set1_epi32(INT32_MAX);
+		bestIdx[g] = zero;
+	}
+	for (u32 i = 0; i < paletteCount; ++i)
+	{
+		__m128i pal = _mm_setr_epi16((i16)palette[i][0], (i16)palette[i][1], (i16)palette[i][2], (i16)palette[i][3],
+		    (i16)palette[i][0], (i16)palette[i][1], (i16)palette[i][2], (i16)palette[i][3]);
+		__m128i idx = _mm_set1_epi32((int)i);
+		for (u32 g = 0; g < 4; ++g)
+		{
+			__m128i dlo = _mm_sub_epi16(pix[g][0], pal);
+			__m128i dhi = _mm_sub_epi16(pix[g][1], pal);
+			dlo = _mm_madd_epi16(dlo, dlo); // [r2+g2, b2+a2] per pixel
+			dhi = _mm_madd_epi16(dhi, dhi);
+			dlo = _mm_add_epi32(dlo, _mm_shuffle_epi32(dlo, _MM_SHUFFLE(2, 3, 0, 1)));
+			dhi = _mm_add_epi32(dhi, _mm_shuffle_epi32(dhi, _MM_SHUFFLE(2, 3, 0, 1)));
+			dlo = _mm_shuffle_epi32(dlo, _MM_SHUFFLE(3, 1, 2, 0));
+			dhi = _mm_shuffle_epi32(dhi, _MM_SHUFFLE(3, 1, 2, 0));
+			__m128i dist = _mm_unpacklo_epi64(dlo, dhi);
+			__m128i better = _mm_cmplt_epi32(dist, bestDist[g]);
+			bestDist[g] = _mm_or_si128(_mm_and_si128(better, dist), _mm_andnot_si128(better, bestDist[g]));
+			bestIdx[g] = _mm_or_si128(_mm_and_si128(better, idx), _mm_andnot_si128(better, bestIdx[g]));
+		}
+	}
+	u32 total = 0;
+	for (u32 g = 0; g < 4; ++g)
+	{
+		i32 d[4], ix[4];
+		_mm_storeu_si128((__m128i*)d, bestDist[g]);
+		_mm_storeu_si128((__m128i*)ix, bestIdx[g]);
+		for (u32 k = 0; k < 4; ++k)
+		{
+			indices[g * 4 + k] = (u8)ix[k];
+			total += (u32)d[k];
+		}
+	}
+	return total;
+#else
+	u32 total = 0;
+	for (u32 p = 0; p < 16; ++p)
+	{
+		i32 best = INT32_MAX;
+		u8 bestIndex = 0;
+		for (u32 i = 0; i < paletteCount; ++i)
+		{
+			i32 dr = px[p * 4 + 0] - palette[i][0];
+			i32 dg = px[p * 4 + 1] - palette[i][1];
+			i32 db = px[p * 4 + 2] - palette[i][2];
+			i32 da = px[p * 4 + 3] - palette[i][3];
+			i32 d = dr * dr + dg * dg + db * db + da * da;
+			if (d < best)
+			{
+				best = d;
+				bestIndex = (u8)i;
+			}
+		}
+		indices[p] = bestIndex;
+		total += (u32)best;
+	}
+	return total;
+#endif
+}
+
+// --- Endpoint fitting (scalar float, identical on every path) ---
+
+// Principal axis of the block through power iteration; dims is 3 (RGB) or 4 (RGBA)
+static void principal_axis(const u8 px[64], u32 dims, float mean[4], float axis[4])
+{
+	float cov[4][4] = {{0}};
+	for (u32 c = 0; c < 4; ++c)
+	{
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+	}
+	for (u32 p = 0; p < 16; ++p)
+		for (u32 c = 0; c < dims; ++c)
+			mean[c] += px[p * 4 + c];
+	for (u32 c = 0; c < dims; ++c)
+		mean[c] /= 16.0f;
+
+	for (u32 p = 0; p < 16; ++p)
+	{
+		float d[4];
+		for (u32 c = 0; c < dims; ++c)
+			d[c] = px[p * 4 + c] - mean[c];
+		for (u32 a = 0; a < dims; ++a)
+			for (u32 b = 0; b < dims; ++b)
+				cov[a][b] += d[a] * d[b];
+	}
+
+	float v[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+	for (u32 it = 0; it < 8; ++it)
+	{
+		float r[4] = {0};
+		float len = 0.0f;
+		for (u32 a = 0; a < dims; ++a)
+		{
+			for (u32 b = 0; b < dims; ++b)
+				r[a] += cov[a][b] * v[b];
+			len += r[a] * r[a];
+		}
+		if (len < 1e-12f)
+			break; // flat block, keep the previous guess
+		len = 1.0f / sqrtf(len);
+		for (u32 a = 0; a < dims; ++a)
+			v[a] = r[a] * len;
+	}
+	float len = 0.0f;
+	for (u32 a = 0; a < dims; ++a)
+		len += v[a] * v[a];
+	len = 1.0f / sqrtf(len);
+	for (u32 a = 0; a < dims; ++a)
+		axis[a] = v[a] * len;
+}
+
+// Endpoints along the principal axis, shrunk by `inset` of the range at both ends
+static void fit_endpoints(const u8 px[64], u32 dims, float inset, float e0[4], float e1[4])
+{
+	float mean[4], axis[4];
+	principal_axis(px, dims, mean, axis);
+
+	float tmin = 1e30f, tmax = -1e30f;
+	for (u32 p = 0; p < 16; ++p)
+	{
+		float t = 0.0f;
+		for (u32 c = 0; c < dims; ++c)
+			t += (px[p * 4 + c] - mean[c]) * axis[c];
+		tmin = MIN(tmin, t);
+		tmax = MAX(tmax, t);
+	}
+	float shrink = (tmax - tmin) * inset;
+	tmin += shrink;
+	tmax -= shrink;
+	for (u32 c = 0; c < 4; ++c)
+	{
+		e0[c] = c < dims ? CLAMP(mean[c] + axis[c] * tmax, 0.0f, 255.0f) : 0.0f;
+		e1[c] = c < dims ? CLAMP(mean[c] + axis[c] * tmin, 0.0f, 255.0f) : 0.0f;
+	}
+}
+
+// Least squares endpoints for fixed interpolation weights (weights[i] / weightScale along e0->e1)
+static bool refit_endpoints(const u8 px[64], u32 dims, const u8 indices[16], const i32* weights, float weightScale,
+    float e0[4], float e1[4])
+{
+	float a = 0.0f, b = 0.0f, c = 0.0f;
+	float x0[4] = {0}, x1[4] = {0};
+	for (u32 p = 0; p < 16; ++p)
+	{
+		float w = weights[indices[p]] / weightScale;
+		float iw = 1.0f - w;
+		a += iw * iw;
+		b += iw * w;
+		c += w * w;
+		for (u32 ch = 0; ch < dims; ++ch)
+		{
+			x0[ch] += iw * px[p * 4 + ch];
+			x1[ch] += w * px[p * 4 + ch];
+		}
+	}
+	float det = a * c - b * b;
+	if (fabsf(det) < 1e-6f)
+		return false;
+	float inv = 1.0f / det;
+	for (u32 ch = 0; ch < dims; ++ch)
+	{
+		e0[ch] = CLAMP((c * x0[ch] - b * x1[ch]) * inv, 0.0f, 255.0f);
+		e1[ch] = CLAMP((a * x1[ch] - b * x0[ch]) * inv, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+// --- BC1 ---
+
+static u16 pack565(const float c[4])
+{
+	u32 r = (u32)((c[0] * 31.0f) / 255.0f + 0.5f);
+	u32 g = (u32)((c[1] * 63.0f) / 255.0f + 0.5f);
+	u32 b = (u32)((c[2] * 31.0f) / 255.0f + 0.5f);
+	return (u16)((r << 11) | (g << 5) | b);
+}
+
+static void unpack565(u16 v, i32 out[4])
+{
+	i32 r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	out[0] = (r << 3) | (r >> 2);
+	out[1] = (g << 2) | (g >> 4);
+	out[2] = (b << 3) | (b >> 2);
+	out[3] = 0;
+}
+
+static const i32 bc1_weights[4] = {0, 3, 1, 2}; // palette order c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+
+static u32 bc1_evaluate(const u8 px[64], u16 c0, u16 c1, u8 indices[16])
+{
+	i32 palette[4][4];
+	unpack565(c0, palette[0]);
+	unpack565(c1, palette[1]);
+	for (u32 ch = 0; ch < 3; ++ch)
+	{
+		palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+		palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+	}
+	palette[2][3] = palette[3][3] = 0;
+	return assign_indices(px, (const i32(*)[4])palette, 4, indices);
+}
+
+void bc1_encode_block(const u8 rgba[64], u8 out[8])
+{
+	// alpha does not take part in BC1 color fitting
+	u8 px[64];
+	for (u32 p = 0; p < 16; ++p)
+	{
+		px[p * 4 + 0] = rgba[p * 4 + 0];
+		px[p * 4 + 1] = rgba[p * 4 + 1];
+		px[p * 4 + 2] = rgba[p * 4 + 2];
+		px[p * 4 + 3] = 0;
+	}
+
+	float e0[4], e1[4];
+	fit_endpoints(px, 3, 1.0f / 16.0f, e0, e1);
+	u16 c0 = pack565(e0), c1 = pack565(e1);
+	u8 indices[16];
+	u32 err = bc1_evaluate(px, c0, c1, indices);
+
+	// One least squares pass on the chosen indices, keep it only if it is better
+	if (c0 != c1 && refit_endpoints(px, 3, indices, bc1_weights, 3.0f, e0, e1))
+	{
+		u16 r0 = pack565(e0), r1 = pack565(e1);
+		u8 refined[16];
+		u32 refinedErr = bc1_evaluate(px, r0, r1, refined);
+		if (refinedErr < err)
+		{
+			c0 = r0;
+			c1 = r1;
+			err = refinedErr;
+			memcpy(indices, refined, 16);
+		}
+	}
+
+	// 4 color mode needs c0 > c1
+	if (c0 < c1)
+	{
+		SWAP(c0, c1);
+		for (u32 p = 0; p < 16; ++p)
+			indices[p] ^= 1; // 0<->1, 2<->3
+	}
+	else if (c0 == c1)
+	{
+		memset(indices, 0, 16);
+	}
+
+	u32 bits = 0;
+	for (u32 p = 0; p < 16; ++p)
+		bits |= (u32)indices[p] << (p * 2);
+	out[0] = (u8)(c0 & 0xFF);
+	out[1] = (u8)(c0 >> 8);
+	out[2] = (u8)(c1 & 0xFF);
+	out[3] = (u8)(c1 >> 8);
+	out[4] = (u8)(bits & 0xFF);
+	out[5] = (u8)((bits >> 8) & 0xFF);
+	out[6] = (u8)((bits >> 16) & 0xFF);
+	out[7] = (u8)(bits >> 24);
+}
+
+// --- BC4 (single channel, 8 value mode) ---
+
+void bc4_encode_block(const u8 rgba[64], u32 channel, u8 out[8])
+{
+	i32 lo = 255, hi = 0;
+	for (u32 p = 0; p < 16; ++p)
+	{
+		i32 v = rgba[p * 4 + channel];
+		lo = MIN(lo, v);
+		hi = MAX(hi, v);
+	}
+
+	i32 palette[8];
+	palette[0] = hi;
+	palette[1] = lo;
+	for (i32 i = 2; i < 8; ++i)
+		palette[i] = ((8 - i) * hi + (i - 1) * lo + 3) / 7;
+
+	u64 bits = 0;
+	if (hi != lo)
+	{
+		for (u32 p = 0; p < 16; ++p)
+		{
+			i32 v = rgba[p * 4 + channel];
+			i32 best = INT32_MAX;
+			u64 bestIndex = 0;
+			for (u32 i = 0; i < 8; ++i)
+			{
+				i32 d = abs(v - palette[i]);
+				if (d < best)
+				{
+					best = d;
+					bestIndex = i;
+				}
+			}
+			bits |= bestIndex << (p * 3);
+		}
+	}
+
+	out[0] = (u8)hi;
+	out[1] = (u8)lo;
+	for (u32 i = 0; i < 6; ++i)
+		out[2 + i] = (u8)((bits >> (i * 8)) & 0xFF);
+}
+
+void bc3_encode_block(const u8 rgba[64], u8 out[16])
+{
+	bc4_encode_block(rgba, 3, out);
+	bc1_encode_block(rgba, out + 8);
+}
+
+void bc5_encode_block(const u8 rgba[64], u8 out[16])
+{
+	bc4_encode_block(rgba, 0, out);
+	bc4_encode_block(rgba, 1, out + 8);
+}
+
+// --- BC7 mode 6 ---
+
+static const i32 bc7_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// 7 bit endpoint + shared p-bit; picks the p-bit that reconstructs closest
+static void bc7_quantize_endpoint(const float e[4], u8 q[4], u8* pbit)
+{
+	float bestErr = 1e30f;
+	for (u32 p = 0; p < 2; ++p)
+	{
+		u8 cand[4];
+		float err = 0.0f;
+		for (u32 c = 0; c < 4; ++c)
+		{
+			i32 v = (i32)((e[c] - (float)p) / 2.0f + 0.5f);
+			v = CLAMP(v, 0, 127);
+			cand[c] = (u8)v;
+			float d = (float)((v << 1) | (i32)p) - e[c];
+			err += d * d;
+		}
+		if (err < bestErr)
+		{
+			bestErr = err;
+			memcpy(q, cand, 4);
+			*pbit = (u8)p;
+		}
+	}
+}
+
+static u32 bc7_evaluate(const u8 px[64], const u8 q0[4], u8 p0, const u8 q1[4], u8 p1, u8 indices[16])
+{
+	i32 palette[16][4];
+	for (u32 c = 0; c < 4; ++c)
+	{
+		i32 a = (q0[c] << 1) | p0;
+		i32 b = (q1[c] << 1) | p1;
+		for (u32 i = 0; i < 16; ++i)
+			palette[i][c] = ((64 - bc7_weights4[i]) * a + bc7_weights4[i] * b + 32) >> 6;
+	}
+	return assign_indices(px, (const i32(*)[4])palette, 16, indices);
+}
+
+typedef struct BitWriter
+{
+	u8* out;
+	u32 pos;
+} BitWriter;
+
+static void put_bits(BitWriter* w, u32 value, u32 count)
+{
+	for (u32 i = 0; i < count; ++i, ++w->pos)
+	{
+		if ((value >> i) & 1)
+			w->out[w->pos >> 3] |= (u8)(1u << (w->pos & 7));
+	}
+}
+
+void bc7_encode_block(const u8 rgba[64], u8 out[16])
+{
+	float e0[4], e1[4];
+	fit_endpoints(rgba, 4, 0.0f, e0, e1);
+
+	u8 q0[4], q1[4], p0, p1;
+	bc7_quantize_endpoint(e0, q0, &p0);
+	bc7_quantize_endpoint(e1, q1, &p1);
+	u8 indices[16];
+	u32 err = bc7_evaluate(rgba, q0, p0, q1, p1, indices);
+
+	if (err > 0 && refit_endpoints(rgba, 4, indices, bc7_weights4, 64.0f, e0, e1))
+	{
+		u8 r0[4], r1[4], rp0, rp1;
+		bc7_quantize_endpoint(e0, r0, &rp0);
+		bc7_quantize_endpoint(e1, r1, &rp1);
+		u8 refined[16];
+		u32 refinedErr = bc7_evaluate(rgba, r0, rp0, r1, rp1, refined);
+		if (refinedErr < err)
+		{
+			memcpy(q0, r0, 4);
+			memcpy(q1, r1, 4);
+			p0 = rp0;
+			p1 = rp1;
+			memcpy(indices, refined, 16);
+		}
+	}
+
+	// Anchor index (pixel 0) is stored with 3 bits, its MSB must be zero
+	if (indices[0] & 8)
+	{
+		u8 t[4];
+		memcpy(t, q0, 4);
+		memcpy(q0, q1, 4);
+		memcpy(q1, t, 4);
+		SWAP(p0, p1);
+		for (u32 p = 0; p < 16; ++p)
+			indices[p] = (u8)(15 - indices[p]);
+	}
+
+	memset(out, 0, 16);
+	BitWriter w = {out, 0};
+	put_bits(&w, 1u << 6, 7); // mode 6
+	for (u32 c = 0; c < 4; ++c)
+	{
+		put_bits(&w, q0[c], 7);
+		put_bits(&w, q1[c], 7);
+	}
+	put_bits(&w, p0, 1);
+	put_bits(&w, p1, 1);
+	put_bits(&w, indices[0], 3);
+	for (u32 p = 1; p < 16; ++p)
+		put_bits(&w, indices[p], 4);
+}
+
+void bc_encode_block(BcFormat format, const u8 rgba[64], u8* out)
+{
+	switch (format)
+	{
+	case BC_FORMAT_BC1:
+		bc1_encode_block(rgba, out);
+		break;
+	case BC_FORMAT_BC3:
+		bc3_encode_block(rgba, out);
+		break;
+	case BC_FORMAT_BC5:
+		bc5_encode_block(rgba, out);
+		break;
+	case BC_FORMAT_BC7:
+		bc7_encode_block(rgba, out);
+		break;
+	default:
+		assert(!"unknown BC format");
+	}
+}
+
+// --- Whole image, block rows split across threads ---
+
+typedef struct BcCompressJob
+{
+	BcFormat format;
+	const u8* rgba;
+	u32 width;
+	u32 height;
+	u8* out;
+	u32 firstRow;
+	u32 rowCount;
+} BcCompressJob;
+
+static void compress_rows(const BcCompressJob* job)
+{
+	u32 blocksX = (job->width + 3) / 4;
+	u32 blockBytes = bc_block_bytes(job->format);
+	u8 block[64];
+	for (u32 by = job->firstRow; by < job->firstRow + job->rowCount; ++by)
+	{
+		for (u32 bx = 0; bx < blocksX; ++bx)
+		{
+			for (u32 y = 0; y < 4; ++y)
+			{
+				u32 sy = MIN(by * 4 + y, job->height - 1);
+				for (u32 x = 0; x < 4; ++x)
+				{
+					u32 sx = MIN(bx * 4 + x, job->width - 1);
+					memcpy(block + (y * 4 + x) * 4, job->rgba + ((size_t)sy * job->width + sx) * 4, 4);
+				}
+			}
+			bc_encode_block(job->format, block, job->out + ((size_t)by * blocksX + bx) * blockBytes);
+		}
+	}
+}
+
+static void* compress_thread(void* arg)
+{
+	compress_rows((const BcCompressJob*)arg);
+	return NULL;
+}
+
+void bc_compress_image(BcFormat format, const u8* rgba, u32 width, u32 height, u8* out, u32 threadCount)
+{
+	u32 blocksY = (height + 3) / 4;
+	if (threadCount == 0)
+	{
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		threadCount = cores > 0 ? (u32)cores : 1;
+	}
+	threadCount = CLAMP(threadCount, 1u, MAX(blocksY, 1u));
+	threadCount = MIN(threadCount, 64u);
+
+	BcCompressJob jobs[64];
+	pthread_t threads[64];
+	for (u32 t = 0; t < threadCount; ++t)
+	{
+		u32 first = (u32)((u64)blocksY * t / threadCount);
+		u32 last = (u32)((u64)blocksY * (t + 1) / threadCount);
+		jobs[t] = (BcCompressJob){format, rgba, width, height, out, first, last - first};
+	}
+	// calling thread takes the first slice itself
+	for (u32 t = 1; t < threadCount; ++t)
+		pthread_create(&threads[t], NULL, compress_thread, &jobs[t]);
+	compress_rows(&jobs[0]);
+	for (u32 t = 1; t < threadCount; ++t)
+		pthread_join(threads[t], NULL);
+}
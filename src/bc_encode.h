@@ -0,0 +1,36 @@
+#ifndef BC_ENCODE_H
+#define BC_ENCODE_H
+
+#include "types.h"
+
+// CPU block compression for the bake step
+// - input is always RGBA8, 4x4 blocks, output matches the layout Vulkan/D3D expect
+// - all decisions are made with integer error metrics, the SSE2 and scalar paths pick the
+//   same indices so the output is bit-exact for caching no matter which path or thread count ran
+// - BC7 uses mode 6 only (one subset, RGBA, 4 bit indices): no partition search, but it is
+//   fast, deterministic and already much better than BC1/BC3 for color
+
+typedef enum BcFormat
+{
+	BC_FORMAT_BC1, // RGB(A1), 8 bytes/block
+	BC_FORMAT_BC3, // RGB + BC4 alpha, 16 bytes/block
+	BC_FORMAT_BC5, // two BC4 channels (RG), 16 bytes/block, for normal maps
+	BC_FORMAT_BC7, // RGBA mode 6, 16 bytes/block
+	BC_FORMAT_COUNT,
+} BcFormat;
+
+u32 bc_block_bytes(BcFormat format);
+size_t bc_compressed_size(BcFormat format, u32 width, u32 height);
+
+void bc1_encode_block(const u8 rgba[64], u8 out[8]);
+void bc4_encode_block(const u8 rgba[64], u32 channel, u8 out[8]);
+void bc3_encode_block(const u8 rgba[64], u8 out[16]);
+void bc5_encode_block(const u8 rgba[64], u8 out[16]);
+void bc7_encode_block(const u8 rgba[64], u8 out[16]);
+void bc_encode_block(BcFormat format, const u8 rgba[64], u8* out);
+
+// Compresses a whole RGBA8 image (edges clamp to fill partial blocks). Block rows are split
+// across threadCount threads (0 = one per core); the output does not depend on threadCount.
+void bc_compress_image(BcFormat format, const u8* rgba, u32 width, u32 height, u8* out, u32 threadCount);
+
+#endif // BC_ENCODE_H
@@ -0,0 +1,241 @@
+#include "bloom.h"
+#include <string.h>
+
+void bloom_init(Bloom* bloom, const Application* app, PipelineManager* pipelines, u32 mipCount)
+{
+	memset(bloom, 0, sizeof(*bloom));
+	bloom->device = app->device;
+	bloom->pipelines = pipelines;
+	bloom->mipCount = MIN(mipCount, (u32)BLOOM_MAX_MIPS);
+	bloom->strength = 0.04f;
+
+	// 0: source (sampled), 1: destination (storage), 2: composite base (sampled)
+	VkDescriptorSetLayoutBinding bindings[3];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = i == 1 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(bloom->device, &layoutInfo, NULL, &bloom->setLayout));
+
+	// one set per pass per frame in flight, rewritten every frame since the transient images move
+	// whenever the graph re-places them
+	const u32 setCount = MAX_FRAMES_IN_FLIGHT * BLOOM_MAX_PASSES;
+	VkDescriptorPoolSize poolSizes[] = {
+	    {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = setCount * 2},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = setCount},
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = setCount,
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
+	    .pPoolSizes = poolSizes,
+	};
+	VK_CHECK(vkCreateDescriptorPool(bloom->device, &poolInfo, NULL, &bloom->descriptorPool));
+	VkDescriptorSetLayout setLayouts[BLOOM_MAX_PASSES];
+	for (u32 i = 0; i < BLOOM_MAX_PASSES; ++i)
+		setLayouts[i] = bloom->setLayout;
+	for (u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; ++f)
+	{
+		VkDescriptorSetAllocateInfo allocInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		    .descriptorPool = bloom->descriptorPool,
+		    .descriptorSetCount = BLOOM_MAX_PASSES,
+		    .pSetLayouts = setLayouts,
+		};
+		VK_CHECK(vkAllocateDescriptorSets(bloom->device, &allocInfo, bloom->sets[f]));
+	}
+
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_LINEAR,
+	    .minFilter = VK_FILTER_LINEAR,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	};
+	VK_CHECK(vkCreateSampler(bloom->device, &samplerInfo, NULL, &bloom->sampler));
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(BloomPush),
+	};
+	bloom->pipelineLayout = createPipelineLayout(bloom->device, &bloom->setLayout, 1, &pcr, 1);
+	PipelineDesc desc = {
+	    .name = "bloom_down",
+	    .onDemand = bloom->mipCount == 0,
+	    .computeShader = "compiledshaders/bloom_down.comp.spv",
+	    .layout = bloom->pipelineLayout,
+	};
+	bloom->downPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "bloom_up";
+	desc.computeShader = "compiledshaders/bloom_up.comp.spv";
+	bloom->upPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "bloom_composite";
+	desc.computeShader = "compiledshaders/bloom_composite.comp.spv";
+	bloom->compositePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	bloom->timestampPeriod = props.limits.timestampComputeAndGraphics ? props.limits.timestampPeriod : 0.0f;
+	if (bloom->timestampPeriod > 0.0f)
+	{
+		VkQueryPoolCreateInfo queryInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+		    .queryCount = MAX_FRAMES_IN_FLIGHT * 2,
+		};
+		VK_CHECK(vkCreateQueryPool(bloom->device, &queryInfo, NULL, &bloom->timestamps));
+	}
+}
+
+void bloom_destroy(Bloom* bloom)
+{
+	if (bloom->timestamps)
+		vkDestroyQueryPool(bloom->device, bloom->timestamps, NULL);
+	vkDestroySampler(bloom->device, bloom->sampler, NULL);
+	vkDestroyPipelineLayout(bloom->device, bloom->pipelineLayout, NULL);
+	vkDestroyDescriptorPool(bloom->device, bloom->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(bloom->device, bloom->setLayout, NULL);
+}
+
+static void bloom_pass_execute(VkCommandBuffer cmd, void* data)
+{
+	BloomPass* pass = (BloomPass*)data;
+	Bloom* bloom = pass->bloom;
+	u32 firstQuery = bloom->frameIndex * 2;
+	bool last = pass->index == bloom->passCount - 1;
+
+	// COMPUTE_SHADER: starts once the producer of the source is done, ends when the composite is
+	if (pass->index == 0 && bloom->timestamps)
+	{
+		vkCmdResetQueryPool(cmd, bloom->timestamps, firstQuery, 2);
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, bloom->timestamps, firstQuery);
+	}
+
+	VkPipeline pipeline = pipeline_get(bloom->pipelines, pass->pipeline);
+	if (pipeline)
+	{
+		VkDescriptorSet set = bloom->sets[bloom->frameIndex][pass->index];
+		VkDescriptorImageInfo imageInfos[3] = {
+		    {bloom->sampler, render_graph_image_view(pass->graph, pass->src), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+		    {VK_NULL_HANDLE, render_graph_image_view(pass->graph, pass->dst), VK_IMAGE_LAYOUT_GENERAL},
+		    {bloom->sampler, last ? render_graph_image_view(pass->graph, pass->base) : VK_NULL_HANDLE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+		};
+		VkWriteDescriptorSet writes[3];
+		for (u32 i = 0; i < ARRAYSIZE(writes); ++i)
+		{
+			writes[i] = (VkWriteDescriptorSet){
+			    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			    .dstSet = set,
+			    .dstBinding = i,
+			    .descriptorCount = 1,
+			    .descriptorType = i == 1 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			    .pImageInfo = &imageInfos[i],
+			};
+		}
+		// binding 2 is only read by the composite
+		vkUpdateDescriptorSets(bloom->device, last ? 3 : 2, writes, 0, NULL);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, bloom->pipelineLayout, 0, 1, &set, 0, NULL);
+		vkCmdPushConstants(cmd, bloom->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BloomPush), &pass->push);
+		vkCmdDispatch(cmd, ((u32)pass->push.dstSize[0] + 7) / 8, ((u32)pass->push.dstSize[1] + 7) / 8, 1);
+	}
+
+	if (last && bloom->timestamps)
+	{
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, bloom->timestamps, firstQuery + 1);
+		bloom->timestampsWritten[bloom->frameIndex] = true;
+	}
+}
+
+static BloomPass* add_pass(Bloom* bloom, RenderGraph* graph, const char* name, PipelineHandle pipeline,
+    RenderGraphImage src, RenderGraphImage dst, RenderGraphUsage dstUsage, VkExtent2D dstExtent)
+{
+	BloomPass* pass = &bloom->passes[bloom->passCount];
+	*pass = (BloomPass){
+	    .bloom = bloom,
+	    .graph = graph,
+	    .pipeline = pipeline,
+	    .src = src,
+	    .dst = dst,
+	    .push = {
+	        .dstSize = {(i32)dstExtent.width, (i32)dstExtent.height},
+	        .radius = 1.0f,
+	        .strength = bloom->strength,
+	        .bloomScale = 1.0f / (float)bloom->mipCount,
+	    },
+	    .index = bloom->passCount++,
+	};
+	pass->graphPass = render_graph_add_pass(graph, name, bloom_pass_execute, pass);
+	render_graph_use(graph, pass->graphPass, src, RG_USAGE_COMPUTE_SAMPLED);
+	render_graph_use(graph, pass->graphPass, dst, dstUsage);
+	return pass;
+}
+
+RenderGraphImage bloom_add_passes(Bloom* bloom, RenderGraph* graph, RenderGraphImage source, VkExtent2D extent, u32 frameIndex)
+{
+	bloom->passCount = 0;
+	bloom->frameIndex = frameIndex;
+	if (bloom->mipCount == 0)
+		return source;
+
+	static const char* mipNames[BLOOM_MAX_MIPS] = {"bloom0", "bloom1", "bloom2", "bloom3", "bloom4", "bloom5", "bloom6", "bloom7"};
+	RenderGraphImage mips[BLOOM_MAX_MIPS];
+	VkExtent2D mipExtents[BLOOM_MAX_MIPS];
+	for (u32 i = 0; i < bloom->mipCount; ++i)
+	{
+		mipExtents[i] = (VkExtent2D){MAX(extent.width >> (i + 1), 1u), MAX(extent.height >> (i + 1), 1u)};
+		RenderGraphImageDesc desc = {VK_FORMAT_R16G16B16A16_SFLOAT, mipExtents[i].width, mipExtents[i].height};
+		mips[i] = render_graph_create_image(graph, mipNames[i], &desc);
+	}
+
+	for (u32 i = 0; i < bloom->mipCount; ++i)
+	{
+		BloomPass* pass = add_pass(bloom, graph, "bloom_down", bloom->downPipeline, i == 0 ? source : mips[i - 1], mips[i],
+		    RG_USAGE_COMPUTE_WRITE, mipExtents[i]);
+		pass->push.karis = i == 0;
+	}
+	// each level adds the blurred smaller one onto itself: read-modify-write
+	for (u32 i = bloom->mipCount - 1; i-- > 0;)
+		add_pass(bloom, graph, "bloom_up", bloom->upPipeline, mips[i + 1], mips[i], RG_USAGE_COMPUTE_READ_WRITE, mipExtents[i]);
+
+	RenderGraphImageDesc outDesc = {VK_FORMAT_R16G16B16A16_SFLOAT, extent.width, extent.height};
+	RenderGraphImage output = render_graph_create_image(graph, "bloom_out", &outDesc);
+	BloomPass* composite = add_pass(bloom, graph, "bloom_composite", bloom->compositePipeline, mips[0], output,
+	    RG_USAGE_COMPUTE_WRITE, extent);
+	composite->base = source;
+	render_graph_use(graph, composite->graphPass, source, RG_USAGE_COMPUTE_SAMPLED);
+	return output;
+}
+
+void bloom_collect_timings(Bloom* bloom, u32 frameIndex)
+{
+	if (!bloom->timestamps || !bloom->timestampsWritten[frameIndex])
+		return;
+	bloom->timestampsWritten[frameIndex] = false;
+	u64 ticks[2];
+	if (vkGetQueryPoolResults(bloom->device, bloom->timestamps, frameIndex * 2, 2, sizeof(ticks), ticks, sizeof(u64),
+	        VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+	bloom->lastGpuMs = (double)(ticks[1] - ticks[0]) * bloom->timestampPeriod * 1e-6;
+	bloom->gpuMsAccum += bloom->lastGpuMs;
+	if (++bloom->gpuFrames == BLOOM_REPORT_FRAMES)
+	{
+		printf("[Bloom] %u levels: %.3f ms GPU\n", bloom->mipCount, bloom->gpuMsAccum / bloom->gpuFrames);
+		bloom->gpuMsAccum = 0.0;
+		bloom->gpuFrames = 0;
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include "pipeline_manager.h"
+#include "render_graph.h"
+
+// Compute bloom on the HDR draw image, as render graph passes
+// - mipCount transient rgba16f levels, the first at half resolution: 13-tap downsample into each
+//   level (bloom_down.comp, shared-memory tile), then tent upsample back up adding every level
+//   onto the next larger one (bloom_up.comp), then a composite that blends the result over the
+//   source into a new full resolution image (bloom_composite.comp)
+// - the source is only sampled, so the path tracer's running mean is never touched
+// - GPU time of the whole chain is measured with timestamps and printed every
+//   BLOOM_REPORT_FRAMES frames
+
+#define BLOOM_MAX_MIPS 8
+#define BLOOM_MAX_PASSES (BLOOM_MAX_MIPS * 2 + 1)
+#define BLOOM_DEFAULT_MIPS 6
+#define BLOOM_REPORT_FRAMES 256
+
+// Matches the push constant block of the bloom shaders
+typedef struct BloomPush
+{
+	i32 dstSize[2];
+	float radius;     // tent tap distance, in texels of the smaller level
+	float strength;   // composite: fraction of the image replaced by its blurred copy
+	float bloomScale; // composite: 1 / mipCount
+	u32 karis;        // downsample: firefly-suppressing weights
+} BloomPush;
+
+typedef struct Bloom Bloom;
+
+typedef struct BloomPass
+{
+	Bloom* bloom;
+	RenderGraph* graph;
+	PipelineHandle pipeline;
+	RenderGraphPass graphPass;
+	RenderGraphImage src;
+	RenderGraphImage dst;
+	RenderGraphImage base; // composite only: the unblurred source
+	BloomPush push;
+	u32 index;
+} BloomPass;
+
+struct Bloom
+{
+	VkDevice device;
+	PipelineManager* pipelines;
+	PipelineHandle downPipeline;
+	PipelineHandle upPipeline;
+	PipelineHandle compositePipeline;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet sets[MAX_FRAMES_IN_FLIGHT][BLOOM_MAX_PASSES];
+	VkSampler sampler;
+
+	u32 mipCount; // 0 = disabled
+	float strength;
+
+	// this frame's passes, referenced by the graph until it executes
+	BloomPass passes[BLOOM_MAX_PASSES];
+	u32 passCount;
+	u32 frameIndex;
+
+	VkQueryPool timestamps; // two per frame in flight
+	float timestampPeriod;  // ns per tick
+	bool timestampsWritten[MAX_FRAMES_IN_FLIGHT];
+	double gpuMsAccum;
+	u32 gpuFrames;
+	double lastGpuMs;
+};
+
+void bloom_init(Bloom* bloom, const Application* app, PipelineManager* pipelines, u32 mipCount);
+void bloom_destroy(Bloom* bloom);
+
+// Adds the bloom chain reading source (sampled) and returns the composited image, a transient
+// rgba16f image of extent. Returns source unchanged when bloom is disabled.
+RenderGraphImage bloom_add_passes(Bloom* bloom, RenderGraph* graph, RenderGraphImage source, VkExtent2D extent, u32 frameIndex);
+
+// Picks up the timestamps of the frame slot whose fence just signaled
+void bloom_collect_timings(Bloom* bloom, u32 frameIndex);
+
+#endif // BLOOM_H
@@ -0,0 +1,760 @@
+#include "bvh.h"
+#include "task.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// subtrees smaller than this are never a task of their own
+#define BVH_PARALLEL_THRESHOLD 8192
+#define BVH_TASKS_PER_THREAD 4
+
+typedef struct Aabb
+{
+	float lo[3];
+	float hi[3];
+} Aabb;
+
+static void aabb_empty(Aabb* box)
+{
+	for (u32 c = 0; c < 3; ++c)
+	{
+		box->lo[c] = FLT_MAX;
+		box->hi[c] = -FLT_MAX;
+	}
+}
+
+static void aabb_grow_point(Aabb* box, const float p[3])
+{
+	for (u32 c = 0; c < 3; ++c)
+	{
+		box->lo[c] = MIN(box->lo[c], p[c]);
+		box->hi[c] = MAX(box->hi[c], p[c]);
+	}
+}
+
+static void aabb_grow(Aabb* box, const Aabb* other)
+{
+	for (u32 c = 0; c < 3; ++c)
+	{
+		box->lo[c] = MIN(box->lo[c], other->lo[c]);
+		box->hi[c] = MAX(box->hi[c], other->hi[c]);
+	}
+}
+
+static float aabb_area(const Aabb* box)
+{
+	float dx = box->hi[0] - box->lo[0], dy = box->hi[1] - box->lo[1], dz = box->hi[2] - box->lo[2];
+	if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+		return 0.0f;
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+// --- Build ---
+
+typedef struct BuildPrim
+{
+	Aabb bounds;
+	float centroid[3];
+} BuildPrim;
+
+typedef struct BuildNode
+{
+	Aabb bounds;
+	u32 left;  // interior: children are left and left + 1
+	u32 first; // leaf: range in the order array
+	u32 count; // 0 for interior nodes
+} BuildNode;
+
+typedef struct Builder
+{
+	const BuildPrim* prims;
+	u32* order; // primitive indices, partitioned in place so every subtree owns a disjoint range
+	BuildNode* nodes;
+	volatile c89atomic_uint32 nodeCount;
+	volatile c89atomic_uint32 maxDepth;
+	// parallel builds: the calling thread splits the top of the tree and queues subtrees of
+	// [BVH_PARALLEL_THRESHOLD, taskSize] primitives, which become one task each
+	bool deferring;
+	u32 taskSize;
+	struct BuildTask* deferred;
+	u32 deferredCount;
+	u32 deferredCapacity;
+} Builder;
+
+typedef struct BuildTask
+{
+	Builder* builder;
+	u32 node;
+	u32 depth;
+} BuildTask;
+
+static void build_node(Builder* b, u32 nodeIndex, u32 depth);
+static void split_node(Builder* b, BuildNode* node, u32 first, u32 mid, u32 count, u32 depth);
+
+static void build_task(void* arg)
+{
+	BuildTask* task = arg;
+	build_node(task->builder, task->node, task->depth);
+}
+
+static u32 bin_index(float centroid, float lo, float scale)
+{
+	i32 bin = (i32)((centroid - lo) * scale);
+	return (u32)CLAMP(bin, 0, BVH_BINS - 1);
+}
+
+// Levels of halving until count fits in a leaf
+static u32 median_levels(u32 count)
+{
+	u32 levels = 0;
+	for (u32 n = count; n > BVH_MAX_LEAF_SIZE; n = (n + 1) / 2)
+		levels++;
+	return levels;
+}
+
+// Partitions order[first, first + count) around its middle element by centroid on axis (quickselect)
+static void median_partition(Builder* b, u32 first, u32 count, u32 axis)
+{
+	u32 lo = first, hi = first + count - 1, mid = first + count / 2;
+	while (lo < hi)
+	{
+		float pivot = b->prims[b->order[(lo + hi) / 2]].centroid[axis];
+		u32 i = lo, j = hi;
+		while (i <= j)
+		{
+			while (b->prims[b->order[i]].centroid[axis] < pivot)
+				i++;
+			while (b->prims[b->order[j]].centroid[axis] > pivot)
+				j--;
+			if (i <= j)
+			{
+				SWAP(b->order[i], b->order[j]);
+				i++;
+				if (j == 0)
+					break;
+				j--;
+			}
+		}
+		if (mid <= j)
+			hi = j;
+		else if (mid >= i)
+			lo = i;
+		else
+			break;
+	}
+}
+
+static void build_node(Builder* b, u32 nodeIndex, u32 depth)
+{
+	BuildNode* node = &b->nodes[nodeIndex];
+	u32 first = node->first, count = node->count;
+
+	c89atomic_uint32 seenDepth = c89atomic_load_32(&b->maxDepth);
+	while (depth > seenDepth && !c89atomic_compare_exchange_weak_32(&b->maxDepth, &seenDepth, depth))
+	{
+	}
+
+	Aabb bounds, centroidBounds;
+	aabb_empty(&bounds);
+	aabb_empty(&centroidBounds);
+	for (u32 i = first; i < first + count; ++i)
+	{
+		const BuildPrim* prim = &b->prims[b->order[i]];
+		aabb_grow(&bounds, &prim->bounds);
+		aabb_grow_point(&centroidBounds, prim->centroid);
+	}
+	node->bounds = bounds;
+	if (count <= 2 || depth == BVH_MAX_DEPTH)
+		return;
+
+	// not enough levels left for SAH to wander: halve by centroid median along the widest axis,
+	// which reaches leaf size in median_levels(count) levels
+	if (depth + median_levels(count) >= BVH_MAX_DEPTH)
+	{
+		u32 axis = 0;
+		for (u32 c = 1; c < 3; ++c)
+		{
+			if (centroidBounds.hi[c] - centroidBounds.lo[c] > centroidBounds.hi[axis] - centroidBounds.lo[axis])
+				axis = c;
+		}
+		median_partition(b, first, count, axis);
+		split_node(b, node, first, first + count / 2, count, depth);
+		return;
+	}
+
+	// Binned SAH, all three axes binned in the same pass over the primitives
+	float scale[3];
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		float extent = centroidBounds.hi[axis] - centroidBounds.lo[axis];
+		scale[axis] = extent > 0.0f ? BVH_BINS / extent : 0.0f;
+	}
+	Aabb binBounds[3][BVH_BINS];
+	u32 binCount[3][BVH_BINS] = {{0}};
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		for (u32 i = 0; i < BVH_BINS; ++i)
+			aabb_empty(&binBounds[axis][i]);
+	}
+	for (u32 i = first; i < first + count; ++i)
+	{
+		const BuildPrim* prim = &b->prims[b->order[i]];
+		for (u32 axis = 0; axis < 3; ++axis)
+		{
+			u32 bin = bin_index(prim->centroid[axis], centroidBounds.lo[axis], scale[axis]);
+			binCount[axis][bin]++;
+			aabb_grow(&binBounds[axis][bin], &prim->bounds);
+		}
+	}
+
+	float bestCost = FLT_MAX;
+	i32 bestAxis = -1;
+	u32 bestSplit = 0;
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		if (scale[axis] == 0.0f)
+			continue;
+		// sweep from the left, then evaluate every plane while sweeping from the right
+		float leftArea[BVH_BINS - 1];
+		u32 leftCount[BVH_BINS - 1];
+		Aabb acc;
+		aabb_empty(&acc);
+		u32 n = 0;
+		for (u32 i = 0; i < BVH_BINS - 1; ++i)
+		{
+			n += binCount[axis][i];
+			aabb_grow(&acc, &binBounds[axis][i]);
+			leftCount[i] = n;
+			leftArea[i] = aabb_area(&acc);
+		}
+		aabb_empty(&acc);
+		n = 0;
+		for (u32 i = BVH_BINS - 1; i > 0; --i)
+		{
+			n += binCount[axis][i];
+			aabb_grow(&acc, &binBounds[axis][i]);
+			if (leftCount[i - 1] == 0 || n == 0)
+				continue;
+			float cost = (float)leftCount[i - 1] * leftArea[i - 1] + (float)n * aabb_area(&acc);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = (i32)axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	float area = aabb_area(&bounds);
+	float splitCost = area > 0.0f ? 1.0f + bestCost / area : FLT_MAX;
+	if ((bestAxis < 0 || splitCost >= (float)count) && count <= BVH_MAX_LEAF_SIZE)
+		return; // splitting doesn't pay off, stay a leaf
+
+	u32 mid;
+	if (bestAxis < 0)
+	{
+		// all centroids coincide, any split is as good as another
+		mid = first + count / 2;
+	}
+	else
+	{
+		u32 i = first, j = first + count;
+		while (i < j)
+		{
+			const BuildPrim* prim = &b->prims[b->order[i]];
+			if (bin_index(prim->centroid[bestAxis], centroidBounds.lo[bestAxis], scale[bestAxis]) < bestSplit)
+			{
+				i++;
+			}
+			else
+			{
+				j--;
+				SWAP(b->order[i], b->order[j]);
+			}
+		}
+		mid = i;
+		if (mid == first || mid == first + count)
+			mid = first + count / 2;
+	}
+
+	split_node(b, node, first, mid, count, depth);
+}
+
+// Turns node into an interior node over [first, mid) and [mid, first + count) and builds both
+static void split_node(Builder* b, BuildNode* node, u32 first, u32 mid, u32 count, u32 depth)
+{
+	u32 left = c89atomic_fetch_add_32(&b->nodeCount, 2);
+	b->nodes[left] = (BuildNode){.first = first, .count = mid - first};
+	b->nodes[left + 1] = (BuildNode){.first = mid, .count = first + count - mid};
+	node->left = left;
+	node->count = 0;
+
+	for (u32 child = left; child < left + 2; ++child)
+	{
+		u32 childCount = b->nodes[child].count;
+		if (!b->deferring || childCount < BVH_PARALLEL_THRESHOLD || childCount > b->taskSize)
+		{
+			build_node(b, child, depth + 1);
+			continue;
+		}
+		if (b->deferredCount == b->deferredCapacity)
+		{
+			b->deferredCapacity = MAX(b->deferredCapacity * 2, 64u);
+			b->deferred = realloc(b->deferred, b->deferredCapacity * sizeof(BuildTask));
+		}
+		b->deferred[b->deferredCount++] = (BuildTask){.builder = b, .node = child, .depth = depth + 1};
+	}
+}
+
+// Depth first relayout, returns the output index of buildIndex
+static u32 flatten(const Builder* b, u32 buildIndex, BvhNode* out, u32* outCount)
+{
+	const BuildNode* src = &b->nodes[buildIndex];
+	u32 index = (*outCount)++;
+	BvhNode* dst = &out[index];
+	memcpy(dst->boundsMin, src->bounds.lo, sizeof(dst->boundsMin));
+	memcpy(dst->boundsMax, src->bounds.hi, sizeof(dst->boundsMax));
+	if (src->count > 0)
+	{
+		dst->leftOrFirst = src->first;
+		dst->count = src->count;
+	}
+	else
+	{
+		flatten(b, src->left, out, outCount); // lands at index + 1
+		dst->leftOrFirst = flatten(b, src->left + 1, out, outCount);
+		dst->count = 0;
+	}
+	return index;
+}
+
+static void load_triangle(BvhTriangle* tri, const float* positions, const u32* indices, u32 primitive)
+{
+	const float* a = &positions[indices[primitive * 3 + 0] * 3];
+	const float* b = &positions[indices[primitive * 3 + 1] * 3];
+	const float* c = &positions[indices[primitive * 3 + 2] * 3];
+	memcpy(tri->v0, a, sizeof(tri->v0));
+	memcpy(tri->v1, b, sizeof(tri->v1));
+	memcpy(tri->v2, c, sizeof(tri->v2));
+	tri->primitive = primitive;
+	tri->pad0 = 0.0f;
+	tri->pad1 = 0.0f;
+}
+
+bool bvh_build(Bvh* bvh, const float* positions, const u32* indices, u32 triangleCount, bool parallel)
+{
+	memset(bvh, 0, sizeof(*bvh));
+	if (triangleCount == 0)
+		return false;
+
+	BuildPrim* prims = malloc((size_t)triangleCount * sizeof(BuildPrim));
+	for (u32 t = 0; t < triangleCount; ++t)
+	{
+		BuildPrim* prim = &prims[t];
+		aabb_empty(&prim->bounds);
+		for (u32 k = 0; k < 3; ++k)
+			aabb_grow_point(&prim->bounds, &positions[indices[t * 3 + k] * 3]);
+		for (u32 c = 0; c < 3; ++c)
+			prim->centroid[c] = 0.5f * (prim->bounds.lo[c] + prim->bounds.hi[c]);
+	}
+
+	Builder builder = {
+	    .prims = prims,
+	    .order = malloc((size_t)triangleCount * sizeof(u32)),
+	    .nodes = malloc(((size_t)triangleCount * 2) * sizeof(BuildNode)),
+	    .nodeCount = 1,
+	    .deferring = parallel,
+	    .taskSize = MAX(triangleCount / (task_thread_count() * BVH_TASKS_PER_THREAD), (u32)BVH_PARALLEL_THRESHOLD),
+	};
+	for (u32 t = 0; t < triangleCount; ++t)
+		builder.order[t] = t;
+	builder.nodes[0] = (BuildNode){.first = 0, .count = triangleCount};
+	build_node(&builder, 0, 0);
+	// the subtrees own disjoint ranges of order[] and take node indices atomically
+	builder.deferring = false;
+	TaskGroup group = {0};
+	for (u32 i = 0; i < builder.deferredCount; ++i)
+		task_submit(build_task, &builder.deferred[i], &group);
+	task_wait(&group);
+	free(builder.deferred);
+
+	bvh->nodeCount = builder.nodeCount;
+	bvh->nodes = malloc((size_t)bvh->nodeCount * sizeof(BvhNode));
+	u32 written = 0;
+	flatten(&builder, 0, bvh->nodes, &written);
+	assert(written == bvh->nodeCount);
+
+	bvh->triangleCount = triangleCount;
+	bvh->triangles = malloc((size_t)triangleCount * sizeof(BvhTriangle));
+	for (u32 i = 0; i < triangleCount; ++i)
+		load_triangle(&bvh->triangles[i], positions, indices, builder.order[i]);
+	bvh->maxDepth = builder.maxDepth;
+	assert(bvh->maxDepth <= BVH_MAX_DEPTH);
+
+	free(builder.nodes);
+	free(builder.order);
+	free(prims);
+	return true;
+}
+
+void bvh_refit(Bvh* bvh, const float* positions, const u32* indices)
+{
+	for (u32 i = 0; i < bvh->triangleCount; ++i)
+		load_triangle(&bvh->triangles[i], positions, indices, bvh->triangles[i].primitive);
+
+	// children always come after their parent in depth first order, so one reverse sweep is bottom-up
+	for (u32 i = bvh->nodeCount; i-- > 0;)
+	{
+		BvhNode* node = &bvh->nodes[i];
+		Aabb box;
+		aabb_empty(&box);
+		if (node->count > 0)
+		{
+			for (u32 t = node->leftOrFirst; t < node->leftOrFirst + node->count; ++t)
+			{
+				const BvhTriangle* tri = &bvh->triangles[t];
+				aabb_grow_point(&box, tri->v0);
+				aabb_grow_point(&box, tri->v1);
+				aabb_grow_point(&box, tri->v2);
+			}
+		}
+		else
+		{
+			const BvhNode* children[2] = {&bvh->nodes[i + 1], &bvh->nodes[node->leftOrFirst]};
+			for (u32 c = 0; c < 2; ++c)
+			{
+				aabb_grow_point(&box, children[c]->boundsMin);
+				aabb_grow_point(&box, children[c]->boundsMax);
+			}
+		}
+		memcpy(node->boundsMin, box.lo, sizeof(box.lo));
+		memcpy(node->boundsMax, box.hi, sizeof(box.hi));
+	}
+}
+
+void bvh_destroy(Bvh* bvh)
+{
+	free(bvh->nodes);
+	free(bvh->triangles);
+	memset(bvh, 0, sizeof(*bvh));
+}
+
+static float node_area(const BvhNode* node)
+{
+	Aabb box;
+	memcpy(box.lo, node->boundsMin, sizeof(box.lo));
+	memcpy(box.hi, node->boundsMax, sizeof(box.hi));
+	return aabb_area(&box);
+}
+
+float bvh_sah_cost(const Bvh* bvh)
+{
+	if (bvh->nodeCount == 0)
+		return 0.0f;
+	double cost = 0.0;
+	for (u32 i = 0; i < bvh->nodeCount; ++i)
+	{
+		const BvhNode* node = &bvh->nodes[i];
+		cost += node_area(node) * (node->count > 0 ? (double)node->count : 1.0);
+	}
+	float rootArea = node_area(&bvh->nodes[0]);
+	return rootArea > 0.0f ? (float)(cost / rootArea) : 0.0f;
+}
+
+// --- Traversal (CPU reference for the compute shader and the benchmark) ---
+
+static float ray_aabb(const BvhNode* node, const float origin[3], const float invDir[3], float tMax)
+{
+	float tmin = 0.0f, tmax = tMax;
+	for (u32 c = 0; c < 3; ++c)
+	{
+		float t0 = (node->boundsMin[c] - origin[c]) * invDir[c];
+		float t1 = (node->boundsMax[c] - origin[c]) * invDir[c];
+		tmin = MAX(tmin, MIN(t0, t1));
+		tmax = MIN(tmax, MAX(t0, t1));
+	}
+	return tmin <= tmax ? tmin : FLT_MAX;
+}
+
+// Möller-Trumbore
+static bool ray_triangle(const BvhTriangle* tri, const float o[3], const float d[3], float* t, float* u, float* v)
+{
+	float e1[3] = {tri->v1[0] - tri->v0[0], tri->v1[1] - tri->v0[1], tri->v1[2] - tri->v0[2]};
+	float e2[3] = {tri->v2[0] - tri->v0[0], tri->v2[1] - tri->v0[1], tri->v2[2] - tri->v0[2]};
+	float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+	float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+	if (fabsf(det) < 1e-12f)
+		return false;
+	float inv = 1.0f / det;
+	float s[3] = {o[0] - tri->v0[0], o[1] - tri->v0[1], o[2] - tri->v0[2]};
+	*u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+	if (*u < 0.0f || *u > 1.0f)
+		return false;
+	float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+	*v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+	if (*v < 0.0f || *u + *v > 1.0f)
+		return false;
+	*t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+	return *t > 1e-6f;
+}
+
+bool bvh_intersect(const Bvh* bvh, const float origin[3], const float dir[3], float tMax, BvhHit* hit, BvhTraversalStats* stats)
+{
+	float invDir[3];
+	for (u32 c = 0; c < 3; ++c)
+		invDir[c] = fabsf(dir[c]) > 1e-20f ? 1.0f / dir[c] : copysignf(1e30f, dir[c]);
+
+	hit->t = tMax;
+	bool found = false;
+	if (bvh->nodeCount == 0 || ray_aabb(&bvh->nodes[0], origin, invDir, tMax) == FLT_MAX)
+		return false;
+
+	u32 stack[BVH_MAX_DEPTH]; // one far child per level at most
+	u32 sp = 0;
+	u32 index = 0;
+	for (;;)
+	{
+		const BvhNode* node = &bvh->nodes[index];
+		if (stats)
+			stats->nodesVisited++;
+		if (node->count > 0)
+		{
+			for (u32 i = node->leftOrFirst; i < node->leftOrFirst + node->count; ++i)
+			{
+				float t, u, v;
+				if (stats)
+					stats->trianglesTested++;
+				if (ray_triangle(&bvh->triangles[i], origin, dir, &t, &u, &v) && t < hit->t)
+				{
+					*hit = (BvhHit){.t = t, .u = u, .v = v, .primitive = bvh->triangles[i].primitive};
+					found = true;
+				}
+			}
+			if (sp == 0)
+				break;
+			index = stack[--sp];
+			continue;
+		}
+
+		// visit the nearer child first, the far one only if still in front of the closest hit
+		u32 near = index + 1, far = node->leftOrFirst;
+		float dNear = ray_aabb(&bvh->nodes[near], origin, invDir, hit->t);
+		float dFar = ray_aabb(&bvh->nodes[far], origin, invDir, hit->t);
+		if (dNear > dFar)
+		{
+			SWAP(near, far);
+			SWAP(dNear, dFar);
+		}
+		if (dNear == FLT_MAX)
+		{
+			if (sp == 0)
+				break;
+			index = stack[--sp];
+			continue;
+		}
+		index = near;
+		if (dFar != FLT_MAX)
+		{
+			assert(sp < ARRAYSIZE(stack)); // the builder bounds the depth
+			stack[sp++] = far;
+		}
+	}
+	return found;
+}
+
+// --- GPU ---
+
+void bvh_gpu_create(BvhGpu* gpu, VmaAllocator allocator, const Bvh* bvh)
+{
+	gpu->nodeBytes = (VkDeviceSize)bvh->nodeCount * sizeof(BvhNode);
+	gpu->triangleBytes = (VkDeviceSize)bvh->triangleCount * sizeof(BvhTriangle);
+	gpu->nodes = create_buffer(allocator, gpu->nodeBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	gpu->triangles = create_buffer(allocator, gpu->triangleBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	VkBufferCreateInfo bufferInfo = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+	    .size = gpu->nodeBytes + gpu->triangleBytes,
+	    .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	};
+	VmaAllocationCreateInfo allocInfo = {
+	    .usage = VMA_MEMORY_USAGE_AUTO,
+	    .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+	};
+	VmaAllocationInfo info;
+	VK_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &gpu->staging.buffer, &gpu->staging.allocation, &info));
+	gpu->stagingMapped = (u8*)info.pMappedData;
+}
+
+void bvh_gpu_upload(BvhGpu* gpu, const Bvh* bvh, VkCommandBuffer cmd)
+{
+	assert((VkDeviceSize)bvh->nodeCount * sizeof(BvhNode) == gpu->nodeBytes);
+	memcpy(gpu->stagingMapped, bvh->nodes, gpu->nodeBytes);
+	memcpy(gpu->stagingMapped + gpu->nodeBytes, bvh->triangles, gpu->triangleBytes);
+
+	VkBufferCopy nodeCopy = {.srcOffset = 0, .dstOffset = 0, .size = gpu->nodeBytes};
+	VkBufferCopy triangleCopy = {.srcOffset = gpu->nodeBytes, .dstOffset = 0, .size = gpu->triangleBytes};
+	vkCmdCopyBuffer(cmd, gpu->staging.buffer, gpu->nodes.buffer, 1, &nodeCopy);
+	vkCmdCopyBuffer(cmd, gpu->staging.buffer, gpu->triangles.buffer, 1, &triangleCopy);
+
+	VkBufferMemoryBarrier2 barriers[2];
+	VkBuffer buffers[2] = {gpu->nodes.buffer, gpu->triangles.buffer};
+	for (u32 i = 0; i < 2; ++i)
+	{
+		barriers[i] = (VkBufferMemoryBarrier2){
+		    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		    .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+		    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .buffer = buffers[i],
+		    .offset = 0,
+		    .size = VK_WHOLE_SIZE,
+		};
+	}
+	pipelineBarrier(cmd, 0, 2, barriers, 0, NULL);
+}
+
+void bvh_gpu_destroy(BvhGpu* gpu, VmaAllocator allocator)
+{
+	vmaDestroyBuffer(allocator, gpu->nodes.buffer, gpu->nodes.allocation);
+	vmaDestroyBuffer(allocator, gpu->triangles.buffer, gpu->triangles.allocation);
+	vmaDestroyBuffer(allocator, gpu->staging.buffer, gpu->staging.allocation);
+	memset(gpu, 0, sizeof(*gpu));
+}
+
+// --- Benchmark ---
+
+static u32 bench_rand(u32* state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static float bench_randf(u32* state)
+{
+	return (float)bench_rand(state) / 16777216.0f;
+}
+
+// Bumpy sphere with `phase` animating the bumps, ~2 * rings * segments triangles
+static void bench_mesh(float* positions, u32 rings, u32 segments, float phase)
+{
+	for (u32 r = 0; r <= rings; ++r)
+	{
+		float theta = 3.14159265f * (float)r / (float)rings;
+		for (u32 s = 0; s <= segments; ++s)
+		{
+			float phi = 6.28318531f * (float)s / (float)segments;
+			float radius = 1.0f + 0.1f * sinf(theta * 13.0f + phase) * cosf(phi * 7.0f - phase);
+			float* p = &positions[(r * (segments + 1) + s) * 3];
+			p[0] = radius * sinf(theta) * cosf(phi);
+			p[1] = radius * cosf(theta);
+			p[2] = radius * sinf(theta) * sinf(phi);
+		}
+	}
+}
+
+static void bench_mesh_size(u32 triangleCount, u32* rings, u32* segments)
+{
+	*segments = MAX((u32)sqrtf((float)triangleCount), 4u);
+	*rings = MAX(triangleCount / (2 * *segments), 2u);
+}
+
+u32 bvh_bench_mesh_create(u32 triangleCount, float** outPositions, u32** outIndices)
+{
+	u32 rings, segments;
+	bench_mesh_size(triangleCount, &rings, &segments);
+	u32 vertexCount = (rings + 1) * (segments + 1);
+	u32 tris = rings * segments * 2;
+
+	float* positions = malloc((size_t)vertexCount * 3 * sizeof(float));
+	u32* indices = malloc((size_t)tris * 3 * sizeof(u32));
+	bench_mesh(positions, rings, segments, 0.0f);
+	u32 k = 0;
+	for (u32 r = 0; r < rings; ++r)
+	{
+		for (u32 s = 0; s < segments; ++s)
+		{
+			u32 a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+			indices[k++] = a;
+			indices[k++] = c;
+			indices[k++] = b;
+			indices[k++] = b;
+			indices[k++] = c;
+			indices[k++] = d;
+		}
+	}
+	*outPositions = positions;
+	*outIndices = indices;
+	return tris;
+}
+
+int bvh_benchmark(u32 triangleCount)
+{
+	u32 threadCount = task_thread_count();
+	float* positions;
+	u32* indices;
+	u32 tris = bvh_bench_mesh_create(triangleCount, &positions, &indices);
+	u32 rings, segments;
+	bench_mesh_size(triangleCount, &rings, &segments);
+	printf("[BVH] benchmark: %u triangles, %u threads\n", tris, threadCount);
+
+	Bvh bvh;
+	double t0 = now_ms();
+	bvh_build(&bvh, positions, indices, tris, false);
+	double singleMs = now_ms() - t0;
+	bvh_destroy(&bvh);
+
+	t0 = now_ms();
+	bvh_build(&bvh, positions, indices, tris, true);
+	double parallelMs = now_ms() - t0;
+	printf("[BVH] build: %.1f ms (1 thread), %.1f ms (%u threads), %.2fx, %.1f Mtris/s\n",
+	    singleMs, parallelMs, threadCount, singleMs / parallelMs, tris / (parallelMs * 1e3));
+	printf("[BVH] %u nodes (%zu KB), depth %u, SAH cost %.2f\n",
+	    bvh.nodeCount, (size_t)bvh.nodeCount * sizeof(BvhNode) / 1024, bvh.maxDepth, bvh_sah_cost(&bvh));
+
+	// rays from a surrounding sphere towards points around the center
+	const u32 rayCount = 1u << 20;
+	u32 seed = 1234567u;
+	BvhTraversalStats stats = {0};
+	u32 hits = 0;
+	t0 = now_ms();
+	for (u32 i = 0; i < rayCount; ++i)
+	{
+		float o[3], target[3], d[3];
+		for (u32 c = 0; c < 3; ++c)
+		{
+			o[c] = bench_randf(&seed) * 2.0f - 1.0f;
+			target[c] = (bench_randf(&seed) * 2.0f - 1.0f) * 0.5f;
+		}
+		float len = sqrtf(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]) + 1e-6f;
+		for (u32 c = 0; c < 3; ++c)
+			o[c] = o[c] / len * 3.0f;
+		float dl = 0.0f;
+		for (u32 c = 0; c < 3; ++c)
+		{
+			d[c] = target[c] - o[c];
+			dl += d[c] * d[c];
+		}
+		dl = sqrtf(dl);
+		for (u32 c = 0; c < 3; ++c)
+			d[c] /= dl;
+		BvhHit hit;
+		hits += bvh_intersect(&bvh, o, d, FLT_MAX, &hit, &stats) ? 1 : 0;
+	}
+	double traceMs = now_ms() - t0;
+	printf("[BVH] trace (1 thread): %.2f Mrays/s, %.1f nodes/ray, %.1f triangles/ray, %u/%u hit\n",
+	    rayCount / (traceMs * 1e3), (double)stats.nodesVisited / rayCount, (double)stats.trianglesTested / rayCount, hits, rayCount);
+
+	bench_mesh(positions, rings, segments, 1.0f);
+	t0 = now_ms();
+	bvh_refit(&bvh, positions, indices);
+	double refitMs = now_ms() - t0;
+	printf("[BVH] refit: %.1f ms, SAH cost after animating %.2f\n", refitMs, bvh_sah_cost(&bvh));
+
+	bvh_destroy(&bvh);
+	free(indices);
+	free(positions);
+	return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "main.h"
+
+// Bounding volume hierarchy for compute ray tracing
+// - binned SAH build (BVH_BINS bins on the widest-centroid axes). Parallel builds split the top
+//   of the tree on the calling thread and build the subtrees below it as tasks (task.h)
+// - flattened depth first into 32 byte nodes: the left child always directly follows its parent,
+//   so half the child fetches hit the cache line we just read
+// - triangles are stored in leaf order next to the nodes, both uploaded as SSBOs
+// - refit keeps the topology and only recomputes bounds (animated meshes), rebuild when
+//   deformation is large and traversal cost creeps up
+// - no leaf is deeper than BVH_MAX_DEPTH: where SAH splits would run out of levels the builder
+//   switches to median splits, so fixed traversal stacks of that size (CPU and pathtrace.glsl)
+//   never overflow
+
+#define BVH_BINS 16
+#define BVH_MAX_LEAF_SIZE 8
+#define BVH_MAX_DEPTH 32 // root is depth 0; also the traversal stack size, keep pathtrace.glsl in sync
+
+// Matches `struct BvhNode` in the shaders (std430: vec3 + uint, vec3 + uint)
+typedef struct BvhNode
+{
+	float boundsMin[3];
+	u32 leftOrFirst; // interior: index of the right child (left is this + 1), leaf: first triangle
+	float boundsMax[3];
+	u32 count; // 0 for interior nodes
+} BvhNode;
+
+// Matches `struct BvhTriangle` (three vec4, primitive id in v0.w)
+typedef struct BvhTriangle
+{
+	float v0[3];
+	u32 primitive; // index of the triangle in the source index buffer
+	float v1[3];
+	float pad0;
+	float v2[3];
+	float pad1;
+} BvhTriangle;
+
+typedef struct Bvh
+{
+	BvhNode* nodes;
+	u32 nodeCount;
+	BvhTriangle* triangles;
+	u32 triangleCount;
+	u32 maxDepth; // <= BVH_MAX_DEPTH
+} Bvh;
+
+typedef struct BvhHit
+{
+	float t;
+	float u;
+	float v;
+	u32 primitive;
+} BvhHit;
+
+typedef struct BvhTraversalStats
+{
+	u64 nodesVisited;
+	u64 trianglesTested;
+} BvhTraversalStats;
+
+// positions: xyz floats, indices: 3 per triangle. parallel builds large subtrees as tasks; call it
+// from the thread that owns the task system (zpl tasks are submitted from the main thread only).
+bool bvh_build(Bvh* bvh, const float* positions, const u32* indices, u32 triangleCount, bool parallel);
+// Recomputes all bounds bottom-up from moved vertices, same index buffer as the build.
+void bvh_refit(Bvh* bvh, const float* positions, const u32* indices);
+void bvh_destroy(Bvh* bvh);
+
+// Expected traversal cost under the SAH (root area normalised, traversal = intersection = 1)
+float bvh_sah_cost(const Bvh* bvh);
+bool bvh_intersect(const Bvh* bvh, const float origin[3], const float dir[3], float tMax, BvhHit* hit, BvhTraversalStats* stats);
+
+// GPU copy: device local SSBOs fed from a persistent staging buffer so refits can re-upload
+typedef struct BvhGpu
+{
+	AllocatedBuffer nodes;
+	AllocatedBuffer triangles;
+	AllocatedBuffer staging;
+	u8* stagingMapped;
+	VkDeviceSize nodeBytes;
+	VkDeviceSize triangleBytes;
+} BvhGpu;
+
+void bvh_gpu_create(BvhGpu* gpu, VmaAllocator allocator, const Bvh* bvh);
+// Records the copy into cmd followed by a barrier making it visible to compute shader reads.
+// The staging buffer is shared, don't upload again before this cmd finished.
+void bvh_gpu_upload(BvhGpu* gpu, const Bvh* bvh, VkCommandBuffer cmd);
+void bvh_gpu_destroy(BvhGpu* gpu, VmaAllocator allocator);
+
+// The benchmarks' procedural mesh, a bumpy sphere of about triangleCount triangles. Returns the
+// exact triangle count; free both arrays.
+u32 bvh_bench_mesh_create(u32 triangleCount, float** positions, u32** indices);
+// --bench-bvh: builds a procedural mesh, reports build time/quality and CPU traversal cost
+int bvh_benchmark(u32 triangleCount);
+
+#endif // BVH_H
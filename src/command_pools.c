@@ -0,0 +1,81 @@
+#include "command_pools.h"
+#include <string.h>
+
+void thread_command_pools_init(ThreadCommandPools* p, const Application* app)
+{
+	memset(p, 0, sizeof(*p));
+	p->device = app->device;
+	p->threadCount = MIN(job_thread_count(), (u32)COMMAND_POOLS_MAX_THREADS);
+
+	// no per-buffer reset flag: pools are only ever reset as a whole, which lets the driver
+	// recycle memory in bulk
+	VkCommandPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+	    .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+	    .queueFamilyIndex = find_graphics_queue_family_index(app->physicaldevice),
+	};
+	for (u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; ++f)
+	{
+		for (u32 t = 0; t < p->threadCount; ++t)
+			VK_CHECK(vkCreateCommandPool(p->device, &poolInfo, NULL, &p->pools[f][t].pool));
+	}
+}
+
+void thread_command_pools_destroy(ThreadCommandPools* p)
+{
+	for (u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; ++f)
+	{
+		for (u32 t = 0; t < p->threadCount; ++t)
+		{
+			ThreadCommandPool* pool = &p->pools[f][t];
+			// destroying the pool frees its buffers
+			vkDestroyCommandPool(p->device, pool->pool, NULL);
+			free(pool->secondaries);
+		}
+	}
+	memset(p, 0, sizeof(*p));
+}
+
+void thread_command_pools_reset(ThreadCommandPools* p, u32 frameIndex)
+{
+	for (u32 t = 0; t < p->threadCount; ++t)
+	{
+		ThreadCommandPool* pool = &p->pools[frameIndex][t];
+		if (pool->secondaryUsed == 0)
+			continue;
+		VK_CHECK(vkResetCommandPool(p->device, pool->pool, 0));
+		pool->secondaryUsed = 0;
+	}
+}
+
+VkCommandBuffer thread_command_pools_begin_secondary(ThreadCommandPools* p, u32 frameIndex,
+    const VkCommandBufferInheritanceInfo* inheritance, VkCommandBufferUsageFlags flags)
+{
+	u32 thread = job_thread_index();
+	assert(thread < p->threadCount);
+	ThreadCommandPool* pool = &p->pools[frameIndex][thread];
+
+	if (pool->secondaryUsed == pool->secondaryCount)
+	{
+		// grow in batches, allocation is the slow part
+		u32 grow = MAX(pool->secondaryCount, 8u);
+		pool->secondaries = realloc(pool->secondaries, (pool->secondaryCount + grow) * sizeof(VkCommandBuffer));
+		VkCommandBufferAllocateInfo allocInfo = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		    .commandPool = pool->pool,
+		    .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+		    .commandBufferCount = grow,
+		};
+		VK_CHECK(vkAllocateCommandBuffers(p->device, &allocInfo, pool->secondaries + pool->secondaryCount));
+		pool->secondaryCount += grow;
+	}
+
+	VkCommandBuffer cmd = pool->secondaries[pool->secondaryUsed++];
+	VkCommandBufferBeginInfo beginInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	    .flags = flags,
+	    .pInheritanceInfo = inheritance,
+	};
+	VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+	return cmd;
+}
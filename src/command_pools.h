@@ -0,0 +1,44 @@
+#ifndef COMMAND_POOLS_H
+#define COMMAND_POOLS_H
+
+#include "main.h"
+#include "job.h"
+
+// Per-thread, per-frame command pools for parallel recording
+// - command pools are externally synchronized, so every job thread records into secondaries
+//   allocated from its own pool (indexed by job_thread_index)
+// - one pool per frame in flight: once the frame's fence signaled all of that frame's pools are
+//   reset in one call, and their secondaries are handed out again without reallocating
+
+#define COMMAND_POOLS_MAX_THREADS (JOB_MAX_WORKERS + 1)
+
+typedef struct ThreadCommandPool
+{
+	VkCommandPool pool;
+	VkCommandBuffer* secondaries; // allocated on demand, reused after every reset
+	u32 secondaryCount;
+	u32 secondaryUsed;
+	u8 pad[40]; // one cache line per thread, counters are bumped while other threads record
+} ThreadCommandPool;
+
+typedef struct ThreadCommandPools
+{
+	VkDevice device;
+	u32 threadCount;
+	ThreadCommandPool pools[MAX_FRAMES_IN_FLIGHT][COMMAND_POOLS_MAX_THREADS];
+} ThreadCommandPools;
+
+// One pool per job thread (job_thread_count) and frame in flight
+void thread_command_pools_init(ThreadCommandPools* p, const Application* app);
+void thread_command_pools_destroy(ThreadCommandPools* p);
+
+// Resets every thread's pool of this frame; only after the frame's fence signaled
+void thread_command_pools_reset(ThreadCommandPools* p, u32 frameIndex);
+
+// Secondary from the calling thread's pool, already begun. Pass inheritance with
+// VkCommandBufferInheritanceRenderingInfo chained and RENDER_PASS_CONTINUE in flags for
+// buffers executed inside vkCmdBeginRendering.
+VkCommandBuffer thread_command_pools_begin_secondary(ThreadCommandPools* p, u32 frameIndex,
+    const VkCommandBufferInheritanceInfo* inheritance, VkCommandBufferUsageFlags flags);
+
+#endif // COMMAND_POOLS_H
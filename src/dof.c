@@ -0,0 +1,378 @@
+#include "dof.h"
+#include <string.h>
+
+// Matches `buffer Tiles` in the dof shaders
+#define DOF_ARGS_SIZE (2 * 4 * sizeof(u32))
+#define DOF_TILES_SIZE (DOF_ARGS_SIZE + (size_t)DOF_MAX_TILES * (2 * sizeof(float) + sizeof(float) + 3 * sizeof(u32)))
+
+enum
+{
+	DOF_BINDING_SOURCE = 0,
+	DOF_BINDING_HALF,
+	DOF_BINDING_BLUR,
+	DOF_BINDING_DST,
+	DOF_BINDING_TILES,
+	DOF_BINDING_COUNT,
+};
+
+void dof_init(Dof* dof, const Application* app, PipelineManager* pipelines, float aperture)
+{
+	memset(dof, 0, sizeof(*dof));
+	dof->device = app->device;
+	dof->allocator = app->allocator;
+	dof->pipelines = pipelines;
+	dof->aperture = MIN(aperture, DOF_MAX_COC);
+	dof->focusDistance = 1.0f;
+
+	VkDescriptorSetLayoutBinding bindings[DOF_BINDING_COUNT];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		if (i == DOF_BINDING_DST)
+			type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		else if (i == DOF_BINDING_TILES)
+			type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = type,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(dof->device, &layoutInfo, NULL, &dof->setLayout));
+
+	// one set per pass per frame in flight, rewritten every frame like bloom's
+	const u32 setCount = MAX_FRAMES_IN_FLIGHT * DOF_PASS_COUNT;
+	VkDescriptorPoolSize poolSizes[] = {
+	    {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = setCount * 3},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = setCount},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = setCount},
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = setCount,
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
+	    .pPoolSizes = poolSizes,
+	};
+	VK_CHECK(vkCreateDescriptorPool(dof->device, &poolInfo, NULL, &dof->descriptorPool));
+	VkDescriptorSetLayout setLayouts[DOF_PASS_COUNT];
+	for (u32 i = 0; i < DOF_PASS_COUNT; ++i)
+		setLayouts[i] = dof->setLayout;
+	for (u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; ++f)
+	{
+		VkDescriptorSetAllocateInfo allocInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		    .descriptorPool = dof->descriptorPool,
+		    .descriptorSetCount = DOF_PASS_COUNT,
+		    .pSetLayouts = setLayouts,
+		};
+		VK_CHECK(vkAllocateDescriptorSets(dof->device, &allocInfo, dof->sets[f]));
+	}
+
+	// the shaders only texelFetch
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_NEAREST,
+	    .minFilter = VK_FILTER_NEAREST,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	};
+	VK_CHECK(vkCreateSampler(dof->device, &samplerInfo, NULL, &dof->sampler));
+
+	dof->tiles = create_buffer(dof->allocator, DOF_TILES_SIZE,
+	    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	    VMA_MEMORY_USAGE_GPU_ONLY);
+	dof->counts = create_buffer(dof->allocator, MAX_FRAMES_IN_FLIGHT * DOF_ARGS_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(DofPush),
+	};
+	dof->pipelineLayout = createPipelineLayout(dof->device, &dof->setLayout, 1, &pcr, 1);
+	PipelineDesc desc = {
+	    .name = "dof_prepare",
+	    .onDemand = dof->aperture <= 0.0f,
+	    .computeShader = "compiledshaders/dof_prepare.comp.spv",
+	    .layout = dof->pipelineLayout,
+	};
+	dof->preparePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "dof_classify";
+	desc.computeShader = "compiledshaders/dof_classify.comp.spv";
+	dof->classifyPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "dof_gather";
+	desc.computeShader = "compiledshaders/dof_gather.comp.spv";
+	dof->gatherPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "dof_composite";
+	desc.computeShader = "compiledshaders/dof_composite.comp.spv";
+	dof->compositePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	dof->timestampPeriod = props.limits.timestampComputeAndGraphics ? props.limits.timestampPeriod : 0.0f;
+	if (dof->timestampPeriod > 0.0f)
+	{
+		VkQueryPoolCreateInfo queryInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+		    .queryCount = MAX_FRAMES_IN_FLIGHT * 2,
+		};
+		VK_CHECK(vkCreateQueryPool(dof->device, &queryInfo, NULL, &dof->timestamps));
+	}
+}
+
+void dof_destroy(Dof* dof)
+{
+	if (dof->timestamps)
+		vkDestroyQueryPool(dof->device, dof->timestamps, NULL);
+	vmaDestroyBuffer(dof->allocator, dof->counts.buffer, dof->counts.allocation);
+	vmaDestroyBuffer(dof->allocator, dof->tiles.buffer, dof->tiles.allocation);
+	vkDestroySampler(dof->device, dof->sampler, NULL);
+	vkDestroyPipelineLayout(dof->device, dof->pipelineLayout, NULL);
+	vkDestroyDescriptorPool(dof->device, dof->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(dof->device, dof->setLayout, NULL);
+}
+
+// Points the set of one pass at this frame's images; dst is the pass's storage image and
+// sampled lists the images it reads, as a mask of DOF_BINDING_SOURCE/HALF/BLUR bits
+static VkDescriptorSet update_set(Dof* dof, DofPassType type, RenderGraphImage dst, u32 sampled)
+{
+	VkDescriptorSet set = dof->sets[dof->frameIndex][type];
+	const RenderGraphImage sampledImages[3] = {dof->source, dof->halfImage, dof->blur};
+	VkDescriptorImageInfo imageInfos[4];
+	VkDescriptorBufferInfo bufferInfo = {dof->tiles.buffer, 0, VK_WHOLE_SIZE};
+	VkWriteDescriptorSet writes[DOF_BINDING_COUNT];
+	u32 writeCount = 0;
+	for (u32 i = 0; i < ARRAYSIZE(sampledImages); ++i)
+	{
+		if (!(sampled & (1u << i)))
+			continue;
+		imageInfos[i] = (VkDescriptorImageInfo){dof->sampler, render_graph_image_view(dof->graph, sampledImages[i]), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		writes[writeCount++] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = set,
+		    .dstBinding = i,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		    .pImageInfo = &imageInfos[i],
+		};
+	}
+	imageInfos[3] = (VkDescriptorImageInfo){VK_NULL_HANDLE, render_graph_image_view(dof->graph, dst), VK_IMAGE_LAYOUT_GENERAL};
+	writes[writeCount++] = (VkWriteDescriptorSet){
+	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+	    .dstSet = set,
+	    .dstBinding = DOF_BINDING_DST,
+	    .descriptorCount = 1,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+	    .pImageInfo = &imageInfos[3],
+	};
+	writes[writeCount++] = (VkWriteDescriptorSet){
+	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+	    .dstSet = set,
+	    .dstBinding = DOF_BINDING_TILES,
+	    .descriptorCount = 1,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	    .pBufferInfo = &bufferInfo,
+	};
+	vkUpdateDescriptorSets(dof->device, writeCount, writes, 0, NULL);
+	return set;
+}
+
+static void tiles_barrier(Dof* dof, VkCommandBuffer cmd, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+	VkBufferMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = srcStage,
+	    .srcAccessMask = srcAccess,
+	    .dstStageMask = dstStage,
+	    .dstAccessMask = dstAccess,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = dof->tiles.buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &barrier, 0, NULL);
+}
+
+static void bind(Dof* dof, VkCommandBuffer cmd, PipelineHandle handle, VkDescriptorSet set)
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_get(dof->pipelines, handle));
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, dof->pipelineLayout, 0, 1, &set, 0, NULL);
+	vkCmdPushConstants(cmd, dof->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DofPush), &dof->push);
+}
+
+static void dof_tiles_execute(VkCommandBuffer cmd, void* data)
+{
+	Dof* dof = (Dof*)data;
+	u32 firstQuery = dof->frameIndex * 2;
+	if (dof->timestamps)
+	{
+		vkCmdResetQueryPool(cmd, dof->timestamps, firstQuery, 2);
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, dof->timestamps, firstQuery);
+	}
+
+	// the previous frame's gather and count copy must be done with the arguments before the reset
+	static const u32 emptyArgs[8] = {0, 1, 1, 0, 0, 1, 1, 0};
+	tiles_barrier(dof, cmd,
+	    VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	vkCmdUpdateBuffer(cmd, dof->tiles.buffer, 0, sizeof(emptyArgs), emptyArgs);
+	tiles_barrier(dof, cmd,
+	    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	VkDescriptorSet set = update_set(dof, DOF_PASS_TILES, dof->halfImage, 1u << DOF_BINDING_SOURCE);
+	bind(dof, cmd, dof->preparePipeline, set);
+	vkCmdDispatch(cmd, dof->push.tiles[0], dof->push.tiles[1], 1);
+
+	// classify reads the neighbours' tile CoC
+	tiles_barrier(dof, cmd,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_get(dof->pipelines, dof->classifyPipeline));
+	vkCmdDispatch(cmd, (dof->push.tiles[0] * dof->push.tiles[1] + 63) / 64, 1, 1);
+}
+
+static void dof_gather_execute(VkCommandBuffer cmd, void* data)
+{
+	Dof* dof = (Dof*)data;
+	// the lists feed the indirect dispatches, the class map the composite, the counts the copy
+	tiles_barrier(dof, cmd,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	    VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT);
+
+	VkDescriptorSet set = update_set(dof, DOF_PASS_GATHER, dof->blur, 1u << DOF_BINDING_HALF);
+	bind(dof, cmd, dof->gatherPipeline, set);
+	vkCmdDispatchIndirect(cmd, dof->tiles.buffer, 4 * sizeof(u32));
+	dof->push.field = 1;
+	vkCmdPushConstants(cmd, dof->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DofPush), &dof->push);
+	vkCmdDispatchIndirect(cmd, dof->tiles.buffer, 0);
+	dof->push.field = 0;
+
+	// the counts the dispatches above just read, kept with the grid they cover: dof->push has
+	// moved on to later frames by the time dof_collect_stats reads this slot
+	VkBufferCopy region = {.srcOffset = 0, .dstOffset = dof->frameIndex * DOF_ARGS_SIZE, .size = DOF_ARGS_SIZE};
+	vkCmdCopyBuffer(cmd, dof->tiles.buffer, dof->counts.buffer, 1, &region);
+	dof->classifiedTiles[dof->frameIndex] = dof->push.tiles[0] * dof->push.tiles[1];
+	VkBufferMemoryBarrier2 toHost = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+	    .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = dof->counts.buffer,
+	    .offset = region.dstOffset,
+	    .size = DOF_ARGS_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &toHost, 0, NULL);
+}
+
+static void dof_composite_execute(VkCommandBuffer cmd, void* data)
+{
+	Dof* dof = (Dof*)data;
+	VkDescriptorSet set = update_set(dof, DOF_PASS_COMPOSITE, dof->output,
+	    (1u << DOF_BINDING_SOURCE) | (1u << DOF_BINDING_HALF) | (1u << DOF_BINDING_BLUR));
+	bind(dof, cmd, dof->compositePipeline, set);
+	vkCmdDispatch(cmd, dof->push.tiles[0], dof->push.tiles[1], 1);
+
+	if (dof->timestamps)
+	{
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, dof->timestamps, dof->frameIndex * 2 + 1);
+		dof->timestampsWritten[dof->frameIndex] = true;
+	}
+}
+
+RenderGraphImage dof_add_passes(Dof* dof, RenderGraph* graph, RenderGraphImage source, VkExtent2D extent, u32 frameIndex)
+{
+	if (dof->aperture <= 0.0f)
+		return source;
+	u32 tilesX = (extent.width + DOF_TILE - 1) / DOF_TILE;
+	u32 tilesY = (extent.height + DOF_TILE - 1) / DOF_TILE;
+	if (tilesX * tilesY > DOF_MAX_TILES)
+		return source;
+	// all four or nothing: a half-built chain would read stale tile lists
+	if (!pipeline_get(dof->pipelines, dof->preparePipeline) || !pipeline_get(dof->pipelines, dof->classifyPipeline) ||
+	    !pipeline_get(dof->pipelines, dof->gatherPipeline) || !pipeline_get(dof->pipelines, dof->compositePipeline))
+		return source;
+
+	VkExtent2D halfExtent = {(extent.width + 1) / 2, (extent.height + 1) / 2};
+	dof->graph = graph;
+	dof->frameIndex = frameIndex;
+	dof->source = source;
+	dof->push = (DofPush){
+	    .size = {(i32)extent.width, (i32)extent.height},
+	    .halfSize = {(i32)halfExtent.width, (i32)halfExtent.height},
+	    .tiles = {tilesX, tilesY},
+	    .focusDistance = dof->focusDistance,
+	    .aperture = dof->aperture,
+	    .maxCoc = DOF_MAX_COC,
+	};
+
+	RenderGraphImageDesc halfDesc = {VK_FORMAT_R16G16B16A16_SFLOAT, halfExtent.width, halfExtent.height};
+	dof->halfImage = render_graph_create_image(graph, "dof_half", &halfDesc);
+	// only texels of blurred tiles are ever written or read
+	dof->blur = render_graph_create_image(graph, "dof_blur", &halfDesc);
+	RenderGraphImageDesc outDesc = {VK_FORMAT_R16G16B16A16_SFLOAT, extent.width, extent.height};
+	dof->output = render_graph_create_image(graph, "dof_out", &outDesc);
+
+	RenderGraphPass pass = render_graph_add_pass(graph, "dof_tiles", dof_tiles_execute, dof);
+	render_graph_use(graph, pass, source, RG_USAGE_COMPUTE_SAMPLED);
+	render_graph_use(graph, pass, dof->halfImage, RG_USAGE_COMPUTE_WRITE);
+	pass = render_graph_add_pass(graph, "dof_gather", dof_gather_execute, dof);
+	render_graph_use(graph, pass, dof->halfImage, RG_USAGE_COMPUTE_SAMPLED);
+	render_graph_use(graph, pass, dof->blur, RG_USAGE_COMPUTE_WRITE);
+	pass = render_graph_add_pass(graph, "dof_composite", dof_composite_execute, dof);
+	render_graph_use(graph, pass, source, RG_USAGE_COMPUTE_SAMPLED);
+	render_graph_use(graph, pass, dof->halfImage, RG_USAGE_COMPUTE_SAMPLED);
+	render_graph_use(graph, pass, dof->blur, RG_USAGE_COMPUTE_SAMPLED);
+	render_graph_use(graph, pass, dof->output, RG_USAGE_COMPUTE_WRITE);
+	return dof->output;
+}
+
+void dof_collect_stats(Dof* dof, u32 frameIndex)
+{
+	if (!dof->timestamps || !dof->timestampsWritten[frameIndex])
+		return;
+	dof->timestampsWritten[frameIndex] = false;
+	u64 ticks[2];
+	if (vkGetQueryPoolResults(dof->device, dof->timestamps, frameIndex * 2, 2, sizeof(ticks), ticks, sizeof(u64),
+	        VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+	dof->lastGpuMs = (double)(ticks[1] - ticks[0]) * dof->timestampPeriod * 1e-6;
+	dof->gpuMsAccum += dof->lastGpuMs;
+
+	u8* mapped;
+	VK_CHECK(vmaMapMemory(dof->allocator, dof->counts.allocation, (void**)&mapped));
+	vmaInvalidateAllocation(dof->allocator, dof->counts.allocation, frameIndex * DOF_ARGS_SIZE, DOF_ARGS_SIZE);
+	const u32* args = (const u32*)(mapped + frameIndex * DOF_ARGS_SIZE);
+	dof->nearTilesAccum += args[0];
+	dof->farTilesAccum += args[4];
+	vmaUnmapMemory(dof->allocator, dof->counts.allocation);
+	dof->tileTotalAccum += dof->classifiedTiles[frameIndex];
+
+	if (++dof->gpuFrames == DOF_REPORT_FRAMES)
+	{
+		double total = (double)MAX(dof->tileTotalAccum, 1u);
+		printf("[DoF] %.3f ms GPU, tiles: %.1f%% near, %.1f%% far, %.1f%% in focus\n",
+		    dof->gpuMsAccum / dof->gpuFrames,
+		    100.0 * (double)dof->nearTilesAccum / total,
+		    100.0 * (double)dof->farTilesAccum / total,
+		    100.0 * (double)(dof->tileTotalAccum - dof->nearTilesAccum - dof->farTilesAccum) / total);
+		dof->gpuMsAccum = 0.0;
+		dof->nearTilesAccum = 0;
+		dof->farTilesAccum = 0;
+		dof->tileTotalAccum = 0;
+		dof->gpuFrames = 0;
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef DOF_H
+#define DOF_H
+
+#include "pipeline_manager.h"
+#include "render_graph.h"
+
+// Gather depth of field on the path traced image, as render graph passes
+// - depth comes from the draw image's alpha (mean primary hit depth written by pathtrace.comp);
+//   CoC = aperture * (1 - focus / depth) full resolution pixels, clamped to one tile
+// - dof_tiles: per 16x16 tile max near/far CoC plus a half resolution copy (dof_prepare.comp),
+//   then one thread per tile sorts tiles into near / far lists and writes the indirect dispatch
+//   arguments (dof_classify.comp)
+// - dof_gather: half resolution gather, two vkCmdDispatchIndirect over the lists; in-focus tiles
+//   launch no work at all (dof_gather.comp)
+// - dof_composite: full resolution, in-focus tiles are a copy, the rest a bilateral upsample of
+//   the gather (dof_composite.comp)
+// - tile lists and indirect arguments live in one device local buffer reused every frame; the
+//   list counts are copied out per frame in flight and printed with the GPU time every
+//   DOF_REPORT_FRAMES frames
+
+#define DOF_TILE 16
+#define DOF_MAX_TILES 65536 // keep in sync with the dof shaders; 4096x4096 at 16x16
+#define DOF_MAX_COC 16.0f
+#define DOF_DEFAULT_APERTURE 8.0f
+#define DOF_REPORT_FRAMES 256
+
+// Matches the push constant block of the dof shaders
+typedef struct DofPush
+{
+	i32 size[2];
+	i32 halfSize[2];
+	u32 tiles[2];
+	float focusDistance;
+	float aperture; // CoC at infinity, full resolution pixels
+	float maxCoc;
+	u32 field; // gather: 0 far, 1 near
+} DofPush;
+
+typedef enum DofPassType
+{
+	DOF_PASS_TILES = 0,
+	DOF_PASS_GATHER,
+	DOF_PASS_COMPOSITE,
+	DOF_PASS_COUNT,
+} DofPassType;
+
+typedef struct Dof
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	PipelineManager* pipelines;
+	PipelineHandle preparePipeline;
+	PipelineHandle classifyPipeline;
+	PipelineHandle gatherPipeline;
+	PipelineHandle compositePipeline;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet sets[MAX_FRAMES_IN_FLIGHT][DOF_PASS_COUNT];
+	VkSampler sampler;
+	AllocatedBuffer tiles;
+	AllocatedBuffer counts; // near/far argument copies, one pair per frame in flight
+
+	float aperture; // 0 = disabled
+	float focusDistance;
+
+	// this frame's graph state, referenced by the pass callbacks until the graph executes
+	RenderGraph* graph;
+	RenderGraphImage source;
+	RenderGraphImage halfImage;
+	RenderGraphImage blur;
+	RenderGraphImage output;
+	DofPush push;
+	u32 frameIndex;
+
+	VkQueryPool timestamps; // two per frame in flight
+	float timestampPeriod;  // ns per tick
+	bool timestampsWritten[MAX_FRAMES_IN_FLIGHT];
+	u32 classifiedTiles[MAX_FRAMES_IN_FLIGHT]; // tile grid the slot's copied counts were classified over
+	double gpuMsAccum;
+	u64 nearTilesAccum;
+	u64 farTilesAccum;
+	u64 tileTotalAccum;
+	u32 gpuFrames;
+	double lastGpuMs;
+} Dof;
+
+void dof_init(Dof* dof, const Application* app, PipelineManager* pipelines, float aperture);
+void dof_destroy(Dof* dof);
+
+// Adds the depth of field passes reading source (sampled, depth in alpha) and returns the
+// result, a transient rgba16f image of extent. Returns source unchanged when disabled or when
+// extent has more than DOF_MAX_TILES tiles.
+RenderGraphImage dof_add_passes(Dof* dof, RenderGraph* graph, RenderGraphImage source, VkExtent2D extent, u32 frameIndex);
+
+// Picks up the timestamps and tile counts of the frame slot whose fence just signaled
+void dof_collect_stats(Dof* dof, u32 frameIndex);
+
+#endif // DOF_H
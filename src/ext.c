@@ -1,3 +1,15 @@
 #define VOLK_IMPLEMENTATION
 #include "../external/volk/volk.h"
 
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../external/stb/stb_image.h"
+
+#define DDSKTX_IMPLEMENT
+#include "../external/dds-ktx/dds-ktx.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../external/stb/stb_image_write.h"
+
+#define LIBRG_IMPL
+#include "../external/librg/code/librg.h"
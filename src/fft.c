@@ -0,0 +1,338 @@
+#include "fft.h"
+#include <math.h>
+#include <string.h>
+
+void fft_init(Fft* fft, const Application* app, PipelineManager* pipelines)
+{
+	memset(fft, 0, sizeof(*fft));
+	fft->device = app->device;
+	fft->pipelines = pipelines;
+
+	// 0: data (rows transform in place, transpose source), 1: transpose destination
+	VkDescriptorSetLayoutBinding bindings[2];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(fft->device, &layoutInfo, NULL, &fft->setLayout));
+
+	VkDescriptorPoolSize poolSize = {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = FFT_MAX_PLANS * 2 * 2};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = FFT_MAX_PLANS * 2,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &poolSize,
+	};
+	VK_CHECK(vkCreateDescriptorPool(fft->device, &poolInfo, NULL, &fft->descriptorPool));
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(FftPush),
+	};
+	fft->pipelineLayout = createPipelineLayout(fft->device, &fft->setLayout, 1, &pcr, 1);
+	PipelineDesc desc = {
+	    .name = "fft_rows",
+	    .computeShader = "compiledshaders/fft.comp.spv",
+	    .layout = fft->pipelineLayout,
+	};
+	fft->rowPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "fft_transpose";
+	desc.computeShader = "compiledshaders/fft_transpose.comp.spv";
+	fft->transposePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+}
+
+void fft_destroy(Fft* fft)
+{
+	vkDestroyPipelineLayout(fft->device, fft->pipelineLayout, NULL);
+	vkDestroyDescriptorPool(fft->device, fft->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(fft->device, fft->setLayout, NULL);
+}
+
+bool fft_create_plan(Fft* fft, FftPlan* plan, u32 n, u32 batch, VkBuffer data, VkBuffer scratch)
+{
+	if (n < FFT_MIN_N || n > FFT_MAX_N || (n & (n - 1)) != 0 || batch == 0)
+	{
+		printf("[FFT] Unsupported size %u (powers of two from %u to %u)\n", n, FFT_MIN_N, FFT_MAX_N);
+		return false;
+	}
+	if (fft->planCount == FFT_MAX_PLANS)
+	{
+		printf("[FFT] Out of plans (%u)\n", FFT_MAX_PLANS);
+		return false;
+	}
+	fft->planCount++;
+
+	*plan = (FftPlan){.data = data, .scratch = scratch, .n = n, .batch = batch};
+	VkDescriptorSetLayout setLayouts[2] = {fft->setLayout, fft->setLayout};
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = fft->descriptorPool,
+	    .descriptorSetCount = 2,
+	    .pSetLayouts = setLayouts,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(fft->device, &allocInfo, plan->sets));
+
+	VkDeviceSize size = (VkDeviceSize)n * n * batch * 2 * sizeof(float);
+	VkDescriptorBufferInfo bufferInfos[2] = {
+	    {data, 0, size},
+	    {scratch, 0, size},
+	};
+	VkWriteDescriptorSet writes[4];
+	for (u32 i = 0; i < 4; ++i)
+	{
+		u32 set = i / 2;
+		u32 binding = i % 2;
+		writes[i] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = plan->sets[set],
+		    .dstBinding = binding,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .pBufferInfo = &bufferInfos[set ^ binding],
+		};
+	}
+	vkUpdateDescriptorSets(fft->device, ARRAYSIZE(writes), writes, 0, NULL);
+	return true;
+}
+
+static void compute_barrier(VkCommandBuffer cmd, VkBuffer buffer)
+{
+	VkBufferMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &barrier, 0, NULL);
+}
+
+bool fft_record(Fft* fft, VkCommandBuffer cmd, const FftPlan* plan, FftDirection direction)
+{
+	VkPipeline rows = pipeline_get(fft->pipelines, fft->rowPipeline);
+	VkPipeline transpose = pipeline_get(fft->pipelines, fft->transposePipeline);
+	if (!rows || !transpose)
+		return false;
+
+	FftPush push = {plan->n, direction == FFT_FORWARD ? -1.0f : 1.0f};
+	vkCmdPushConstants(cmd, fft->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+	// a group covers FFT_MAX_N elements: 512/n rows
+	u32 rowGroups = plan->n * plan->n * plan->batch / FFT_MAX_N;
+	u32 tiles = plan->n / 16;
+
+	// rows of data, data -> scratch transposed, rows of scratch (the columns), back to data
+	for (u32 i = 0; i < 2; ++i)
+	{
+		VkBuffer current = i == 0 ? plan->data : plan->scratch;
+		VkBuffer other = i == 0 ? plan->scratch : plan->data;
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, rows);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, fft->pipelineLayout, 0, 1, &plan->sets[i], 0, NULL);
+		vkCmdDispatch(cmd, rowGroups, 1, 1);
+		compute_barrier(cmd, current);
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, transpose);
+		vkCmdDispatch(cmd, tiles, tiles, plan->batch);
+		compute_barrier(cmd, other);
+	}
+	return true;
+}
+
+// --- Benchmark ---
+
+static void transfer_barrier(VkCommandBuffer cmd, VkBuffer buffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+	VkBufferMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = srcStage,
+	    .srcAccessMask = srcAccess,
+	    .dstStageMask = dstStage,
+	    .dstAccessMask = dstAccess,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &barrier, 0, NULL);
+}
+
+static void submit_and_wait(const Application* app, VkQueue queue, VkCommandBuffer cmd, VkFence fence)
+{
+	VK_CHECK(vkEndCommandBuffer(cmd));
+	VkCommandBufferSubmitInfo cmdInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+	    .commandBuffer = cmd};
+	VkSubmitInfo2 submit = {
+	    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+	    .commandBufferInfoCount = 1,
+	    .pCommandBufferInfos = &cmdInfo};
+	VK_CHECK(vkQueueSubmit2(queue, 1, &submit, fence));
+	VK_CHECK(vkWaitForFences(app->device, 1, &fence, VK_TRUE, UINT64_MAX));
+	VK_CHECK(vkResetFences(app->device, 1, &fence));
+}
+
+static void begin(VkCommandBuffer cmd)
+{
+	VK_CHECK(vkResetCommandBuffer(cmd, 0));
+	VkCommandBufferBeginInfo beginInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+	VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+}
+
+// Reference bin (u, v) of grid 0: direct 2D DFT in double precision
+static void reference_bin(const float* input, u32 n, u32 u, u32 v, double* re, double* im)
+{
+	double sumRe = 0.0, sumIm = 0.0;
+	for (u32 y = 0; y < n; ++y)
+	{
+		for (u32 x = 0; x < n; ++x)
+		{
+			// exponent reduced mod n first so the angle stays exact
+			double angle = -2.0 * 3.14159265358979323846 * (double)((u * x + v * y) % n) / (double)n;
+			double c = cos(angle), s = sin(angle);
+			const float* e = &input[2 * (y * n + x)];
+			sumRe += e[0] * c - e[1] * s;
+			sumIm += e[0] * s + e[1] * c;
+		}
+	}
+	*re = sumRe;
+	*im = sumIm;
+}
+
+int fft_benchmark(Fft* fft, const Application* app, u32 batch, u32 iterations)
+{
+	static const u32 sizes[] = {256, 512};
+	iterations = MAX(iterations, 1u);
+	VkQueue queue;
+	vkGetDeviceQueue(app->device, find_graphics_queue_family_index(app->physicaldevice), 0, &queue);
+	VkCommandPool commandPool = createCommandBufferPool(app->device, app->physicaldevice);
+	VkCommandBuffer cmd = createCommandBuffer(app->device, commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	VkFence fence = CreateFence(app->device);
+	VK_CHECK(vkResetFences(app->device, 1, &fence));
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	float timestampPeriod = props.limits.timestampComputeAndGraphics ? props.limits.timestampPeriod : 0.0f;
+	VkQueryPool timestamps = VK_NULL_HANDLE;
+	if (timestampPeriod > 0.0f)
+	{
+		VkQueryPoolCreateInfo queryInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+		    .queryCount = 2,
+		};
+		VK_CHECK(vkCreateQueryPool(app->device, &queryInfo, NULL, &timestamps));
+	}
+
+	int result = 0;
+	for (u32 s = 0; s < ARRAYSIZE(sizes); ++s)
+	{
+		u32 n = sizes[s];
+		size_t count = (size_t)n * n * batch;
+		size_t size = count * 2 * sizeof(float);
+		AllocatedBuffer data = create_buffer(app->allocator, size,
+		    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		AllocatedBuffer scratch = create_buffer(app->allocator, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		AllocatedBuffer host = create_buffer(app->allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		    VMA_MEMORY_USAGE_GPU_TO_CPU);
+		FftPlan plan;
+		if (!fft_create_plan(fft, &plan, n, batch, data.buffer, scratch.buffer))
+		{
+			result = 1;
+			break;
+		}
+
+		float* input = malloc(size);
+		u32 rng = 0x9e3779b9u;
+		for (size_t i = 0; i < count * 2; ++i)
+		{
+			rng = rng * 1664525u + 1013904223u;
+			input[i] = (float)(rng >> 8) * (2.0f / 16777216.0f) - 1.0f;
+		}
+		float* mapped;
+		VK_CHECK(vmaMapMemory(app->allocator, host.allocation, (void**)&mapped));
+		memcpy(mapped, input, size);
+		vmaFlushAllocation(app->allocator, host.allocation, 0, VK_WHOLE_SIZE);
+
+		// correctness: one forward transform, read back
+		begin(cmd);
+		VkBufferCopy region = {0, 0, size};
+		vkCmdCopyBuffer(cmd, host.buffer, data.buffer, 1, &region);
+		transfer_barrier(cmd, data.buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		    VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		fft_record(fft, cmd, &plan, FFT_FORWARD);
+		transfer_barrier(cmd, data.buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COPY_BIT,
+		    VK_ACCESS_2_TRANSFER_READ_BIT);
+		vkCmdCopyBuffer(cmd, data.buffer, host.buffer, 1, &region);
+		transfer_barrier(cmd, host.buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT,
+		    VK_ACCESS_2_HOST_READ_BIT);
+		submit_and_wait(app, queue, cmd, fence);
+		vmaInvalidateAllocation(app->allocator, host.allocation, 0, VK_WHOLE_SIZE);
+
+		// a spread of bins of the first grid against the direct sum, relative to the largest bin
+		double maxError = 0.0, maxMagnitude = 0.0;
+		u32 bins = 16;
+		for (u32 b = 0; b < bins; ++b)
+		{
+			u32 u = (b * 37u) % n;
+			u32 v = (b * 101u + 3u) % n;
+			double re, im;
+			reference_bin(input, n, u, v, &re, &im);
+			const float* gpu = &mapped[2 * (v * n + u)];
+			maxError = MAX(maxError, hypot(gpu[0] - re, gpu[1] - im));
+			maxMagnitude = MAX(maxMagnitude, hypot(re, im));
+		}
+		double relativeError = maxMagnitude > 0.0 ? maxError / maxMagnitude : maxError;
+		bool correct = relativeError < 1e-3;
+
+		// timing: iterations back to back, each depending on the last
+		begin(cmd);
+		if (timestamps)
+			vkCmdResetQueryPool(cmd, timestamps, 0, 2);
+		if (timestamps)
+			vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, timestamps, 0);
+		for (u32 i = 0; i < iterations; ++i)
+			fft_record(fft, cmd, &plan, (i & 1) ? FFT_INVERSE : FFT_FORWARD);
+		if (timestamps)
+			vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, timestamps, 1);
+		double start = glfwGetTime();
+		submit_and_wait(app, queue, cmd, fence);
+		double ms = (glfwGetTime() - start) * 1e3;
+		u64 ticks[2];
+		if (timestamps &&
+		    vkGetQueryPoolResults(app->device, timestamps, 0, 2, sizeof(ticks), ticks, sizeof(u64), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+			ms = (double)(ticks[1] - ticks[0]) * timestampPeriod * 1e-6;
+
+		printf("[FFT] %ux%u x%u: %.3f ms per 2D transform, %.3f ms per grid (%s time, %u runs), error %.2e %s\n", n, n, batch, ms / iterations,
+		    ms / iterations / batch, timestamps ? "GPU" : "submit", iterations, relativeError, correct ? "ok" : "FAILED");
+		if (!correct)
+			result = 1;
+
+		vmaUnmapMemory(app->allocator, host.allocation);
+		free(input);
+		vmaDestroyBuffer(app->allocator, host.buffer, host.allocation);
+		vmaDestroyBuffer(app->allocator, scratch.buffer, scratch.allocation);
+		vmaDestroyBuffer(app->allocator, data.buffer, data.allocation);
+	}
+
+	if (timestamps)
+		vkDestroyQueryPool(app->device, timestamps, NULL);
+	vkDestroyFence(app->device, fence, NULL);
+	vkDestroyCommandPool(app->device, commandPool, NULL);
+	return result;
+}
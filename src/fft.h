@@ -0,0 +1,67 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include "pipeline_manager.h"
+
+// Batched 2D FFT of n x n complex grids (vec2 per element) in storage buffers, for any compute user
+// - rows: Stockham radix-4 (plus one radix-2 stage for odd powers of two) in shared memory, one
+//   pass over every row of every grid (fft.comp)
+// - columns: transpose through shared tiles, run the rows again, transpose back (fft_transpose.comp)
+// - a plan binds a data buffer and an equally sized scratch buffer; fft_record leaves the result
+//   in data, in natural order, unnormalized
+// - fft_benchmark times 256^2 and 512^2 grids against a CPU reference (--bench-fft)
+
+#define FFT_MIN_N 32
+#define FFT_MAX_N 512 // keep in sync with fft.comp
+#define FFT_MAX_PLANS 8
+
+typedef enum FftDirection
+{
+	FFT_FORWARD = 0,
+	FFT_INVERSE,
+} FftDirection;
+
+// Matches the push constant block of fft.comp and fft_transpose.comp
+typedef struct FftPush
+{
+	u32 n;
+	float direction;
+} FftPush;
+
+typedef struct FftPlan
+{
+	VkBuffer data;
+	VkBuffer scratch;
+	VkDescriptorSet sets[2]; // {data, scratch} and {scratch, data}
+	u32 n;
+	u32 batch;
+} FftPlan;
+
+typedef struct Fft
+{
+	VkDevice device;
+	PipelineManager* pipelines;
+	PipelineHandle rowPipeline;
+	PipelineHandle transposePipeline;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	u32 planCount;
+} Fft;
+
+void fft_init(Fft* fft, const Application* app, PipelineManager* pipelines);
+void fft_destroy(Fft* fft);
+
+// data and scratch hold batch grids of n x n vec2 each; n is a power of two in [FFT_MIN_N, FFT_MAX_N]
+bool fft_create_plan(Fft* fft, FftPlan* plan, u32 n, u32 batch, VkBuffer data, VkBuffer scratch);
+
+// Records the 2D transform of every grid in plan->data. Writes to data must be made visible to
+// compute shaders before; the result is written by compute shaders. Returns false (and records
+// nothing) while the pipelines are still compiling.
+bool fft_record(Fft* fft, VkCommandBuffer cmd, const FftPlan* plan, FftDirection direction);
+
+// Headless benchmark: GPU time per 2D transform at 256^2 and 512^2, batch grids each, checked
+// against a CPU DFT. The pipelines must have been compiled.
+int fft_benchmark(Fft* fft, const Application* app, u32 batch, u32 iterations);
+
+#endif // FFT_H
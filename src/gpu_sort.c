@@ -0,0 +1,191 @@
+#include "gpu_sort.h"
+#include <string.h>
+
+void gpu_sort_init(GpuSort* sort, const Application* app, PipelineManager* pipelines)
+{
+	memset(sort, 0, sizeof(*sort));
+	sort->device = app->device;
+	sort->allocator = app->allocator;
+	sort->pipelines = pipelines;
+
+	// 0: pairs, 1: arguments (count, size, indirect dispatches), 2: the count's source
+	VkDescriptorSetLayoutBinding bindings[3];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(sort->device, &layoutInfo, NULL, &sort->setLayout));
+
+	VkDescriptorPoolSize poolSize = {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = GPU_SORT_MAX_PLANS * 3};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+	    .maxSets = GPU_SORT_MAX_PLANS,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &poolSize,
+	};
+	VK_CHECK(vkCreateDescriptorPool(sort->device, &poolInfo, NULL, &sort->descriptorPool));
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(GpuSortPush),
+	};
+	sort->pipelineLayout = createPipelineLayout(sort->device, &sort->setLayout, 1, &pcr, 1);
+	PipelineDesc desc = {
+	    .name = "sort_args",
+	    .computeShader = "compiledshaders/sort_args.comp.spv",
+	    .layout = sort->pipelineLayout,
+	};
+	sort->argsPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "sort_local";
+	desc.computeShader = "compiledshaders/sort_local.comp.spv";
+	sort->localPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "sort_global";
+	desc.computeShader = "compiledshaders/sort_global.comp.spv";
+	sort->globalPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "sort_merge";
+	desc.computeShader = "compiledshaders/sort_merge.comp.spv";
+	sort->mergePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+}
+
+void gpu_sort_destroy(GpuSort* sort)
+{
+	vkDestroyPipelineLayout(sort->device, sort->pipelineLayout, NULL);
+	vkDestroyDescriptorPool(sort->device, sort->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(sort->device, sort->setLayout, NULL);
+}
+
+u32 gpu_sort_capacity(u32 count)
+{
+	u32 capacity = SORT_BLOCK;
+	while (capacity < count)
+		capacity <<= 1;
+	return capacity;
+}
+
+bool gpu_sort_create_plan(GpuSort* sort, GpuSortPlan* plan, VkBuffer pairs, u32 capacity, VkBuffer countBuffer, VkDeviceSize countOffset)
+{
+	memset(plan, 0, sizeof(*plan));
+	if (capacity < SORT_BLOCK || (capacity & (capacity - 1)) != 0 || capacity > ((u32)SORT_BLOCK << SORT_MAX_LEVELS) || countOffset % sizeof(u32) != 0)
+	{
+		printf("[Sort] Unsupported capacity %u (powers of two from %u to %u)\n", capacity, SORT_BLOCK, (u32)SORT_BLOCK << SORT_MAX_LEVELS);
+		return false;
+	}
+	plan->pairs = pairs;
+	plan->capacity = capacity;
+	plan->countIndex = (u32)(countOffset / sizeof(u32));
+	for (u32 k = SORT_BLOCK * 2; k <= capacity; k <<= 1)
+		plan->levels++;
+	plan->args = create_buffer(sort->allocator, SORT_ARGS_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+	    VMA_MEMORY_USAGE_GPU_ONLY);
+
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = sort->descriptorPool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &sort->setLayout,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(sort->device, &allocInfo, &plan->set));
+	VkDescriptorBufferInfo bufferInfos[3] = {
+	    {pairs, 0, (VkDeviceSize)capacity * 2 * sizeof(u32)},
+	    {plan->args.buffer, 0, VK_WHOLE_SIZE},
+	    {countBuffer, 0, VK_WHOLE_SIZE},
+	};
+	VkWriteDescriptorSet writes[3];
+	for (u32 i = 0; i < 3; ++i)
+	{
+		writes[i] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = plan->set,
+		    .dstBinding = i,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .pBufferInfo = &bufferInfos[i],
+		};
+	}
+	vkUpdateDescriptorSets(sort->device, ARRAYSIZE(writes), writes, 0, NULL);
+	return true;
+}
+
+void gpu_sort_destroy_plan(GpuSort* sort, GpuSortPlan* plan)
+{
+	if (plan->set)
+		vkFreeDescriptorSets(sort->device, sort->descriptorPool, 1, &plan->set);
+	if (plan->args.buffer)
+		vmaDestroyBuffer(sort->allocator, plan->args.buffer, plan->args.allocation);
+	memset(plan, 0, sizeof(*plan));
+}
+
+static void sort_barrier(VkCommandBuffer cmd, VkBuffer buffer, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+	VkBufferMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = dstStage,
+	    .dstAccessMask = dstAccess,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &barrier, 0, NULL);
+}
+
+static void push(GpuSort* sort, VkCommandBuffer cmd, const GpuSortPlan* plan, u32 k, u32 j)
+{
+	GpuSortPush pc = {k, j, plan->countIndex, plan->capacity};
+	vkCmdPushConstants(cmd, sort->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+}
+
+bool gpu_sort_record(GpuSort* sort, VkCommandBuffer cmd, const GpuSortPlan* plan)
+{
+	VkPipeline args = pipeline_get(sort->pipelines, sort->argsPipeline);
+	VkPipeline local = pipeline_get(sort->pipelines, sort->localPipeline);
+	VkPipeline global = pipeline_get(sort->pipelines, sort->globalPipeline);
+	VkPipeline merge = pipeline_get(sort->pipelines, sort->mergePipeline);
+	if (!args || !local || !global || !merge)
+		return false;
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, sort->pipelineLayout, 0, 1, &plan->set, 0, NULL);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, args);
+	push(sort, cmd, plan, 0, 0);
+	vkCmdDispatch(cmd, 1, 1, 1);
+	sort_barrier(cmd, plan->args.buffer, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+	const VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	const VkAccessFlags2 access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, local);
+	vkCmdDispatchIndirect(cmd, plan->args.buffer, SORT_ARGS_LOCAL * sizeof(u32));
+	sort_barrier(cmd, plan->pairs, stage, access);
+
+	u32 level = 0;
+	for (u32 k = SORT_BLOCK * 2; k <= plan->capacity; k <<= 1, ++level)
+	{
+		VkDeviceSize levelArgs = (SORT_ARGS_LEVELS + level * 6) * sizeof(u32);
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, global);
+		for (u32 j = k / 2; j >= SORT_BLOCK; j >>= 1)
+		{
+			push(sort, cmd, plan, k, j);
+			vkCmdDispatchIndirect(cmd, plan->args.buffer, levelArgs);
+			sort_barrier(cmd, plan->pairs, stage, access);
+		}
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, merge);
+		push(sort, cmd, plan, k, 0);
+		vkCmdDispatchIndirect(cmd, plan->args.buffer, levelArgs + 3 * sizeof(u32));
+		sort_barrier(cmd, plan->pairs, stage, access);
+	}
+	return true;
+}
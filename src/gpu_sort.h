@@ -0,0 +1,72 @@
+#ifndef GPU_SORT_H
+#define GPU_SORT_H
+
+#include "pipeline_manager.h"
+
+// Bitonic sort of u32 key / u32 value pairs in a storage buffer, sized on the GPU
+// - the element count is read from a buffer another pass wrote; sort_args.comp turns it into
+//   indirect dispatch arguments, so nothing is read back and unused levels dispatch no groups
+// - sort_local.comp sorts SORT_BLOCK pairs per group in shared memory, sort_global.comp does the
+//   steps wider than a block one pair per thread, sort_merge.comp finishes each level in shared
+//   memory: 2^20 pairs take 66 dispatches instead of 210
+// - ascending by key; entries between the count and the next power of two are overwritten with
+//   max keys
+
+#define SORT_BLOCK 1024 // keep in sync with the sort shaders
+#define SORT_MAX_LEVELS 16 // capacity up to SORT_BLOCK << SORT_MAX_LEVELS
+// uint offsets into the arguments buffer (sort_args.comp)
+#define SORT_ARGS_LOCAL 4
+#define SORT_ARGS_LEVELS 7
+#define SORT_ARGS_SIZE ((SORT_ARGS_LEVELS + SORT_MAX_LEVELS * 6) * sizeof(u32))
+
+// Matches the push constant block of the sort shaders
+typedef struct GpuSortPush
+{
+	u32 k;
+	u32 j;
+	u32 countIndex;
+	u32 capacity;
+} GpuSortPush;
+
+typedef struct GpuSortPlan
+{
+	VkBuffer pairs;
+	u32 capacity; // power of two
+	u32 countIndex;
+	u32 levels;
+	AllocatedBuffer args;
+	VkDescriptorSet set;
+} GpuSortPlan;
+
+typedef struct GpuSort
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	PipelineManager* pipelines;
+	PipelineHandle argsPipeline;
+	PipelineHandle localPipeline;
+	PipelineHandle globalPipeline;
+	PipelineHandle mergePipeline;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+} GpuSort;
+
+#define GPU_SORT_MAX_PLANS 8
+
+void gpu_sort_init(GpuSort* sort, const Application* app, PipelineManager* pipelines);
+void gpu_sort_destroy(GpuSort* sort);
+
+// Smallest capacity a pairs buffer for count elements needs
+u32 gpu_sort_capacity(u32 count);
+
+// pairs: capacity uvec2 (key, value). The element count is the u32 at byte countOffset of
+// countBuffer (a multiple of 4).
+bool gpu_sort_create_plan(GpuSort* sort, GpuSortPlan* plan, VkBuffer pairs, u32 capacity, VkBuffer countBuffer, VkDeviceSize countOffset);
+void gpu_sort_destroy_plan(GpuSort* sort, GpuSortPlan* plan);
+
+// Records the sort. The count and pair writes must be visible to compute shaders; the sorted pairs
+// are written by compute shaders. Returns false while the pipelines are compiling.
+bool gpu_sort_record(GpuSort* sort, VkCommandBuffer cmd, const GpuSortPlan* plan);
+
+#endif // GPU_SORT_H
@@ -1,4 +1,9 @@
 #include "main.h"
+#include "shader_archive.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 VkImageMemoryBarrier2 imageBarrier(VkImage image, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkImageLayout currentLayout, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask, VkImageLayout newLayout, VkImageAspectFlags aspectMask, uint32_t baseMipLevel, uint32_t levelCount)
 {
@@ -55,6 +60,21 @@ VkBool32 hasStencil(VkFormat f)
 
 VkShaderModule LoadShaderModule(const char* filepath, VkDevice device)
 {
+	VkShaderModuleCreateInfo createInfo = {0};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	VkShaderModule shaderModule;
+
+	// straight from the mapped archive when it has this shader
+	const u32* code = NULL;
+	const ShaderArchiveEntry* entry = shader_archive_find(filepath, &code);
+	if (entry)
+	{
+		createInfo.codeSize = entry->size;
+		createInfo.pCode = code;
+		VK_CHECK(vkCreateShaderModule(device, &createInfo, NULL, &shaderModule));
+		return shaderModule;
+	}
+
 	FILE* file = fopen(filepath, "rb");
 	assert(file);
 
@@ -70,18 +90,50 @@ VkShaderModule LoadShaderModule(const char* filepath, VkDevice device)
 	assert(rc == (size_t)length);
 	fclose(file);
 
-	VkShaderModuleCreateInfo createInfo = {0};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	createInfo.codeSize = length;
 	createInfo.pCode = (const u32*)buffer;
-
-	VkShaderModule shaderModule;
 	VK_CHECK(vkCreateShaderModule(device, &createInfo, NULL, &shaderModule));
 
 	free(buffer);
 	return shaderModule;
 }
 
+// mmap the whole file read-only; the pages are shared with the page cache so parsing
+// containers (dds/ktx, shader archives) can hand out pointers into it without copying
+bool map_file(const char* path, MappedFile* out)
+{
+	out->data = NULL;
+	out->size = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps its own reference to the file
+	if (data == MAP_FAILED)
+		return false;
+
+	out->data = (const u8*)data;
+	out->size = (size_t)st.st_size;
+	return true;
+}
+
+void unmap_file(MappedFile* file)
+{
+	if (file->data)
+		munmap((void*)file->data, file->size);
+	file->data = NULL;
+	file->size = 0;
+}
+
 // we might need mutiple command pools per thread for multi threading or you need to have 1 VkCommandPool and 1 VkCommandBuffer per thread
 // commandpool manages command buffers so its command buffer pool
 VkCommandPool createCommandBufferPool(VkDevice device, VkPhysicalDevice physicaldevice)
@@ -91,6 +91,21 @@ VkInstance createInstance()
 	extensions[extensionCount++] = VK_KHR_XLIB_SURFACE_EXTENSION_NAME;
 #endif
 	extensions[extensionCount++] = VK_KHR_SURFACE_EXTENSION_NAME;
+
+	// Optional: HDR10 and other non-sRGB swapchain color spaces
+	u32 availableCount = 0;
+	vkEnumerateInstanceExtensionProperties(NULL, &availableCount, NULL);
+	VkExtensionProperties* available = malloc(availableCount * sizeof(VkExtensionProperties));
+	vkEnumerateInstanceExtensionProperties(NULL, &availableCount, available);
+	for (u32 i = 0; i < availableCount; ++i)
+	{
+		if (strcmp(available[i].extensionName, VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME) == 0)
+		{
+			extensions[extensionCount++] = VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME;
+			break;
+		}
+	}
+	free(available);
 	createInfo.enabledExtensionCount = extensionCount;
 	createInfo.ppEnabledExtensionNames = extensions;
 
@@ -250,6 +265,37 @@ u32 find_graphics_queue_family_index(VkPhysicalDevice pickedPhysicalDevice)
 	free(queueFamilies);
 	return queuefamilyIndex;
 }
+bool physicalDeviceSupportsExtension(VkPhysicalDevice physicalDevice, const char* extensionName)
+{
+	u32 count = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, NULL);
+	VkExtensionProperties* props = malloc(count * sizeof(VkExtensionProperties));
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, props);
+
+	bool found = false;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (strcmp(props[i].extensionName, extensionName) == 0)
+		{
+			found = true;
+			break;
+		}
+	}
+	free(props);
+	return found;
+}
+
+VkSubgroupFeatureFlags computeSubgroupOperations(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceSubgroupProperties subgroup = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES};
+	VkPhysicalDeviceProperties2 props = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &subgroup};
+	vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+	if (!(subgroup.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT))
+		return 0;
+	printf("[Device] subgroup size %u, compute subgroup operations 0x%x\n", subgroup.subgroupSize, subgroup.supportedOperations);
+	return subgroup.supportedOperations;
+}
+
 VkDevice createLogicalDevice(VkPhysicalDevice pickedphysicaldevice)
 {
 	float queuePriorities = 1.0f;
@@ -274,7 +320,17 @@ VkDevice createLogicalDevice(VkPhysicalDevice pickedphysicaldevice)
 	    .dynamicRendering = VK_TRUE,
 	};
 
-	const char* deviceExtensions[] = {
+	// Optional: storage writes without a format qualifier, so the tonemap pass can write BGRA and
+	// 10-bit swapchain images directly
+	VkPhysicalDeviceFeatures supported;
+	vkGetPhysicalDeviceFeatures(pickedphysicaldevice, &supported);
+	VkPhysicalDeviceFeatures2 features2 = {
+	    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+	    .pNext = &dynamicRenderingFeature,
+	    .features = {.shaderStorageImageWriteWithoutFormat = supported.shaderStorageImageWriteWithoutFormat},
+	};
+
+	const char* deviceExtensions[16] = {
 	    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 	    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
 	    VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME, // required by dynamic rendering
@@ -282,13 +338,18 @@ VkDevice createLogicalDevice(VkPhysicalDevice pickedphysicaldevice)
 	    VK_KHR_MULTIVIEW_EXTENSION_NAME,             // required by renderpass2
 	    VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME      // required by vkCmdPipelineBarrier2
 	};
+	u32 deviceExtensionCount = 6;
+
+	// Optional: real heap budgets for VMA (texture streaming sizes itself from these)
+	if (physicalDeviceSupportsExtension(pickedphysicaldevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+		deviceExtensions[deviceExtensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
 
 	VkDeviceCreateInfo deviceInfo = {
 	    .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-	    .pNext = &dynamicRenderingFeature, // chain starts here
+	    .pNext = &features2, // chain starts here
 	    .queueCreateInfoCount = 1,
 	    .pQueueCreateInfos = &queueInfo,
-	    .enabledExtensionCount = ARRAYSIZE(deviceExtensions),
+	    .enabledExtensionCount = deviceExtensionCount,
 	    .ppEnabledExtensionNames = deviceExtensions,
 	};
 
@@ -361,10 +422,23 @@ void selectSwapchainFormat(Application* app)
 	VkSurfaceFormatKHR* formats = malloc(formatCount * sizeof(VkSurfaceFormatKHR));
 	vkGetPhysicalDeviceSurfaceFormatsKHR(app->physicaldevice, app->surface, &formatCount, formats);
 
+	// The tonemap pass writes the swapchain from a compute shader when it can: that needs storage
+	// usage on the surface, storage support for the format and typeless storage writes
+	VkSurfaceCapabilitiesKHR caps;
+	VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(app->physicaldevice, app->surface, &caps));
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(app->physicaldevice, &features);
+	bool storageUsable = (caps.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT) && features.shaderStorageImageWriteWithoutFormat;
+
 	// Default pick first
 	app->swapchainFormat = formats[0].format;
 	app->swapchainColorSpace = formats[0].colorSpace;
+	app->swapchainStorage = false;
 
+	// best first: HDR10 (only with --hdr), 8-bit UNORM encoded by the tonemap pass, then the
+	// sRGB format the blit fallback relies on
+	int best = -1;
+	int bestRank = 0;
 	for (u32 i = 0; i < formatCount; ++i)
 	{
 		printf("[Swapchain] Format[%u]: %s, ColorSpace: %s\n",
@@ -372,16 +446,35 @@ void selectSwapchainFormat(Application* app)
 		    vkFormatToString(formats[i].format),
 		    vkColorSpaceToString(formats[i].colorSpace));
 
-		if (formats[i].format == VK_FORMAT_R8G8B8A8_SRGB)
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(app->physicaldevice, formats[i].format, &props);
+		bool storage = storageUsable && (props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+		bool tenBit = formats[i].format == VK_FORMAT_A2B10G10R10_UNORM_PACK32 || formats[i].format == VK_FORMAT_A2R10G10B10_UNORM_PACK32;
+		bool eightBit = formats[i].format == VK_FORMAT_B8G8R8A8_UNORM || formats[i].format == VK_FORMAT_R8G8B8A8_UNORM;
+		int rank = 0;
+		if (app->hdrOutput && storage && tenBit && formats[i].colorSpace == VK_COLOR_SPACE_HDR10_ST2084_EXT)
+			rank = 3;
+		else if (storage && eightBit && formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+			rank = 2;
+		else if (formats[i].format == VK_FORMAT_R8G8B8A8_SRGB)
+			rank = 1;
+		if (rank > bestRank)
 		{
-			printf("[Swapchain] ✅ Chose preferred format: %s + %s\n",
-			    vkFormatToString(formats[i].format),
-			    vkColorSpaceToString(formats[i].colorSpace));
-			app->swapchainFormat = formats[i].format;
-			app->swapchainColorSpace = formats[i].colorSpace;
-			break;
+			best = (int)i;
+			bestRank = rank;
 		}
 	}
+	if (best >= 0)
+	{
+		printf("[Swapchain] ✅ Chose preferred format: %s + %s\n",
+		    vkFormatToString(formats[best].format),
+		    vkColorSpaceToString(formats[best].colorSpace));
+		app->swapchainFormat = formats[best].format;
+		app->swapchainColorSpace = formats[best].colorSpace;
+		app->swapchainStorage = bestRank >= 2;
+	}
+	if (app->hdrOutput && bestRank < 3)
+		printf("[Swapchain] No HDR10 format usable from compute, falling back to SDR\n");
 
 	printf("[Swapchain] Using format: %s, colorSpace: %s\n",
 	    vkFormatToString(app->swapchainFormat),
@@ -439,7 +532,7 @@ VkSwapchainKHR createSwapchain(Application* app)
 	    .imageColorSpace = app->swapchainColorSpace,
 	    .imageExtent = imageExtent,
 	    .imageArrayLayers = 1,
-	    .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	    .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | (app->swapchainStorage ? VK_IMAGE_USAGE_STORAGE_BIT : 0),
 	    .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
 	    .preTransform = surfaceCapabilities.currentTransform,
 	    .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
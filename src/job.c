@@ -0,0 +1,437 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime, posix_memalign
+#include "job.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// idle threads retry this many times before yielding / going to sleep
+#define JOB_SPIN_COUNT 64
+#define JOB_YIELD_COUNT 256
+
+// Chase-Lev deque (Le et al. 2013, "Correct and Efficient Work-Stealing for Weak Memory Models").
+// Indices grow forever and wrap at 2^32, only their difference matters.
+typedef struct JobDeque
+{
+	volatile c89atomic_uint32 top; // next job to steal
+	u8 pad0[60];
+	volatile c89atomic_uint32 bottom; // next free slot, written by the owner only
+	u8 pad1[60];
+	Job jobs[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct JobSystem
+{
+	bool running;
+	u32 threadCount; // workers + main thread
+	JobDeque* deques; // [threadCount], 0 belongs to the main thread
+	pthread_t workers[JOB_MAX_WORKERS];
+	pthread_key_t threadKey; // thread index + 1, 0 for unknown threads
+
+	volatile c89atomic_uint32 quit;
+	volatile c89atomic_uint32 queued;   // pushed but not taken yet, sleepers wait for this to rise
+	volatile c89atomic_uint32 sleeping;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+} JobSystem;
+
+static JobSystem jobSystem;
+
+double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+}
+
+// --- Deque ---
+
+// Owner only
+static bool deque_push(JobDeque* q, const Job* job)
+{
+	c89atomic_uint32 b = c89atomic_load_explicit_32(&q->bottom, c89atomic_memory_order_relaxed);
+	c89atomic_uint32 t = c89atomic_load_explicit_32(&q->top, c89atomic_memory_order_acquire);
+	if (b - t >= JOB_DEQUE_CAPACITY)
+		return false;
+	q->jobs[b & (JOB_DEQUE_CAPACITY - 1)] = *job;
+	c89atomic_thread_fence(c89atomic_memory_order_release);
+	c89atomic_store_explicit_32(&q->bottom, b + 1, c89atomic_memory_order_relaxed);
+	return true;
+}
+
+// Owner only, newest job first
+static bool deque_pop(JobDeque* q, Job* out)
+{
+	c89atomic_uint32 b = c89atomic_load_explicit_32(&q->bottom, c89atomic_memory_order_relaxed) - 1;
+	c89atomic_store_explicit_32(&q->bottom, b, c89atomic_memory_order_relaxed);
+	c89atomic_thread_fence(c89atomic_memory_order_seq_cst);
+	c89atomic_uint32 t = c89atomic_load_explicit_32(&q->top, c89atomic_memory_order_relaxed);
+	if ((i32)(b - t) < 0)
+	{
+		// empty
+		c89atomic_store_explicit_32(&q->bottom, b + 1, c89atomic_memory_order_relaxed);
+		return false;
+	}
+	*out = q->jobs[b & (JOB_DEQUE_CAPACITY - 1)];
+	if (b != t)
+		return true;
+
+	// last job: race the thieves for it
+	bool won = c89atomic_compare_exchange_strong_explicit_32(&q->top, &t, t + 1, c89atomic_memory_order_seq_cst, c89atomic_memory_order_relaxed);
+	c89atomic_store_explicit_32(&q->bottom, b + 1, c89atomic_memory_order_relaxed);
+	return won;
+}
+
+// Any thread, oldest job first. Fails on contention as well as on empty.
+static bool deque_steal(JobDeque* q, Job* out)
+{
+	c89atomic_uint32 t = c89atomic_load_explicit_32(&q->top, c89atomic_memory_order_acquire);
+	c89atomic_thread_fence(c89atomic_memory_order_seq_cst);
+	c89atomic_uint32 b = c89atomic_load_explicit_32(&q->bottom, c89atomic_memory_order_acquire);
+	if ((i32)(b - t) <= 0)
+		return false;
+	// the slot can only be reused once top moved past it, in which case the CAS below fails
+	Job job = q->jobs[t & (JOB_DEQUE_CAPACITY - 1)];
+	if (!c89atomic_compare_exchange_strong_explicit_32(&q->top, &t, t + 1, c89atomic_memory_order_seq_cst, c89atomic_memory_order_relaxed))
+		return false;
+	*out = job;
+	return true;
+}
+
+// --- Scheduling ---
+
+static void execute(const Job* job)
+{
+	job->func(job->data);
+	if (job->counter)
+		c89atomic_fetch_sub_explicit_32(&job->counter->pending, 1, c89atomic_memory_order_release);
+}
+
+// Own deque first, then steal round robin starting at the next thread
+static bool take_job(u32 self, Job* out)
+{
+	u32 count = jobSystem.threadCount;
+	bool found = self < count && deque_pop(&jobSystem.deques[self], out);
+	for (u32 i = 1; !found && i <= count; ++i)
+	{
+		u32 victim = (self < count ? self + i : i) % count;
+		if (victim != self)
+			found = deque_steal(&jobSystem.deques[victim], out);
+	}
+	if (found)
+		c89atomic_fetch_sub_32(&jobSystem.queued, 1);
+	return found;
+}
+
+static void* worker_main(void* arg)
+{
+	u32 self = (u32)(uintptr_t)arg;
+	pthread_setspecific(jobSystem.threadKey, (void*)(uintptr_t)(self + 1));
+
+	u32 idle = 0;
+	while (!c89atomic_load_32(&jobSystem.quit))
+	{
+		Job job;
+		if (take_job(self, &job))
+		{
+			execute(&job);
+			idle = 0;
+			continue;
+		}
+		if (++idle < JOB_SPIN_COUNT)
+			continue;
+		if (idle < JOB_YIELD_COUNT)
+		{
+			sched_yield();
+			continue;
+		}
+
+		// sleeping is raised before queued is checked and job_run raises queued before it checks
+		// sleeping, so one of the two always sees the other
+		pthread_mutex_lock(&jobSystem.mutex);
+		c89atomic_fetch_add_32(&jobSystem.sleeping, 1);
+		while (c89atomic_load_32(&jobSystem.queued) == 0 && !c89atomic_load_32(&jobSystem.quit))
+			pthread_cond_wait(&jobSystem.wake, &jobSystem.mutex);
+		c89atomic_fetch_sub_32(&jobSystem.sleeping, 1);
+		pthread_mutex_unlock(&jobSystem.mutex);
+		idle = 0;
+	}
+	return NULL;
+}
+
+void job_system_init(u32 workerCount)
+{
+	assert(!jobSystem.running);
+	// at least one worker even on a single core so fire-and-forget jobs (texture decodes) make
+	// progress while the main thread only renders
+	if (workerCount == 0)
+		workerCount = (u32)MAX(sysconf(_SC_NPROCESSORS_ONLN) - 1, 1L);
+	workerCount = MIN(workerCount, (u32)JOB_MAX_WORKERS);
+
+	memset(&jobSystem, 0, sizeof(jobSystem));
+	jobSystem.threadCount = workerCount + 1;
+	void* deques = NULL;
+	if (posix_memalign(&deques, 64, jobSystem.threadCount * sizeof(JobDeque)) != 0)
+		return; // stays stopped, everything runs inline
+	jobSystem.deques = deques;
+	memset(jobSystem.deques, 0, jobSystem.threadCount * sizeof(JobDeque));
+
+	pthread_mutex_init(&jobSystem.mutex, NULL);
+	pthread_cond_init(&jobSystem.wake, NULL);
+	pthread_key_create(&jobSystem.threadKey, NULL);
+	pthread_setspecific(jobSystem.threadKey, (void*)(uintptr_t)1);
+	jobSystem.running = true;
+
+	u32 started = 1;
+	for (; started < jobSystem.threadCount; ++started)
+	{
+		if (pthread_create(&jobSystem.workers[started - 1], NULL, worker_main, (void*)(uintptr_t)started) != 0)
+			break;
+	}
+	jobSystem.threadCount = started;
+	printf("[Job] %u worker threads + main thread\n", started - 1);
+}
+
+void job_system_shutdown(void)
+{
+	if (!jobSystem.running)
+		return;
+
+	// drain whatever the main thread still owns so no counter is left hanging
+	Job job;
+	while (take_job(0, &job))
+		execute(&job);
+
+	pthread_mutex_lock(&jobSystem.mutex);
+	c89atomic_store_32(&jobSystem.quit, 1);
+	pthread_cond_broadcast(&jobSystem.wake);
+	pthread_mutex_unlock(&jobSystem.mutex);
+	for (u32 i = 1; i < jobSystem.threadCount; ++i)
+		pthread_join(jobSystem.workers[i - 1], NULL);
+
+	pthread_key_delete(jobSystem.threadKey);
+	pthread_cond_destroy(&jobSystem.wake);
+	pthread_mutex_destroy(&jobSystem.mutex);
+	free(jobSystem.deques);
+	memset(&jobSystem, 0, sizeof(jobSystem));
+}
+
+u32 job_thread_count(void)
+{
+	return jobSystem.running ? jobSystem.threadCount : 1;
+}
+
+u32 job_thread_index(void)
+{
+	if (!jobSystem.running)
+		return 0;
+	return (u32)(uintptr_t)pthread_getspecific(jobSystem.threadKey) - 1;
+}
+
+void job_run(JobFunc func, void* data, JobCounter* counter)
+{
+	Job job = {.func = func, .data = data, .counter = counter};
+	if (counter)
+		c89atomic_fetch_add_32(&counter->pending, 1);
+
+	u32 self = job_thread_index();
+	if (!jobSystem.running || self >= jobSystem.threadCount)
+	{
+		execute(&job);
+		return;
+	}
+
+	c89atomic_fetch_add_32(&jobSystem.queued, 1);
+	if (!deque_push(&jobSystem.deques[self], &job))
+	{
+		c89atomic_fetch_sub_32(&jobSystem.queued, 1);
+		execute(&job);
+		return;
+	}
+	if (c89atomic_load_32(&jobSystem.sleeping) > 0)
+	{
+		pthread_mutex_lock(&jobSystem.mutex);
+		pthread_cond_signal(&jobSystem.wake);
+		pthread_mutex_unlock(&jobSystem.mutex);
+	}
+}
+
+bool job_done(const JobCounter* counter)
+{
+	return c89atomic_load_explicit_32((volatile c89atomic_uint32*)&counter->pending, c89atomic_memory_order_acquire) == 0;
+}
+
+void job_wait(JobCounter* counter)
+{
+	u32 self = job_thread_index();
+	u32 idle = 0;
+	while (!job_done(counter))
+	{
+		Job job;
+		if (jobSystem.running && take_job(self, &job))
+		{
+			execute(&job);
+			idle = 0;
+		}
+		else if (++idle >= JOB_SPIN_COUNT)
+		{
+			sched_yield();
+		}
+	}
+}
+
+// --- Parallel for ---
+
+typedef struct ParallelFor
+{
+	JobRangeFunc func;
+	void* data;
+	u32 count;
+	u32 batchSize;
+	volatile c89atomic_uint32 next;
+} ParallelFor;
+
+static void parallel_for_job(void* arg)
+{
+	ParallelFor* pf = (ParallelFor*)arg;
+	for (;;)
+	{
+		u32 begin = c89atomic_fetch_add_32(&pf->next, pf->batchSize);
+		if (begin >= pf->count)
+			break;
+		pf->func(pf->data, begin, MIN(begin + pf->batchSize, pf->count));
+	}
+}
+
+void job_parallel_for(u32 count, u32 batchSize, JobRangeFunc func, void* data)
+{
+	if (count == 0)
+		return;
+	u32 threads = job_thread_count();
+	if (batchSize == 0)
+		batchSize = MAX(count / (threads * 8), 1u); // a few batches per thread to even out imbalance
+
+	ParallelFor pf = {.func = func, .data = data, .count = count, .batchSize = batchSize, .next = 0};
+	u32 batches = (count + batchSize - 1) / batchSize;
+	u32 helpers = MIN(threads - 1, batches - 1);
+	JobCounter counter = {0};
+	for (u32 i = 0; i < helpers; ++i)
+		job_run(parallel_for_job, &pf, &counter);
+	parallel_for_job(&pf);
+	job_wait(&counter);
+}
+
+// --- Benchmark ---
+
+static void empty_job(void* data)
+{
+	(void)data;
+}
+
+typedef struct FibJob
+{
+	u32 n;
+	u64 result;
+} FibJob;
+
+static u64 fib_serial(u32 n)
+{
+	return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+// One job per call, no cutoff: measures fork/join overhead, not arithmetic
+static void fib_job(void* data)
+{
+	FibJob* f = (FibJob*)data;
+	if (f->n < 2)
+	{
+		f->result = f->n;
+		return;
+	}
+	JobCounter counter = {0};
+	FibJob a = {.n = f->n - 1};
+	FibJob b = {.n = f->n - 2};
+	job_run(fib_job, &a, &counter);
+	fib_job(&b);
+	job_wait(&counter);
+	f->result = a.result + b.result;
+}
+
+typedef struct SumRange
+{
+	const float* values;
+	double* partial; // one slot per batch
+	u32 batchSize;
+} SumRange;
+
+static void sum_range(void* data, u32 begin, u32 end)
+{
+	SumRange* s = (SumRange*)data;
+	double sum = 0.0;
+	for (u32 i = begin; i < end; ++i)
+		sum += sqrt((double)s->values[i]);
+	s->partial[begin / s->batchSize] = sum;
+}
+
+int job_benchmark(u32 workerCount)
+{
+	job_system_init(workerCount);
+	u32 threads = job_thread_count();
+	printf("[Job] benchmark: %u threads\n", threads);
+
+	// 1. empty jobs, spawned in rounds that fit the deque
+	const u32 rounds = 1000, perRound = 1024;
+	double t0 = now_ms();
+	for (u32 r = 0; r < rounds; ++r)
+	{
+		JobCounter counter = {0};
+		for (u32 i = 0; i < perRound; ++i)
+			job_run(empty_job, NULL, &counter);
+		job_wait(&counter);
+	}
+	double emptyMs = now_ms() - t0;
+	printf("[Job] empty: %u jobs in %.1f ms, %.0f ns/job\n", rounds * perRound, emptyMs, emptyMs * 1e6 / (rounds * perRound));
+
+	// 2. fork/join recursion
+	const u32 fibN = 27;
+	t0 = now_ms();
+	u64 expected = fib_serial(fibN);
+	double serialMs = now_ms() - t0;
+	FibJob root = {.n = fibN};
+	t0 = now_ms();
+	fib_job(&root);
+	double fibMs = now_ms() - t0;
+	u64 calls = 2 * fib_serial(fibN + 1) - 1;
+	printf("[Job] fib(%u) = %llu%s: %.1f ms (serial %.1f ms), %.0f ns/job\n", fibN, (unsigned long long)root.result,
+	    root.result == expected ? "" : " MISMATCH", fibMs, serialMs, fibMs * 1e6 / (double)calls);
+
+	// 3. parallel for over a large array
+	const u32 count = 1u << 24;
+	float* values = malloc(count * sizeof(float));
+	for (u32 i = 0; i < count; ++i)
+		values[i] = (float)(i & 1023);
+	const u32 batchSize = 1u << 14;
+	double* partial = calloc(count / batchSize, sizeof(double));
+	SumRange range = {.values = values, .partial = partial, .batchSize = batchSize};
+
+	t0 = now_ms();
+	sum_range(&(SumRange){.values = values, .partial = partial, .batchSize = count}, 0, count);
+	double singleMs = now_ms() - t0;
+	double singleSum = partial[0];
+
+	t0 = now_ms();
+	job_parallel_for(count, batchSize, sum_range, &range);
+	double parallelMs = now_ms() - t0;
+	double parallelSum = 0.0;
+	for (u32 i = 0; i < count / batchSize; ++i)
+		parallelSum += partial[i];
+	printf("[Job] parallel for: %u items, %.1f ms (1 thread %.1f ms), %.2fx%s\n", count, parallelMs, singleMs,
+	    singleMs / parallelMs, fabs(parallelSum - singleSum) < 1e-6 * singleSum ? "" : " MISMATCH");
+
+	free(partial);
+	free(values);
+	job_system_shutdown();
+	return root.result == expected ? 0 : 1;
+}
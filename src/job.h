@@ -0,0 +1,59 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include "types.h"
+#include "../external/c89atomic/c89atomic.h"
+
+// Job system (no fibers)
+// - one worker thread per core minus the main thread, each with a Chase-Lev work-stealing deque:
+//   the owner pushes/pops at the bottom (LIFO, cache warm), idle workers steal from the top
+// - fork-join via counters: job_run increments, completion decrements, job_wait returns at zero
+// - waiting never blocks: the waiting thread (main or worker) runs other jobs until the counter
+//   drops, so jobs may spawn and wait on children freely
+// - before job_system_init, and on threads the system didn't start, job_run executes the job inline
+
+#define JOB_MAX_WORKERS 64
+#define JOB_DEQUE_CAPACITY 4096 // per thread, power of two; a full deque runs the job inline
+
+typedef void (*JobFunc)(void* data);
+// Processes [begin, end) of a job_parallel_for range
+typedef void (*JobRangeFunc)(void* data, u32 begin, u32 end);
+
+typedef struct JobCounter
+{
+	volatile c89atomic_uint32 pending;
+} JobCounter;
+
+typedef struct Job
+{
+	JobFunc func;
+	void* data;
+	JobCounter* counter; // may be NULL (fire and forget)
+} Job;
+
+// workerCount 0 = one per core minus the calling (main) thread, at least one
+void job_system_init(u32 workerCount);
+// Outstanding counters must have been waited on
+void job_system_shutdown(void);
+// Threads that execute jobs, including the main thread
+u32 job_thread_count(void);
+// 0 for the main thread, 1.. for workers, UINT32_MAX for threads the system doesn't know
+u32 job_thread_index(void);
+
+// data must stay alive until the counter reaches zero
+void job_run(JobFunc func, void* data, JobCounter* counter);
+// Runs other jobs until counter reaches zero
+void job_wait(JobCounter* counter);
+bool job_done(const JobCounter* counter);
+
+// Splits [0, count) into batches of batchSize (0 = picked from the thread count) and blocks
+// until all of them ran; the caller processes batches too
+void job_parallel_for(u32 count, u32 batchSize, JobRangeFunc func, void* data);
+
+// Monotonic clock in milliseconds, for timings and the benchmarks
+double now_ms(void);
+
+// Scheduler microbenchmark: empty job overhead, recursive fib, parallel for
+int job_benchmark(u32 workerCount);
+
+#endif // JOB_H
@@ -1,8 +1,29 @@
 #include "main.h"
+#include "bloom.h"
+#include "bvh.h"
+#include "dof.h"
+#include "fft.h"
+#include "job.h"
+#include "task.h"
+#include "pathtracer.h"
+#include "pipeline_manager.h"
+#include "render_graph.h"
+#include "scene_pass.h"
+#include "texture.h"
+#include "tonemap.h"
+#include "water.h"
+#include "particles.h"
+#include "shader_reload.h"
+#include "shader_archive.h"
+#include "autotune.h"
+#include "world_stream.h"
+#include "overlay.h"
 #include <GLFW/glfw3.h>
 #include <math.h>
 #include <string.h>
 #include "../external/SPIRV-Reflect/spirv_reflect.h"
+#include "../external/stb/stb_image.h"
+#include "../external/stb/stb_image_write.h"
 AllocatedBuffer create_buffer(VmaAllocator allocator, size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage)
 {
 	VkBufferCreateInfo bufferInfo = {
@@ -20,6 +41,25 @@ AllocatedBuffer create_buffer(VmaAllocator allocator, size_t allocSize, VkBuffer
 
 	return newBuffer;
 }
+
+VmaAllocator createAllocator(Application* app)
+{
+	VmaVulkanFunctions vmaFuncs = {0};
+	vmaFuncs.vkGetInstanceProcAddr = vkGetInstanceProcAddr;
+	vmaFuncs.vkGetDeviceProcAddr = vkGetDeviceProcAddr;
+	VmaAllocatorCreateInfo allocatorInfo = {
+	    .flags = app->memoryBudgetSupported ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0,
+	    .instance = app->instance,
+	    .physicalDevice = app->physicaldevice,
+	    .device = app->device,
+	    .pVulkanFunctions = &vmaFuncs,
+	    .vulkanApiVersion = VK_API_VERSION_1_3,
+	};
+	VmaAllocator allocator;
+	VK_CHECK(vmaCreateAllocator(&allocatorInfo, &allocator));
+	return allocator;
+}
+
 void createDrawImage(Application* app, VmaAllocator allocator)
 {
 	VkExtent3D extent = {
@@ -36,6 +76,7 @@ void createDrawImage(Application* app, VmaAllocator allocator)
 	usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 	usage |= VK_IMAGE_USAGE_STORAGE_BIT;
 	usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	usage |= VK_IMAGE_USAGE_SAMPLED_BIT; // post passes read it through a sampler
 
 	VkImageCreateInfo imgInfo = {
 	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -62,6 +103,9 @@ void createDrawImage(Application* app, VmaAllocator allocator)
 	app->drawImage.imageView = createImageView(app->device, app->drawImage.image, app->drawImage.imageFormat, VK_IMAGE_VIEW_TYPE_2D, 0, 1, 0, 1);
 	app->drawExtent.width = extent.width;
 	app->drawExtent.height = extent.height;
+	app->drawImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	app->drawImageStages = VK_PIPELINE_STAGE_2_NONE;
+	app->drawImageAccess = 0;
 }
 
 void CopyImagetoImage(VkCommandBuffer cmd, VkImage src, VkImageLayout srcLayout, VkImage dst, VkImageLayout dstLayout,
@@ -226,12 +270,644 @@ void createSyncObjects(FrameData* frameData, Application* app)
 	}
 }
 
-int main(void)
+// Depth of field focuses on whatever the camera orbits
+static float camera_focus_distance(const PathTracerCamera* camera)
+{
+	float d[3] = {camera->target[0] - camera->position[0], camera->target[1] - camera->position[1], camera->target[2] - camera->position[2]};
+	return sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+}
+
+// Arrow keys orbit the camera around its target, page up/down dolly. Untouched keys leave the
+// camera bit-identical so accumulation is not reset by float noise.
+static void orbit_camera(GLFWwindow* window, PathTracerCamera* camera, float dt)
+{
+	float yaw = 0.0f, pitch = 0.0f, dolly = 1.0f;
+	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+		yaw -= dt;
+	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+		yaw += dt;
+	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+		pitch += dt;
+	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+		pitch -= dt;
+	if (glfwGetKey(window, GLFW_KEY_PAGE_UP) == GLFW_PRESS)
+		dolly -= dt;
+	if (glfwGetKey(window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS)
+		dolly += dt;
+	if (yaw == 0.0f && pitch == 0.0f && dolly == 1.0f)
+		return;
+
+	float offset[3] = {camera->position[0] - camera->target[0], camera->position[1] - camera->target[1], camera->position[2] - camera->target[2]};
+	float radius = sqrtf(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+	float theta = atan2f(offset[0], offset[2]) + yaw;
+	float phi = CLAMP(asinf(offset[1] / radius) + pitch, -1.5f, 1.5f);
+	radius = MAX(radius * dolly, 0.05f);
+	camera->position[0] = camera->target[0] + radius * cosf(phi) * sinf(theta);
+	camera->position[1] = camera->target[1] + radius * sinf(phi);
+	camera->position[2] = camera->target[2] + radius * cosf(phi) * cosf(theta);
+}
+
+// Everything the frame's render graph passes need, filled in once per frame
+typedef struct FramePasses
+{
+	Application* app;
+	u32 frameIndex;
+	u32 swapchainImageIndex;
+	ScenePass* scenePass;
+	PathTracer* pathTracer;
+	Water* water;
+	RenderGraphImage waterDepth;
+	Particles* particles;
+	RenderGraphImage particleTarget;
+	const PathTracerCamera* camera; // orbited once per frame before the graph is built
+	double time;                    // seconds, sampled once per frame
+	float dt;                       // since the previous frame
+	PipelineManager* pipelines;
+	PipelineHandle gradPipeline;
+	VkPipelineLayout gradLayout;
+	VkDescriptorSet gradDescriptorSet;
+	RenderGraph* graph;
+	RenderGraphImage blitSource;
+} FramePasses;
+
+static void scene_node(VkCommandBuffer cmd, void* data)
+{
+	FramePasses* f = (FramePasses*)data;
+	scene_pass_record(f->scenePass, cmd, f->frameIndex, f->app->drawImage.imageView, (VkExtent2D){f->app->drawExtent.width, f->app->drawExtent.height});
+}
+
+static void pathtrace_node(VkCommandBuffer cmd, void* data)
+{
+	FramePasses* f = (FramePasses*)data;
+	pathtracer_set_camera(f->pathTracer, f->camera);
+	pathtracer_dispatch(f->pathTracer, cmd, (VkExtent2D){f->app->drawExtent.width, f->app->drawExtent.height});
+}
+
+static void water_node(VkCommandBuffer cmd, void* data)
+{
+	FramePasses* f = (FramePasses*)data;
+	water_simulate(f->water, cmd, f->frameIndex, (float)f->time, f->dt);
+	water_draw(f->water, cmd, f->app->drawImage.imageView, render_graph_image_view(f->graph, f->waterDepth),
+	    (VkExtent2D){f->app->drawExtent.width, f->app->drawExtent.height}, f->camera);
+}
+
+static void particle_node(VkCommandBuffer cmd, void* data)
+{
+	FramePasses* f = (FramePasses*)data;
+	particles_simulate(f->particles, cmd, f->frameIndex, f->camera, (float)f->time, f->dt);
+	particles_draw(f->particles, cmd, render_graph_image_view(f->graph, f->particleTarget),
+	    (VkExtent2D){f->app->drawExtent.width, f->app->drawExtent.height}, f->camera);
+}
+
+// Dispatch grad.comp to fill the draw image
+static void grad_node(VkCommandBuffer cmd, void* data)
+{
+	FramePasses* f = (FramePasses*)data;
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, f->gradLayout, 0, 1, &f->gradDescriptorSet, 0, NULL);
+	// Push current time (seconds) into the shader push constant block
+	float timeSec = (float)glfwGetTime();
+	vkCmdPushConstants(cmd, f->gradLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float), &timeSec);
+	// one invocation per pixel, grouped by whatever workgroup size the variant was specialized to
+	pipeline_dispatch(f->pipelines, cmd, f->gradPipeline, f->app->drawExtent.width, f->app->drawExtent.height, 1);
+}
+
+// execute copy (blit, allows different sizes)
+static void blit_node(VkCommandBuffer cmd, void* data)
+{
+	FramePasses* f = (FramePasses*)data;
+	VkExtent3D srcExtent = {f->app->drawExtent.width, f->app->drawExtent.height, 1};
+	VkExtent3D dstExtent = {f->app->width, f->app->height, 1};
+	CopyImagetoImage(cmd,
+	    render_graph_image(f->graph, f->blitSource), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	    f->app->swapchainImages[f->swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	    srcExtent, dstExtent,
+	    VK_IMAGE_ASPECT_COLOR_BIT,
+	    0, 0, 0, 0, 1,
+	    VK_FILTER_LINEAR);
+}
+
+typedef struct OfflineReadback
+{
+	RenderGraph* graph;
+	RenderGraphImage image;
+	VkBuffer buffer;
+	VkExtent3D extent;
+} OfflineReadback;
+
+static void readback_node(VkCommandBuffer cmd, void* data)
+{
+	OfflineReadback* r = (OfflineReadback*)data;
+	VkBufferImageCopy region = {
+	    .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+	    .imageExtent = r->extent,
+	};
+	vkCmdCopyImageToBuffer(cmd, render_graph_image(r->graph, r->image), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, r->buffer, 1, &region);
+}
+
+static float encode_srgb(float c)
+{
+	c = CLAMP(c, 0.0f, 1.0f);
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+#define BLOOM_COMPARE_MIN_PSNR 40.0
+
+// PSNR of the RGB channels in display space (clamped, sRGB encoded, 8 bit for .png references)
+static double compare_to_reference(const float* pixels, u32 width, u32 height, const char* refPath)
+{
+	int w, h, n;
+	const char* ext = strrchr(refPath, '.');
+	bool hdr = ext && strcmp(ext, ".hdr") == 0;
+	float* refF = NULL;
+	u8* ref8 = NULL;
+	if (hdr)
+		refF = stbi_loadf(refPath, &w, &h, &n, 4);
+	else
+		ref8 = stbi_load(refPath, &w, &h, &n, 4);
+	if ((!refF && !ref8) || w != (int)width || h != (int)height)
+	{
+		printf("[Compare] Cannot use reference %s (%s)\n", refPath, (refF || ref8) ? "size mismatch" : stbi_failure_reason());
+		stbi_image_free(refF);
+		stbi_image_free(ref8);
+		return -1.0;
+	}
+
+	double sum = 0.0;
+	size_t pixelCount = (size_t)width * height;
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		for (u32 c = 0; c < 3; ++c)
+		{
+			float a = encode_srgb(pixels[i * 4 + c]);
+			float b;
+			if (hdr)
+				b = encode_srgb(refF[i * 4 + c]);
+			else
+			{
+				a = floorf(a * 255.0f + 0.5f) / 255.0f;
+				b = ref8[i * 4 + c] / 255.0f;
+			}
+			sum += (double)(a - b) * (a - b);
+		}
+	}
+	stbi_image_free(refF);
+	stbi_image_free(ref8);
+	double mse = sum / (double)(pixelCount * 3);
+	return mse > 0.0 ? 10.0 * log10(1.0 / mse) : INFINITY;
+}
+
+// The device, with no window or swapchain, for the modes that run without one
+static void headless_init(Application* app)
+{
+	glfwInit(); // createInstance asks GLFW for instance extensions
+	volkInitialize();
+	app->instance = createInstance();
+	volkLoadInstance(app->instance);
+	app->physicaldevice = pickPhysicalDevice(app->instance);
+	print_gpu_info(app->physicaldevice);
+	app->device = createLogicalDevice(app->physicaldevice);
+	volkLoadDevice(app->device);
+	app->memoryBudgetSupported = physicalDeviceSupportsExtension(app->physicaldevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	app->computeSubgroupOps = computeSubgroupOperations(app->physicaldevice);
+	app->allocator = createAllocator(app);
+}
+
+// After the mode has destroyed everything it allocated
+static void headless_shutdown(Application* app)
+{
+	vmaDestroyAllocator(app->allocator);
+	vkDestroyDevice(app->device, NULL);
+	vkDestroyInstance(app->instance, NULL);
+	glfwTerminate();
+}
+
+// Renders `samples` path traced samples per pixel without a window, runs depth of field and the
+// bloom chain over the mean and writes it to outPath (.hdr keeps the float data, anything else is written as an sRGB
+// png). With comparePath the result is checked against a golden image.
+static int pathtrace_offline(u32 samples, const char* outPath, u32 bloomMips, float dofAperture, const char* comparePath)
+{
+	Application app = {0};
+	app.width = 512;
+	app.height = 512;
+	headless_init(&app);
+	createDrawImage(&app, app.allocator);
+
+	PathTracerScene scene;
+	PathTracerCamera camera;
+	pathtracer_cornell_box(&scene, &camera);
+	PipelineManager* pipelines = malloc(sizeof(PipelineManager));
+	pipeline_manager_init(pipelines, &app);
+	PathTracer* pt = malloc(sizeof(PathTracer));
+	pathtracer_init(pt, &app, pipelines, &scene);
+	Dof* dof = malloc(sizeof(Dof));
+	dof_init(dof, &app, pipelines, dofAperture);
+	dof->focusDistance = camera_focus_distance(&camera);
+	Bloom* bloom = malloc(sizeof(Bloom));
+	bloom_init(bloom, &app, pipelines, bloomMips);
+	pipeline_compile_startup(pipelines);
+	pathtracer_bind_target(pt, app.drawImage.imageView);
+	pathtracer_set_camera(pt, &camera);
+
+	VkQueue queue;
+	vkGetDeviceQueue(app.device, find_graphics_queue_family_index(app.physicaldevice), 0, &queue);
+	VkCommandPool commandPool = createCommandBufferPool(app.device, app.physicaldevice);
+	VkCommandBuffer cmd = createCommandBuffer(app.device, commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	VkFence fence = CreateFence(app.device);
+	RenderGraph* graph = malloc(sizeof(RenderGraph));
+	render_graph_init(graph, &app);
+
+	// sized for the rgba32f draw image; the post passes output rgba16f
+	size_t pixelCount = (size_t)app.width * app.height;
+	AllocatedBuffer readback = create_buffer(app.allocator, pixelCount * 4 * sizeof(float), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+	// Submit in small batches so no single submission runs into the driver's GPU timeout
+	const u32 batchSize = 16;
+	VkExtent2D extent = {app.width, app.height};
+	RenderGraphImage drawRes = 0;
+	RenderGraphImage finalImage = 0;
+	OfflineReadback readbackNode;
+	double start = glfwGetTime();
+	for (u32 done = 0; done < samples;)
+	{
+		u32 count = MIN(batchSize, samples - done);
+		VK_CHECK(vkWaitForFences(app.device, 1, &fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK(vkResetFences(app.device, 1, &fence));
+		VK_CHECK(vkResetCommandBuffer(cmd, 0));
+		VkCommandBufferBeginInfo beginInfo = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+		VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			// each sample reads the previous mean
+			VkImageMemoryBarrier2 toGeneral = imageBarrier(
+			    app.drawImage.image,
+			    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			    VK_ACCESS_2_SHADER_WRITE_BIT,
+			    app.drawImageLayout,
+			    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			    VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+			    VK_IMAGE_LAYOUT_GENERAL,
+			    VK_IMAGE_ASPECT_COLOR_BIT,
+			    0, 1);
+			pipelineBarrier(cmd, 0, 0, NULL, 1, &toGeneral);
+			app.drawImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			pathtracer_dispatch(pt, cmd, extent);
+		}
+		done += count;
+
+		if (done == samples)
+		{
+			// same post chain as the window path, then copy out whatever it produced
+			render_graph_begin(graph);
+			drawRes = render_graph_import_image(graph, "draw", app.drawImage.image, app.drawImage.imageView, VK_IMAGE_ASPECT_COLOR_BIT,
+			    app.drawImageLayout, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT);
+			finalImage = dof_add_passes(dof, graph, drawRes, extent, 0);
+			finalImage = bloom_add_passes(bloom, graph, finalImage, extent, 0);
+			readbackNode = (OfflineReadback){graph, finalImage, readback.buffer, app.drawImage.imageExtent};
+			RenderGraphPass pass = render_graph_add_pass(graph, "readback", readback_node, &readbackNode);
+			render_graph_use(graph, pass, finalImage, RG_USAGE_TRANSFER_SRC);
+			render_graph_export_image(graph, drawRes, VK_IMAGE_LAYOUT_UNDEFINED);
+			render_graph_execute(graph, cmd);
+		}
+		VK_CHECK(vkEndCommandBuffer(cmd));
+
+		VkCommandBufferSubmitInfo cmdInfo = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+		    .commandBuffer = cmd};
+		VkSubmitInfo2 submit = {
+		    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+		    .commandBufferInfoCount = 1,
+		    .pCommandBufferInfos = &cmdInfo};
+		VK_CHECK(vkQueueSubmit2(queue, 1, &submit, fence));
+	}
+	VK_CHECK(vkWaitForFences(app.device, 1, &fence, VK_TRUE, UINT64_MAX));
+	printf("[PathTracer] %u samples at %ux%u in %.2f s\n", samples, app.width, app.height, glfwGetTime() - start);
+
+	bloom_collect_timings(bloom, 0);
+	if (bloom->mipCount > 0)
+		printf("[Bloom] %u levels at %ux%u: %.3f ms GPU\n", bloom->mipCount, app.width, app.height, bloom->lastGpuMs);
+
+	void* mapped;
+	VK_CHECK(vmaMapMemory(app.allocator, readback.allocation, &mapped));
+	vmaInvalidateAllocation(app.allocator, readback.allocation, 0, VK_WHOLE_SIZE);
+	float* pixels = (float*)mapped;
+	if (finalImage != drawRes)
+	{
+		// rgba16f: widen in place, back to front so no half is overwritten before it is read
+		const u16* halves = (const u16*)mapped;
+		for (size_t i = pixelCount * 4; i-- > 0;)
+			pixels[i] = half_to_float(halves[i]);
+	}
+	const char* ext = strrchr(outPath, '.');
+	int written;
+	if (ext && strcmp(ext, ".hdr") == 0)
+	{
+		written = stbi_write_hdr(outPath, (int)app.width, (int)app.height, 4, pixels);
+	}
+	else
+	{
+		u8* ldr = malloc(pixelCount * 4);
+		for (size_t i = 0; i < pixelCount * 4; ++i)
+		{
+			// alpha of the draw image is depth, the png is opaque
+			float c = (i & 3) != 3 ? encode_srgb(pixels[i]) : 1.0f;
+			ldr[i] = (u8)(c * 255.0f + 0.5f);
+		}
+		written = stbi_write_png(outPath, (int)app.width, (int)app.height, 4, ldr, (int)app.width * 4);
+		free(ldr);
+	}
+	printf(written ? "[PathTracer] Wrote %s\n" : "[PathTracer] Failed to write %s\n", outPath);
+
+	// golden image check: fails below BLOOM_COMPARE_MIN_PSNR so scripts can gate on the exit code
+	bool matches = true;
+	if (comparePath)
+	{
+		double psnr = compare_to_reference(pixels, app.width, app.height, comparePath);
+		matches = psnr >= BLOOM_COMPARE_MIN_PSNR;
+		printf("[Compare] %s: PSNR %.2f dB (%s, threshold %.0f dB)\n", comparePath, psnr, matches ? "pass" : "FAIL", BLOOM_COMPARE_MIN_PSNR);
+	}
+	vmaUnmapMemory(app.allocator, readback.allocation);
+
+	render_graph_destroy(graph);
+	free(graph);
+	vmaDestroyBuffer(app.allocator, readback.buffer, readback.allocation);
+	vkDestroyFence(app.device, fence, NULL);
+	vkDestroyCommandPool(app.device, commandPool, NULL);
+	pipeline_manager_destroy(pipelines);
+	free(pipelines);
+	bloom_destroy(bloom);
+	free(bloom);
+	dof_destroy(dof);
+	free(dof);
+	pathtracer_destroy(pt);
+	free(pt);
+	pathtracer_scene_free(&scene);
+	vkDestroyImageView(app.device, app.drawImage.imageView, NULL);
+	vmaDestroyImage(app.allocator, app.drawImage.image, app.drawImage.allocation);
+	headless_shutdown(&app);
+	return written && matches ? 0 : 1;
+}
+
+// --bench-fft: the ocean's FFT on its own, one cascade (4 complex grids) per transform
+static int fft_bench(u32 iterations)
+{
+	Application app = {0};
+	headless_init(&app);
+
+	PipelineManager* pipelines = malloc(sizeof(PipelineManager));
+	pipeline_manager_init(pipelines, &app);
+	Fft fft;
+	fft_init(&fft, &app, pipelines);
+	pipeline_compile_startup(pipelines);
+	int result = fft_benchmark(&fft, &app, 4, iterations);
+
+	pipeline_manager_destroy(pipelines);
+	free(pipelines);
+	fft_destroy(&fft);
+	headless_shutdown(&app);
+	return result;
+}
+
+// --bench-world: world streaming over two world sizes, no rendering, only its buffers
+static int world_bench(u32 entityCount)
+{
+	Application app = {0};
+	headless_init(&app);
+
+	int result = world_stream_benchmark(&app, entityCount);
+
+	headless_shutdown(&app);
+	return result;
+}
+
+// grad.comp as an autotune pass: its one storage image and the time push constant
+typedef struct GradTunable
+{
+	VkDevice device;
+	VkPipelineLayout layout;
+	VkDescriptorSet set;
+} GradTunable;
+
+static void grad_tune_prepare(void* user, VkImageView target, u32 width, u32 height)
+{
+	(void)width;
+	(void)height;
+	GradTunable* g = (GradTunable*)user;
+	VkDescriptorImageInfo storageInfo = {.imageView = target, .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+	VkWriteDescriptorSet write = {
+	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+	    .dstSet = g->set,
+	    .dstBinding = 0,
+	    .descriptorCount = 1,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+	    .pImageInfo = &storageInfo,
+	};
+	vkUpdateDescriptorSets(g->device, 1, &write, 0, NULL);
+}
+
+static void grad_tune_bind(void* user, VkCommandBuffer cmd)
+{
+	GradTunable* g = (GradTunable*)user;
+	float timeSec = 1.0f;
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g->layout, 0, 1, &g->set, 0, NULL);
+	vkCmdPushConstants(cmd, g->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float), &timeSec);
+}
+
+// The tuned grad variant for a new draw size; the current one keeps drawing while it compiles
+static PipelineHandle grad_retune(PipelineManager* pipelines, PipelineHandle current, const AutotuneTable* tuning, VkExtent2D extent)
+{
+	u32 tuned[2];
+	if (!autotune_best(tuning, "grad", extent.width, extent.height, tuned))
+		return current;
+	return pipeline_variant(pipelines, current, tuned, 2);
+}
+
+// --autotune: every tunable compute pass over the workgroup shapes and image sizes, results to AUTOTUNE_PATH
+static int autotune_bench(u32 iterations)
 {
+	Application app = {0};
+	headless_init(&app);
+
+	PipelineManager* pipelines = malloc(sizeof(PipelineManager));
+	pipeline_manager_init(pipelines, &app);
+
+	// the same layout as the windowed grad pass
+	VkDescriptorSetLayoutBinding imageBinding = {
+	    .binding = 0,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+	    .descriptorCount = 1,
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = 1,
+	    .pBindings = &imageBinding,
+	};
+	VkDescriptorSetLayout setLayout;
+	VK_CHECK(vkCreateDescriptorSetLayout(app.device, &layoutInfo, NULL, &setLayout));
+	VkDescriptorPoolSize poolSize = {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = 1,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &poolSize,
+	};
+	VkDescriptorPool descriptorPool;
+	VK_CHECK(vkCreateDescriptorPool(app.device, &poolInfo, NULL, &descriptorPool));
+	GradTunable grad = {.device = app.device};
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = descriptorPool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &setLayout,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(app.device, &allocInfo, &grad.set));
+	VkPushConstantRange pcr = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(float)};
+	grad.layout = createPipelineLayout(app.device, &setLayout, 1, &pcr, 1);
+	PipelineDesc gradDesc = {
+	    .name = "grad",
+	    .computeShader = "compiledshaders/grad.comp.spv",
+	    .layout = grad.layout,
+	    .specConstants = {16, 16},
+	    .specConstantCount = 2,
+	};
+
+	AutotunePass passes[] = {
+	    {
+	        .name = "grad",
+	        .base = pipeline_register(pipelines, &gradDesc, PIPELINE_INVALID_HANDLE),
+	        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+	        .user = &grad,
+	        .prepare = grad_tune_prepare,
+	        .bind = grad_tune_bind,
+	    },
+	};
+	pipeline_compile_startup(pipelines);
+	int result = autotune_run(&app, pipelines, passes, ARRAYSIZE(passes), iterations, AUTOTUNE_PATH);
+
+	pipeline_manager_destroy(pipelines);
+	free(pipelines);
+	vkDestroyPipelineLayout(app.device, grad.layout, NULL);
+	vkDestroyDescriptorPool(app.device, descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(app.device, setLayout, NULL);
+	headless_shutdown(&app);
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	// every shader module comes from this one mapping (or its .spv when there is no archive)
+	shader_archive_open(SHADER_ARCHIVE_PATH);
+
+	// Headless modes (no window) and flags
+	bool useGrad = false;
+	u32 sceneDrawCount = 0; // > 0: raster scene of that many draws instead of the compute passes
+	bool serialRecord = false;
+	bool sceneMaterials = false;
+	u32 bloomMips = BLOOM_DEFAULT_MIPS;
+	float dofAperture = DOF_DEFAULT_APERTURE;
+	u32 offlineSamples = 0;
+	const char* offlinePath = NULL;
+	const char* comparePath = NULL;
+	bool hdrOutput = false;
+	bool overlayVisible = false;
+	u32 waterSize = 0; // > 0: FFT ocean instead of the path tracer
+	u32 particleCount = 0; // > 0: GPU particles instead of the path tracer
+	u32 gradWorkgroup[2] = {16, 16};
+	bool gradWorkgroupSet = false; // given on the command line: the tuning file is not consulted
+	TonemapOperator tonemapper = TONEMAP_ACES;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--bench-jobs") == 0)
+			return job_benchmark(i + 1 < argc ? (u32)atoi(argv[i + 1]) : 0);
+		if (strcmp(argv[i], "--bench-tasks") == 0)
+			return task_benchmark(i + 1 < argc ? (u32)atoi(argv[i + 1]) : 0);
+		if (strcmp(argv[i], "--autotune") == 0)
+		{
+			job_system_init(0);
+			int result = autotune_bench(i + 1 < argc && atoi(argv[i + 1]) > 0 ? (u32)atoi(argv[i + 1]) : AUTOTUNE_DEFAULT_ITERATIONS);
+			job_system_shutdown();
+			shader_archive_close();
+			return result;
+		}
+		if (strcmp(argv[i], "--bench-world") == 0)
+			return world_bench(i + 1 < argc ? (u32)atoi(argv[i + 1]) : 100000u);
+		if (strcmp(argv[i], "--bench-fft") == 0)
+			return fft_bench(i + 1 < argc ? (u32)atoi(argv[i + 1]) : 100u);
+		if (strcmp(argv[i], "--bench-bvh") == 0)
+		{
+			job_system_init(0);
+			int result = bvh_benchmark(i + 1 < argc ? (u32)atoi(argv[i + 1]) : 1000000u);
+			job_system_shutdown();
+			return result;
+		}
+		if (strcmp(argv[i], "--pathtrace-offline") == 0)
+		{
+			if (i + 2 >= argc)
+			{
+				printf("usage: --pathtrace-offline <samples> <out.png|out.hdr> [--bloom-mips N] [--dof-aperture px] [--compare ref.png|ref.hdr]\n");
+				return 1;
+			}
+			offlineSamples = (u32)atoi(argv[i + 1]);
+			offlinePath = argv[i + 2];
+			i += 2;
+		}
+		if (strcmp(argv[i], "--bloom-mips") == 0 && i + 1 < argc)
+			bloomMips = (u32)atoi(argv[i + 1]); // 0 disables bloom
+		if (strcmp(argv[i], "--dof-aperture") == 0 && i + 1 < argc)
+			dofAperture = (float)atof(argv[i + 1]); // blur of distant objects in pixels, 0 disables depth of field
+		if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+			comparePath = argv[i + 1]; // golden image for --pathtrace-offline
+		if (strcmp(argv[i], "--overlay") == 0)
+			overlayVisible = true; // debug overlay shown from the first frame, F1 toggles it
+		if (strcmp(argv[i], "--hdr") == 0)
+			hdrOutput = true; // HDR10 swapchain when the surface offers one
+		if (strcmp(argv[i], "--tonemap") == 0 && i + 1 < argc)
+			tonemapper = strcmp(argv[i + 1], "agx") == 0 ? TONEMAP_AGX : TONEMAP_ACES;
+		if (strcmp(argv[i], "--water") == 0)
+			waterSize = waterSize ? waterSize : WATER_DEFAULT_SIZE;
+		if (strcmp(argv[i], "--water-size") == 0 && i + 1 < argc)
+			waterSize = (u32)atoi(argv[i + 1]); // FFT size per cascade
+		if (strcmp(argv[i], "--particles") == 0)
+			particleCount = i + 1 < argc && atoi(argv[i + 1]) > 0 ? (u32)atoi(argv[i + 1]) : PARTICLES_DEFAULT_CAPACITY;
+		if (strcmp(argv[i], "--grad") == 0)
+			useGrad = true; // old animated gradient instead of the path tracer
+		if (strcmp(argv[i], "--grad-workgroup") == 0 && i + 1 < argc)
+		{
+			// grad.comp's workgroup size, WxH: a specialization, no shader rebuild
+			u32 w = 0, h = 0;
+			if (sscanf(argv[i + 1], "%ux%u", &w, &h) == 2 && w > 0 && h > 0)
+			{
+				gradWorkgroup[0] = w;
+				gradWorkgroup[1] = h;
+				gradWorkgroupSet = true;
+			}
+		}
+		if (strcmp(argv[i], "--scene-draws") == 0 && i + 1 < argc)
+			sceneDrawCount = (u32)atoi(argv[i + 1]);
+		if (strcmp(argv[i], "--serial-record") == 0)
+			serialRecord = true; // record the scene on the main thread only, for comparison
+		if (strcmp(argv[i], "--scene-materials") == 0)
+			sceneMaterials = true; // the scene's draws as sorted material instances (material.h)
+	}
+	if (offlinePath)
+	{
+		job_system_init(0);
+		int result = pathtrace_offline(offlineSamples, offlinePath, bloomMips, dofAperture, comparePath);
+		job_system_shutdown();
+		shader_archive_close();
+		return result;
+	}
+	job_system_init(0);
+
 	Application app = {0};
 	app.width = 800;
 	app.height = 600;
+	app.hdrOutput = hdrOutput;
 	glfwInit();
+	double startupTime = glfwGetTime();
 	#if defined (VK_USE_PLATFORM_WAYLAND_KHR)
     glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
     printf("Compiled with Wayland support\n");
@@ -259,6 +935,8 @@ int main(void)
 
 	app.device = createLogicalDevice(app.physicaldevice);
 	volkLoadDevice(app.device);
+	app.memoryBudgetSupported = physicalDeviceSupportsExtension(app.physicaldevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	app.computeSubgroupOps = computeSubgroupOperations(app.physicaldevice);
 
 	selectSwapchainFormat(&app);
 
@@ -267,21 +945,66 @@ int main(void)
 
 	// Create VMA allocator and the offscreen draw image
 	printf("[VMA] Creating allocator...\n");
-	VmaVulkanFunctions vmaFuncs = {0};
-	vmaFuncs.vkGetInstanceProcAddr = vkGetInstanceProcAddr;
-	vmaFuncs.vkGetDeviceProcAddr = vkGetDeviceProcAddr;
-	VmaAllocatorCreateInfo allocatorInfo = {
-	    .instance = app.instance,
-	    .physicalDevice = app.physicaldevice,
-	    .device = app.device,
-	    .pVulkanFunctions = &vmaFuncs,
-	    .vulkanApiVersion = VK_API_VERSION_1_3,
-	};
-	VK_CHECK(vmaCreateAllocator(&allocatorInfo, &app.allocator));
+	app.allocator = createAllocator(&app);
 	printf("[VMA] Allocator created. Creating draw image...\n");
 	createDrawImage(&app, app.allocator);
 	printf("[VMA] Draw image created.\n");
 
+	TextureStreamer* textureStreamer = malloc(sizeof(TextureStreamer));
+	texture_streamer_init(textureStreamer, &app, NULL);
+
+	PathTracerScene scene;
+	PathTracerCamera camera;
+	pathtracer_cornell_box(&scene, &camera);
+	if (waterSize > 0)
+		camera = (PathTracerCamera){.position = {0.0f, 6.0f, 40.0f}, .target = {0.0f, 0.0f, 0.0f}, .fovY = 60.0f * 3.14159265f / 180.0f};
+	if (particleCount > 0)
+		camera = (PathTracerCamera){.position = {0.0f, 4.0f, 14.0f}, .target = {0.0f, 2.0f, 0.0f}, .fovY = 50.0f * 3.14159265f / 180.0f};
+	// everything below registers its pipelines here; they are compiled together further down
+	PipelineManager* pipelines = malloc(sizeof(PipelineManager));
+	pipeline_manager_init(pipelines, &app);
+
+	PathTracer* pathTracer = malloc(sizeof(PathTracer));
+	pathtracer_init(pathTracer, &app, pipelines, &scene);
+	pathtracer_bind_target(pathTracer, app.drawImage.imageView);
+	Dof* dof = malloc(sizeof(Dof));
+	dof_init(dof, &app, pipelines, sceneDrawCount > 0 || useGrad || waterSize > 0 || particleCount > 0 ? 0.0f : dofAperture); // needs the path tracer's depth
+	Bloom* bloom = malloc(sizeof(Bloom));
+	bloom_init(bloom, &app, pipelines, bloomMips);
+	Tonemap* tonemap = malloc(sizeof(Tonemap));
+	tonemap_init(tonemap, &app, pipelines, tonemapper);
+	Overlay* overlay = malloc(sizeof(Overlay));
+	overlay_init(overlay, &app, pipelines, overlayVisible);
+	double lastFrameTime = glfwGetTime();
+
+	ThreadCommandPools* threadCommandPools = malloc(sizeof(ThreadCommandPools));
+	thread_command_pools_init(threadCommandPools, &app);
+	ScenePass* scenePass = NULL;
+	MaterialSystem* materials = NULL;
+	if (sceneDrawCount > 0)
+	{
+		if (sceneMaterials)
+		{
+			materials = malloc(sizeof(MaterialSystem));
+			material_system_init(materials, &app, pipelines);
+		}
+		scenePass = malloc(sizeof(ScenePass));
+		scene_pass_init(scenePass, &app, threadCommandPools, pipelines, materials, sceneDrawCount, !serialRecord);
+	}
+	Water* water = NULL;
+	if (waterSize > 0)
+	{
+		water = malloc(sizeof(Water));
+		water_init(water, &app, pipelines, waterSize);
+	}
+	Particles* particles = NULL;
+	if (particleCount > 0)
+	{
+		// own target: blending on the rgba32f draw image is optional
+		particles = malloc(sizeof(Particles));
+		particles_init(particles, &app, pipelines, particleCount, VK_FORMAT_R16G16B16A16_SFLOAT);
+	}
+
 	FrameData frameData = {0};
 	initCommands(&frameData, &app);
 
@@ -352,23 +1075,31 @@ int main(void)
 		VK_CHECK(vkCreatePipelineLayout(app.device, &plInfo, NULL, &computePipelineLayout));
 	}
 
-	VkPipeline computePipeline;
-	{
-		VkShaderModule compModule = LoadShaderModule("compiledshaders/grad.comp.spv", app.device);
-		VkPipelineShaderStageCreateInfo stage = {
-		    .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-		    .stage = VK_SHADER_STAGE_COMPUTE_BIT,
-		    .module = compModule,
-		    .pName = "main",
-		};
-		VkComputePipelineCreateInfo cpInfo = {
-		    .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-		    .stage = stage,
-		    .layout = computePipelineLayout,
-		};
-		VK_CHECK(vkCreateComputePipelines(app.device, VK_NULL_HANDLE, 1, &cpInfo, NULL, &computePipeline));
-		vkDestroyShaderModule(app.device, compModule, NULL);
-	}
+	// workgroup shape measured by --autotune on this GPU, for the size closest to the draw image
+	AutotuneTable* tuning = malloc(sizeof(AutotuneTable));
+	autotune_load(tuning, AUTOTUNE_PATH, app.physicaldevice);
+	if (!gradWorkgroupSet && autotune_best(tuning, "grad", app.drawExtent.width, app.drawExtent.height, gradWorkgroup))
+		printf("[Autotune] grad: %ux%u workgroups at %ux%u\n", gradWorkgroup[0], gradWorkgroup[1], app.drawExtent.width, app.drawExtent.height);
+	if (gradWorkgroupSet)
+		tuning->count = 0;
+	PipelineDesc gradDesc = {
+	    .name = "grad",
+	    .onDemand = !useGrad, // only built if something asks for it
+	    .computeShader = "compiledshaders/grad.comp.spv",
+	    .layout = computePipelineLayout,
+	    .specConstants = {gradWorkgroup[0], gradWorkgroup[1]},
+	    .specConstantCount = 2,
+	};
+	PipelineHandle gradPipeline = pipeline_register(pipelines, &gradDesc, PIPELINE_INVALID_HANDLE);
+
+	// all startup pipelines at once, spread over the job threads
+	pipeline_compile_startup(pipelines);
+	ShaderReload* shaderReload = malloc(sizeof(ShaderReload));
+	shader_reload_init(shaderReload, pipelines, "shaders", "compiledshaders");
+	bool firstFrame = true;
+	RenderGraph* renderGraph = malloc(sizeof(RenderGraph));
+	render_graph_init(renderGraph, &app);
+
 	// Hook resize callback and user pointer
 	glfwSetWindowUserPointer(window, &app);
 	glfwSetFramebufferSizeCallback(window, glfw_framebuffer_resize_callback);
@@ -381,11 +1112,45 @@ int main(void)
 		{
 			recreate_swapchain(&app);
 			update_storage_image_descriptor(&app, descriptorSet);
+			pathtracer_bind_target(pathTracer, app.drawImage.imageView);
+			gradPipeline = grad_retune(pipelines, gradPipeline, tuning, app.drawExtent);
 			app.framebufferResized = false;
 		}
 		u32 frameIndex = app.frameNumber % MAX_FRAMES_IN_FLIGHT;
 		VK_CHECK(vkWaitForFences(app.device, 1, &frameData.inFlightFences[frameIndex], VK_TRUE, UINT64_MAX));
 		vkResetFences(app.device, 1, &frameData.inFlightFences[frameIndex]);
+		// frame boundary: edited shaders' pipelines are swapped in before anything records
+		shader_reload_poll(shaderReload);
+		pipeline_manager_update(pipelines, app.frameNumber);
+		dof_collect_stats(dof, frameIndex);
+		if (water)
+			water_collect_timings(water, frameIndex);
+		if (particles)
+			particles_collect_timings(particles, frameIndex);
+		bloom_collect_timings(bloom, frameIndex);
+		// one clock sample per frame: the camera, the simulations and auto-exposure all step by it
+		double frameTime = glfwGetTime();
+		float frameDt = (float)(frameTime - lastFrameTime);
+		lastFrameTime = frameTime;
+		orbit_camera(window, &camera, frameDt);
+		bool overlayShown = overlay_begin_frame(overlay, window, frameDt * 1e3);
+		if (overlayShown)
+		{
+			if (dof->aperture > 0.0f)
+				overlay_gpu_time(overlay, "depth of field", dof->lastGpuMs);
+			if (bloom->mipCount > 0)
+				overlay_gpu_time(overlay, "bloom", bloom->lastGpuMs);
+			if (water)
+				overlay_gpu_time(overlay, "water simulation", water->lastGpuMs);
+			if (particles)
+				overlay_gpu_time(overlay, "particle simulation", particles->lastGpuMs);
+			overlay_counter(overlay, "frame", (double)app.frameNumber);
+			overlay_counter(overlay, "texture MiB resident", (double)textureStreamer->residentBytes / (1024.0 * 1024.0));
+			if (scenePass)
+				overlay_counter(overlay, "scene draws", (double)sceneDrawCount);
+			if (particles)
+				overlay_counter(overlay, "particle capacity", (double)particles->capacity);
+		}
 
 		u32 swapchainImageIndex;
 		VkResult acq = vkAcquireNextImageKHR(app.device, app.swapchain, UINT64_MAX, frameData.swapchainSemaphore[frameIndex], VK_NULL_HANDLE, &swapchainImageIndex);
@@ -393,6 +1158,8 @@ int main(void)
 		{
 			recreate_swapchain(&app);
 			update_storage_image_descriptor(&app, descriptorSet);
+			pathtracer_bind_target(pathTracer, app.drawImage.imageView);
+			gradPipeline = grad_retune(pipelines, gradPipeline, tuning, app.drawExtent);
 			continue;
 		}
 		if (acq == VK_SUBOPTIMAL_KHR)
@@ -405,95 +1172,106 @@ int main(void)
 			VK_CHECK(acq);
 		}
 		VkCommandBuffer cmd = frameData.commandBuffers[frameIndex];
-		VK_CHECK(vkResetCommandBuffer(cmd, 0));
+		// The fence above means every command buffer of this frame slot is done: reset the
+		// primary's pool and all worker pools in bulk
+		VK_CHECK(vkResetCommandPool(app.device, frameData.commandPools[frameIndex], 0));
+		thread_command_pools_reset(threadCommandPools, frameIndex);
 		VkCommandBufferBeginInfo cmdinfo = {
 		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 		    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
 		vkBeginCommandBuffer(cmd, &cmdinfo);
 
-		// Prepare draw image for compute writes: UNDEFINED -> GENERAL
-		VkImageMemoryBarrier2 drawToGeneral = imageBarrier(
-		    app.drawImage.image,
-		    VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
-		    0,
-		    VK_IMAGE_LAYOUT_UNDEFINED,
-		    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-		    VK_ACCESS_2_SHADER_WRITE_BIT,
-		    VK_IMAGE_LAYOUT_GENERAL,
-		    VK_IMAGE_ASPECT_COLOR_BIT,
-		    0, 1);
-		pipelineBarrier(cmd, 0, 0, NULL, 1, &drawToGeneral);
-
-	// Dispatch grad.comp to fill the draw image
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &descriptorSet, 0, NULL);
-	// Push current time (seconds) into the shader push constant block
-	float timeSec = (float)glfwGetTime();
-	vkCmdPushConstants(cmd, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float), &timeSec);
-		uint32_t gx = (app.drawExtent.width + 15u) / 16u;
-		uint32_t gy = (app.drawExtent.height + 15u) / 16u;
-		vkCmdDispatch(cmd, gx, gy, 1);
-
-		// Prepare for copy: draw GENERAL -> TRANSFER_SRC, swap UNDEFINED -> TRANSFER_DST
-		VkImageMemoryBarrier2 drawToSrc = imageBarrier(
-		    app.drawImage.image,
-		    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-		    VK_ACCESS_2_SHADER_WRITE_BIT,
-		    VK_IMAGE_LAYOUT_GENERAL,
-		    VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-		    VK_ACCESS_2_TRANSFER_READ_BIT,
-		    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-		    VK_IMAGE_ASPECT_COLOR_BIT,
-		    0, 1);
-
-		VkImageMemoryBarrier2 swapToDst = imageBarrier(
-		    app.swapchainImages[swapchainImageIndex],
-		    VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
-		    0,
-		    VK_IMAGE_LAYOUT_UNDEFINED,
-		    VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-		    VK_ACCESS_2_TRANSFER_WRITE_BIT,
-		    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		    VK_IMAGE_ASPECT_COLOR_BIT,
-		    0, 1);
-		VkImageMemoryBarrier2 barriersPrep[2] = {drawToSrc, swapToDst};
-		pipelineBarrier(cmd, 0, 0, NULL, 2, barriersPrep);
-
-		// execute copy (blit, allows different sizes)
-		VkExtent3D srcExtent = {app.drawExtent.width, app.drawExtent.height, 1};
-		VkExtent3D dstExtent = {app.width, app.height, 1};
-		CopyImagetoImage(cmd,
-		    app.drawImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-		    app.swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		    srcExtent, dstExtent,
-		    VK_IMAGE_ASPECT_COLOR_BIT,
-		    0, 0, 0, 0, 1,
-		    VK_FILTER_LINEAR);
-
-		// Transition swapchain to PRESENT
-		VkImageMemoryBarrier2 toPresent = imageBarrier(
-		    app.swapchainImages[swapchainImageIndex],
-		    VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-		    VK_ACCESS_2_TRANSFER_WRITE_BIT,
-		    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		    VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
-		    0,
-		    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-		    VK_IMAGE_ASPECT_COLOR_BIT,
-		    0, 1);
-		pipelineBarrier(cmd, 0, 0, NULL, 1, &toPresent);
+		// Texture uploads for this frame (mip tails, streamed mips, evictions)
+		texture_streamer_update(textureStreamer, cmd, app.frameNumber);
+
+		// The draw image carries over from last frame (the path tracer accumulates into it), imported
+		// with the stages its last uses ran in (the post chain samples it in compute); the swapchain image arrives through the acquire semaphore, waited on where the tonemap pass
+		// (compute) or the blit (transfer) first writes it
+		VkPipelineStageFlags2 swapchainStage = tonemap_swapchain_stage(tonemap);
+		FramePasses framePasses = {
+		    .app = &app,
+		    .frameIndex = frameIndex,
+		    .swapchainImageIndex = swapchainImageIndex,
+		    .scenePass = scenePass,
+		    .pathTracer = pathTracer,
+		    .water = water,
+		    .particles = particles,
+		    .camera = &camera,
+		    .time = frameTime,
+		    .dt = frameDt,
+		    .pipelines = pipelines,
+		    .gradPipeline = gradPipeline,
+		    .gradLayout = computePipelineLayout,
+		    .gradDescriptorSet = descriptorSet,
+		    .graph = renderGraph,
+		};
+		render_graph_begin(renderGraph);
+		RenderGraphImage drawRes = render_graph_import_image(renderGraph, "draw", app.drawImage.image, app.drawImage.imageView, VK_IMAGE_ASPECT_COLOR_BIT,
+		    app.drawImageLayout, app.drawImageStages, app.drawImageAccess);
+		RenderGraphImage swapRes = render_graph_import_image(renderGraph, "swapchain", app.swapchainImages[swapchainImageIndex], app.swapchainImageViews[swapchainImageIndex],
+		    VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, swapchainStage, 0);
+		render_graph_export_image(renderGraph, drawRes, VK_IMAGE_LAYOUT_UNDEFINED);
+		render_graph_export_image(renderGraph, swapRes, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+		RenderGraphPass pass;
+		if (scenePass)
+		{
+			pass = render_graph_add_pass(renderGraph, "scene", scene_node, &framePasses);
+			render_graph_use(renderGraph, pass, drawRes, RG_USAGE_COLOR_WRITE);
+		}
+		else if (water)
+		{
+			RenderGraphImageDesc depthDesc = {water->depthFormat, app.drawExtent.width, app.drawExtent.height};
+			framePasses.waterDepth = render_graph_create_image(renderGraph, "water_depth", &depthDesc);
+			pass = render_graph_add_pass(renderGraph, "water", water_node, &framePasses);
+			render_graph_use(renderGraph, pass, drawRes, RG_USAGE_COLOR_WRITE);
+			render_graph_use(renderGraph, pass, framePasses.waterDepth, RG_USAGE_DEPTH_WRITE);
+		}
+		else if (particles)
+		{
+			RenderGraphImageDesc targetDesc = {particles->colorFormat, app.drawExtent.width, app.drawExtent.height};
+			framePasses.particleTarget = render_graph_create_image(renderGraph, "particles", &targetDesc);
+			pass = render_graph_add_pass(renderGraph, "particles", particle_node, &framePasses);
+			render_graph_use(renderGraph, pass, framePasses.particleTarget, RG_USAGE_COLOR_WRITE);
+		}
+		else if (!useGrad)
+		{
+			pass = render_graph_add_pass(renderGraph, "pathtrace", pathtrace_node, &framePasses);
+			render_graph_use(renderGraph, pass, drawRes, RG_USAGE_COMPUTE_READ_WRITE);
+		}
+		else
+		{
+			pass = render_graph_add_pass(renderGraph, "grad", grad_node, &framePasses);
+			render_graph_use(renderGraph, pass, drawRes, RG_USAGE_COMPUTE_WRITE);
+		}
+		VkExtent2D postExtent = {app.drawExtent.width, app.drawExtent.height};
+		dof->focusDistance = camera_focus_distance(&camera);
+		RenderGraphImage post = dof_add_passes(dof, renderGraph, particles ? framePasses.particleTarget : drawRes, postExtent, frameIndex);
+		post = bloom_add_passes(bloom, renderGraph, post, postExtent, frameIndex);
+		framePasses.blitSource = tonemap_add_pass(tonemap, renderGraph, post, swapRes, postExtent, frameIndex, frameDt);
+		if (framePasses.blitSource != swapRes)
+		{
+			pass = render_graph_add_pass(renderGraph, "blit", blit_node, &framePasses);
+			render_graph_use(renderGraph, pass, framePasses.blitSource, RG_USAGE_TRANSFER_SRC);
+			render_graph_use(renderGraph, pass, swapRes, RG_USAGE_TRANSFER_DST);
+		}
+		if (overlayShown)
+			overlay_add_pass(overlay, renderGraph, swapRes, (VkExtent2D){app.width, app.height}, frameIndex);
+
+		render_graph_execute(renderGraph, cmd);
+		app.drawImageLayout = render_graph_image_layout(renderGraph, drawRes);
+		render_graph_image_last_use(renderGraph, drawRes, &app.drawImageStages, &app.drawImageAccess);
 
 		// finalize the command buffer (we can no longer add commands, but it can now be executed)
 		VK_CHECK(vkEndCommandBuffer(cmd));
 
 		// Submit and present
-		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		VkSemaphore signalForThisImage = app.presentSemaphores[swapchainImageIndex];
 
 		VkSemaphoreSubmitInfo waitSemaphoreInfo = {
 		    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
 		    .semaphore = frameData.swapchainSemaphore[frameIndex],
-		    .stageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT};
+		    .stageMask = swapchainStage};
 
 		VkSemaphoreSubmitInfo signalSemaphoreInfo = {
 		    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
@@ -526,17 +1304,68 @@ int main(void)
 		{
 			recreate_swapchain(&app);
 			update_storage_image_descriptor(&app, descriptorSet);
+			pathtracer_bind_target(pathTracer, app.drawImage.imageView);
+			gradPipeline = grad_retune(pipelines, gradPipeline, tuning, app.drawExtent);
 		}
 		else
 		{
 			VK_CHECK(pres);
 		}
+		if (firstFrame)
+		{
+			printf("[Startup] time to first frame: %.1f ms\n", (glfwGetTime() - startupTime) * 1e3);
+			firstFrame = false;
+		}
 		app.frameNumber++;
 	}
 
 	// Ensure GPU work is complete before destroying resources
 	vkDeviceWaitIdle(app.device);
 
+	render_graph_destroy(renderGraph);
+	free(renderGraph);
+	shader_reload_destroy(shaderReload);
+	free(shaderReload);
+	// first: waits for background compiles that may still use the layouts destroyed below
+	pipeline_manager_destroy(pipelines);
+	free(pipelines);
+	tonemap_destroy(tonemap);
+	free(tonemap);
+	overlay_destroy(overlay);
+	free(overlay);
+	free(tuning);
+	bloom_destroy(bloom);
+	free(bloom);
+	dof_destroy(dof);
+	free(dof);
+	texture_streamer_destroy(textureStreamer);
+	free(textureStreamer);
+	pathtracer_destroy(pathTracer);
+	free(pathTracer);
+	pathtracer_scene_free(&scene);
+	if (scenePass)
+	{
+		scene_pass_destroy(scenePass);
+		free(scenePass);
+	}
+	if (materials)
+	{
+		material_system_destroy(materials);
+		free(materials);
+	}
+	if (water)
+	{
+		water_destroy(water);
+		free(water);
+	}
+	if (particles)
+	{
+		particles_destroy(particles);
+		free(particles);
+	}
+	thread_command_pools_destroy(threadCommandPools);
+	free(threadCommandPools);
+
 	// destroy draw image resources
 	if (app.drawImage.imageView)
 		vkDestroyImageView(app.device, app.drawImage.imageView, NULL);
@@ -556,7 +1385,6 @@ int main(void)
 	}
 	// swapchain already destroyed by destroy_swapchain_resources
 	// Destroy compute/descriptor objects
-	vkDestroyPipeline(app.device, computePipeline, NULL);
 	vkDestroyPipelineLayout(app.device, computePipelineLayout, NULL);
 	vkDestroyDescriptorSetLayout(app.device, drawImageDescriptorLayout, NULL);
 	vkDestroyDescriptorPool(app.device, descriptorPool, NULL);
@@ -569,5 +1397,7 @@ int main(void)
 
 	glfwDestroyWindow(window);
 	glfwTerminate();
+	job_system_shutdown();
+	shader_archive_close();
 	return 0;
 }
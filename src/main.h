@@ -22,6 +22,13 @@ typedef struct AllocatedBuffer
 	VmaAllocation allocation;
 } AllocatedBuffer;
 
+// Read-only view of a whole file mapped into the address space (no copy)
+typedef struct MappedFile
+{
+	const u8* data;
+	size_t size;
+} MappedFile;
+
 typedef struct Application // Moved to top
 {
 	VkInstance instance;
@@ -30,6 +37,8 @@ typedef struct Application // Moved to top
 	VkDevice device;
 	VmaAllocator allocator;
 	VkSurfaceKHR surface;
+	bool memoryBudgetSupported; // VK_EXT_memory_budget enabled on the device
+	VkSubgroupFeatureFlags computeSubgroupOps; // subgroup operations compute shaders may use (only BASIC is guaranteed)
 	GLFWwindow* window; // glfw window handle for callbacks/size
 	u32 width;
 	u32 height;
@@ -37,6 +46,8 @@ typedef struct Application // Moved to top
 	u64 frameNumber;
 	VkFormat swapchainFormat;
 	VkColorSpaceKHR swapchainColorSpace;
+	bool hdrOutput;        // --hdr: prefer an HDR10 swapchain
+	bool swapchainStorage; // swapchain images are compute-writable (the tonemap pass writes them directly)
 	VkImage* swapchainImages;
 	VkImageView* swapchainImageViews;
 	u32 swapchainImageCount;
@@ -47,6 +58,9 @@ typedef struct Application // Moved to top
 	VkSemaphore* presentSemaphores;
 	AllocatedImage drawImage; // High-precision offscreen render target
 	VkExtent3D drawExtent;    // Resolution of drawImage
+	VkImageLayout drawImageLayout; // Layout drawImage was left in, so progressive passes keep its contents
+	VkPipelineStageFlags2 drawImageStages; // and the stages and write access of its last uses
+	VkAccessFlags2 drawImageAccess;
 	AllocatedBuffer curveVertexBuffer; // optional in minimal compute example
 	u32 curveVertexCount; // optional in minimal compute example
 } Application;
@@ -62,7 +76,7 @@ typedef struct FrameData
 } FrameData;
 
 // Entry point
-int main(void);
+int main(int argc, char** argv);
 
 // Instance & Device Setup
 VkInstance createInstance();
@@ -71,6 +85,9 @@ void cleanupDebugMessenger(Application* app);
 VkPhysicalDevice pickPhysicalDevice(VkInstance instance);
 void print_gpu_info(VkPhysicalDevice device);
 u32 find_graphics_queue_family_index(VkPhysicalDevice pickedPhysicalDevice);
+bool physicalDeviceSupportsExtension(VkPhysicalDevice physicalDevice, const char* extensionName);
+// VkPhysicalDeviceSubgroupProperties::supportedOperations, or 0 when compute isn't in supportedStages
+VkSubgroupFeatureFlags computeSubgroupOperations(VkPhysicalDevice physicalDevice);
 VkDevice createLogicalDevice(VkPhysicalDevice pickedphysicaldevice);
 void create_surface(Application* app, GLFWwindow* window);
 void selectSwapchainFormat(Application* app);
@@ -84,6 +101,7 @@ void glfw_framebuffer_resize_callback(GLFWwindow* window, int width, int height)
 
 // Resource Creation & Utilities
 AllocatedBuffer create_buffer(VmaAllocator allocator, size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+VmaAllocator createAllocator(Application* app);
 void createDrawImage(Application* app, VmaAllocator allocator);
 void CopyImagetoImage(VkCommandBuffer cmd, VkImage src, VkImageLayout srcLayout, VkImage dst, VkImageLayout dstLayout,
                       VkExtent3D srcExtent, VkExtent3D dstExtent, VkImageAspectFlags aspectMask,
@@ -91,6 +109,8 @@ void CopyImagetoImage(VkCommandBuffer cmd, VkImage src, VkImageLayout srcLayout,
                       uint32_t srcBaseLayer, uint32_t dstBaseLayer,
                       uint32_t layerCount, VkFilter filter);
 static void update_storage_image_descriptor(Application* app, VkDescriptorSet descriptorSet);
+bool map_file(const char* path, MappedFile* out);
+void unmap_file(MappedFile* file);
 
 // Command & Sync
 void initCommands(FrameData* frameData, Application* app);
@@ -1,3 +1,445 @@
 #include "material.h"
+#include "shader_archive.h"
+#include <string.h>
+#include "../external/SPIRV-Reflect/spirv_reflect.h"
 
+// Every material mesh: one vec2 position stream
+static const VkVertexInputBindingDescription meshBinding = {.binding = 0, .stride = 2 * sizeof(float), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+static const VkVertexInputAttributeDescription meshAttribute = {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0};
+static const VkPipelineVertexInputStateCreateInfo meshInput = {
+    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    .vertexBindingDescriptionCount = 1,
+    .pVertexBindingDescriptions = &meshBinding,
+    .vertexAttributeDescriptionCount = 1,
+    .pVertexAttributeDescriptions = &meshAttribute,
+};
 
+void material_system_init(MaterialSystem* ms, const Application* app, PipelineManager* pipelines)
+{
+	memset(ms, 0, sizeof(*ms));
+	ms->device = app->device;
+	ms->allocator = app->allocator;
+	ms->pipelines = pipelines;
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	ms->paramAlignment = (u32)MAX(props.limits.minUniformBufferOffsetAlignment, (VkDeviceSize)16);
+
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_LINEAR,
+	    .minFilter = VK_FILTER_LINEAR,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+	    .maxLod = VK_LOD_CLAMP_NONE,
+	};
+	VK_CHECK(vkCreateSampler(ms->device, &samplerInfo, NULL, &ms->sampler));
+
+	VkDescriptorSetLayoutBinding globalBinding = {
+	    .binding = 0,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+	    .descriptorCount = 1,
+	    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = 1,
+	    .pBindings = &globalBinding,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(ms->device, &layoutInfo, NULL, &ms->globalLayout));
+	layoutInfo.bindingCount = 0;
+	VK_CHECK(vkCreateDescriptorSetLayout(ms->device, &layoutInfo, NULL, &ms->passLayout));
+
+	VkDescriptorPoolSize poolSizes[] = {
+	    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT},
+	    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MATERIAL_MAX_SETS},
+	    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MATERIAL_MAX_SETS * MATERIAL_MAX_TEXTURES},
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = MATERIAL_MAX_SETS + MAX_FRAMES_IN_FLIGHT,
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
+	    .pPoolSizes = poolSizes,
+	};
+	VK_CHECK(vkCreateDescriptorPool(ms->device, &poolInfo, NULL, &ms->descriptorPool));
+
+	VkDescriptorSetLayout globalLayouts[MAX_FRAMES_IN_FLIGHT];
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		globalLayouts[i] = ms->globalLayout;
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = ms->descriptorPool,
+	    .descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+	    .pSetLayouts = globalLayouts,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(ms->device, &allocInfo, ms->globalSets));
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		ms->globals[i] = create_buffer(ms->allocator, sizeof(MaterialGlobals), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+		VK_CHECK(vmaMapMemory(ms->allocator, ms->globals[i].allocation, (void**)&ms->globalsMapped[i]));
+		memset(ms->globalsMapped[i], 0, sizeof(MaterialGlobals));
+		VkDescriptorBufferInfo bufferInfo = {ms->globals[i].buffer, 0, sizeof(MaterialGlobals)};
+		VkWriteDescriptorSet write = {
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = ms->globalSets[i],
+		    .dstBinding = 0,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+		    .pBufferInfo = &bufferInfo,
+		};
+		vkUpdateDescriptorSets(ms->device, 1, &write, 0, NULL);
+	}
+
+	// written once per instance and only read by the GPU after that: host visible is enough
+	ms->params = create_buffer(ms->allocator, MATERIAL_PARAM_BUFFER_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	VK_CHECK(vmaMapMemory(ms->allocator, ms->params.allocation, (void**)&ms->paramsMapped));
+	uniform_ring_init(&ms->objects, app, MATERIAL_OBJECT_RING_SIZE, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+}
+
+void material_system_destroy(MaterialSystem* ms)
+{
+	for (u32 i = 0; i < ms->meshCount; ++i)
+	{
+		vmaDestroyBuffer(ms->allocator, ms->meshes[i].vertices.buffer, ms->meshes[i].vertices.allocation);
+		vmaDestroyBuffer(ms->allocator, ms->meshes[i].indices.buffer, ms->meshes[i].indices.allocation);
+	}
+	for (u32 i = 0; i < ms->definitionCount; ++i)
+	{
+		vkDestroyPipelineLayout(ms->device, ms->definitions[i].layout, NULL);
+		vkDestroyDescriptorSetLayout(ms->device, ms->definitions[i].setLayout, NULL);
+	}
+	uniform_ring_destroy(&ms->objects);
+	vmaUnmapMemory(ms->allocator, ms->params.allocation);
+	vmaDestroyBuffer(ms->allocator, ms->params.buffer, ms->params.allocation);
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		vmaUnmapMemory(ms->allocator, ms->globals[i].allocation);
+		vmaDestroyBuffer(ms->allocator, ms->globals[i].buffer, ms->globals[i].allocation);
+	}
+	vkDestroyDescriptorPool(ms->device, ms->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(ms->device, ms->passLayout, NULL);
+	vkDestroyDescriptorSetLayout(ms->device, ms->globalLayout, NULL);
+	vkDestroySampler(ms->device, ms->sampler, NULL);
+}
+
+// --- Definitions ---
+
+// Both stages' bindings, merged per set
+typedef struct MaterialReflection
+{
+	VkDescriptorSetLayoutBinding bindings[4][MATERIAL_MAX_BINDINGS];
+	u32 blockSizes[4][MATERIAL_MAX_BINDINGS];
+	u32 bindingCounts[4];
+	u32 pushConstantSize;
+} MaterialReflection;
+
+static bool reflect_stage(const char* path, MaterialReflection* r)
+{
+	const u32* code = NULL;
+	const ShaderArchiveEntry* entry = shader_archive_find(path, &code);
+	MappedFile file = {0};
+	if (!entry && !map_file(path, &file))
+	{
+		printf("[Material] Cannot read %s\n", path);
+		return false;
+	}
+	SpvReflectShaderModule module;
+	bool ok = spvReflectCreateShaderModule(entry ? entry->size : file.size, entry ? (const void*)code : file.data, &module) == SPV_REFLECT_RESULT_SUCCESS;
+	unmap_file(&file);
+	if (!ok)
+		return false;
+
+	u32 count = 0;
+	SpvReflectDescriptorBinding* bindings[4 * MATERIAL_MAX_BINDINGS];
+	ok = spvReflectEnumerateDescriptorBindings(&module, &count, NULL) == SPV_REFLECT_RESULT_SUCCESS && count <= ARRAYSIZE(bindings);
+	if (ok && count > 0)
+		ok = spvReflectEnumerateDescriptorBindings(&module, &count, bindings) == SPV_REFLECT_RESULT_SUCCESS;
+	for (u32 i = 0; ok && i < count; ++i)
+	{
+		const SpvReflectDescriptorBinding* b = bindings[i];
+		if (b->set >= 4)
+		{
+			printf("[Material] %s: set %u is outside the frequency scheme\n", path, b->set);
+			ok = false;
+			break;
+		}
+		// the other stage may have it already
+		u32 j = 0;
+		while (j < r->bindingCounts[b->set] && r->bindings[b->set][j].binding != b->binding)
+			++j;
+		if (j == r->bindingCounts[b->set])
+		{
+			if (j == MATERIAL_MAX_BINDINGS)
+			{
+				ok = false;
+				break;
+			}
+			r->bindingCounts[b->set]++;
+			r->bindings[b->set][j] = (VkDescriptorSetLayoutBinding){
+			    .binding = b->binding,
+			    .descriptorType = (VkDescriptorType)b->descriptor_type,
+			    .descriptorCount = b->count,
+			};
+			r->blockSizes[b->set][j] = b->block.size;
+		}
+		r->bindings[b->set][j].stageFlags |= (VkShaderStageFlags)module.shader_stage;
+	}
+
+	count = 0;
+	if (ok && spvReflectEnumeratePushConstantBlocks(&module, &count, NULL) == SPV_REFLECT_RESULT_SUCCESS && count > 0)
+	{
+		SpvReflectBlockVariable* blocks[4];
+		count = MIN(count, ARRAYSIZE(blocks));
+		if (spvReflectEnumeratePushConstantBlocks(&module, &count, blocks) == SPV_REFLECT_RESULT_SUCCESS)
+		{
+			for (u32 i = 0; i < count; ++i)
+				r->pushConstantSize = MAX(r->pushConstantSize, blocks[i]->offset + blocks[i]->size);
+		}
+	}
+	spvReflectDestroyShaderModule(&module);
+	return ok;
+}
+
+MaterialHandle material_define(MaterialSystem* ms, const MaterialDefinitionDesc* desc)
+{
+	if (ms->definitionCount == MATERIAL_MAX_DEFINITIONS)
+		return MATERIAL_INVALID_HANDLE;
+	MaterialReflection r;
+	memset(&r, 0, sizeof(r));
+	if (!reflect_stage(desc->vertexShader, &r) || !reflect_stage(desc->fragmentShader, &r))
+		return MATERIAL_INVALID_HANDLE;
+
+	// sets 0, 1 and 3 are the system's; set 3 is the object block, read as a dynamic uniform buffer
+	bool ok = r.bindingCounts[MATERIAL_SET_PASS] == 0 && r.pushConstantSize == 0;
+	for (u32 i = 0; i < r.bindingCounts[MATERIAL_SET_GLOBAL]; ++i)
+		ok = ok && r.bindings[MATERIAL_SET_GLOBAL][i].binding == 0 && r.bindings[MATERIAL_SET_GLOBAL][i].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	for (u32 i = 0; i < r.bindingCounts[MATERIAL_SET_OBJECT]; ++i)
+		ok = ok && r.bindings[MATERIAL_SET_OBJECT][i].binding == 0 && r.bindings[MATERIAL_SET_OBJECT][i].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER &&
+		     r.blockSizes[MATERIAL_SET_OBJECT][i] <= UNIFORM_RING_MAX_BLOCK;
+
+	MaterialDefinition* def = &ms->definitions[ms->definitionCount];
+	memset(def, 0, sizeof(*def));
+	snprintf(def->name, sizeof(def->name), "%s", desc->name);
+	VkDescriptorSetLayoutBinding* bindings = r.bindings[MATERIAL_SET_MATERIAL];
+	VkSampler immutableSamplers[MATERIAL_MAX_BINDINGS];
+	for (u32 i = 0; ok && i < r.bindingCounts[MATERIAL_SET_MATERIAL]; ++i)
+	{
+		VkDescriptorSetLayoutBinding* b = &bindings[i];
+		if (b->binding == 0 && b->descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+		{
+			// the parameter block: one buffer for every instance, selected per draw
+			b->descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+			def->paramSize = r.blockSizes[MATERIAL_SET_MATERIAL][i];
+		}
+		else if (b->descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && b->descriptorCount == 1 && def->textureCount < MATERIAL_MAX_TEXTURES)
+		{
+			immutableSamplers[i] = ms->sampler;
+			b->pImmutableSamplers = &immutableSamplers[i];
+			// binding order, whatever order the shader declared them in
+			u32 j = def->textureCount++;
+			for (; j > 0 && def->textureBindings[j - 1] > b->binding; --j)
+				def->textureBindings[j] = def->textureBindings[j - 1];
+			def->textureBindings[j] = b->binding;
+		}
+		else
+		{
+			ok = false;
+		}
+	}
+	if (!ok)
+	{
+		printf("[Material] '%s': shaders don't fit the set layout scheme (material.h)\n", desc->name);
+		return MATERIAL_INVALID_HANDLE;
+	}
+
+	def->hasSet = r.bindingCounts[MATERIAL_SET_MATERIAL] > 0;
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = r.bindingCounts[MATERIAL_SET_MATERIAL],
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(ms->device, &layoutInfo, NULL, &def->setLayout));
+	VkDescriptorSetLayout setLayouts[4] = {ms->globalLayout, ms->passLayout, def->setLayout, ms->objects.layout};
+	def->layout = createPipelineLayout(ms->device, setLayouts, ARRAYSIZE(setLayouts), NULL, 0);
+
+	PipelineDesc pipelineDesc = {
+	    .name = desc->name,
+	    .onDemand = desc->onDemand,
+	    .vertexShader = desc->vertexShader,
+	    .fragmentShader = desc->fragmentShader,
+	    .layout = def->layout,
+	    .vertexInput = &meshInput,
+	    .topology = desc->topology,
+	    .cullMode = VK_CULL_MODE_NONE,
+	    .colorFormat = desc->colorFormat,
+	};
+	def->pipeline = pipeline_register(ms->pipelines, &pipelineDesc, PIPELINE_INVALID_HANDLE);
+	printf("[Material] '%s': %u-byte parameters, %u textures\n", def->name, def->paramSize, def->textureCount);
+	return ms->definitionCount++;
+}
+
+// --- Instances ---
+
+static u64 fingerprint(MaterialHandle definition, const VkImageView* textures, u32 textureCount)
+{
+	u64 h = fnv1a64(&definition, sizeof(definition));
+	return fnv1a64_append(h, textures, textureCount * sizeof(VkImageView));
+}
+
+// The set 2 for these textures: shared with every instance that has the same ones
+static u32 find_or_create_set(MaterialSystem* ms, MaterialHandle definition, const VkImageView* textures)
+{
+	const MaterialDefinition* def = &ms->definitions[definition];
+	u64 key = fingerprint(definition, textures, def->textureCount);
+	for (u32 i = 0; i < ms->setCount; ++i)
+	{
+		if (ms->sets[i].fingerprint == key)
+			return i;
+	}
+	if (ms->setCount == MATERIAL_MAX_SETS)
+		return UINT32_MAX;
+
+	MaterialSet* set = &ms->sets[ms->setCount];
+	set->fingerprint = key;
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = ms->descriptorPool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &def->setLayout,
+	};
+	if (vkAllocateDescriptorSets(ms->device, &allocInfo, &set->set) != VK_SUCCESS)
+		return UINT32_MAX;
+
+	VkWriteDescriptorSet writes[1 + MATERIAL_MAX_TEXTURES];
+	VkDescriptorImageInfo imageInfos[MATERIAL_MAX_TEXTURES];
+	VkDescriptorBufferInfo bufferInfo = {ms->params.buffer, 0, def->paramSize};
+	u32 writeCount = 0;
+	if (def->paramSize > 0)
+	{
+		writes[writeCount++] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = set->set,
+		    .dstBinding = 0,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		    .pBufferInfo = &bufferInfo,
+		};
+	}
+	for (u32 i = 0; i < def->textureCount; ++i)
+	{
+		imageInfos[i] = (VkDescriptorImageInfo){.imageView = textures[i], .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		writes[writeCount++] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = set->set,
+		    .dstBinding = def->textureBindings[i],
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		    .pImageInfo = &imageInfos[i],
+		};
+	}
+	vkUpdateDescriptorSets(ms->device, writeCount, writes, 0, NULL);
+	return ms->setCount++;
+}
+
+MaterialInstanceHandle material_instance_create(MaterialSystem* ms, MaterialHandle definition, const void* params, u32 paramSize,
+    const VkImageView* textures, u32 textureCount)
+{
+	if (definition >= ms->definitionCount || ms->instanceCount == MATERIAL_MAX_INSTANCES)
+		return MATERIAL_INVALID_HANDLE;
+	const MaterialDefinition* def = &ms->definitions[definition];
+	if (textureCount != def->textureCount)
+	{
+		printf("[Material] '%s' takes %u textures, got %u\n", def->name, def->textureCount, textureCount);
+		return MATERIAL_INVALID_HANDLE;
+	}
+	u32 offset = (ms->paramsUsed + ms->paramAlignment - 1) / ms->paramAlignment * ms->paramAlignment;
+	if (offset + def->paramSize > MATERIAL_PARAM_BUFFER_SIZE)
+		return MATERIAL_INVALID_HANDLE;
+
+	MaterialInstance* instance = &ms->instances[ms->instanceCount];
+	instance->definition = definition;
+	instance->set = UINT32_MAX;
+	if (def->hasSet && (instance->set = find_or_create_set(ms, definition, textures)) == UINT32_MAX)
+		return MATERIAL_INVALID_HANDLE;
+	instance->paramOffset = offset;
+	if (def->paramSize > 0)
+	{
+		memset(ms->paramsMapped + offset, 0, def->paramSize);
+		if (params)
+			memcpy(ms->paramsMapped + offset, params, MIN(paramSize, def->paramSize));
+		vmaFlushAllocation(ms->allocator, ms->params.allocation, offset, def->paramSize);
+		ms->paramsUsed = offset + def->paramSize;
+	}
+	return ms->instanceCount++;
+}
+
+MaterialMeshHandle material_mesh_create(MaterialSystem* ms, const float* positions, u32 vertexCount, const u16* indices, u32 indexCount)
+{
+	if (ms->meshCount == MATERIAL_MAX_MESHES)
+		return MATERIAL_INVALID_HANDLE;
+	MaterialMesh* mesh = &ms->meshes[ms->meshCount];
+	size_t vertexSize = (size_t)vertexCount * 2 * sizeof(float);
+	size_t indexSize = (size_t)indexCount * sizeof(u16);
+	mesh->vertices = create_buffer(ms->allocator, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	mesh->indices = create_buffer(ms->allocator, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	mesh->indexCount = indexCount;
+	void* mapped;
+	VK_CHECK(vmaMapMemory(ms->allocator, mesh->vertices.allocation, &mapped));
+	memcpy(mapped, positions, vertexSize);
+	vmaFlushAllocation(ms->allocator, mesh->vertices.allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(ms->allocator, mesh->vertices.allocation);
+	VK_CHECK(vmaMapMemory(ms->allocator, mesh->indices.allocation, &mapped));
+	memcpy(mapped, indices, indexSize);
+	vmaFlushAllocation(ms->allocator, mesh->indices.allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(ms->allocator, mesh->indices.allocation);
+	return ms->meshCount++;
+}
+
+void material_system_begin_frame(MaterialSystem* ms, u32 frameIndex, const MaterialGlobals* globals)
+{
+	*ms->globalsMapped[frameIndex] = *globals;
+	vmaFlushAllocation(ms->allocator, ms->globals[frameIndex].allocation, 0, VK_WHOLE_SIZE);
+	uniform_ring_begin_frame(&ms->objects, frameIndex);
+}
+
+void material_system_end_frame(MaterialSystem* ms)
+{
+	uniform_ring_flush(&ms->objects);
+}
+
+// --- Submission ---
+
+bool material_submit(MaterialSystem* ms, RenderQueue* queue, u32 frameIndex, u32 pass, MaterialInstanceHandle instance, MaterialMeshHandle mesh,
+    float depth, const void* object, u32 objectSize)
+{
+	if (instance >= ms->instanceCount || mesh >= ms->meshCount)
+		return false;
+	const MaterialInstance* inst = &ms->instances[instance];
+	const MaterialDefinition* def = &ms->definitions[inst->definition];
+	VkPipeline pipeline = pipeline_get(ms->pipelines, def->pipeline);
+	if (!pipeline)
+		return false;
+	// per-object data: a fresh block per draw, the set itself never changes
+	u32 objectOffset = uniform_ring_push(&ms->objects, object, objectSize);
+	if (objectOffset == UNIFORM_RING_FULL)
+		return false;
+	const MaterialMesh* m = &ms->meshes[mesh];
+	RenderPacket packet = {
+	    .pipeline = pipeline,
+	    .layout = def->layout,
+	    .sets = {[MATERIAL_SET_GLOBAL] = ms->globalSets[frameIndex], [MATERIAL_SET_OBJECT] = ms->objects.set},
+	    .dynamicOffsets = {RENDER_QUEUE_NO_DYNAMIC_OFFSET, RENDER_QUEUE_NO_DYNAMIC_OFFSET, RENDER_QUEUE_NO_DYNAMIC_OFFSET, objectOffset},
+	    .vertexBuffer = m->vertices.buffer,
+	    .indexBuffer = m->indices.buffer,
+	    .count = m->indexCount,
+	};
+	if (inst->set != UINT32_MAX)
+	{
+		packet.sets[MATERIAL_SET_MATERIAL] = ms->sets[inst->set].set;
+		if (def->paramSize > 0)
+			packet.dynamicOffsets[MATERIAL_SET_MATERIAL] = inst->paramOffset;
+	}
+	u64 key = render_queue_key(pass, inst->definition, instance, render_queue_depth_bucket(depth), mesh);
+	return render_queue_submit(queue, key, &packet, NULL);
+}
@@ -1,10 +1,147 @@
-#include "../external/SPIRV-Reflect/spirv_reflect.h"
+#ifndef MATERIAL_H
+#define MATERIAL_H
 
-typedef struct Material {
+#include "pipeline_manager.h"
+#include "render_queue.h"
+#include "uniform_ring.h"
 
+// Material system: descriptor sets split by update frequency (materialdesign.txt)
+// - set 0 globals, one UBO per frame in flight, bound once per draw list; set 1 per pass
+//   (reserved, empty for now); set 2 material static data; set 3 per-object data, a block in
+//   the system's uniform ring (uniform_ring.h) picked by its dynamic offset
+// - a definition is a vertex + fragment shader pair: both stages are reflected, set 2 becomes
+//   its descriptor set layout and the pipeline is registered with the pipeline manager; every
+//   definition shares sets 0, 1 and 3, so their layouts stay compatible and set 0 survives
+//   pipeline switches
+// - set 2 binding 0, if it is a uniform block, is the instance's parameters: every instance's
+//   block lives in one buffer and is selected with a dynamic offset; other set 2 bindings are
+//   textures, sampled through one immutable sampler
+// - instances with the same definition and textures share a descriptor set (found by
+//   fingerprint) and differ only in their dynamic offset
+// - draws go into a render queue (render_queue.h) keyed by pass, definition, instance, depth
+//   and mesh; its state cache binds the pipeline, set 2 and the mesh only when they change
 
+#define MATERIAL_MAX_DEFINITIONS 32
+#define MATERIAL_MAX_INSTANCES 4096
+#define MATERIAL_MAX_MESHES 256
+#define MATERIAL_MAX_SETS 1024 // distinct set 2 contents
+#define MATERIAL_MAX_BINDINGS 8 // per reflected set
+#define MATERIAL_MAX_TEXTURES 4
+#define MATERIAL_PARAM_BUFFER_SIZE (1u << 20)
+#define MATERIAL_OBJECT_RING_SIZE (4u << 20) // per-object blocks of every frame in flight
 
-}Material;
+#define MATERIAL_SET_GLOBAL 0
+#define MATERIAL_SET_PASS 1
+#define MATERIAL_SET_MATERIAL 2
+#define MATERIAL_SET_OBJECT 3
 
+typedef u32 MaterialHandle;
+typedef u32 MaterialInstanceHandle;
+typedef u32 MaterialMeshHandle;
+#define MATERIAL_INVALID_HANDLE UINT32_MAX
 
+// Matches the set 0 binding 0 block of the material shaders
+typedef struct MaterialGlobals
+{
+	float viewport[4]; // width, height, 1 / width, 1 / height
+	float time[4];     // x: seconds
+} MaterialGlobals;
 
+typedef struct MaterialDefinitionDesc
+{
+	const char* name;
+	const char* vertexShader; // .spv paths
+	const char* fragmentShader;
+	VkFormat colorFormat;
+	VkPrimitiveTopology topology;
+	bool onDemand; // see PipelineDesc
+} MaterialDefinitionDesc;
+
+typedef struct MaterialDefinition
+{
+	char name[32];
+	PipelineHandle pipeline;
+	VkDescriptorSetLayout setLayout; // set 2, reflected
+	VkPipelineLayout layout;         // global, pass, set 2 and object layouts
+	u32 paramSize;                   // set 2 binding 0 block size, 0: no parameters
+	u32 textureBindings[MATERIAL_MAX_TEXTURES];
+	u32 textureCount;
+	bool hasSet; // set 2 has any binding
+} MaterialDefinition;
+
+typedef struct MaterialInstance
+{
+	MaterialHandle definition;
+	u32 set;         // index into MaterialSystem.sets, UINT32_MAX: the definition has no set 2
+	u32 paramOffset; // dynamic offset of its block in the parameter buffer
+} MaterialInstance;
+
+typedef struct MaterialSet
+{
+	u64 fingerprint; // definition and texture views
+	VkDescriptorSet set;
+} MaterialSet;
+
+// Indexed 2D mesh: vec2 positions
+typedef struct MaterialMesh
+{
+	AllocatedBuffer vertices;
+	AllocatedBuffer indices; // u16
+	u32 indexCount;
+} MaterialMesh;
+
+typedef struct MaterialSystem
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	PipelineManager* pipelines;
+	u32 paramAlignment; // minUniformBufferOffsetAlignment
+
+	VkSampler sampler; // immutable in every texture binding
+	VkDescriptorSetLayout globalLayout;
+	VkDescriptorSetLayout passLayout;
+	VkDescriptorPool descriptorPool;
+	AllocatedBuffer globals[MAX_FRAMES_IN_FLIGHT];
+	MaterialGlobals* globalsMapped[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorSet globalSets[MAX_FRAMES_IN_FLIGHT];
+	AllocatedBuffer params;
+	u8* paramsMapped;
+	u32 paramsUsed;
+	UniformRing objects; // set 3
+
+	MaterialDefinition definitions[MATERIAL_MAX_DEFINITIONS];
+	u32 definitionCount;
+	MaterialInstance instances[MATERIAL_MAX_INSTANCES];
+	u32 instanceCount;
+	MaterialSet sets[MATERIAL_MAX_SETS];
+	u32 setCount;
+	MaterialMesh meshes[MATERIAL_MAX_MESHES];
+	u32 meshCount;
+} MaterialSystem;
+
+void material_system_init(MaterialSystem* ms, const Application* app, PipelineManager* pipelines);
+void material_system_destroy(MaterialSystem* ms);
+
+// Reflects both shaders and registers the pipeline. MATERIAL_INVALID_HANDLE if the shaders use
+// sets or descriptor types the frequency scheme has no place for.
+MaterialHandle material_define(MaterialSystem* ms, const MaterialDefinitionDesc* desc);
+// params: paramSize bytes for the definition's parameter block (NULL: zeros). textures: one view
+// per texture binding of set 2, in binding order, SHADER_READ_ONLY_OPTIMAL.
+MaterialInstanceHandle material_instance_create(MaterialSystem* ms, MaterialHandle definition, const void* params, u32 paramSize,
+    const VkImageView* textures, u32 textureCount);
+MaterialMeshHandle material_mesh_create(MaterialSystem* ms, const float* positions, u32 vertexCount, const u16* indices, u32 indexCount);
+
+// Writes this frame's globals and releases the slot's object blocks; call after the frame's
+// fence wait
+void material_system_begin_frame(MaterialSystem* ms, u32 frameIndex, const MaterialGlobals* globals);
+// Flushes this frame's object blocks; call once everything is submitted
+void material_system_end_frame(MaterialSystem* ms);
+
+// Queues mesh drawn with instance: globals, set 2 at the instance's offset, the mesh and
+// objectSize bytes (at most UNIFORM_RING_MAX_BLOCK) of per-object data copied into a set 3
+// block. depth in [0, 1] orders draws within a material. False (nothing queued) while the
+// definition's pipeline is not ready or the queue or object ring is full.
+bool material_submit(MaterialSystem* ms, RenderQueue* queue, u32 frameIndex, u32 pass, MaterialInstanceHandle instance, MaterialMeshHandle mesh,
+    float depth, const void* object, u32 objectSize);
+
+#endif // MATERIAL_H
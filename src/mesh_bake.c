@@ -0,0 +1,288 @@
+#include "mesh_bake.h"
+#include <math.h>
+#include <string.h>
+
+// --- Vertex cache optimisation (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation") ---
+
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_VALENCE_TABLE 32
+
+static float cacheScoreTable[FORSYTH_CACHE_SIZE];
+static float valenceScoreTable[FORSYTH_VALENCE_TABLE];
+
+static void forsyth_init_tables(void)
+{
+	for (u32 i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+	{
+		// the last triangle's three vertices get a fixed score so we don't favour any of its edges
+		if (i < 3)
+			cacheScoreTable[i] = 0.75f;
+		else
+			cacheScoreTable[i] = powf(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+	}
+	for (u32 i = 1; i < FORSYTH_VALENCE_TABLE; ++i)
+		valenceScoreTable[i] = 2.0f / sqrtf((float)i);
+	valenceScoreTable[0] = 0.0f;
+}
+
+static float forsyth_vertex_score(i32 cachePosition, u32 remaining)
+{
+	if (remaining == 0)
+		return -1.0f; // nothing left to draw with this vertex
+	float score = cachePosition >= 0 && cachePosition < FORSYTH_CACHE_SIZE ? cacheScoreTable[cachePosition] : 0.0f;
+	// low valence vertices are boosted so we finish off lone triangles instead of leaving them behind
+	score += remaining < FORSYTH_VALENCE_TABLE ? valenceScoreTable[remaining] : 2.0f / sqrtf((float)remaining);
+	return score;
+}
+
+void mesh_optimize_vertex_cache(u32* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triCount = indexCount / 3;
+	if (triCount == 0)
+		return;
+	forsyth_init_tables();
+
+	// per vertex list of not yet emitted triangles, stored as ranges in one array
+	u32* remaining = calloc(vertexCount, sizeof(u32));
+	u32* adjOffset = malloc((vertexCount + 1) * sizeof(u32));
+	u32* adjacency = malloc(indexCount * sizeof(u32));
+	for (size_t i = 0; i < indexCount; ++i)
+		remaining[indices[i]]++;
+	adjOffset[0] = 0;
+	for (size_t v = 0; v < vertexCount; ++v)
+		adjOffset[v + 1] = adjOffset[v] + remaining[v];
+	u32* fill = calloc(vertexCount, sizeof(u32));
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		u32 v = indices[i];
+		adjacency[adjOffset[v] + fill[v]++] = (u32)(i / 3);
+	}
+	free(fill);
+
+	i32* cachePosition = malloc(vertexCount * sizeof(i32));
+	float* vertexScore = malloc(vertexCount * sizeof(float));
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		cachePosition[v] = -1;
+		vertexScore[v] = forsyth_vertex_score(-1, remaining[v]);
+	}
+
+	float* triScore = malloc(triCount * sizeof(float));
+	bool* emitted = calloc(triCount, sizeof(bool));
+	i64 best = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triCount; ++t)
+	{
+		triScore[t] = vertexScore[indices[t * 3 + 0]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triScore[t] > bestScore)
+		{
+			bestScore = triScore[t];
+			best = (i64)t;
+		}
+	}
+
+	u32 cache[FORSYTH_CACHE_SIZE + 3];
+	u32 newCache[FORSYTH_CACHE_SIZE + 3];
+	u32 cacheCount = 0;
+	u32* output = malloc(indexCount * sizeof(u32));
+	size_t outCount = 0;
+	size_t cursor = 0; // fallback scan position when the cache runs dry
+
+	while (outCount < triCount * 3)
+	{
+		if (best < 0)
+		{
+			// nothing in the cache touches a live triangle, continue with the next unemitted one
+			while (emitted[cursor])
+				cursor++;
+			best = (i64)cursor;
+		}
+		const u32* tri = &indices[best * 3];
+		emitted[best] = true;
+		for (u32 k = 0; k < 3; ++k)
+		{
+			u32 v = tri[k];
+			output[outCount++] = v;
+			// remove the triangle from this vertex's live range
+			u32* list = &adjacency[adjOffset[v]];
+			for (u32 j = 0; j < remaining[v]; ++j)
+			{
+				if (list[j] == (u32)best)
+				{
+					list[j] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// new LRU: the triangle's vertices in front, then the old cache minus those
+		u32 newCount = 0;
+		for (u32 k = 0; k < 3; ++k)
+			newCache[newCount++] = tri[k];
+		for (u32 i = 0; i < cacheCount; ++i)
+		{
+			u32 v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+		for (u32 i = 0; i < newCount; ++i)
+		{
+			u32 v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (i32)i : -1;
+			vertexScore[v] = forsyth_vertex_score(cachePosition[v], remaining[v]);
+		}
+
+		// only triangles touching the (old or new) cache changed score
+		best = -1;
+		bestScore = -1.0f;
+		for (u32 i = 0; i < newCount; ++i)
+		{
+			u32 v = newCache[i];
+			const u32* list = &adjacency[adjOffset[v]];
+			for (u32 j = 0; j < remaining[v]; ++j)
+			{
+				u32 t = list[j];
+				float score = vertexScore[indices[t * 3 + 0]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triScore[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = (i64)t;
+				}
+			}
+		}
+
+		cacheCount = MIN(newCount, (u32)FORSYTH_CACHE_SIZE);
+		memcpy(cache, newCache, cacheCount * sizeof(u32));
+	}
+
+	memcpy(indices, output, triCount * 3 * sizeof(u32));
+	free(output);
+	free(emitted);
+	free(triScore);
+	free(vertexScore);
+	free(cachePosition);
+	free(adjacency);
+	free(adjOffset);
+	free(remaining);
+}
+
+size_t mesh_optimize_vertex_fetch(MeshVertex* vertices, size_t vertexCount, u32* indices, size_t indexCount)
+{
+	u32* remap = malloc(vertexCount * sizeof(u32));
+	memset(remap, 0xff, vertexCount * sizeof(u32));
+	u32 next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		u32 v = indices[i];
+		if (remap[v] == UINT32_MAX)
+			remap[v] = next++;
+		indices[i] = remap[v];
+	}
+
+	MeshVertex* reordered = malloc((size_t)next * sizeof(MeshVertex));
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] != UINT32_MAX)
+			reordered[remap[v]] = vertices[v];
+	}
+	memcpy(vertices, reordered, (size_t)next * sizeof(MeshVertex));
+	free(reordered);
+	free(remap);
+	return next;
+}
+
+float mesh_acmr(const u32* indices, size_t indexCount, size_t vertexCount, u32 cacheSize)
+{
+	if (indexCount < 3)
+		return 0.0f;
+	// FIFO: a vertex is a hit if fewer than cacheSize misses happened since it was inserted
+	u32* insertedAt = malloc(vertexCount * sizeof(u32));
+	memset(insertedAt, 0xff, vertexCount * sizeof(u32));
+	u32 misses = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		u32 v = indices[i];
+		if (insertedAt[v] == UINT32_MAX || misses - insertedAt[v] >= cacheSize)
+		{
+			insertedAt[v] = misses;
+			misses++;
+		}
+	}
+	free(insertedAt);
+	return (float)misses / (float)(indexCount / 3);
+}
+
+// --- Quantization ---
+
+MeshQuantization mesh_compute_quantization(const MeshVertex* vertices, size_t vertexCount)
+{
+	float lo[3] = {INFINITY, INFINITY, INFINITY};
+	float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		for (u32 c = 0; c < 3; ++c)
+		{
+			lo[c] = MIN(lo[c], vertices[i].position[c]);
+			hi[c] = MAX(hi[c], vertices[i].position[c]);
+		}
+	}
+	MeshQuantization q = {0};
+	for (u32 c = 0; c < 3; ++c)
+	{
+		q.offset[c] = vertexCount ? lo[c] : 0.0f;
+		q.scale[c] = vertexCount ? hi[c] - lo[c] : 0.0f;
+	}
+	return q;
+}
+
+static i16 float_to_snorm16(float f)
+{
+	f = CLAMP(f, -1.0f, 1.0f);
+	return (i16)lrintf(f * 32767.0f);
+}
+
+static void oct_encode(const float n[3], i16 out[2])
+{
+	float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	if (l1 <= 0.0f)
+	{
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+	float x = n[0] / l1, y = n[1] / l1;
+	if (n[2] < 0.0f)
+	{
+		// fold the lower hemisphere over the diagonals
+		float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	out[0] = float_to_snorm16(x);
+	out[1] = float_to_snorm16(y);
+}
+
+void mesh_quantize(const MeshVertex* vertices, size_t vertexCount, const MeshQuantization* q, QuantizedVertex* out)
+{
+	float inv[3];
+	for (u32 c = 0; c < 3; ++c)
+		inv[c] = q->scale[c] > 0.0f ? 65535.0f / q->scale[c] : 0.0f;
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const MeshVertex* v = &vertices[i];
+		QuantizedVertex* o = &out[i];
+		for (u32 c = 0; c < 3; ++c)
+		{
+			float u = (v->position[c] - q->offset[c]) * inv[c];
+			o->position[c] = (u16)lrintf(CLAMP(u, 0.0f, 65535.0f));
+		}
+		o->position[3] = 0;
+		oct_encode(v->normal, o->normal);
+		o->uv[0] = float_to_half(v->uv[0]);
+		o->uv[1] = float_to_half(v->uv[1]);
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef MESH_BAKE_H
+#define MESH_BAKE_H
+
+#include "types.h"
+
+// Mesh optimisation for the bake step
+// - vertices are quantized to 16 bytes (vs 32 for float pos/normal/uv):
+//     position  R16G16B16A16_UNORM, dequantized in the shader with a per-mesh offset/scale
+//     normal    R16G16_SNORM octahedral
+//     uv        R16G16_SFLOAT
+// - indices are reordered for the post-transform cache (Forsyth), then vertices are
+//   reordered by first use so vertex fetch walks memory linearly
+// shaders/mesh_quant.vert spells out the decode of QuantizedVertex (binding 0, the formats above
+// at offsetof each field). Nothing loads .mesh files at runtime yet, so no pipeline uses it.
+
+typedef struct MeshVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+} MeshVertex;
+
+typedef struct QuantizedVertex
+{
+	u16 position[4]; // xyz unorm, w unused (keeps the attribute 8 byte aligned)
+	i16 normal[2];   // octahedral snorm
+	u16 uv[2];       // half floats
+} QuantizedVertex;
+
+typedef struct MeshQuantization
+{
+	float offset[3]; // position = offset + unorm * scale
+	float scale[3];
+} MeshQuantization;
+
+// On-disk layout written by `bake mesh`:
+//   MeshFileHeader, QuantizedVertex[vertexCount], u16 or u32 indices[indexCount]
+#define MESH_FILE_MAGIC 0x3148534du // "MSH1"
+
+typedef struct MeshFileHeader
+{
+	u32 magic;
+	u32 vertexCount;
+	u32 indexCount;
+	u32 indexSize; // 2 or 4
+	MeshQuantization quantization;
+} MeshFileHeader;
+
+// Reorders triangles in place for a post-transform cache of ~32 entries.
+void mesh_optimize_vertex_cache(u32* indices, size_t indexCount, size_t vertexCount);
+
+// Reorders vertices by first use and rewrites indices to match. Unreferenced vertices are
+// dropped. Returns the new vertex count.
+size_t mesh_optimize_vertex_fetch(MeshVertex* vertices, size_t vertexCount, u32* indices, size_t indexCount);
+
+// Average cache miss ratio (transformed vertices per triangle) for a FIFO cache of cacheSize.
+float mesh_acmr(const u32* indices, size_t indexCount, size_t vertexCount, u32 cacheSize);
+
+MeshQuantization mesh_compute_quantization(const MeshVertex* vertices, size_t vertexCount);
+void mesh_quantize(const MeshVertex* vertices, size_t vertexCount, const MeshQuantization* q, QuantizedVertex* out);
+
+#endif // MESH_BAKE_H
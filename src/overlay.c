@@ -0,0 +1,466 @@
+// Nuklear first: types.h turns u8, u32, ... into macros that must not reach its implementation
+#define NK_INCLUDE_FIXED_TYPES
+#define NK_INCLUDE_STANDARD_VARARGS
+#define NK_INCLUDE_DEFAULT_ALLOCATOR
+#define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
+#define NK_INCLUDE_FONT_BAKING
+#define NK_INCLUDE_DEFAULT_FONT
+#define NK_IMPLEMENTATION
+#include "../external/nuklear/nuklear.h"
+#include "overlay.h"
+#include <string.h>
+
+struct OverlayNuklear
+{
+	struct nk_context ctx;
+	struct nk_font_atlas atlas;
+	struct nk_draw_null_texture nullTexture;
+	struct nk_buffer commands;
+};
+
+#define OVERLAY_VERTEX_BYTES (OVERLAY_MAX_VERTICES * sizeof(OverlayVertex))
+#define OVERLAY_FRAME_BYTES (OVERLAY_VERTEX_BYTES + OVERLAY_MAX_INDICES * sizeof(u16))
+
+static const VkVertexInputBindingDescription overlayBinding = {.binding = 0, .stride = sizeof(OverlayVertex), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+static const VkVertexInputAttributeDescription overlayAttributes[] = {
+    {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(OverlayVertex, position)},
+    {.location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(OverlayVertex, uv)},
+    {.location = 2, .binding = 0, .format = VK_FORMAT_R8G8B8A8_UNORM, .offset = offsetof(OverlayVertex, color)},
+    {.location = 3, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(OverlayVertex, clip)},
+};
+static const VkPipelineVertexInputStateCreateInfo overlayInput = {
+    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    .vertexBindingDescriptionCount = 1,
+    .pVertexBindingDescriptions = &overlayBinding,
+    .vertexAttributeDescriptionCount = ARRAYSIZE(overlayAttributes),
+    .pVertexAttributeDescriptions = overlayAttributes,
+};
+// what nk_convert writes; the clip rectangle is filled in afterwards
+static const struct nk_draw_vertex_layout_element overlayLayout[] = {
+    {NK_VERTEX_POSITION, NK_FORMAT_FLOAT, offsetof(OverlayVertex, position)},
+    {NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, offsetof(OverlayVertex, uv)},
+    {NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, offsetof(OverlayVertex, color)},
+    {NK_VERTEX_LAYOUT_END},
+};
+
+// Bakes the font and stages its pixels; the image is filled by the first overlay pass
+static struct nk_font* create_atlas(Overlay* ov)
+{
+	struct nk_font_atlas* atlas = &ov->nk->atlas;
+	nk_font_atlas_init_default(atlas);
+	nk_font_atlas_begin(atlas);
+	struct nk_font* font = nk_font_atlas_add_default(atlas, OVERLAY_FONT_SIZE, NULL);
+	int width, height;
+	const void* pixels = nk_font_atlas_bake(atlas, &width, &height, NK_FONT_ATLAS_RGBA32);
+
+	size_t bytes = (size_t)width * (size_t)height * 4;
+	ov->atlasStaging = create_buffer(ov->allocator, bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	void* mapped;
+	VK_CHECK(vmaMapMemory(ov->allocator, ov->atlasStaging.allocation, &mapped));
+	memcpy(mapped, pixels, bytes);
+	vmaFlushAllocation(ov->allocator, ov->atlasStaging.allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(ov->allocator, ov->atlasStaging.allocation);
+
+	ov->atlas = (AllocatedImage){
+	    .imageExtent = {(u32)width, (u32)height, 1},
+	    .imageFormat = VK_FORMAT_R8G8B8A8_UNORM,
+	};
+	VkImageCreateInfo imgInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+	    .imageType = VK_IMAGE_TYPE_2D,
+	    .format = ov->atlas.imageFormat,
+	    .extent = ov->atlas.imageExtent,
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .samples = VK_SAMPLE_COUNT_1_BIT,
+	    .tiling = VK_IMAGE_TILING_OPTIMAL,
+	    .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	};
+	VmaAllocationCreateInfo allocInfo = {
+	    .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+	};
+	VK_CHECK(vmaCreateImage(ov->allocator, &imgInfo, &allocInfo, &ov->atlas.image, &ov->atlas.allocation, NULL));
+	ov->atlas.imageView = createImageView(ov->device, ov->atlas.image, ov->atlas.imageFormat, VK_IMAGE_VIEW_TYPE_2D, 0, 1, 0, 1);
+
+	// frees the baked pixels; the glyphs stay until nk_font_atlas_clear
+	nk_font_atlas_end(atlas, nk_handle_id(0), &ov->nk->nullTexture);
+	nk_font_atlas_cleanup(atlas);
+	printf("[Overlay] font atlas %dx%d\n", width, height);
+	return font;
+}
+
+void overlay_init(Overlay* ov, const Application* app, PipelineManager* pipelines, bool visible)
+{
+	memset(ov, 0, sizeof(*ov));
+	ov->device = app->device;
+	ov->allocator = app->allocator;
+	ov->app = app;
+	ov->pipelines = pipelines;
+	ov->visible = visible;
+	ov->nk = calloc(1, sizeof(OverlayNuklear));
+
+	struct nk_font* font = create_atlas(ov);
+	nk_init_default(&ov->nk->ctx, &font->handle);
+	nk_buffer_init_default(&ov->nk->commands);
+
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_LINEAR,
+	    .minFilter = VK_FILTER_LINEAR,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	};
+	VK_CHECK(vkCreateSampler(ov->device, &samplerInfo, NULL, &ov->sampler));
+
+	VkDescriptorSetLayoutBinding binding = {
+	    .binding = 0,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+	    .descriptorCount = 1,
+	    .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = 1,
+	    .pBindings = &binding,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(ov->device, &layoutInfo, NULL, &ov->setLayout));
+
+	VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = 1,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &poolSize,
+	};
+	VK_CHECK(vkCreateDescriptorPool(ov->device, &poolInfo, NULL, &ov->descriptorPool));
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = ov->descriptorPool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &ov->setLayout,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(ov->device, &allocInfo, &ov->set));
+
+	VkDescriptorImageInfo imageInfo = {ov->sampler, ov->atlas.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	VkWriteDescriptorSet write = {
+	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+	    .dstSet = ov->set,
+	    .dstBinding = 0,
+	    .descriptorCount = 1,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+	    .pImageInfo = &imageInfo,
+	};
+	vkUpdateDescriptorSets(ov->device, 1, &write, 0, NULL);
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+	    .offset = 0,
+	    .size = sizeof(OverlayPush),
+	};
+	ov->pipelineLayout = createPipelineLayout(ov->device, &ov->setLayout, 1, &pcr, 1);
+	PipelineDesc desc = {
+	    .name = "overlay",
+	    .onDemand = !visible, // compiled the first time F1 shows it
+	    .vertexShader = "compiledshaders/overlay.vert.spv",
+	    .fragmentShader = "compiledshaders/overlay.frag.spv",
+	    .layout = ov->pipelineLayout,
+	    .vertexInput = &overlayInput,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	    .cullMode = VK_CULL_MODE_NONE,
+	    .colorFormat = app->swapchainFormat,
+	    .blend = PIPELINE_BLEND_PREMULTIPLIED,
+	};
+	ov->pipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+
+	ov->geometry = create_buffer(ov->allocator, OVERLAY_FRAME_BYTES * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+	    VMA_MEMORY_USAGE_CPU_TO_GPU);
+	VK_CHECK(vmaMapMemory(ov->allocator, ov->geometry.allocation, (void**)&ov->mapped));
+	ov->vertices = malloc(OVERLAY_VERTEX_BYTES);
+	ov->indices = malloc(OVERLAY_MAX_INDICES * sizeof(u16));
+}
+
+void overlay_destroy(Overlay* ov)
+{
+	nk_buffer_free(&ov->nk->commands);
+	nk_free(&ov->nk->ctx);
+	nk_font_atlas_clear(&ov->nk->atlas);
+	free(ov->nk);
+	free(ov->vertices);
+	free(ov->indices);
+	vmaUnmapMemory(ov->allocator, ov->geometry.allocation);
+	vmaDestroyBuffer(ov->allocator, ov->geometry.buffer, ov->geometry.allocation);
+	if (ov->atlasStaging.buffer)
+		vmaDestroyBuffer(ov->allocator, ov->atlasStaging.buffer, ov->atlasStaging.allocation);
+	vkDestroyImageView(ov->device, ov->atlas.imageView, NULL);
+	vmaDestroyImage(ov->allocator, ov->atlas.image, ov->atlas.allocation);
+	vkDestroySampler(ov->device, ov->sampler, NULL);
+	vkDestroyPipelineLayout(ov->device, ov->pipelineLayout, NULL);
+	vkDestroyDescriptorPool(ov->device, ov->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(ov->device, ov->setLayout, NULL);
+}
+
+bool overlay_begin_frame(Overlay* ov, GLFWwindow* window, double frameMs)
+{
+	ov->frameMs[ov->frameCursor] = (float)frameMs;
+	ov->frameCursor = (ov->frameCursor + 1) % OVERLAY_HISTORY;
+	bool down = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+	if (down && !ov->toggleDown)
+		ov->visible = !ov->visible;
+	ov->toggleDown = down;
+	ov->gpuTimeCount = 0;
+	ov->counterCount = 0;
+
+	if (ov->atlasStaging.buffer && ov->atlasUploaded && ov->app->frameNumber >= ov->atlasUploadFrame + MAX_FRAMES_IN_FLIGHT)
+	{
+		vmaDestroyBuffer(ov->allocator, ov->atlasStaging.buffer, ov->atlasStaging.allocation);
+		ov->atlasStaging = (AllocatedBuffer){0};
+	}
+	if (!ov->visible)
+		return false;
+
+	// the cursor is in window coordinates, the panels in swapchain pixels
+	struct nk_context* ctx = &ov->nk->ctx;
+	double x, y;
+	int windowWidth, windowHeight;
+	glfwGetCursorPos(window, &x, &y);
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
+	x *= windowWidth > 0 ? (double)ov->app->width / windowWidth : 1.0;
+	y *= windowHeight > 0 ? (double)ov->app->height / windowHeight : 1.0;
+	nk_input_begin(ctx);
+	nk_input_motion(ctx, (int)x, (int)y);
+	nk_input_button(ctx, NK_BUTTON_LEFT, (int)x, (int)y, glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS);
+	nk_input_end(ctx);
+	return true;
+}
+
+void overlay_gpu_time(Overlay* ov, const char* name, double ms)
+{
+	if (ov->gpuTimeCount < OVERLAY_MAX_VALUES)
+		ov->gpuTimes[ov->gpuTimeCount++] = (OverlayValue){name, ms};
+}
+
+void overlay_counter(Overlay* ov, const char* name, double value)
+{
+	if (ov->counterCount < OVERLAY_MAX_VALUES)
+		ov->counters[ov->counterCount++] = (OverlayValue){name, value};
+}
+
+static void build_panels(Overlay* ov)
+{
+	struct nk_context* ctx = &ov->nk->ctx;
+	float height = MIN((float)ov->extent.height - 20.0f, 560.0f);
+	if (nk_begin(ctx, "Debug (F1)", nk_rect(10.0f, 10.0f, 320.0f, height),
+	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_TITLE))
+	{
+		float maxMs = 0.0f, sumMs = 0.0f;
+		for (u32 i = 0; i < OVERLAY_HISTORY; ++i)
+		{
+			maxMs = MAX(maxMs, ov->frameMs[i]);
+			sumMs += ov->frameMs[i];
+		}
+		nk_layout_row_dynamic(ctx, 18.0f, 1);
+		nk_labelf(ctx, NK_TEXT_LEFT, "Frame: %.2f ms avg, %.2f ms max", sumMs / OVERLAY_HISTORY, maxMs);
+		nk_layout_row_dynamic(ctx, 60.0f, 1);
+		if (nk_chart_begin(ctx, NK_CHART_LINES, OVERLAY_HISTORY, 0.0f, MAX(maxMs, 1.0f)))
+		{
+			// oldest first
+			for (u32 i = 0; i < OVERLAY_HISTORY; ++i)
+				nk_chart_push(ctx, ov->frameMs[(ov->frameCursor + i) % OVERLAY_HISTORY]);
+			nk_chart_end(ctx);
+		}
+
+		if (ov->gpuTimeCount > 0)
+		{
+			nk_layout_row_dynamic(ctx, 18.0f, 1);
+			nk_label(ctx, "GPU", NK_TEXT_LEFT);
+			nk_layout_row_dynamic(ctx, 16.0f, 2);
+			for (u32 i = 0; i < ov->gpuTimeCount; ++i)
+			{
+				nk_label(ctx, ov->gpuTimes[i].name, NK_TEXT_LEFT);
+				nk_labelf(ctx, NK_TEXT_RIGHT, "%.3f ms", ov->gpuTimes[i].value);
+			}
+		}
+
+		// without VK_EXT_memory_budget VMA estimates the budget and knows only its own usage
+		const VkPhysicalDeviceMemoryProperties* memProps;
+		vmaGetMemoryProperties(ov->allocator, &memProps);
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetHeapBudgets(ov->allocator, budgets);
+		nk_layout_row_dynamic(ctx, 18.0f, 1);
+		nk_label(ctx, ov->app->memoryBudgetSupported ? "Memory" : "Memory (estimated)", NK_TEXT_LEFT);
+		for (u32 i = 0; i < memProps->memoryHeapCount; ++i)
+		{
+			const double mib = 1.0 / (1024.0 * 1024.0);
+			bool deviceLocal = (memProps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+			nk_layout_row_dynamic(ctx, 16.0f, 1);
+			nk_labelf(ctx, NK_TEXT_LEFT, "heap %u%s: %.0f / %.0f MiB", i, deviceLocal ? " (device)" : "", (double)budgets[i].usage * mib,
+			    (double)budgets[i].budget * mib);
+			nk_size usage = (nk_size)MIN(budgets[i].usage, budgets[i].budget);
+			nk_layout_row_dynamic(ctx, 8.0f, 1);
+			nk_prog(ctx, usage, (nk_size)MAX(budgets[i].budget, (VkDeviceSize)1), nk_false);
+		}
+
+		if (ov->counterCount > 0)
+		{
+			nk_layout_row_dynamic(ctx, 18.0f, 1);
+			nk_label(ctx, "Counters", NK_TEXT_LEFT);
+			nk_layout_row_dynamic(ctx, 16.0f, 2);
+			for (u32 i = 0; i < ov->counterCount; ++i)
+			{
+				nk_label(ctx, ov->counters[i].name, NK_TEXT_LEFT);
+				nk_labelf(ctx, NK_TEXT_RIGHT, "%.6g", ov->counters[i].value);
+			}
+		}
+
+		nk_layout_row_dynamic(ctx, 16.0f, 1);
+		nk_labelf(ctx, NK_TEXT_LEFT, "overlay: %.3f ms CPU", ov->buildMs);
+	}
+	nk_end(ctx);
+}
+
+// Converts this frame's panels into the scratch arrays, stamps each vertex with its command's
+// clip rectangle and copies both arrays into the frame slot. False when there is nothing to draw.
+static bool build_geometry(Overlay* ov)
+{
+	OverlayNuklear* nk = ov->nk;
+	struct nk_convert_config config = {
+	    .global_alpha = 1.0f,
+	    .line_AA = NK_ANTI_ALIASING_ON,
+	    .shape_AA = NK_ANTI_ALIASING_ON,
+	    .circle_segment_count = 16,
+	    .arc_segment_count = 16,
+	    .curve_segment_count = 16,
+	    .tex_null = nk->nullTexture,
+	    .vertex_layout = overlayLayout,
+	    .vertex_size = sizeof(OverlayVertex),
+	    .vertex_alignment = NK_ALIGNOF(OverlayVertex),
+	};
+	struct nk_buffer vertexBuffer, indexBuffer;
+	nk_buffer_clear(&nk->commands);
+	nk_buffer_init_fixed(&vertexBuffer, ov->vertices, OVERLAY_VERTEX_BYTES);
+	nk_buffer_init_fixed(&indexBuffer, ov->indices, OVERLAY_MAX_INDICES * sizeof(u16));
+	nk_flags result = nk_convert(&nk->ctx, &nk->commands, &vertexBuffer, &indexBuffer, &config);
+	if (result != NK_CONVERT_SUCCESS)
+	{
+		if (!ov->overflowReported)
+			printf("[Overlay] more than %u vertices or %u indices, not drawn\n", OVERLAY_MAX_VERTICES, OVERLAY_MAX_INDICES);
+		ov->overflowReported = true;
+		return false;
+	}
+
+	// a command's vertices are only referenced by its own indices
+	u32 indexCount = 0, vertexCount = 0;
+	const struct nk_draw_command* command;
+	nk_draw_foreach(command, &nk->ctx, &nk->commands)
+	{
+		const struct nk_rect r = command->clip_rect;
+		const float clip[4] = {r.x, r.y, r.x + r.w, r.y + r.h};
+		for (u32 i = indexCount; i < indexCount + command->elem_count; ++i)
+		{
+			u16 v = ov->indices[i];
+			memcpy(ov->vertices[v].clip, clip, sizeof(clip));
+			vertexCount = MAX(vertexCount, (u32)v + 1);
+		}
+		indexCount += command->elem_count;
+	}
+	ov->indexCount = indexCount;
+	ov->vertexCount = vertexCount;
+	if (indexCount == 0)
+		return false;
+
+	VkDeviceSize base = (VkDeviceSize)ov->frameIndex * OVERLAY_FRAME_BYTES;
+	memcpy(ov->mapped + base, ov->vertices, vertexCount * sizeof(OverlayVertex));
+	memcpy(ov->mapped + base + OVERLAY_VERTEX_BYTES, ov->indices, indexCount * sizeof(u16));
+	vmaFlushAllocation(ov->allocator, ov->geometry.allocation, base, OVERLAY_FRAME_BYTES);
+	return true;
+}
+
+static void upload_atlas(Overlay* ov, VkCommandBuffer cmd)
+{
+	VkImageMemoryBarrier2 toCopy = imageBarrier(ov->atlas.image,
+	    VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+	    VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	    VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	pipelineBarrier(cmd, 0, 0, NULL, 1, &toCopy);
+	VkBufferImageCopy region = {
+	    .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+	    .imageExtent = ov->atlas.imageExtent,
+	};
+	vkCmdCopyBufferToImage(cmd, ov->atlasStaging.buffer, ov->atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	VkImageMemoryBarrier2 toSampled = imageBarrier(ov->atlas.image,
+	    VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	    VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	    VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	pipelineBarrier(cmd, 0, 0, NULL, 1, &toSampled);
+	ov->atlasUploaded = true;
+	ov->atlasUploadFrame = ov->app->frameNumber;
+}
+
+static void overlay_execute(VkCommandBuffer cmd, void* data)
+{
+	Overlay* ov = (Overlay*)data;
+	if (!ov->atlasUploaded)
+		upload_atlas(ov, cmd);
+
+	VkRenderingAttachmentInfo colorAttachment = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+	    .imageView = render_graph_image_view(ov->graph, ov->target),
+	    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	    .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+	    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+	};
+	VkRenderingInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+	    .renderArea = {{0, 0}, ov->extent},
+	    .layerCount = 1,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachments = &colorAttachment,
+	};
+	vkCmdBeginRendering(cmd, &renderingInfo);
+
+	VkDeviceSize base = (VkDeviceSize)ov->frameIndex * OVERLAY_FRAME_BYTES;
+	VkViewport viewport = {0.0f, 0.0f, (float)ov->extent.width, (float)ov->extent.height, 0.0f, 1.0f};
+	VkRect2D scissor = {{0, 0}, ov->extent};
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_get(ov->pipelines, ov->pipeline));
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ov->pipelineLayout, 0, 1, &ov->set, 0, NULL);
+	vkCmdPushConstants(cmd, ov->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(OverlayPush), &ov->push);
+	vkCmdBindVertexBuffers(cmd, 0, 1, &ov->geometry.buffer, &base);
+	vkCmdBindIndexBuffer(cmd, ov->geometry.buffer, base + OVERLAY_VERTEX_BYTES, VK_INDEX_TYPE_UINT16);
+	vkCmdDrawIndexed(cmd, ov->indexCount, 1, 0, 0, 0);
+	vkCmdEndRendering(cmd);
+}
+
+static bool is_srgb(VkFormat format)
+{
+	return format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+}
+
+void overlay_add_pass(Overlay* ov, RenderGraph* graph, RenderGraphImage target, VkExtent2D extent, u32 frameIndex)
+{
+	// on demand: nothing is built until the pipeline is ready
+	if (!pipeline_get(ov->pipelines, ov->pipeline))
+		return;
+
+	double start = glfwGetTime();
+	ov->graph = graph;
+	ov->target = target;
+	ov->extent = extent;
+	ov->frameIndex = frameIndex;
+	ov->push = (OverlayPush){
+	    .scale = {2.0f / (float)extent.width, 2.0f / (float)extent.height},
+	    .linearize = is_srgb(ov->app->swapchainFormat),
+	};
+	build_panels(ov);
+	bool draw = build_geometry(ov);
+	nk_clear(&ov->nk->ctx);
+	ov->buildMs = (glfwGetTime() - start) * 1e3;
+	if (!draw)
+		return;
+
+	RenderGraphPass pass = render_graph_add_pass(graph, "overlay", overlay_execute, ov);
+	render_graph_use(graph, pass, target, RG_USAGE_COLOR_READ_WRITE);
+}
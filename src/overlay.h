@@ -0,0 +1,112 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include "pipeline_manager.h"
+#include "render_graph.h"
+
+// Debug overlay: Nuklear (external/nuklear) panels drawn over the presented image
+// - F1 toggles it, --overlay starts with it shown. Hidden, a frame costs storing its frame time
+//   and one key poll: no Nuklear calls, no pass in the graph
+// - panels: CPU frame time history, the GPU pass timings and counters the caller hands in for
+//   this frame, and the VMA heap budgets
+// - one font atlas (Nuklear's default font), baked at init and uploaded by the first pass that
+//   draws; the staging copy is freed once that frame is done
+// - nk_convert writes into CPU scratch arrays, which are then copied into this frame slot's
+//   region of one persistently mapped vertex + index buffer, so the GPU reads the other slot's
+//   while this one is written
+// - Nuklear only starts a new command where the clip rectangle changes (every command samples the
+//   one atlas). The rectangle is stored per vertex instead and overlay.frag discards outside it,
+//   so the whole overlay is a single vkCmdDrawIndexed under a full screen scissor
+// - dynamic rendering straight onto the swapchain image after tonemapping, loaded, premultiplied
+//   alpha blended
+
+#define OVERLAY_HISTORY 240         // frame times in the chart
+#define OVERLAY_MAX_VALUES 16       // GPU timings and counters, each
+#define OVERLAY_MAX_VERTICES 16384  // per frame, so 16-bit indices always reach
+#define OVERLAY_MAX_INDICES (OVERLAY_MAX_VERTICES * 3)
+#define OVERLAY_FONT_SIZE 13.0f
+
+// Matches overlay.vert's inputs
+typedef struct OverlayVertex
+{
+	float position[2]; // pixels
+	float uv[2];
+	u8 color[4];
+	float clip[4]; // x0, y0, x1, y1 in pixels
+} OverlayVertex;
+
+// Matches the push constant block of overlay.vert
+typedef struct OverlayPush
+{
+	float scale[2]; // 2 / extent
+	u32 linearize;
+} OverlayPush;
+
+typedef struct OverlayValue
+{
+	const char* name; // must outlive the frame's overlay_add_pass
+	double value;
+} OverlayValue;
+
+typedef struct OverlayNuklear OverlayNuklear;
+
+typedef struct Overlay
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	const Application* app;
+	PipelineManager* pipelines;
+	PipelineHandle pipeline;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet set;
+	VkSampler sampler;
+	OverlayNuklear* nk; // context, font atlas, command buffer: overlay.c
+
+	AllocatedImage atlas;
+	AllocatedBuffer atlasStaging; // until the upload's frame is done
+	u64 atlasUploadFrame;
+	bool atlasUploaded;
+
+	AllocatedBuffer geometry; // MAX_FRAMES_IN_FLIGHT x (vertices, indices), persistently mapped
+	u8* mapped;
+	OverlayVertex* vertices; // nk_convert's output, before the copy
+	u16* indices;
+	u32 vertexCount;
+	u32 indexCount;
+
+	bool visible;
+	bool toggleDown;
+	bool overflowReported;
+
+	// filled every frame, visible or not
+	float frameMs[OVERLAY_HISTORY];
+	u32 frameCursor;
+	double buildMs; // last visible frame's UI build, convert and copy
+
+	// this frame's rows and graph state, referenced by the pass callback until the graph executes
+	OverlayValue gpuTimes[OVERLAY_MAX_VALUES];
+	u32 gpuTimeCount;
+	OverlayValue counters[OVERLAY_MAX_VALUES];
+	u32 counterCount;
+	RenderGraph* graph;
+	RenderGraphImage target;
+	VkExtent2D extent;
+	u32 frameIndex;
+	OverlayPush push;
+} Overlay;
+
+void overlay_init(Overlay* ov, const Application* app, PipelineManager* pipelines, bool visible);
+void overlay_destroy(Overlay* ov);
+
+// Once per frame after the fence wait: records frameMs and polls F1. Returns whether the overlay
+// is shown this frame; when it is not, skip the calls below.
+bool overlay_begin_frame(Overlay* ov, GLFWwindow* window, double frameMs);
+void overlay_gpu_time(Overlay* ov, const char* name, double ms);
+void overlay_counter(Overlay* ov, const char* name, double value);
+
+// Builds the panels and draws them onto target (the swapchain image, loaded) at extent
+void overlay_add_pass(Overlay* ov, RenderGraph* graph, RenderGraphImage target, VkExtent2D extent, u32 frameIndex);
+
+#endif // OVERLAY_H
@@ -0,0 +1,345 @@
+#include "particles.h"
+#include <math.h>
+#include <string.h>
+
+#define PARTICLE_BINDINGS 7
+
+void particles_init(Particles* particles, const Application* app, PipelineManager* pipelines, u32 capacity, VkFormat colorFormat)
+{
+	memset(particles, 0, sizeof(*particles));
+	particles->device = app->device;
+	particles->allocator = app->allocator;
+	particles->pipelines = pipelines;
+	particles->colorFormat = colorFormat;
+	particles->capacity = gpu_sort_capacity(MIN(capacity, PARTICLES_MAX_CAPACITY));
+	u32 n = particles->capacity;
+
+	gpu_sort_init(&particles->sort, app, pipelines);
+
+	// 0 positions, 1 velocities, 2 lifetimes, 3 dead list, 4 alive lists, 5 counters, 6 sort pairs
+	VkDescriptorSetLayoutBinding bindings[PARTICLE_BINDINGS];
+	for (u32 i = 0; i < PARTICLE_BINDINGS; ++i)
+	{
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = PARTICLE_BINDINGS,
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(particles->device, &layoutInfo, NULL, &particles->setLayout));
+
+	VkDescriptorPoolSize poolSize = {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = PARTICLE_BINDINGS};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = 1,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &poolSize,
+	};
+	VK_CHECK(vkCreateDescriptorPool(particles->device, &poolInfo, NULL, &particles->descriptorPool));
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = particles->descriptorPool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &particles->setLayout,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(particles->device, &allocInfo, &particles->set));
+
+	const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	particles->positions = create_buffer(particles->allocator, (size_t)n * 4 * sizeof(float), storage, VMA_MEMORY_USAGE_GPU_ONLY);
+	particles->velocities = create_buffer(particles->allocator, (size_t)n * 4 * sizeof(float), storage, VMA_MEMORY_USAGE_GPU_ONLY);
+	particles->lifetimes = create_buffer(particles->allocator, (size_t)n * sizeof(float), storage, VMA_MEMORY_USAGE_GPU_ONLY);
+	particles->deadList = create_buffer(particles->allocator, (size_t)n * sizeof(u32), storage, VMA_MEMORY_USAGE_GPU_ONLY);
+	particles->aliveLists = create_buffer(particles->allocator, (size_t)n * 2 * sizeof(u32), storage, VMA_MEMORY_USAGE_GPU_ONLY);
+	particles->counters = create_buffer(particles->allocator, PARTICLE_COUNTERS_SIZE, storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	particles->pairs = create_buffer(particles->allocator, (size_t)n * 2 * sizeof(u32), storage, VMA_MEMORY_USAGE_GPU_ONLY);
+	particles->sortReady = gpu_sort_create_plan(&particles->sort, &particles->sortPlan, particles->pairs.buffer, n, particles->counters.buffer,
+	    PARTICLE_COUNTER_SORT);
+
+	const VkBuffer buffers[PARTICLE_BINDINGS] = {particles->positions.buffer, particles->velocities.buffer, particles->lifetimes.buffer,
+	    particles->deadList.buffer, particles->aliveLists.buffer, particles->counters.buffer, particles->pairs.buffer};
+	VkDescriptorBufferInfo bufferInfos[PARTICLE_BINDINGS];
+	VkWriteDescriptorSet writes[PARTICLE_BINDINGS];
+	for (u32 i = 0; i < PARTICLE_BINDINGS; ++i)
+	{
+		bufferInfos[i] = (VkDescriptorBufferInfo){buffers[i], 0, VK_WHOLE_SIZE};
+		writes[i] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = particles->set,
+		    .dstBinding = i,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .pBufferInfo = &bufferInfos[i],
+		};
+	}
+	vkUpdateDescriptorSets(particles->device, PARTICLE_BINDINGS, writes, 0, NULL);
+
+	VkPushConstantRange simRange = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(ParticleSimPush),
+	};
+	particles->simLayout = createPipelineLayout(particles->device, &particles->setLayout, 1, &simRange, 1);
+	VkPushConstantRange drawRange = {
+	    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+	    .offset = 0,
+	    .size = sizeof(ParticleDrawPush),
+	};
+	particles->drawLayout = createPipelineLayout(particles->device, &particles->setLayout, 1, &drawRange, 1);
+
+	PipelineDesc desc = {
+	    .name = "particle_reset",
+	    .computeShader = "compiledshaders/particle_reset.comp.spv",
+	    .layout = particles->simLayout,
+	};
+	particles->resetPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "particle_args";
+	desc.computeShader = "compiledshaders/particle_args.comp.spv";
+	particles->argsPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "particle_emit";
+	desc.computeShader = "compiledshaders/particle_emit.comp.spv";
+	particles->emitPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "particle_simulate";
+	desc.computeShader = "compiledshaders/particle_simulate.comp.spv";
+	particles->simulatePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	PipelineDesc drawDesc = {
+	    .name = "particle",
+	    .vertexShader = "compiledshaders/particle.vert.spv",
+	    .fragmentShader = "compiledshaders/particle.frag.spv",
+	    .layout = particles->drawLayout,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+	    .cullMode = VK_CULL_MODE_NONE,
+	    .colorFormat = colorFormat,
+	    .blend = PIPELINE_BLEND_PREMULTIPLIED,
+	};
+	particles->drawPipeline = pipeline_register(pipelines, &drawDesc, PIPELINE_INVALID_HANDLE);
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	particles->timestampPeriod = props.limits.timestampComputeAndGraphics ? props.limits.timestampPeriod : 0.0f;
+	if (particles->timestampPeriod > 0.0f)
+	{
+		VkQueryPoolCreateInfo queryInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+		    .queryCount = MAX_FRAMES_IN_FLIGHT * 2,
+		};
+		VK_CHECK(vkCreateQueryPool(particles->device, &queryInfo, NULL, &particles->timestamps));
+	}
+	printf("[Particles] capacity %u, %.1f MiB of particle state\n", n, (double)n * 56 / (1024.0 * 1024.0));
+}
+
+void particles_destroy(Particles* particles)
+{
+	if (particles->timestamps)
+		vkDestroyQueryPool(particles->device, particles->timestamps, NULL);
+	gpu_sort_destroy_plan(&particles->sort, &particles->sortPlan);
+	gpu_sort_destroy(&particles->sort);
+	const AllocatedBuffer buffers[] = {particles->positions, particles->velocities, particles->lifetimes, particles->deadList, particles->aliveLists,
+	    particles->counters, particles->pairs};
+	for (u32 i = 0; i < ARRAYSIZE(buffers); ++i)
+		vmaDestroyBuffer(particles->allocator, buffers[i].buffer, buffers[i].allocation);
+	vkDestroyPipelineLayout(particles->device, particles->drawLayout, NULL);
+	vkDestroyPipelineLayout(particles->device, particles->simLayout, NULL);
+	vkDestroyDescriptorPool(particles->device, particles->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(particles->device, particles->setLayout, NULL);
+}
+
+// One barrier over every particle buffer
+static void state_barrier(Particles* particles, VkCommandBuffer cmd, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage,
+    VkAccessFlags2 dstAccess)
+{
+	const VkBuffer buffers[PARTICLE_BINDINGS] = {particles->positions.buffer, particles->velocities.buffer, particles->lifetimes.buffer,
+	    particles->deadList.buffer, particles->aliveLists.buffer, particles->counters.buffer, particles->pairs.buffer};
+	VkBufferMemoryBarrier2 barriers[PARTICLE_BINDINGS];
+	for (u32 i = 0; i < PARTICLE_BINDINGS; ++i)
+	{
+		barriers[i] = (VkBufferMemoryBarrier2){
+		    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		    .srcStageMask = srcStage,
+		    .srcAccessMask = srcAccess,
+		    .dstStageMask = dstStage,
+		    .dstAccessMask = dstAccess,
+		    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .buffer = buffers[i],
+		    .size = VK_WHOLE_SIZE,
+		};
+	}
+	pipelineBarrier(cmd, 0, PARTICLE_BINDINGS, barriers, 0, NULL);
+}
+
+// Compute writes to the next compute pass and its indirect arguments
+static void compute_barrier(Particles* particles, VkCommandBuffer cmd)
+{
+	state_barrier(particles, cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+	    VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+}
+
+void particles_simulate(Particles* particles, VkCommandBuffer cmd, u32 frameIndex, const PathTracerCamera* camera, float time, float deltaTime)
+{
+	PipelineManager* pm = particles->pipelines;
+	VkPipeline reset = pipeline_get(pm, particles->resetPipeline);
+	VkPipeline args = pipeline_get(pm, particles->argsPipeline);
+	VkPipeline emit = pipeline_get(pm, particles->emitPipeline);
+	VkPipeline simulate = pipeline_get(pm, particles->simulatePipeline);
+	if (!particles->sortReady || !reset || !args || !emit || !simulate)
+		return;
+
+	u32 firstQuery = frameIndex * 2;
+	if (particles->timestamps)
+	{
+		vkCmdResetQueryPool(cmd, particles->timestamps, firstQuery, 2);
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, particles->timestamps, firstQuery);
+	}
+
+	// last frame's draw read the state and the arguments this frame rewrites
+	state_barrier(particles, cmd, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, 0, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	// a steady emission rate keeps about capacity particles alive; the fraction carries over
+	deltaTime = MIN(deltaTime, 0.1f);
+	particles->emitAccum += (float)particles->capacity / PARTICLES_LIFETIME * deltaTime;
+	u32 emitRequest = (u32)particles->emitAccum;
+	particles->emitAccum -= (float)emitRequest;
+
+	float forward[3] = {camera->target[0] - camera->position[0], camera->target[1] - camera->position[1], camera->target[2] - camera->position[2]};
+	float len = sqrtf(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+	for (u32 i = 0; i < 3 && len > 0.0f; ++i)
+		forward[i] /= len;
+	ParticleSimPush push = {
+	    .cameraPosition = {camera->position[0], camera->position[1], camera->position[2], deltaTime},
+	    .cameraForward = {forward[0], forward[1], forward[2], time},
+	    .capacity = particles->capacity,
+	    .emitRequest = emitRequest,
+	    .seed = particles->frame++,
+	};
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, particles->simLayout, 0, 1, &particles->set, 0, NULL);
+	vkCmdPushConstants(cmd, particles->simLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+	if (!particles->initialized)
+	{
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, reset);
+		vkCmdDispatch(cmd, (particles->capacity + 255) / 256, 1, 1);
+		compute_barrier(particles, cmd);
+		particles->initialized = true;
+	}
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, args);
+	vkCmdDispatch(cmd, 1, 1, 1);
+	compute_barrier(particles, cmd);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, emit);
+	vkCmdDispatchIndirect(cmd, particles->counters.buffer, PARTICLE_COUNTER_EMIT_ARGS);
+	compute_barrier(particles, cmd);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, simulate);
+	vkCmdDispatchIndirect(cmd, particles->counters.buffer, PARTICLE_COUNTER_SIMULATE_ARGS);
+	compute_barrier(particles, cmd);
+	push.phase = 1;
+	vkCmdPushConstants(cmd, particles->simLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, args);
+	vkCmdDispatch(cmd, 1, 1, 1);
+	compute_barrier(particles, cmd);
+
+	// unsorted while the sort pipelines compile: drawn in simulation order
+	gpu_sort_record(&particles->sort, cmd, &particles->sortPlan);
+
+	state_barrier(particles, cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+	particles->simulated = true;
+
+	if (particles->timestamps)
+	{
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, particles->timestamps, firstQuery + 1);
+		particles->timestampsWritten[frameIndex] = true;
+	}
+}
+
+static void normalize3(float v[3])
+{
+	float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (len > 0.0f)
+	{
+		v[0] /= len;
+		v[1] /= len;
+		v[2] /= len;
+	}
+}
+
+static void cross3(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void particles_draw(Particles* particles, VkCommandBuffer cmd, VkImageView target, VkExtent2D extent, const PathTracerCamera* camera)
+{
+	VkRenderingAttachmentInfo colorAttachment = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+	    .imageView = target,
+	    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+	    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+	    .clearValue = {.color = {.float32 = {0.01f, 0.012f, 0.02f, 1.0f}}},
+	};
+	VkRenderingInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+	    .renderArea = {{0, 0}, extent},
+	    .layerCount = 1,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachments = &colorAttachment,
+	};
+	vkCmdBeginRendering(cmd, &renderingInfo);
+
+	VkPipeline pipeline = pipeline_get(particles->pipelines, particles->drawPipeline);
+	if (pipeline && particles->simulated)
+	{
+		float forward[3] = {camera->target[0] - camera->position[0], camera->target[1] - camera->position[1], camera->target[2] - camera->position[2]};
+		normalize3(forward);
+		const float worldUp[3] = {0.0f, 1.0f, 0.0f};
+		float right[3], up[3];
+		cross3(forward, worldUp, right);
+		normalize3(right);
+		cross3(right, forward, up);
+		ParticleDrawPush push = {
+		    .cameraPosition = {camera->position[0], camera->position[1], camera->position[2], tanf(camera->fovY * 0.5f)},
+		    .cameraRight = {right[0], right[1], right[2], (float)extent.width / (float)extent.height},
+		    .cameraUp = {up[0], up[1], up[2], 0.05f},
+		    .cameraForward = {forward[0], forward[1], forward[2], 1000.0f},
+		};
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		VkViewport viewport = {0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f};
+		VkRect2D scissor = {{0, 0}, extent};
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, particles->drawLayout, 0, 1, &particles->set, 0, NULL);
+		vkCmdPushConstants(cmd, particles->drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+		vkCmdDrawIndirect(cmd, particles->counters.buffer, PARTICLE_COUNTER_DRAW, 1, 0);
+	}
+	vkCmdEndRendering(cmd);
+}
+
+void particles_collect_timings(Particles* particles, u32 frameIndex)
+{
+	if (!particles->timestamps || !particles->timestampsWritten[frameIndex])
+		return;
+	particles->timestampsWritten[frameIndex] = false;
+	u64 ticks[2];
+	if (vkGetQueryPoolResults(particles->device, particles->timestamps, frameIndex * 2, 2, sizeof(ticks), ticks, sizeof(u64),
+	        VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+	particles->lastGpuMs = (double)(ticks[1] - ticks[0]) * particles->timestampPeriod * 1e-6;
+	particles->gpuMsAccum += particles->lastGpuMs;
+	if (++particles->gpuFrames == PARTICLES_REPORT_FRAMES)
+	{
+		printf("[Particles] emit + simulate + sort (capacity %u): %.3f ms GPU\n", particles->capacity, particles->gpuMsAccum / particles->gpuFrames);
+		particles->gpuMsAccum = 0.0;
+		particles->gpuFrames = 0;
+	}
+}
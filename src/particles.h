@@ -0,0 +1,105 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "gpu_sort.h"
+#include "pathtracer.h"
+
+// GPU particles: emitted, simulated, compacted and sorted in compute, drawn with an indirect draw
+// - structure of arrays in storage buffers (positions + size, velocities + age, lifetimes), so
+//   each pass only touches the streams it needs
+// - free slots live in a dead list; particle_args.comp clamps the CPU's emit request to it and
+//   writes the emit and simulate dispatch sizes, so nothing is ever read back
+// - particle_simulate.comp integrates the alive list into the other alive list (double buffered
+//   by the current index in the counters buffer), returning expired slots to the dead list and
+//   writing a depth key per survivor
+// - gpu_sort.h sorts the survivors back to front; particle.vert expands each one to a camera
+//   facing quad, instanced by the GPU written draw arguments, premultiplied alpha blended
+// - the GPU time of everything but the draw is printed every PARTICLES_REPORT_FRAMES frames
+
+#define PARTICLES_DEFAULT_CAPACITY (1u << 20)
+#define PARTICLES_MAX_CAPACITY (1u << 23)
+#define PARTICLES_LIFETIME 3.2f // mean seconds, the emitter keeps about capacity alive
+#define PARTICLES_REPORT_FRAMES 256
+
+// byte offsets into the counters buffer (see particle_args.comp)
+#define PARTICLE_COUNTER_SORT 20
+#define PARTICLE_COUNTER_DRAW 32
+#define PARTICLE_COUNTER_EMIT_ARGS 48
+#define PARTICLE_COUNTER_SIMULATE_ARGS 60
+#define PARTICLE_COUNTERS_SIZE 80
+
+// Matches the push constant block of the particle compute shaders
+typedef struct ParticleSimPush
+{
+	float cameraPosition[4]; // w: delta time
+	float cameraForward[4];  // w: time
+	u32 capacity;
+	u32 emitRequest;
+	u32 phase; // particle_args.comp: 0 before emitting, 1 after simulating
+	u32 seed;
+} ParticleSimPush;
+
+// Matches the push constant block of particle.vert
+typedef struct ParticleDrawPush
+{
+	float cameraPosition[4]; // w: tan(fovY / 2)
+	float cameraRight[4];    // w: aspect
+	float cameraUp[4];       // w: near
+	float cameraForward[4];  // w: far
+} ParticleDrawPush;
+
+typedef struct Particles
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	PipelineManager* pipelines;
+	GpuSort sort;
+	GpuSortPlan sortPlan;
+	bool sortReady;
+	u32 capacity;
+
+	PipelineHandle resetPipeline;
+	PipelineHandle argsPipeline;
+	PipelineHandle emitPipeline;
+	PipelineHandle simulatePipeline;
+	PipelineHandle drawPipeline;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout simLayout;
+	VkPipelineLayout drawLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet set;
+
+	AllocatedBuffer positions;  // vec4: xyz, size
+	AllocatedBuffer velocities; // vec4: xyz, age
+	AllocatedBuffer lifetimes;  // float
+	AllocatedBuffer deadList;   // uint slot
+	AllocatedBuffer aliveLists; // 2 x capacity uint slots
+	AllocatedBuffer counters;   // PARTICLE_COUNTERS_SIZE bytes, also the indirect arguments
+	AllocatedBuffer pairs;      // uvec2 per slot: depth key, slot
+	bool initialized;
+	bool simulated; // counters hold a draw
+	float emitAccum;
+	u32 frame;
+
+	VkFormat colorFormat;
+	VkQueryPool timestamps; // 2 per frame in flight
+	float timestampPeriod;
+	bool timestampsWritten[MAX_FRAMES_IN_FLIGHT];
+	double gpuMsAccum;
+	u32 gpuFrames;
+	double lastGpuMs;
+} Particles;
+
+// capacity: maximum live particles, rounded up to a power of two (the sort's) and clamped to
+// PARTICLES_MAX_CAPACITY. colorFormat: the target particles_draw renders to.
+void particles_init(Particles* particles, const Application* app, PipelineManager* pipelines, u32 capacity, VkFormat colorFormat);
+void particles_destroy(Particles* particles);
+
+// Emits, simulates and sorts. Records compute work: call outside rendering.
+void particles_simulate(Particles* particles, VkCommandBuffer cmd, u32 frameIndex, const PathTracerCamera* camera, float time, float deltaTime);
+// Clears target (COLOR_ATTACHMENT_OPTIMAL) and draws the particles seen from camera
+void particles_draw(Particles* particles, VkCommandBuffer cmd, VkImageView target, VkExtent2D extent, const PathTracerCamera* camera);
+// Call after the frame's fence wait
+void particles_collect_timings(Particles* particles, u32 frameIndex);
+
+#endif // PARTICLES_H
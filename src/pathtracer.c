@@ -0,0 +1,333 @@
+#include "pathtracer.h"
+#include <math.h>
+#include <string.h>
+
+// --- Scenes ---
+
+static void add_quad(PathTracerScene* scene, const float q[4][3], u32 material)
+{
+	u32 base = scene->vertexCount;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		for (u32 c = 0; c < 3; ++c)
+			scene->positions[(base + i) * 3 + c] = q[i][c] / 555.0f; // unit sized box
+	}
+	scene->vertexCount += 4;
+
+	const u32 tris[2][3] = {{0, 1, 2}, {0, 2, 3}};
+	for (u32 t = 0; t < 2; ++t)
+	{
+		for (u32 k = 0; k < 3; ++k)
+			scene->indices[scene->triangleCount * 3 + k] = base + tris[t][k];
+		scene->materialIds[scene->triangleCount] = material;
+		scene->triangleCount++;
+	}
+}
+
+void pathtracer_cornell_box(PathTracerScene* scene, PathTracerCamera* camera)
+{
+	enum
+	{
+		WHITE,
+		RED,
+		GREEN,
+		LIGHT,
+		MATERIAL_COUNT
+	};
+	// Cornell box data (cornell.edu), the light sits a hair below the ceiling
+	static const float quads[][4][3] = {
+	    {{552.8f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 559.2f}, {549.6f, 0.0f, 559.2f}},             // floor
+	    {{556.0f, 548.8f, 0.0f}, {556.0f, 548.8f, 559.2f}, {0.0f, 548.8f, 559.2f}, {0.0f, 548.8f, 0.0f}},     // ceiling
+	    {{549.6f, 0.0f, 559.2f}, {0.0f, 0.0f, 559.2f}, {0.0f, 548.8f, 559.2f}, {556.0f, 548.8f, 559.2f}},     // back
+	    {{130.0f, 165.0f, 65.0f}, {82.0f, 165.0f, 225.0f}, {240.0f, 165.0f, 272.0f}, {290.0f, 165.0f, 114.0f}}, // short block
+	    {{290.0f, 0.0f, 114.0f}, {290.0f, 165.0f, 114.0f}, {240.0f, 165.0f, 272.0f}, {240.0f, 0.0f, 272.0f}},
+	    {{130.0f, 0.0f, 65.0f}, {130.0f, 165.0f, 65.0f}, {290.0f, 165.0f, 114.0f}, {290.0f, 0.0f, 114.0f}},
+	    {{82.0f, 0.0f, 225.0f}, {82.0f, 165.0f, 225.0f}, {130.0f, 165.0f, 65.0f}, {130.0f, 0.0f, 65.0f}},
+	    {{240.0f, 0.0f, 272.0f}, {240.0f, 165.0f, 272.0f}, {82.0f, 165.0f, 225.0f}, {82.0f, 0.0f, 225.0f}},
+	    {{423.0f, 330.0f, 247.0f}, {265.0f, 330.0f, 296.0f}, {314.0f, 330.0f, 456.0f}, {472.0f, 330.0f, 406.0f}}, // tall block
+	    {{423.0f, 0.0f, 247.0f}, {423.0f, 330.0f, 247.0f}, {472.0f, 330.0f, 406.0f}, {472.0f, 0.0f, 406.0f}},
+	    {{472.0f, 0.0f, 406.0f}, {472.0f, 330.0f, 406.0f}, {314.0f, 330.0f, 456.0f}, {314.0f, 0.0f, 456.0f}},
+	    {{314.0f, 0.0f, 456.0f}, {314.0f, 330.0f, 456.0f}, {265.0f, 330.0f, 296.0f}, {265.0f, 0.0f, 296.0f}},
+	    {{265.0f, 0.0f, 296.0f}, {265.0f, 330.0f, 296.0f}, {423.0f, 330.0f, 247.0f}, {423.0f, 0.0f, 247.0f}},
+	};
+	static const float red[4][3] = {{552.8f, 0.0f, 0.0f}, {549.6f, 0.0f, 559.2f}, {556.0f, 548.8f, 559.2f}, {556.0f, 548.8f, 0.0f}};
+	static const float green[4][3] = {{0.0f, 0.0f, 559.2f}, {0.0f, 0.0f, 0.0f}, {0.0f, 548.8f, 0.0f}, {0.0f, 548.8f, 559.2f}};
+	static const float light[4][3] = {{343.0f, 548.0f, 227.0f}, {343.0f, 548.0f, 332.0f}, {213.0f, 548.0f, 332.0f}, {213.0f, 548.0f, 227.0f}};
+
+	u32 quadCount = ARRAYSIZE(quads) + 3;
+	*scene = (PathTracerScene){
+	    .positions = malloc(quadCount * 4 * 3 * sizeof(float)),
+	    .indices = malloc(quadCount * 6 * sizeof(u32)),
+	    .materialIds = malloc(quadCount * 2 * sizeof(u32)),
+	    .materials = calloc(MATERIAL_COUNT, sizeof(PathTracerMaterial)),
+	    .materialCount = MATERIAL_COUNT,
+	};
+	for (u32 i = 0; i < ARRAYSIZE(quads); ++i)
+		add_quad(scene, quads[i], WHITE);
+	add_quad(scene, red, RED);
+	add_quad(scene, green, GREEN);
+	add_quad(scene, light, LIGHT);
+
+	scene->materials[WHITE] = (PathTracerMaterial){.albedo = {0.73f, 0.73f, 0.73f, 1.0f}};
+	scene->materials[RED] = (PathTracerMaterial){.albedo = {0.65f, 0.05f, 0.05f, 1.0f}};
+	scene->materials[GREEN] = (PathTracerMaterial){.albedo = {0.12f, 0.45f, 0.15f, 1.0f}};
+	scene->materials[LIGHT] = (PathTracerMaterial){.albedo = {0.78f, 0.78f, 0.78f, 1.0f}, .emission = {17.0f, 12.0f, 4.0f, 0.0f}};
+
+	*camera = (PathTracerCamera){
+	    .position = {278.0f / 555.0f, 273.0f / 555.0f, -800.0f / 555.0f},
+	    .target = {278.0f / 555.0f, 273.0f / 555.0f, 0.0f},
+	    .fovY = 39.3f * 3.14159265f / 180.0f,
+	};
+}
+
+void pathtracer_scene_free(PathTracerScene* scene)
+{
+	free(scene->positions);
+	free(scene->indices);
+	free(scene->materialIds);
+	free(scene->materials);
+	memset(scene, 0, sizeof(*scene));
+}
+
+// --- Setup ---
+
+static AllocatedBuffer create_static_buffer(VmaAllocator allocator, const void* data, size_t size)
+{
+	AllocatedBuffer buffer = create_buffer(allocator, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	void* mapped;
+	VK_CHECK(vmaMapMemory(allocator, buffer.allocation, &mapped));
+	memcpy(mapped, data, size);
+	vmaUnmapMemory(allocator, buffer.allocation);
+	return buffer;
+}
+
+void pathtracer_init(PathTracer* pt, const Application* app, PipelineManager* pipelines, const PathTracerScene* scene)
+{
+	memset(pt, 0, sizeof(*pt));
+	pt->device = app->device;
+	pt->allocator = app->allocator;
+	pt->maxBounces = 6;
+	pt->persistentGroups = 1024; // enough to fill big GPUs, the tiles run out long before on small ones
+
+	bvh_build(&pt->bvh, scene->positions, scene->indices, scene->triangleCount, true);
+	// pathtrace.glsl's traversal stack holds BVH_MAX_DEPTH entries and cannot report an overflow
+	if (pt->bvh.maxDepth > BVH_MAX_DEPTH)
+	{
+		fprintf(stderr, "[PathTracer] BVH depth %u exceeds the shader's stack of %u\n", pt->bvh.maxDepth, BVH_MAX_DEPTH);
+		exit(1);
+	}
+	bvh_gpu_create(&pt->bvhGpu, pt->allocator, &pt->bvh);
+	printf("[PathTracer] %u triangles, %u BVH nodes, SAH cost %.2f\n", pt->bvh.triangleCount, pt->bvh.nodeCount, bvh_sah_cost(&pt->bvh));
+
+	pt->materialIds = create_static_buffer(pt->allocator, scene->materialIds, scene->triangleCount * sizeof(u32));
+	pt->materials = create_static_buffer(pt->allocator, scene->materials, scene->materialCount * sizeof(PathTracerMaterial));
+	pt->workCounter = create_buffer(pt->allocator, sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	// 0: accumulation image, 1: nodes, 2: triangles, 3: material ids, 4: materials, 5: work counter
+	VkDescriptorSetLayoutBinding bindings[6];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(pt->device, &layoutInfo, NULL, &pt->setLayout));
+
+	VkDescriptorPoolSize poolSizes[] = {
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 5},
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = 1,
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
+	    .pPoolSizes = poolSizes,
+	};
+	VK_CHECK(vkCreateDescriptorPool(pt->device, &poolInfo, NULL, &pt->descriptorPool));
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = pt->descriptorPool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &pt->setLayout,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(pt->device, &allocInfo, &pt->descriptorSet));
+
+	VkDescriptorBufferInfo bufferInfos[5] = {
+	    {.buffer = pt->bvhGpu.nodes.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+	    {.buffer = pt->bvhGpu.triangles.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+	    {.buffer = pt->materialIds.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+	    {.buffer = pt->materials.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+	    {.buffer = pt->workCounter.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+	};
+	VkWriteDescriptorSet writes[5];
+	for (u32 i = 0; i < ARRAYSIZE(writes); ++i)
+	{
+		writes[i] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = pt->descriptorSet,
+		    .dstBinding = i + 1,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .pBufferInfo = &bufferInfos[i],
+		};
+	}
+	vkUpdateDescriptorSets(pt->device, ARRAYSIZE(writes), writes, 0, NULL);
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(PathTracerPush),
+	};
+	pt->pipelineLayout = createPipelineLayout(pt->device, &pt->setLayout, 1, &pcr, 1);
+
+	pt->pipelines = pipelines;
+	VkSubgroupFeatureFlags claim = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT;
+	bool subgroupClaim = (app->computeSubgroupOps & claim) == claim;
+	if (!subgroupClaim)
+		printf("[PathTracer] No subgroup ballot in compute, every invocation claims its own work item\n");
+	PipelineDesc desc = {
+	    .name = "pathtrace",
+	    .computeShader = subgroupClaim ? "compiledshaders/pathtrace.comp.spv" : "compiledshaders/pathtrace_atomic.comp.spv",
+	    .layout = pt->pipelineLayout,
+	};
+	pt->pipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+}
+
+void pathtracer_destroy(PathTracer* pt)
+{
+	vkDestroyPipelineLayout(pt->device, pt->pipelineLayout, NULL);
+	vkDestroyDescriptorPool(pt->device, pt->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(pt->device, pt->setLayout, NULL);
+	vmaDestroyBuffer(pt->allocator, pt->workCounter.buffer, pt->workCounter.allocation);
+	vmaDestroyBuffer(pt->allocator, pt->materials.buffer, pt->materials.allocation);
+	vmaDestroyBuffer(pt->allocator, pt->materialIds.buffer, pt->materialIds.allocation);
+	bvh_gpu_destroy(&pt->bvhGpu, pt->allocator);
+	bvh_destroy(&pt->bvh);
+}
+
+void pathtracer_bind_target(PathTracer* pt, VkImageView target)
+{
+	VkDescriptorImageInfo imageInfo = {
+	    .imageView = target,
+	    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+	};
+	VkWriteDescriptorSet write = {
+	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+	    .dstSet = pt->descriptorSet,
+	    .dstBinding = 0,
+	    .descriptorCount = 1,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+	    .pImageInfo = &imageInfo,
+	};
+	vkUpdateDescriptorSets(pt->device, 1, &write, 0, NULL);
+	pathtracer_reset(pt);
+}
+
+void pathtracer_set_camera(PathTracer* pt, const PathTracerCamera* camera)
+{
+	if (memcmp(&pt->camera, camera, sizeof(*camera)) != 0)
+	{
+		pt->camera = *camera;
+		pathtracer_reset(pt);
+	}
+}
+
+void pathtracer_reset(PathTracer* pt)
+{
+	pt->sampleCount = 0;
+}
+
+// --- Per frame ---
+
+static void normalize3(float v[3])
+{
+	float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (len > 0.0f)
+	{
+		v[0] /= len;
+		v[1] /= len;
+		v[2] /= len;
+	}
+}
+
+static void cross3(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void pathtracer_dispatch(PathTracer* pt, VkCommandBuffer cmd, VkExtent2D extent)
+{
+	VkPipeline pipeline = pipeline_get(pt->pipelines, pt->pipeline);
+	if (!pipeline)
+		return;
+
+	if (!pt->bvhUploaded)
+	{
+		bvh_gpu_upload(&pt->bvhGpu, &pt->bvh, cmd);
+		pt->bvhUploaded = true;
+	}
+
+	// reset the tile counter; the previous dispatch's atomics must land before the clear
+	VkBufferMemoryBarrier2 toClear = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	    .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = pt->workCounter.buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &toClear, 0, NULL);
+	vkCmdFillBuffer(cmd, pt->workCounter.buffer, 0, sizeof(u32), 0);
+	VkBufferMemoryBarrier2 toCompute = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = pt->workCounter.buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &toCompute, 0, NULL);
+
+	const PathTracerCamera* cam = &pt->camera;
+	float forward[3] = {cam->target[0] - cam->position[0], cam->target[1] - cam->position[1], cam->target[2] - cam->position[2]};
+	normalize3(forward);
+	const float worldUp[3] = {0.0f, 1.0f, 0.0f};
+	float right[3], up[3];
+	cross3(forward, worldUp, right);
+	normalize3(right);
+	cross3(right, forward, up);
+	float tanHalf = tanf(cam->fovY * 0.5f);
+	float aspect = (float)extent.width / (float)MAX(extent.height, 1u);
+
+	PathTracerPush push = {
+	    .cameraPosition = {cam->position[0], cam->position[1], cam->position[2], 0.0f},
+	    .cameraRight = {right[0] * tanHalf * aspect, right[1] * tanHalf * aspect, right[2] * tanHalf * aspect, 0.0f},
+	    .cameraUp = {up[0] * tanHalf, up[1] * tanHalf, up[2] * tanHalf, 0.0f},
+	    .cameraForward = {forward[0], forward[1], forward[2], 0.0f},
+	    .extent = {extent.width, extent.height},
+	    .sampleIndex = pt->sampleCount,
+	    .maxBounces = pt->maxBounces,
+	};
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pt->pipelineLayout, 0, 1, &pt->descriptorSet, 0, NULL);
+	vkCmdPushConstants(cmd, pt->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+	vkCmdDispatch(cmd, pt->persistentGroups, 1, 1);
+	pt->sampleCount++;
+}
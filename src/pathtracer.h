@@ -0,0 +1,99 @@
+#ifndef PATHTRACER_H
+#define PATHTRACER_H
+
+#include "bvh.h"
+#include "pipeline_manager.h"
+
+// Progressive compute path tracer (shaders/pathtrace.glsl)
+// - traverses the SSBO BVH from bvh.c, diffuse + emissive materials, russian roulette
+// - every dispatch adds one sample per pixel to the running mean stored in drawImage (alpha:
+//   mean view depth of the primary hit, for depth of field),
+//   accumulation restarts whenever the camera or the target image changes
+// - persistent threads: a fixed number of workgroups pull 8x8 pixel tiles from an atomic
+//   counter (one atomic per subgroup, or per invocation where compute has no subgroup ballot), so
+//   long paths don't leave whole groups idle
+
+#define PATHTRACER_LOCAL_SIZE 64
+#define PATHTRACER_TILE 8
+
+// Matches `struct Material` in pathtrace.glsl
+typedef struct PathTracerMaterial
+{
+	float albedo[4];
+	float emission[4];
+} PathTracerMaterial;
+
+typedef struct PathTracerScene
+{
+	float* positions; // xyz
+	u32 vertexCount;
+	u32* indices;
+	u32* materialIds; // one per triangle
+	u32 triangleCount;
+	PathTracerMaterial* materials;
+	u32 materialCount;
+} PathTracerScene;
+
+typedef struct PathTracerCamera
+{
+	float position[3];
+	float target[3];
+	float fovY; // radians
+} PathTracerCamera;
+
+// Matches the push constant block in pathtrace.glsl
+typedef struct PathTracerPush
+{
+	float cameraPosition[4];
+	float cameraRight[4];   // scaled by tan(fovY / 2) * aspect
+	float cameraUp[4];      // scaled by tan(fovY / 2)
+	float cameraForward[4];
+	u32 extent[2];
+	u32 sampleIndex;
+	u32 maxBounces;
+} PathTracerPush;
+
+typedef struct PathTracer
+{
+	VkDevice device;
+	VmaAllocator allocator;
+
+	Bvh bvh;
+	BvhGpu bvhGpu;
+	bool bvhUploaded;
+	AllocatedBuffer materialIds;
+	AllocatedBuffer materials;
+	AllocatedBuffer workCounter;
+
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+	VkPipelineLayout pipelineLayout;
+	PipelineManager* pipelines;
+	PipelineHandle pipeline;
+	u32 persistentGroups;
+
+	PathTracerCamera camera;
+	u32 sampleCount; // samples accumulated in the target so far
+	u32 maxBounces;
+} PathTracer;
+
+// The classic Cornell box, used when no scene is given
+void pathtracer_cornell_box(PathTracerScene* scene, PathTracerCamera* camera);
+void pathtracer_scene_free(PathTracerScene* scene);
+
+// Registers the tracer pipeline with pipelines; it compiles with the rest of the startup set
+void pathtracer_init(PathTracer* pt, const Application* app, PipelineManager* pipelines, const PathTracerScene* scene);
+void pathtracer_destroy(PathTracer* pt);
+
+// Points the tracer at the accumulation image (rgba32f storage, GENERAL) and restarts accumulation
+void pathtracer_bind_target(PathTracer* pt, VkImageView target);
+// Restarts accumulation if the camera differs from the last one
+void pathtracer_set_camera(PathTracer* pt, const PathTracerCamera* camera);
+void pathtracer_reset(PathTracer* pt);
+
+// Records one sample per pixel, or nothing while the pipeline is not ready.
+// The target must be in GENERAL and visible to compute reads/writes.
+void pathtracer_dispatch(PathTracer* pt, VkCommandBuffer cmd, VkExtent2D extent);
+
+#endif // PATHTRACER_H
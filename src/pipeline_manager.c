@@ -0,0 +1,497 @@
+#include "pipeline_manager.h"
+#include "shader_archive.h"
+#include <stdio.h>
+#include <string.h>
+
+// The driver rejects foreign caches itself, but some only do so by crashing; compare the header first
+static bool cache_header_matches(const MappedFile* file, const VkPhysicalDeviceProperties* props)
+{
+	VkPipelineCacheHeaderVersionOne header;
+	if (file->size < sizeof(header))
+		return false;
+	memcpy(&header, file->data, sizeof(header));
+	return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+	       header.vendorID == props->vendorID &&
+	       header.deviceID == props->deviceID &&
+	       memcmp(header.pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void pipeline_manager_init(PipelineManager* pm, const Application* app)
+{
+	memset(pm, 0, sizeof(*pm));
+	pm->device = app->device;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	MappedFile file = {0};
+	if (map_file(PIPELINE_CACHE_PATH, &file) && cache_header_matches(&file, &props))
+		pm->cacheLoaded = true;
+
+	VkPipelineCacheCreateInfo cacheInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+	    .initialDataSize = pm->cacheLoaded ? file.size : 0,
+	    .pInitialData = pm->cacheLoaded ? file.data : NULL,
+	};
+	VK_CHECK(vkCreatePipelineCache(pm->device, &cacheInfo, NULL, &pm->cache));
+	printf("[Pipeline] cache %s (%zu KB)\n", pm->cacheLoaded ? "loaded" : "cold", pm->cacheLoaded ? file.size / 1024 : (size_t)0);
+	unmap_file(&file);
+}
+
+static void save_cache(PipelineManager* pm)
+{
+	size_t size = 0;
+	if (vkGetPipelineCacheData(pm->device, pm->cache, &size, NULL) != VK_SUCCESS || size == 0)
+		return;
+	void* data = malloc(size);
+	if (vkGetPipelineCacheData(pm->device, pm->cache, &size, data) == VK_SUCCESS)
+	{
+		// write next to it and rename so a crash mid-write never leaves a torn cache behind
+		FILE* f = fopen(PIPELINE_CACHE_PATH ".tmp", "wb");
+		if (f)
+		{
+			bool ok = fwrite(data, 1, size, f) == size;
+			ok = fclose(f) == 0 && ok;
+			if (ok && rename(PIPELINE_CACHE_PATH ".tmp", PIPELINE_CACHE_PATH) == 0)
+				printf("[Pipeline] cache saved (%zu KB)\n", size / 1024);
+		}
+	}
+	free(data);
+}
+
+void pipeline_manager_destroy(PipelineManager* pm)
+{
+	job_wait(&pm->pending);
+	save_cache(pm);
+	for (u32 i = 0; i < pm->count; ++i)
+	{
+		if (pm->entries[i].pipeline)
+			vkDestroyPipeline(pm->device, pm->entries[i].pipeline, NULL);
+		if (pm->entries[i].reloaded)
+			vkDestroyPipeline(pm->device, pm->entries[i].reloaded, NULL);
+	}
+	for (u32 i = 0; i < pm->retiredCount; ++i)
+		vkDestroyPipeline(pm->device, pm->retired[i].pipeline, NULL);
+	pm->retiredCount = 0;
+	vkDestroyPipelineCache(pm->device, pm->cache, NULL);
+	pm->count = 0;
+}
+
+static const char* copy_string(char* dst, size_t size, const char* src)
+{
+	if (!src)
+		return NULL;
+	snprintf(dst, size, "%s", src);
+	return dst;
+}
+
+static u64 hash_string(u64 h, const char* s)
+{
+	return s ? fnv1a64_append(h, s, strlen(s) + 1) : fnv1a64_append(h, "", 1);
+}
+
+// Everything that makes two descs different pipelines (not the name, not onDemand)
+static u64 desc_key(const PipelineDesc* desc)
+{
+	u64 h = FNV1A64_OFFSET;
+	h = hash_string(h, desc->computeShader);
+	h = hash_string(h, desc->vertexShader);
+	h = hash_string(h, desc->fragmentShader);
+	h = fnv1a64_append(h, &desc->layout, sizeof(desc->layout));
+	h = fnv1a64_append(h, &desc->vertexInput, sizeof(desc->vertexInput));
+	const u32 state[] = {(u32)desc->topology, (u32)desc->cullMode, (u32)desc->colorFormat, (u32)desc->depthFormat, (u32)desc->blend};
+	h = fnv1a64_append(h, state, sizeof(state));
+	u32 count = MIN(desc->specConstantCount, PIPELINE_MAX_SPEC_CONSTANTS);
+	h = fnv1a64_append(h, &count, sizeof(count));
+	return fnv1a64_append(h, desc->specConstants, count * sizeof(u32));
+}
+
+PipelineHandle pipeline_register(PipelineManager* pm, const PipelineDesc* desc, PipelineHandle fallback)
+{
+	u64 key = desc_key(desc);
+	for (u32 i = 0; i < pm->count; ++i)
+	{
+		if (pm->entries[i].key != key)
+			continue;
+		// a startup user makes a shared on-demand pipeline part of the startup set
+		pm->entries[i].desc.onDemand = pm->entries[i].desc.onDemand && desc->onDemand;
+		return i;
+	}
+	if (pm->count == PIPELINE_MANAGER_MAX)
+		return PIPELINE_INVALID_HANDLE;
+	PipelineHandle handle = pm->count++;
+	PipelineEntry* e = &pm->entries[handle];
+	memset(e, 0, sizeof(*e));
+	e->manager = pm;
+	e->key = key;
+	e->desc = *desc;
+	e->desc.specConstantCount = MIN(desc->specConstantCount, PIPELINE_MAX_SPEC_CONSTANTS);
+	e->desc.name = copy_string(e->name, sizeof(e->name), desc->name ? desc->name : "unnamed");
+	if (desc->computeShader)
+	{
+		e->desc.computeShader = copy_string(e->shaders[0], sizeof(e->shaders[0]), desc->computeShader);
+	}
+	else
+	{
+		e->desc.vertexShader = copy_string(e->shaders[0], sizeof(e->shaders[0]), desc->vertexShader);
+		e->desc.fragmentShader = copy_string(e->shaders[1], sizeof(e->shaders[1]), desc->fragmentShader);
+	}
+	e->fallback = fallback;
+	return handle;
+}
+
+PipelineHandle pipeline_variant(PipelineManager* pm, PipelineHandle base, const u32* specConstants, u32 specConstantCount)
+{
+	if (base >= pm->count)
+		return PIPELINE_INVALID_HANDLE;
+	PipelineDesc desc = pm->entries[base].desc;
+	desc.onDemand = true;
+	desc.specConstantCount = MIN(specConstantCount, PIPELINE_MAX_SPEC_CONSTANTS);
+	memcpy(desc.specConstants, specConstants, desc.specConstantCount * sizeof(u32));
+	return pipeline_register(pm, &desc, base);
+}
+
+// --- Compilation ---
+
+// Points info at desc's constants; NULL when there are none
+static const VkSpecializationInfo* specialization(const PipelineDesc* desc, VkSpecializationInfo* info, VkSpecializationMapEntry* entries)
+{
+	if (desc->specConstantCount == 0)
+		return NULL;
+	for (u32 i = 0; i < desc->specConstantCount; ++i)
+		entries[i] = (VkSpecializationMapEntry){.constantID = i, .offset = i * sizeof(u32), .size = sizeof(u32)};
+	*info = (VkSpecializationInfo){
+	    .mapEntryCount = desc->specConstantCount,
+	    .pMapEntries = entries,
+	    .dataSize = desc->specConstantCount * sizeof(u32),
+	    .pData = desc->specConstants,
+	};
+	return info;
+}
+
+// The shader's declared workgroup size with the size constants applied
+static void local_size(const PipelineDesc* desc, u32 out[3])
+{
+	shader_reflect_local_size(desc->computeShader, out);
+	for (u32 i = 0; i < 3; ++i)
+	{
+		if (PIPELINE_SPEC_LOCAL_SIZE_X + i < desc->specConstantCount)
+			out[i] = MAX(desc->specConstants[PIPELINE_SPEC_LOCAL_SIZE_X + i], 1u);
+	}
+}
+
+static VkPipeline create_compute(PipelineManager* pm, const PipelineDesc* desc)
+{
+	VkShaderModule module = LoadShaderModule(desc->computeShader, pm->device);
+	VkSpecializationInfo specInfo;
+	VkSpecializationMapEntry specEntries[PIPELINE_MAX_SPEC_CONSTANTS];
+	VkComputePipelineCreateInfo info = {
+	    .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+	    .stage = {
+	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+	        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+	        .module = module,
+	        .pName = "main",
+	        .pSpecializationInfo = specialization(desc, &specInfo, specEntries),
+	    },
+	    .layout = desc->layout,
+	};
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateComputePipelines(pm->device, pm->cache, 1, &info, NULL, &pipeline);
+	vkDestroyShaderModule(pm->device, module, NULL);
+	return result == VK_SUCCESS ? pipeline : VK_NULL_HANDLE;
+}
+
+static VkPipeline create_graphics(PipelineManager* pm, const PipelineDesc* desc)
+{
+	VkShaderModule vert = LoadShaderModule(desc->vertexShader, pm->device);
+	VkShaderModule frag = LoadShaderModule(desc->fragmentShader, pm->device);
+	VkSpecializationInfo specInfo;
+	VkSpecializationMapEntry specEntries[PIPELINE_MAX_SPEC_CONSTANTS];
+	const VkSpecializationInfo* spec = specialization(desc, &specInfo, specEntries);
+	VkPipelineShaderStageCreateInfo stages[2] = {
+	    {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = vert, .pName = "main", .pSpecializationInfo = spec},
+	    {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = frag, .pName = "main", .pSpecializationInfo = spec},
+	};
+
+	VkPipelineVertexInputStateCreateInfo noVertexInput = {.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+	    .topology = desc->topology,
+	};
+	VkPipelineViewportStateCreateInfo viewportState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+	    .viewportCount = 1,
+	    .scissorCount = 1,
+	};
+	VkPipelineRasterizationStateCreateInfo raster = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+	    .polygonMode = VK_POLYGON_MODE_FILL,
+	    .cullMode = desc->cullMode,
+	    .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+	    .lineWidth = 1.0f,
+	};
+	VkPipelineMultisampleStateCreateInfo multisample = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+	    .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+	};
+	bool hasDepth = desc->depthFormat != VK_FORMAT_UNDEFINED;
+	VkPipelineDepthStencilStateCreateInfo depth = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+	    .depthTestEnable = hasDepth,
+	    .depthWriteEnable = hasDepth,
+	    .depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+	};
+	VkPipelineColorBlendAttachmentState blendAttachment = {
+	    .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+	};
+	if (desc->blend == PIPELINE_BLEND_PREMULTIPLIED)
+	{
+		blendAttachment.blendEnable = VK_TRUE;
+		blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	}
+	VkPipelineColorBlendStateCreateInfo blend = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+	    .attachmentCount = 1,
+	    .pAttachments = &blendAttachment,
+	};
+	VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamic = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+	    .dynamicStateCount = ARRAYSIZE(dynamicStates),
+	    .pDynamicStates = dynamicStates,
+	};
+	VkPipelineRenderingCreateInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachmentFormats = &desc->colorFormat,
+	    .depthAttachmentFormat = desc->depthFormat,
+	};
+
+	VkGraphicsPipelineCreateInfo info = {
+	    .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+	    .pNext = &renderingInfo,
+	    .stageCount = ARRAYSIZE(stages),
+	    .pStages = stages,
+	    .pVertexInputState = desc->vertexInput ? desc->vertexInput : &noVertexInput,
+	    .pInputAssemblyState = &inputAssembly,
+	    .pViewportState = &viewportState,
+	    .pRasterizationState = &raster,
+	    .pMultisampleState = &multisample,
+	    .pDepthStencilState = &depth,
+	    .pColorBlendState = &blend,
+	    .pDynamicState = &dynamic,
+	    .layout = desc->layout,
+	};
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateGraphicsPipelines(pm->device, pm->cache, 1, &info, NULL, &pipeline);
+	vkDestroyShaderModule(pm->device, vert, NULL);
+	vkDestroyShaderModule(pm->device, frag, NULL);
+	return result == VK_SUCCESS ? pipeline : VK_NULL_HANDLE;
+}
+
+// Runs on any job thread; the cache is internally synchronized
+static void compile_entry(PipelineEntry* e)
+{
+	double start = now_ms();
+	VkPipeline pipeline = e->desc.computeShader ? create_compute(e->manager, &e->desc) : create_graphics(e->manager, &e->desc);
+	e->compileMs = now_ms() - start;
+	e->pipeline = pipeline;
+	if (e->desc.computeShader)
+		local_size(&e->desc, e->localSize);
+	// publishes e->pipeline to pipeline_get on other threads
+	c89atomic_store_explicit_32(&e->state, pipeline ? PIPELINE_STATE_READY : PIPELINE_STATE_FAILED, c89atomic_memory_order_release);
+	if (!pipeline)
+		printf("[Pipeline] '%s' failed to compile\n", e->desc.name);
+}
+
+static void compile_job(void* data)
+{
+	PipelineEntry* e = (PipelineEntry*)data;
+	compile_entry(e);
+	printf("[Pipeline] '%s' compiled on demand in %.1f ms\n", e->desc.name, e->compileMs);
+}
+
+static bool try_queue(PipelineEntry* e)
+{
+	c89atomic_uint32 expected = PIPELINE_STATE_REGISTERED;
+	return c89atomic_compare_exchange_strong_explicit_32(&e->state, &expected, PIPELINE_STATE_QUEUED, c89atomic_memory_order_acq_rel, c89atomic_memory_order_relaxed);
+}
+
+typedef struct StartupBatch
+{
+	PipelineManager* pm;
+	PipelineHandle* handles;
+} StartupBatch;
+
+static void compile_startup_range(void* data, u32 begin, u32 end)
+{
+	StartupBatch* batch = (StartupBatch*)data;
+	for (u32 i = begin; i < end; ++i)
+		compile_entry(&batch->pm->entries[batch->handles[i]]);
+}
+
+void pipeline_compile_startup(PipelineManager* pm)
+{
+	PipelineHandle handles[PIPELINE_MANAGER_MAX];
+	u32 count = 0;
+	for (u32 i = 0; i < pm->count; ++i)
+	{
+		if (!pm->entries[i].desc.onDemand && try_queue(&pm->entries[i]))
+			handles[count++] = i;
+	}
+
+	double start = now_ms();
+	StartupBatch batch = {.pm = pm, .handles = handles};
+	job_parallel_for(count, 1, compile_startup_range, &batch);
+	double wallMs = now_ms() - start;
+
+	double sumMs = 0.0;
+	for (u32 i = 0; i < count; ++i)
+		sumMs += pm->entries[handles[i]].compileMs;
+	printf("[Pipeline] %u startup pipelines in %.1f ms (%.1f ms serial, %u threads, %s cache)\n",
+	    count, wallMs, sumMs, job_thread_count(), pm->cacheLoaded ? "warm" : "cold");
+}
+
+bool pipeline_compile(PipelineManager* pm, PipelineHandle handle)
+{
+	if (handle >= pm->count)
+		return false;
+	PipelineEntry* e = &pm->entries[handle];
+	if (try_queue(e))
+		compile_entry(e);
+	else
+		job_wait(&pm->pending); // queued by pipeline_get, or already done
+	return c89atomic_load_explicit_32(&e->state, c89atomic_memory_order_acquire) == PIPELINE_STATE_READY;
+}
+
+// The ready entry pipeline_get hands out: handle's, or its fallback's while it compiles
+static PipelineEntry* resolve(PipelineManager* pm, PipelineHandle handle)
+{
+	if (handle >= pm->count)
+		return NULL;
+	PipelineEntry* e = &pm->entries[handle];
+	c89atomic_uint32 state = c89atomic_load_explicit_32(&e->state, c89atomic_memory_order_acquire);
+	if (state == PIPELINE_STATE_READY)
+		return e;
+	if (state == PIPELINE_STATE_REGISTERED && try_queue(e))
+		job_run(compile_job, e, &pm->pending);
+	return e->fallback != handle ? resolve(pm, e->fallback) : NULL;
+}
+
+VkPipeline pipeline_get(PipelineManager* pm, PipelineHandle handle)
+{
+	PipelineEntry* e = resolve(pm, handle);
+	return e ? e->pipeline : VK_NULL_HANDLE;
+}
+
+bool pipeline_dispatch(PipelineManager* pm, VkCommandBuffer cmd, PipelineHandle handle, u32 width, u32 height, u32 depth)
+{
+	PipelineEntry* e = resolve(pm, handle);
+	if (!e || !e->desc.computeShader)
+		return false;
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, e->pipeline);
+	vkCmdDispatch(cmd, (width + e->localSize[0] - 1) / e->localSize[0], (height + e->localSize[1] - 1) / e->localSize[1],
+	    (depth + e->localSize[2] - 1) / e->localSize[2]);
+	return true;
+}
+
+// --- Hot reload ---
+
+static void reload_job(void* data)
+{
+	PipelineEntry* e = (PipelineEntry*)data;
+	double start = now_ms();
+	VkPipeline pipeline = e->desc.computeShader ? create_compute(e->manager, &e->desc) : create_graphics(e->manager, &e->desc);
+	if (e->desc.computeShader)
+		local_size(&e->desc, e->reloadedLocalSize); // the edit may have changed it
+	if (pipeline)
+		printf("[Pipeline] '%s' rebuilt in %.1f ms\n", e->desc.name, now_ms() - start);
+	else
+		printf("[Pipeline] '%s' failed to rebuild, keeping the old one\n", e->desc.name);
+	e->reloaded = pipeline;
+	// publishes e->reloaded to pipeline_manager_update
+	c89atomic_store_explicit_32(&e->reloadState, PIPELINE_STATE_READY, c89atomic_memory_order_release);
+}
+
+static bool uses_shader(const PipelineEntry* e, const char* spvPath)
+{
+	const char* stages[3] = {e->desc.computeShader, e->desc.vertexShader, e->desc.fragmentShader};
+	for (u32 i = 0; i < ARRAYSIZE(stages); ++i)
+	{
+		if (stages[i] && strcmp(stages[i], spvPath) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void queue_reload(PipelineManager* pm, PipelineEntry* e)
+{
+	e->reloaded = VK_NULL_HANDLE;
+	c89atomic_store_explicit_32(&e->reloadState, PIPELINE_STATE_QUEUED, c89atomic_memory_order_relaxed);
+	job_run(reload_job, e, &pm->pending);
+}
+
+u32 pipeline_reload_shader(PipelineManager* pm, const char* spvPath)
+{
+	u32 queued = 0;
+	for (u32 i = 0; i < pm->count; ++i)
+	{
+		PipelineEntry* e = &pm->entries[i];
+		if (!uses_shader(e, spvPath))
+			continue;
+		// not compiled yet: its first compile reads the new file anyway
+		c89atomic_uint32 state = c89atomic_load_explicit_32(&e->state, c89atomic_memory_order_acquire);
+		if (state != PIPELINE_STATE_READY && state != PIPELINE_STATE_FAILED)
+			continue;
+		if (c89atomic_load_explicit_32(&e->reloadState, c89atomic_memory_order_acquire) != PIPELINE_STATE_REGISTERED)
+			e->reloadAgain = true;
+		else
+			queue_reload(pm, e);
+		queued++;
+	}
+	return queued;
+}
+
+void pipeline_manager_update(PipelineManager* pm, u64 frameNumber)
+{
+	// a pipeline replaced at frame f was last recorded in frame f - 1, which this frame's fence
+	// wait (or an earlier one) has seen finish once f + MAX_FRAMES_IN_FLIGHT is reached
+	u32 kept = 0;
+	for (u32 i = 0; i < pm->retiredCount; ++i)
+	{
+		if (frameNumber >= pm->retired[i].frame + MAX_FRAMES_IN_FLIGHT)
+			vkDestroyPipeline(pm->device, pm->retired[i].pipeline, NULL);
+		else
+			pm->retired[kept++] = pm->retired[i];
+	}
+	pm->retiredCount = kept;
+
+	for (u32 i = 0; i < pm->count; ++i)
+	{
+		PipelineEntry* e = &pm->entries[i];
+		if (c89atomic_load_explicit_32(&e->reloadState, c89atomic_memory_order_acquire) != PIPELINE_STATE_READY)
+			continue;
+		if (e->reloaded)
+		{
+			if (e->pipeline && pm->retiredCount == PIPELINE_RETIRED_MAX)
+				continue; // swapped once older ones are gone
+			if (e->pipeline)
+				pm->retired[pm->retiredCount++] = (RetiredPipeline){e->pipeline, frameNumber};
+			e->pipeline = e->reloaded;
+			memcpy(e->localSize, e->reloadedLocalSize, sizeof(e->localSize));
+			e->reloaded = VK_NULL_HANDLE;
+			c89atomic_store_explicit_32(&e->state, PIPELINE_STATE_READY, c89atomic_memory_order_release);
+		}
+		c89atomic_store_explicit_32(&e->reloadState, PIPELINE_STATE_REGISTERED, c89atomic_memory_order_relaxed);
+		if (e->reloadAgain)
+		{
+			e->reloadAgain = false;
+			queue_reload(pm, e);
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#ifndef PIPELINE_MANAGER_H
+#define PIPELINE_MANAGER_H
+
+#include "main.h"
+#include "job.h"
+
+// Pipeline manager
+// - every pipeline is registered up front from a PipelineDesc and referred to by handle
+// - startup pipelines are compiled together by pipeline_compile_startup, one job per pipeline,
+//   so time to first frame is bounded by the slowest pipeline, not the sum
+// - on-demand pipelines (variants) compile in a background job the first time pipeline_get
+//   asks for them; until then pipeline_get returns the fallback, or VK_NULL_HANDLE and the
+//   caller skips the draw for that frame
+// - all compiles share one VkPipelineCache, saved to PIPELINE_CACHE_PATH on destroy and reused
+//   on the next start when the driver and device match
+// - pipeline_reload_shader rebuilds every pipeline using a .spv in the background; the new
+//   pipelines are swapped in by pipeline_manager_update at a frame boundary and the old ones are
+//   destroyed once the frames that may still use them have finished (shader_reload.h)
+// - variants: a desc carries specialization constants, and registering a desc that matches an
+//   existing entry (shaders, constants, state) returns that entry, so (shader, constants) maps
+//   to one pipeline; pipeline_variant derives an on-demand variant from a registered pipeline
+// - constant_id 0, 1, 2 are the compute workgroup size by convention (local_size_{x,y,z}_id);
+//   pipeline_dispatch sizes the grid from the workgroup size the bound pipeline really has
+
+#define PIPELINE_MANAGER_MAX 256
+#define PIPELINE_RETIRED_MAX 64
+#define PIPELINE_MAX_SPEC_CONSTANTS 8
+#define PIPELINE_SPEC_LOCAL_SIZE_X 0
+#define PIPELINE_SPEC_LOCAL_SIZE_Y 1
+#define PIPELINE_SPEC_LOCAL_SIZE_Z 2
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+typedef u32 PipelineHandle;
+#define PIPELINE_INVALID_HANDLE UINT32_MAX
+
+typedef enum PipelineState
+{
+	PIPELINE_STATE_REGISTERED = 0,
+	PIPELINE_STATE_QUEUED, // compile job in flight
+	PIPELINE_STATE_READY,
+	PIPELINE_STATE_FAILED,
+} PipelineState;
+
+typedef enum PipelineBlend
+{
+	PIPELINE_BLEND_NONE = 0,
+	PIPELINE_BLEND_PREMULTIPLIED, // src + dst * (1 - src alpha)
+} PipelineBlend;
+
+typedef struct PipelineDesc
+{
+	const char* name;
+	bool onDemand; // false: part of the startup set
+
+	// compute when computeShader is set, graphics otherwise; .spv paths
+	const char* computeShader;
+	const char* vertexShader;
+	const char* fragmentShader;
+	VkPipelineLayout layout;
+
+	// graphics only; viewport and scissor are always dynamic
+	const VkPipelineVertexInputStateCreateInfo* vertexInput; // NULL = no vertex buffers
+	VkPrimitiveTopology topology;
+	VkCullModeFlags cullMode;
+	VkFormat colorFormat;
+	VkFormat depthFormat; // VK_FORMAT_UNDEFINED = no depth attachment
+	PipelineBlend blend;
+
+	// constant_id i = specConstants[i] for i < specConstantCount, in every stage
+	u32 specConstants[PIPELINE_MAX_SPEC_CONSTANTS];
+	u32 specConstantCount;
+} PipelineDesc;
+
+typedef struct PipelineManager PipelineManager;
+
+typedef struct PipelineEntry
+{
+	PipelineManager* manager;
+	PipelineDesc desc; // strings point into the arrays below
+	char name[64];
+	char shaders[2][128];
+	PipelineHandle fallback;
+	u64 key; // shaders, constants and state: equal keys are the same pipeline
+	volatile c89atomic_uint32 state; // PipelineState
+	VkPipeline pipeline;
+	u32 localSize[3]; // compute: reflected, then specialized; valid once ready
+	double compileMs;
+
+	// hot reload: the rebuilt pipeline waits in reloaded until the next frame boundary
+	volatile c89atomic_uint32 reloadState; // PipelineState: REGISTERED idle, QUEUED, READY
+	VkPipeline reloaded;
+	u32 reloadedLocalSize[3];
+	bool reloadAgain; // the shader changed again while rebuilding
+} PipelineEntry;
+
+typedef struct RetiredPipeline
+{
+	VkPipeline pipeline;
+	u64 frame; // frame number it was replaced at
+} RetiredPipeline;
+
+struct PipelineManager
+{
+	VkDevice device;
+	VkPipelineCache cache;
+	bool cacheLoaded; // started from a valid cache file
+
+	PipelineEntry entries[PIPELINE_MANAGER_MAX];
+	u32 count;
+	JobCounter pending; // on-demand compiles and rebuilds in flight
+
+	RetiredPipeline retired[PIPELINE_RETIRED_MAX];
+	u32 retiredCount;
+};
+
+void pipeline_manager_init(PipelineManager* pm, const Application* app);
+// Waits for background compiles, writes the cache file and destroys every pipeline
+void pipeline_manager_destroy(PipelineManager* pm);
+
+// fallback: pipeline used while an on-demand one is still compiling (PIPELINE_INVALID_HANDLE = skip).
+// A desc equal to a registered one returns that handle.
+PipelineHandle pipeline_register(PipelineManager* pm, const PipelineDesc* desc, PipelineHandle fallback);
+// base with other specialization constants: registered on demand the first time, found after;
+// base is the fallback while it compiles
+PipelineHandle pipeline_variant(PipelineManager* pm, PipelineHandle base, const u32* specConstants, u32 specConstantCount);
+
+// Compiles every registered startup pipeline in parallel and blocks until they are done
+void pipeline_compile_startup(PipelineManager* pm);
+// Compiles handle on the calling thread, or waits for the compile already in flight. True once it
+// is ready. For tools that must never measure a fallback (autotune.h); main thread only.
+bool pipeline_compile(PipelineManager* pm, PipelineHandle handle);
+
+// Ready pipeline, or the fallback (possibly VK_NULL_HANDLE) while it compiles. Kicks off the
+// background compile on first use. Safe from any job thread.
+VkPipeline pipeline_get(PipelineManager* pm, PipelineHandle handle);
+// Binds the compute pipeline pipeline_get would return and dispatches enough workgroups of its
+// size to cover width x height x depth invocations. False (nothing recorded) while none is ready.
+bool pipeline_dispatch(PipelineManager* pm, VkCommandBuffer cmd, PipelineHandle handle, u32 width, u32 height, u32 depth);
+
+// Rebuilds, in background jobs, every compiled pipeline that uses spvPath. Main thread only.
+// Returns the number of pipelines queued.
+u32 pipeline_reload_shader(PipelineManager* pm, const char* spvPath);
+// Frame boundary, main thread, before recording: swaps in rebuilt pipelines and destroys the
+// replaced ones that frameNumber's fence wait proved idle
+void pipeline_manager_update(PipelineManager* pm, u64 frameNumber);
+
+#endif // PIPELINE_MANAGER_H
@@ -0,0 +1,528 @@
+#include "render_graph.h"
+#include <string.h>
+
+typedef struct UsageInfo
+{
+	VkPipelineStageFlags2 stage;
+	VkAccessFlags2 access;
+	VkImageLayout layout;
+	bool read;
+	bool write;
+	VkImageUsageFlags imageUsage; // what a transient image needs to be created with
+} UsageInfo;
+
+static const UsageInfo usageInfo[RG_USAGE_COUNT] = {
+    [RG_USAGE_COMPUTE_READ] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, true, false, VK_IMAGE_USAGE_STORAGE_BIT},
+    [RG_USAGE_COMPUTE_WRITE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, false, true, VK_IMAGE_USAGE_STORAGE_BIT},
+    [RG_USAGE_COMPUTE_READ_WRITE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true, true, VK_IMAGE_USAGE_STORAGE_BIT},
+    [RG_USAGE_COMPUTE_SAMPLED] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false, VK_IMAGE_USAGE_SAMPLED_BIT},
+    [RG_USAGE_FRAGMENT_SAMPLED] = {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false, VK_IMAGE_USAGE_SAMPLED_BIT},
+    [RG_USAGE_COLOR_WRITE] = {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, false, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT},
+    [RG_USAGE_COLOR_READ_WRITE] = {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT},
+    [RG_USAGE_DEPTH_WRITE] = {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, false, true, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT},
+    [RG_USAGE_DEPTH_READ] = {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, true, false, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT},
+    [RG_USAGE_TRANSFER_SRC] = {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, false, VK_IMAGE_USAGE_TRANSFER_SRC_BIT},
+    [RG_USAGE_TRANSFER_DST] = {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false, true, VK_IMAGE_USAGE_TRANSFER_DST_BIT},
+};
+
+// only writes need to be made available; reads just need an execution dependency
+#define RG_WRITE_ACCESS (VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | \
+                         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT)
+
+void render_graph_init(RenderGraph* graph, const Application* app)
+{
+	memset(graph, 0, sizeof(*graph));
+	graph->device = app->device;
+	graph->allocator = app->allocator;
+}
+
+static void destroy_transients(RenderGraph* graph)
+{
+	for (u32 i = 0; i < graph->transientCount; ++i)
+	{
+		RenderGraphTransient* t = &graph->transients[i];
+		if (t->view)
+			vkDestroyImageView(graph->device, t->view, NULL);
+		if (t->image)
+			vkDestroyImage(graph->device, t->image, NULL); // aliasing images don't own their memory
+	}
+	if (graph->transientMemory)
+		vmaFreeMemory(graph->allocator, graph->transientMemory);
+	graph->transientMemory = NULL;
+	graph->transientCount = 0;
+	graph->transientSignature = 0;
+	graph->transientLastStages = 0;
+	graph->transientLastAccess = 0;
+}
+
+void render_graph_destroy(RenderGraph* graph)
+{
+	vkDeviceWaitIdle(graph->device);
+	destroy_transients(graph);
+}
+
+void render_graph_begin(RenderGraph* graph)
+{
+	graph->imageCount = 0;
+	graph->passCount = 0;
+	graph->culledCount = 0;
+	graph->barrierCount = 0;
+	graph->batchCount = 0;
+}
+
+RenderGraphImage render_graph_import_image(RenderGraph* graph, const char* name, VkImage image, VkImageView view, VkImageAspectFlags aspect,
+    VkImageLayout layout, VkPipelineStageFlags2 stage, VkAccessFlags2 access)
+{
+	assert(graph->imageCount < RENDER_GRAPH_MAX_IMAGES);
+	RenderGraphImage handle = graph->imageCount++;
+	graph->images[handle] = (RenderGraphImageState){
+	    .name = name,
+	    .image = image,
+	    .view = view,
+	    .aspect = aspect,
+	    .layout = layout,
+	    .writeStages = stage,
+	    .writeAccess = access & RG_WRITE_ACCESS,
+	};
+	return handle;
+}
+
+void render_graph_export_image(RenderGraph* graph, RenderGraphImage image, VkImageLayout finalLayout)
+{
+	graph->images[image].exported = true;
+	graph->images[image].finalLayout = finalLayout;
+}
+
+RenderGraphImage render_graph_create_image(RenderGraph* graph, const char* name, const RenderGraphImageDesc* desc)
+{
+	assert(graph->imageCount < RENDER_GRAPH_MAX_IMAGES);
+	bool depth = desc->format == VK_FORMAT_D16_UNORM || desc->format == VK_FORMAT_X8_D24_UNORM_PACK32 ||
+	             desc->format == VK_FORMAT_D32_SFLOAT || hasStencil(desc->format);
+	RenderGraphImage handle = graph->imageCount++;
+	graph->images[handle] = (RenderGraphImageState){
+	    .name = name,
+	    .aspect = depth ? VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil(desc->format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0) : VK_IMAGE_ASPECT_COLOR_BIT,
+	    .transient = true,
+	    .desc = *desc,
+	    .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+	return handle;
+}
+
+RenderGraphPass render_graph_add_pass(RenderGraph* graph, const char* name, RenderGraphExecuteFunc execute, void* data)
+{
+	assert(graph->passCount < RENDER_GRAPH_MAX_PASSES);
+	RenderGraphPass handle = graph->passCount++;
+	graph->passes[handle] = (RenderGraphPassInfo){
+	    .name = name,
+	    .execute = execute,
+	    .data = data,
+	};
+	return handle;
+}
+
+void render_graph_use(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image, RenderGraphUsage usage)
+{
+	RenderGraphPassInfo* p = &graph->passes[pass];
+	assert(p->useCount < RENDER_GRAPH_MAX_USES);
+	for (u32 i = 0; i < p->useCount; ++i)
+		assert(p->uses[i].image != image); // one usage per image per pass
+	p->uses[p->useCount++] = (RenderGraphUse){image, usage};
+}
+
+// Walks the passes backwards from the exported images: a pass survives if it writes something
+// a later surviving pass (or the outside) reads
+static void cull(RenderGraph* graph)
+{
+	for (u32 i = 0; i < graph->imageCount; ++i)
+		graph->images[i].needed = graph->images[i].exported;
+
+	for (u32 i = graph->passCount; i-- > 0;)
+	{
+		RenderGraphPassInfo* pass = &graph->passes[i];
+		bool alive = false;
+		for (u32 u = 0; u < pass->useCount; ++u)
+			alive |= usageInfo[pass->uses[u].usage].write && graph->images[pass->uses[u].image].needed;
+		pass->culled = !alive;
+		if (!alive)
+		{
+			graph->culledCount++;
+			continue;
+		}
+		// a write-only use replaces the contents, earlier writers don't matter for it anymore
+		for (u32 u = 0; u < pass->useCount; ++u)
+		{
+			const UsageInfo* info = &usageInfo[pass->uses[u].usage];
+			if (info->write && !info->read)
+				graph->images[pass->uses[u].image].needed = false;
+		}
+		for (u32 u = 0; u < pass->useCount; ++u)
+		{
+			if (usageInfo[pass->uses[u].usage].read)
+				graph->images[pass->uses[u].image].needed = true;
+		}
+	}
+}
+
+// Widens a read barrier to every following pass that reads the image in the same layout before
+// it is written again, so a run of readers costs one barrier instead of one each
+static void gather_readers(const RenderGraph* graph, u32 passIndex, RenderGraphImage image, VkImageLayout layout,
+    VkPipelineStageFlags2* stage, VkAccessFlags2* access)
+{
+	for (u32 i = passIndex + 1; i < graph->passCount; ++i)
+	{
+		const RenderGraphPassInfo* pass = &graph->passes[i];
+		if (pass->culled)
+			continue;
+		for (u32 u = 0; u < pass->useCount; ++u)
+		{
+			if (pass->uses[u].image != image)
+				continue;
+			const UsageInfo* info = &usageInfo[pass->uses[u].usage];
+			if (info->write || info->layout != layout)
+				return;
+			*stage |= info->stage;
+			*access |= info->access;
+		}
+	}
+}
+
+// Barrier (if any) that makes img ready for a use; updates the tracked state
+static bool transition(RenderGraph* graph, u32 passIndex, const RenderGraphUse* use, VkImageMemoryBarrier2* out)
+{
+	RenderGraphImageState* img = &graph->images[use->image];
+	const UsageInfo* info = &usageInfo[use->usage];
+	VkPipelineStageFlags2 stage = info->stage;
+	VkAccessFlags2 access = info->access;
+	bool layoutChange = info->layout != img->layout;
+
+	if (!info->write && !layoutChange)
+	{
+		// read after read in the same layout: only stages the last write isn't visible to yet
+		if ((stage & ~img->readStages) == 0 && (access & ~img->readAccess) == 0)
+			return false;
+		gather_readers(graph, passIndex, use->image, info->layout, &stage, &access);
+		*out = imageBarrier(img->image, img->writeStages, img->writeAccess, img->layout, stage, access, img->layout,
+		    img->aspect, 0, VK_REMAINING_MIP_LEVELS);
+		img->readStages |= stage;
+		img->readAccess |= access;
+		return true;
+	}
+
+	if (!info->write)
+		gather_readers(graph, passIndex, use->image, info->layout, &stage, &access);
+	// write-only: no need to preserve the old contents through the transition
+	VkImageLayout oldLayout = layoutChange && !info->read ? VK_IMAGE_LAYOUT_UNDEFINED : img->layout;
+	*out = imageBarrier(img->image, img->writeStages | img->readStages, img->writeAccess, oldLayout, stage, access, info->layout,
+	    img->aspect, 0, VK_REMAINING_MIP_LEVELS);
+	img->layout = info->layout;
+	// a layout transition counts as a write for whoever comes next. Only a read-triggered barrier
+	// makes the contents visible to readers: after a write even the same stages need one
+	img->writeStages = stage;
+	img->writeAccess = access & RG_WRITE_ACCESS;
+	img->readStages = info->write ? 0 : stage;
+	img->readAccess = info->write ? 0 : access;
+	return true;
+}
+
+// --- Transient memory ---
+
+static u64 hash_u64(u64 h, u64 v)
+{
+	return fnv1a64_append(h, &v, sizeof(v));
+}
+
+static bool lifetimes_overlap(const RenderGraphImageState* a, const RenderGraphImageState* b)
+{
+	return a->firstPass <= b->lastPass && b->firstPass <= a->lastPass;
+}
+
+static bool ranges_overlap(const RenderGraphTransient* a, const RenderGraphTransient* b)
+{
+	return a->offset < b->offset + b->size && b->offset < a->offset + a->size;
+}
+
+// Lifetimes and usage flags of this frame's transients (alive passes only), hashed together
+static u64 transient_signature(RenderGraph* graph, VkImageUsageFlags* usage, u32* transientIndex, u32* transientCount)
+{
+	u64 h = FNV1A64_OFFSET;
+	u32 count = 0;
+	for (u32 i = 0; i < graph->imageCount; ++i)
+	{
+		RenderGraphImageState* img = &graph->images[i];
+		if (!img->transient)
+			continue;
+		usage[i] = 0;
+		img->firstPass = UINT32_MAX;
+		img->lastPass = 0;
+		for (u32 p = 0; p < graph->passCount; ++p)
+		{
+			const RenderGraphPassInfo* pass = &graph->passes[p];
+			for (u32 u = 0; u < pass->useCount && !pass->culled; ++u)
+			{
+				if (pass->uses[u].image != i)
+					continue;
+				usage[i] |= usageInfo[pass->uses[u].usage].imageUsage;
+				img->firstPass = MIN(img->firstPass, p);
+				img->lastPass = MAX(img->lastPass, p);
+			}
+		}
+		transientIndex[i] = count++;
+		h = hash_u64(h, img->desc.format);
+		h = hash_u64(h, (u64)img->desc.width << 32 | img->desc.height);
+		h = hash_u64(h, usage[i]);
+		h = hash_u64(h, (u64)img->firstPass << 32 | img->lastPass);
+	}
+	*transientCount = count;
+	return h;
+}
+
+// Greedy placement, largest first: each image goes to the lowest offset that doesn't collide
+// with an already placed image whose lifetime overlaps its own
+static void place_transients(RenderGraph* graph, const VkImageUsageFlags* usage, const u32* transientIndex, u32 transientCount)
+{
+	if (graph->transientMemory)
+		vkDeviceWaitIdle(graph->device); // frames in flight may still use the old images; only on resize/mode switch
+	u64 signature = graph->transientSignature;
+	destroy_transients(graph);
+	graph->transientSignature = signature;
+	graph->transientCount = transientCount;
+
+	RenderGraphImageState* owners[RENDER_GRAPH_MAX_IMAGES] = {0};
+	VkDeviceSize alignments[RENDER_GRAPH_MAX_IMAGES] = {0};
+	u32 order[RENDER_GRAPH_MAX_IMAGES];
+	u32 placeCount = 0;
+	VkMemoryRequirements blockReqs = {.memoryTypeBits = UINT32_MAX, .alignment = 1};
+	graph->transientSeparate = 0;
+	for (u32 i = 0; i < graph->imageCount; ++i)
+	{
+		RenderGraphImageState* img = &graph->images[i];
+		if (!img->transient)
+			continue;
+		RenderGraphTransient* t = &graph->transients[transientIndex[i]];
+		memset(t, 0, sizeof(*t));
+		owners[transientIndex[i]] = img;
+		if (usage[i] == 0)
+			continue; // only culled passes use it
+		t->info = (VkImageCreateInfo){
+		    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		    .imageType = VK_IMAGE_TYPE_2D,
+		    .format = img->desc.format,
+		    .extent = {img->desc.width, img->desc.height, 1},
+		    .mipLevels = 1,
+		    .arrayLayers = 1,
+		    .samples = VK_SAMPLE_COUNT_1_BIT,
+		    .tiling = VK_IMAGE_TILING_OPTIMAL,
+		    .usage = usage[i],
+		    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+		VkDeviceImageMemoryRequirements query = {
+		    .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+		    .pCreateInfo = &t->info,
+		};
+		VkMemoryRequirements2 reqs = {.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+		vkGetDeviceImageMemoryRequirements(graph->device, &query, &reqs);
+		t->size = reqs.memoryRequirements.size;
+		alignments[transientIndex[i]] = reqs.memoryRequirements.alignment;
+		blockReqs.memoryTypeBits &= reqs.memoryRequirements.memoryTypeBits;
+		blockReqs.alignment = MAX(blockReqs.alignment, reqs.memoryRequirements.alignment);
+		graph->transientSeparate += t->size;
+
+		u32 at = placeCount++;
+		while (at > 0 && graph->transients[order[at - 1]].size < t->size)
+		{
+			order[at] = order[at - 1];
+			at--;
+		}
+		order[at] = transientIndex[i];
+	}
+
+	graph->transientPeak = 0;
+	for (u32 k = 0; k < placeCount; ++k)
+	{
+		RenderGraphTransient* t = &graph->transients[order[k]];
+		bool moved = true;
+		while (moved)
+		{
+			moved = false;
+			for (u32 j = 0; j < k; ++j)
+			{
+				const RenderGraphTransient* placed = &graph->transients[order[j]];
+				if (lifetimes_overlap(owners[order[k]], owners[order[j]]) && ranges_overlap(t, placed))
+				{
+					VkDeviceSize alignment = alignments[order[k]];
+					t->offset = (placed->offset + placed->size + alignment - 1) / alignment * alignment;
+					moved = true;
+				}
+			}
+		}
+		graph->transientPeak = MAX(graph->transientPeak, t->offset + t->size);
+	}
+	if (placeCount == 0)
+		return;
+
+	// every image is bound into the one block, so its memory type has to be in all of their
+	// memoryTypeBits, not only the first's
+	blockReqs.size = graph->transientPeak;
+	VmaAllocationCreateInfo allocInfo = {
+	    .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	};
+	u32 memoryType;
+	if (blockReqs.memoryTypeBits == 0 || vmaFindMemoryTypeIndex(graph->allocator, blockReqs.memoryTypeBits, &allocInfo, &memoryType) != VK_SUCCESS)
+	{
+		fprintf(stderr, "[RenderGraph] no device local memory type fits all %u transient images (common types 0x%x)\n", placeCount,
+		    blockReqs.memoryTypeBits);
+		exit(1);
+	}
+	allocInfo.memoryTypeBits = 1u << memoryType;
+	VK_CHECK(vmaAllocateMemory(graph->allocator, &blockReqs, &allocInfo, &graph->transientMemory, NULL));
+	for (u32 k = 0; k < placeCount; ++k)
+	{
+		RenderGraphTransient* t = &graph->transients[order[k]];
+		VK_CHECK(vmaCreateAliasingImage2(graph->allocator, graph->transientMemory, t->offset, &t->info, &t->image));
+		t->view = createImageView(graph->device, t->image, t->info.format, VK_IMAGE_VIEW_TYPE_2D, 0, 1, 0, 1);
+	}
+	graph->transientGeneration++;
+	printf("[RenderGraph] transient memory %.1f MB aliased, %.1f MB without aliasing (%u images)\n",
+	    graph->transientPeak / (1024.0 * 1024.0), graph->transientSeparate / (1024.0 * 1024.0), placeCount);
+}
+
+// Binds this frame's transients to their placed images; rebuilds the placement when the set changed
+static void prepare_transients(RenderGraph* graph, u32* transientIndex)
+{
+	VkImageUsageFlags usage[RENDER_GRAPH_MAX_IMAGES];
+	u32 transientCount = 0;
+	u64 signature = transient_signature(graph, usage, transientIndex, &transientCount);
+	if (signature != graph->transientSignature || transientCount != graph->transientCount)
+	{
+		graph->transientSignature = signature;
+		place_transients(graph, usage, transientIndex, transientCount);
+	}
+	for (u32 i = 0; i < graph->imageCount; ++i)
+	{
+		RenderGraphImageState* img = &graph->images[i];
+		if (!img->transient)
+			continue;
+		img->image = graph->transients[transientIndex[i]].image;
+		img->view = graph->transients[transientIndex[i]].view;
+		img->writeStages = graph->transientLastStages;
+		img->writeAccess = graph->transientLastAccess;
+	}
+}
+
+// First use of a transient: its memory may have belonged to images that are done by now
+static void wait_for_aliases(RenderGraph* graph, const u32* transientIndex, RenderGraphImage image)
+{
+	RenderGraphImageState* img = &graph->images[image];
+	const RenderGraphTransient* t = &graph->transients[transientIndex[image]];
+	for (u32 i = 0; i < graph->imageCount; ++i)
+	{
+		const RenderGraphImageState* other = &graph->images[i];
+		if (!other->transient || i == image || other->lastPass >= img->firstPass || !other->image)
+			continue;
+		if (ranges_overlap(t, &graph->transients[transientIndex[i]]))
+		{
+			img->writeStages |= other->writeStages | other->readStages;
+			img->writeAccess |= other->writeAccess;
+		}
+	}
+}
+
+void render_graph_execute(RenderGraph* graph, VkCommandBuffer cmd)
+{
+	cull(graph);
+	u32 transientIndex[RENDER_GRAPH_MAX_IMAGES];
+	prepare_transients(graph, transientIndex);
+
+	VkImageMemoryBarrier2 barriers[RENDER_GRAPH_MAX_IMAGES];
+	for (u32 i = 0; i < graph->passCount; ++i)
+	{
+		RenderGraphPassInfo* pass = &graph->passes[i];
+		if (pass->culled)
+			continue;
+		u32 count = 0;
+		for (u32 u = 0; u < pass->useCount; ++u)
+		{
+			const RenderGraphImageState* img = &graph->images[pass->uses[u].image];
+			if (img->transient && img->firstPass == i)
+			{
+				assert(!usageInfo[pass->uses[u].usage].read); // contents are undefined before the first write
+				wait_for_aliases(graph, transientIndex, pass->uses[u].image);
+			}
+			count += transition(graph, i, &pass->uses[u], &barriers[count]);
+		}
+		if (count > 0)
+		{
+			pipelineBarrier(cmd, 0, 0, NULL, count, barriers);
+			graph->barrierCount += count;
+			graph->batchCount++;
+		}
+		pass->execute(cmd, pass->data);
+	}
+
+	// exported images into their final layout, one batch
+	u32 count = 0;
+	for (u32 i = 0; i < graph->imageCount; ++i)
+	{
+		RenderGraphImageState* img = &graph->images[i];
+		if (!img->exported || img->finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || img->finalLayout == img->layout)
+			continue;
+		// presentation waits on the submit's semaphore, nothing later in the queue touches it;
+		// anything else keeps the last stages so the next frame's import chains onto this barrier
+		VkPipelineStageFlags2 srcStages = img->writeStages | img->readStages;
+		VkPipelineStageFlags2 dstStages = img->finalLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR ? VK_PIPELINE_STAGE_2_NONE : srcStages;
+		barriers[count++] = imageBarrier(img->image, srcStages, img->writeAccess, img->layout, dstStages, 0, img->finalLayout,
+		    img->aspect, 0, VK_REMAINING_MIP_LEVELS);
+		img->layout = img->finalLayout;
+		img->writeStages = dstStages;
+		img->writeAccess = 0;
+		img->readStages = 0;
+		img->readAccess = 0;
+	}
+	if (count > 0)
+	{
+		pipelineBarrier(cmd, 0, 0, NULL, count, barriers);
+		graph->barrierCount += count;
+		graph->batchCount++;
+	}
+
+	graph->transientLastStages = 0;
+	graph->transientLastAccess = 0;
+	for (u32 i = 0; i < graph->imageCount; ++i)
+	{
+		const RenderGraphImageState* img = &graph->images[i];
+		if (!img->transient || !img->image)
+			continue;
+		graph->transientLastStages |= img->writeStages | img->readStages;
+		graph->transientLastAccess |= img->writeAccess;
+	}
+
+	u32 summary = graph->passCount | graph->culledCount << 8 | graph->barrierCount << 16 | graph->batchCount << 24;
+	if (summary != graph->lastSummary)
+	{
+		printf("[RenderGraph] %u passes (%u culled), %u barriers in %u batches\n",
+		    graph->passCount, graph->culledCount, graph->barrierCount, graph->batchCount);
+		graph->lastSummary = summary;
+	}
+}
+
+VkImageLayout render_graph_image_layout(const RenderGraph* graph, RenderGraphImage image)
+{
+	return graph->images[image].layout;
+}
+
+void render_graph_image_last_use(const RenderGraph* graph, RenderGraphImage image, VkPipelineStageFlags2* stage, VkAccessFlags2* access)
+{
+	*stage = graph->images[image].writeStages | graph->images[image].readStages;
+	*access = graph->images[image].writeAccess;
+}
+
+VkImage render_graph_image(const RenderGraph* graph, RenderGraphImage image)
+{
+	return graph->images[image].image;
+}
+
+VkImageView render_graph_image_view(const RenderGraph* graph, RenderGraphImage image)
+{
+	return graph->images[image].view;
+}
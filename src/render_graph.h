@@ -0,0 +1,165 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include "main.h"
+
+// Frame render graph over imageBarrier/pipelineBarrier
+// - rebuilt every frame: import images, add passes, declare per pass how each image is used,
+//   then render_graph_execute records everything
+// - a usage fixes stage, access and layout, so barriers carry only the stages that actually
+//   touch the image instead of TOP_OF_PIPE/BOTTOM_OF_PIPE/ALL_COMMANDS
+// - all barriers needed before a pass go out in one vkCmdPipelineBarrier2; read-after-read in the
+//   same layout needs none
+// - passes whose writes nobody reads (and that don't reach an exported image) are culled
+// - write-only usages discard the old contents (transition from UNDEFINED)
+// - transient images live only inside the graph: their lifetime is the span of passes using
+//   them, and images whose lifetimes don't overlap share memory in one VMA block
+//   (vmaCreateAliasingImage2). Placement is redone only when the set of transients changes.
+
+#define RENDER_GRAPH_MAX_IMAGES 32
+#define RENDER_GRAPH_MAX_PASSES 32
+#define RENDER_GRAPH_MAX_USES 8 // per pass
+
+typedef u32 RenderGraphImage;
+typedef u32 RenderGraphPass;
+
+typedef enum RenderGraphUsage
+{
+	RG_USAGE_COMPUTE_READ = 0,   // storage image, GENERAL
+	RG_USAGE_COMPUTE_WRITE,      // storage image, every texel written
+	RG_USAGE_COMPUTE_READ_WRITE, // storage image, read-modify-write
+	RG_USAGE_COMPUTE_SAMPLED,    // sampled in a compute shader
+	RG_USAGE_FRAGMENT_SAMPLED,   // sampled in a fragment shader
+	RG_USAGE_COLOR_WRITE,        // color attachment, cleared or fully covered
+	RG_USAGE_COLOR_READ_WRITE,   // color attachment, loaded
+	RG_USAGE_DEPTH_WRITE,        // depth attachment, cleared
+	RG_USAGE_DEPTH_READ,         // depth attachment, test only
+	RG_USAGE_TRANSFER_SRC,
+	RG_USAGE_TRANSFER_DST,       // copy/blit/clear covering the whole image
+	RG_USAGE_COUNT,
+} RenderGraphUsage;
+
+typedef void (*RenderGraphExecuteFunc)(VkCommandBuffer cmd, void* data);
+
+// Usage flags are derived from how the passes use the image
+typedef struct RenderGraphImageDesc
+{
+	VkFormat format;
+	u32 width;
+	u32 height;
+} RenderGraphImageDesc;
+
+typedef struct RenderGraphImageState
+{
+	const char* name;
+	VkImage image;
+	VkImageView view;
+	VkImageAspectFlags aspect;
+
+	bool transient;
+	RenderGraphImageDesc desc;
+	u32 firstPass; // transient lifetime, alive passes only
+	u32 lastPass;
+
+	// tracked while recording
+	VkImageLayout layout;
+	VkPipelineStageFlags2 writeStages; // last write (or layout transition)
+	VkAccessFlags2 writeAccess;
+	VkPipelineStageFlags2 readStages;  // stages the last write is already visible to
+	VkAccessFlags2 readAccess;
+
+	bool exported;
+	VkImageLayout finalLayout;
+	bool needed; // culling scratch
+} RenderGraphImageState;
+
+typedef struct RenderGraphUse
+{
+	RenderGraphImage image;
+	RenderGraphUsage usage;
+} RenderGraphUse;
+
+typedef struct RenderGraphPassInfo
+{
+	const char* name;
+	RenderGraphExecuteFunc execute;
+	void* data;
+	RenderGraphUse uses[RENDER_GRAPH_MAX_USES];
+	u32 useCount;
+	bool culled;
+} RenderGraphPassInfo;
+
+// Memory placement of one transient image; kept across frames
+typedef struct RenderGraphTransient
+{
+	VkImageCreateInfo info;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	VkImage image;
+	VkImageView view;
+} RenderGraphTransient;
+
+typedef struct RenderGraph
+{
+	VkDevice device;
+	VmaAllocator allocator;
+
+	// transient memory, rebuilt when transientSignature changes
+	RenderGraphTransient transients[RENDER_GRAPH_MAX_IMAGES];
+	u32 transientCount;
+	u64 transientSignature;
+	VmaAllocation transientMemory;
+	VkDeviceSize transientPeak;     // bytes of the shared block
+	VkDeviceSize transientSeparate; // bytes without aliasing
+	u32 transientGeneration;        // bumped on every rebuild, for descriptor caches
+	// every transient use of the previous frame; memory is shared, so the first use of any
+	// transient waits on all of them
+	VkPipelineStageFlags2 transientLastStages;
+	VkAccessFlags2 transientLastAccess;
+
+	RenderGraphImageState images[RENDER_GRAPH_MAX_IMAGES];
+	u32 imageCount;
+	RenderGraphPassInfo passes[RENDER_GRAPH_MAX_PASSES];
+	u32 passCount;
+
+	// last execute, printed whenever the shape of the frame changes
+	u32 culledCount;
+	u32 barrierCount;
+	u32 batchCount;
+	u32 lastSummary;
+} RenderGraph;
+
+void render_graph_init(RenderGraph* graph, const Application* app);
+// Waits for the device and frees the transient images
+void render_graph_destroy(RenderGraph* graph);
+
+// Starts a new frame's graph; images and passes from the previous frame are dropped
+void render_graph_begin(RenderGraph* graph);
+
+// stage/access: the last use of the image before this graph (e.g. the semaphore wait stage for
+// a freshly acquired swapchain image), layout: its current layout
+RenderGraphImage render_graph_import_image(RenderGraph* graph, const char* name, VkImage image, VkImageView view, VkImageAspectFlags aspect,
+    VkImageLayout layout, VkPipelineStageFlags2 stage, VkAccessFlags2 access);
+// The image outlives the graph: passes writing it are never culled and it ends in finalLayout
+// (VK_IMAGE_LAYOUT_UNDEFINED = whatever its last use left)
+void render_graph_export_image(RenderGraph* graph, RenderGraphImage image, VkImageLayout finalLayout);
+
+// Graph-owned image, contents undefined before its first (write) use. Its VkImage/view are only
+// valid inside pass callbacks.
+RenderGraphImage render_graph_create_image(RenderGraph* graph, const char* name, const RenderGraphImageDesc* desc);
+
+RenderGraphPass render_graph_add_pass(RenderGraph* graph, const char* name, RenderGraphExecuteFunc execute, void* data);
+void render_graph_use(RenderGraph* graph, RenderGraphPass pass, RenderGraphImage image, RenderGraphUsage usage);
+
+// Culls, then records barriers and passes in declaration order
+void render_graph_execute(RenderGraph* graph, VkCommandBuffer cmd);
+
+// Layout the image was left in by the last execute
+VkImageLayout render_graph_image_layout(const RenderGraph* graph, RenderGraphImage image);
+// Stages and write access of the image's last uses in the last execute: what the next import of
+// the image passes as stage/access
+void render_graph_image_last_use(const RenderGraph* graph, RenderGraphImage image, VkPipelineStageFlags2* stage, VkAccessFlags2* access);
+VkImage render_graph_image(const RenderGraph* graph, RenderGraphImage image);
+VkImageView render_graph_image_view(const RenderGraph* graph, RenderGraphImage image);
+
+#endif // RENDER_GRAPH_H
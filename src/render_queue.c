@@ -0,0 +1,230 @@
+#include "render_queue.h"
+#include <string.h>
+
+void render_queue_init(RenderQueue* queue, u32 capacity)
+{
+	memset(queue, 0, sizeof(*queue));
+	queue->capacity = MAX(capacity, 1u);
+	queue->packets = malloc((size_t)queue->capacity * sizeof(RenderPacket));
+	queue->keys = malloc((size_t)queue->capacity * sizeof(u64));
+	queue->order = malloc((size_t)queue->capacity * sizeof(u32));
+	queue->scratchKeys = malloc((size_t)queue->capacity * sizeof(u64));
+	queue->scratchOrder = malloc((size_t)queue->capacity * sizeof(u32));
+	// most draws push a small per-object block; grows if they push more
+	queue->pushCapacity = queue->capacity * 32;
+	queue->pushData = malloc(queue->pushCapacity);
+}
+
+void render_queue_destroy(RenderQueue* queue)
+{
+	free(queue->packets);
+	free(queue->keys);
+	free(queue->order);
+	free(queue->scratchKeys);
+	free(queue->scratchOrder);
+	free(queue->pushData);
+	memset(queue, 0, sizeof(*queue));
+}
+
+void render_queue_reset(RenderQueue* queue)
+{
+	queue->count = 0;
+	queue->pushUsed = 0;
+}
+
+bool render_queue_submit(RenderQueue* queue, u64 key, const RenderPacket* packet, const void* pushData)
+{
+	if (queue->count == queue->capacity || packet->pushSize > RENDER_QUEUE_MAX_PUSH)
+		return false;
+	if (queue->pushUsed + packet->pushSize > queue->pushCapacity)
+	{
+		queue->pushCapacity = MAX(queue->pushCapacity * 2, queue->pushUsed + packet->pushSize);
+		queue->pushData = realloc(queue->pushData, queue->pushCapacity);
+	}
+	u32 index = queue->count++;
+	RenderPacket* p = &queue->packets[index];
+	*p = *packet;
+	p->pushOffset = queue->pushUsed;
+	if (p->pushSize > 0)
+		memcpy(queue->pushData + queue->pushUsed, pushData, p->pushSize);
+	queue->pushUsed += p->pushSize;
+	queue->keys[index] = key;
+	queue->order[index] = index;
+	return true;
+}
+
+// LSD radix sort of (key, order) pairs, a byte per pass. All eight histograms come from one read
+// of the keys (independent counters, no branches), and a byte that is the same in every key is
+// skipped: keys that only differ in a few fields cost a few passes.
+void render_queue_sort(RenderQueue* queue)
+{
+	u32 count = queue->count;
+	if (count < 2)
+		return;
+	u32 histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	const u64* keys = queue->keys;
+	for (u32 i = 0; i < count; ++i)
+	{
+		u64 k = keys[i];
+		histograms[0][k & 0xff]++;
+		histograms[1][(k >> 8) & 0xff]++;
+		histograms[2][(k >> 16) & 0xff]++;
+		histograms[3][(k >> 24) & 0xff]++;
+		histograms[4][(k >> 32) & 0xff]++;
+		histograms[5][(k >> 40) & 0xff]++;
+		histograms[6][(k >> 48) & 0xff]++;
+		histograms[7][k >> 56]++;
+	}
+
+	u64* srcKeys = queue->keys;
+	u32* srcOrder = queue->order;
+	u64* dstKeys = queue->scratchKeys;
+	u32* dstOrder = queue->scratchOrder;
+	for (u32 digit = 0; digit < 8; ++digit)
+	{
+		u32 shift = digit * 8;
+		u32* histogram = histograms[digit];
+		if (histogram[(srcKeys[0] >> shift) & 0xff] == count)
+			continue;
+		u32 offset = 0;
+		for (u32 b = 0; b < 256; ++b)
+		{
+			u32 n = histogram[b];
+			histogram[b] = offset;
+			offset += n;
+		}
+		// stable scatter: equal digits keep the order of the previous pass
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 slot = histogram[(srcKeys[i] >> shift) & 0xff]++;
+			dstKeys[slot] = srcKeys[i];
+			dstOrder[slot] = srcOrder[i];
+		}
+		u64* tk = srcKeys;
+		srcKeys = dstKeys;
+		dstKeys = tk;
+		u32* to = srcOrder;
+		srcOrder = dstOrder;
+		dstOrder = to;
+	}
+	// an odd number of passes leaves the result in the scratch arrays: swap them in
+	queue->keys = srcKeys;
+	queue->order = srcOrder;
+	queue->scratchKeys = dstKeys;
+	queue->scratchOrder = dstOrder;
+}
+
+// What the command buffer has bound
+typedef struct RenderStateCache
+{
+	VkPipeline pipeline;
+	VkPipelineLayout layout;
+	VkDescriptorSet sets[RENDER_QUEUE_MAX_SETS];
+	u32 dynamicOffsets[RENDER_QUEUE_MAX_SETS];
+	VkBuffer vertexBuffer;
+	VkBuffer indexBuffer;
+	VkShaderStageFlags pushStages;
+	u32 pushSize;
+	u8 push[RENDER_QUEUE_MAX_PUSH];
+} RenderStateCache;
+
+void render_queue_record(const RenderQueue* queue, VkCommandBuffer cmd, u32 begin, u32 end, RenderQueueStats* stats)
+{
+	RenderQueueStats counts = {0};
+	RenderStateCache state;
+	memset(&state, 0, sizeof(state));
+	end = MIN(end, queue->count);
+	for (u32 i = begin; i < end; ++i)
+	{
+		const RenderPacket* p = &queue->packets[queue->order[i]];
+		if (p->pipeline != state.pipeline)
+		{
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, p->pipeline);
+			state.pipeline = p->pipeline;
+			counts.pipelineBinds++;
+		}
+		else
+		{
+			counts.pipelineSkips++;
+		}
+		if (p->layout != state.layout)
+		{
+			memset(state.sets, 0, sizeof(state.sets));
+			state.pushSize = 0;
+			state.layout = p->layout;
+		}
+
+		for (u32 s = 0; s < RENDER_QUEUE_MAX_SETS; ++s)
+		{
+			if (!p->sets[s])
+				continue;
+			bool dynamic = p->dynamicOffsets[s] != RENDER_QUEUE_NO_DYNAMIC_OFFSET;
+			if (p->sets[s] == state.sets[s] && p->dynamicOffsets[s] == state.dynamicOffsets[s])
+			{
+				counts.setSkips++;
+				continue;
+			}
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, p->layout, s, 1, &p->sets[s], dynamic ? 1 : 0, &p->dynamicOffsets[s]);
+			state.sets[s] = p->sets[s];
+			state.dynamicOffsets[s] = p->dynamicOffsets[s];
+			counts.setBinds++;
+		}
+
+		if (p->vertexBuffer != state.vertexBuffer || p->indexBuffer != state.indexBuffer)
+		{
+			if (p->vertexBuffer)
+			{
+				VkDeviceSize offset = 0;
+				vkCmdBindVertexBuffers(cmd, 0, 1, &p->vertexBuffer, &offset);
+			}
+			if (p->indexBuffer)
+				vkCmdBindIndexBuffer(cmd, p->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+			state.vertexBuffer = p->vertexBuffer;
+			state.indexBuffer = p->indexBuffer;
+			counts.bufferBinds++;
+		}
+		else if (p->vertexBuffer || p->indexBuffer)
+		{
+			counts.bufferSkips++;
+		}
+
+		if (p->pushSize > 0)
+		{
+			const u8* data = queue->pushData + p->pushOffset;
+			if (p->pushStages == state.pushStages && p->pushSize == state.pushSize && memcmp(data, state.push, p->pushSize) == 0)
+			{
+				counts.pushSkips++;
+			}
+			else
+			{
+				vkCmdPushConstants(cmd, p->layout, p->pushStages, 0, p->pushSize, data);
+				memcpy(state.push, data, p->pushSize);
+				state.pushStages = p->pushStages;
+				state.pushSize = p->pushSize;
+				counts.pushes++;
+			}
+		}
+
+		if (p->indexBuffer)
+			vkCmdDrawIndexed(cmd, p->count, 1, 0, 0, 0);
+		else
+			vkCmdDraw(cmd, p->count, 1, 0, 0);
+		counts.draws++;
+	}
+	if (stats)
+		render_queue_stats_add(stats, &counts);
+}
+
+void render_queue_stats_add(RenderQueueStats* total, const RenderQueueStats* stats)
+{
+	total->draws += stats->draws;
+	total->pipelineBinds += stats->pipelineBinds;
+	total->pipelineSkips += stats->pipelineSkips;
+	total->setBinds += stats->setBinds;
+	total->setSkips += stats->setSkips;
+	total->pushes += stats->pushes;
+	total->pushSkips += stats->pushSkips;
+	total->bufferBinds += stats->bufferBinds;
+	total->bufferSkips += stats->bufferSkips;
+}
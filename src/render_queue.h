@@ -0,0 +1,96 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "main.h"
+
+// Render queue: draws collected as flat packets, radix sorted on a 64-bit key, replayed through
+// a state cache
+// - a packet carries everything a draw binds (pipeline, descriptor sets and dynamic offsets,
+//   vertex/index buffers, push constants), so any range of the sorted queue can be recorded
+//   on its own, e.g. one range per secondary command buffer
+// - key, most significant first: pass | pipeline | material | depth bucket | mesh, so sorting
+//   groups draws by the most expensive state change first (render_queue_key)
+// - the sort is an LSD radix sort on bytes, O(n): one pass builds all eight histograms, and a
+//   byte every key has in common costs nothing; it moves (key, index) pairs, never packets
+// - the state cache remembers what the command buffer has bound and drops vkCmdBindPipeline,
+//   vkCmdBindDescriptorSets, vkCmdPushConstants and buffer binds that would change nothing;
+//   issued and skipped calls are counted per category
+// - a layout change forgets the bound sets and push constants: the cache does not know which
+//   layouts are compatible, so it never relies on state surviving one
+
+#define RENDER_QUEUE_MAX_SETS 4
+#define RENDER_QUEUE_MAX_PUSH 128
+#define RENDER_QUEUE_NO_DYNAMIC_OFFSET UINT32_MAX
+
+// key fields (bits): pass 4, pipeline 12, material 20, depth bucket 12, mesh 16
+#define RENDER_KEY_PASS_SHIFT 60
+#define RENDER_KEY_PIPELINE_SHIFT 48
+#define RENDER_KEY_MATERIAL_SHIFT 28
+#define RENDER_KEY_DEPTH_SHIFT 16
+#define RENDER_KEY_DEPTH_BUCKETS 4096
+
+typedef struct RenderPacket
+{
+	VkPipeline pipeline;
+	VkPipelineLayout layout;
+	VkDescriptorSet sets[RENDER_QUEUE_MAX_SETS]; // VK_NULL_HANDLE: set not used
+	u32 dynamicOffsets[RENDER_QUEUE_MAX_SETS];   // one per set, or RENDER_QUEUE_NO_DYNAMIC_OFFSET
+	VkBuffer vertexBuffer;                       // VK_NULL_HANDLE: no vertex input
+	VkBuffer indexBuffer;                        // u16; VK_NULL_HANDLE: non-indexed draw
+	u32 count;                                   // indices, or vertices when non-indexed
+	VkShaderStageFlags pushStages;
+	u32 pushSize;
+	u32 pushOffset; // into the queue's push data
+} RenderPacket;
+
+typedef struct RenderQueueStats
+{
+	u32 draws;
+	u32 pipelineBinds, pipelineSkips;
+	u32 setBinds, setSkips; // per set
+	u32 pushes, pushSkips;
+	u32 bufferBinds, bufferSkips; // vertex + index pairs
+} RenderQueueStats;
+
+typedef struct RenderQueue
+{
+	RenderPacket* packets;
+	u64* keys;
+	u32* order; // sorted packet indices
+	u64* scratchKeys;
+	u32* scratchOrder;
+	u32 count;
+	u32 capacity;
+	u8* pushData;
+	u32 pushUsed;
+	u32 pushCapacity;
+} RenderQueue;
+
+static inline u64 render_queue_key(u32 pass, u32 pipeline, u32 material, u32 depthBucket, u32 mesh)
+{
+	return (u64)(pass & 0xf) << RENDER_KEY_PASS_SHIFT | (u64)(pipeline & 0xfff) << RENDER_KEY_PIPELINE_SHIFT |
+	       (u64)(material & 0xfffff) << RENDER_KEY_MATERIAL_SHIFT | (u64)(depthBucket & 0xfff) << RENDER_KEY_DEPTH_SHIFT | (u64)(mesh & 0xffff);
+}
+
+// depth in [0, 1] (near to far) to a bucket; pass 1 - depth to sort back to front
+static inline u32 render_queue_depth_bucket(float depth)
+{
+	depth = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+	return (u32)(depth * (RENDER_KEY_DEPTH_BUCKETS - 1) + 0.5f);
+}
+
+void render_queue_init(RenderQueue* queue, u32 capacity);
+void render_queue_destroy(RenderQueue* queue);
+void render_queue_reset(RenderQueue* queue);
+
+// Copies packet and pushSize bytes of push data (packet->pushOffset is filled in). False when full.
+bool render_queue_submit(RenderQueue* queue, u64 key, const RenderPacket* packet, const void* pushData);
+void render_queue_sort(RenderQueue* queue);
+
+// Records sorted packets [begin, end) assuming nothing is bound (a fresh command buffer or
+// secondary). Call inside rendering with viewport and scissor set. stats may be NULL.
+void render_queue_record(const RenderQueue* queue, VkCommandBuffer cmd, u32 begin, u32 end, RenderQueueStats* stats);
+
+void render_queue_stats_add(RenderQueueStats* total, const RenderQueueStats* stats);
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,321 @@
+#include "scene_pass.h"
+#include <math.h>
+#include <string.h>
+
+static float next_random(u32* state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return (float)(*state >> 8) * (1.0f / 16777216.0f);
+}
+
+#define SCENE_INSTANCES_PER_MATERIAL 16
+
+// Matches the parameter blocks of material_flat.frag and material_ring.frag
+typedef struct SceneMaterialParams
+{
+	float tint[4];
+	float ring[4]; // x: inner radius, y: pulse rate, z: pulse phase
+} SceneMaterialParams;
+
+// Two definitions, a few instances of each and three meshes; every draw picks one of each
+static void init_materials(ScenePass* pass, u32* rng)
+{
+	MaterialSystem* ms = pass->materials;
+	static const float quad[] = {-1, -1, 1, -1, 1, 1, -1, 1};
+	static const u16 quadIndices[] = {0, 1, 2, 0, 2, 3};
+	static const float triangle[] = {0.0f, 1.0f, -0.866f, -0.5f, 0.866f, -0.5f};
+	static const u16 triangleIndices[] = {0, 1, 2};
+	float hexagon[14] = {0.0f, 0.0f};
+	u16 hexagonIndices[18];
+	for (u32 i = 0; i < 6; ++i)
+	{
+		hexagon[2 + 2 * i] = cosf((float)i * 1.04719755f);
+		hexagon[3 + 2 * i] = sinf((float)i * 1.04719755f);
+		hexagonIndices[3 * i] = 0;
+		hexagonIndices[3 * i + 1] = (u16)(1 + i);
+		hexagonIndices[3 * i + 2] = (u16)(1 + (i + 1) % 6);
+	}
+	MaterialMeshHandle meshes[3] = {
+	    material_mesh_create(ms, quad, 4, quadIndices, ARRAYSIZE(quadIndices)),
+	    material_mesh_create(ms, triangle, 3, triangleIndices, ARRAYSIZE(triangleIndices)),
+	    material_mesh_create(ms, hexagon, 7, hexagonIndices, ARRAYSIZE(hexagonIndices)),
+	};
+
+	MaterialDefinitionDesc desc = {
+	    .name = "material_flat",
+	    .vertexShader = "compiledshaders/material.vert.spv",
+	    .fragmentShader = "compiledshaders/material_flat.frag.spv",
+	    .colorFormat = pass->colorFormat,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	};
+	MaterialHandle definitions[2];
+	definitions[0] = material_define(ms, &desc);
+	desc.name = "material_ring";
+	desc.fragmentShader = "compiledshaders/material_ring.frag.spv";
+	definitions[1] = material_define(ms, &desc);
+
+	MaterialInstanceHandle instances[2 * SCENE_INSTANCES_PER_MATERIAL];
+	u32 instanceCount = 0;
+	for (u32 d = 0; d < ARRAYSIZE(definitions); ++d)
+	{
+		for (u32 i = 0; definitions[d] != MATERIAL_INVALID_HANDLE && i < SCENE_INSTANCES_PER_MATERIAL; ++i)
+		{
+			SceneMaterialParams params = {
+			    .tint = {0.5f + next_random(rng), 0.5f + next_random(rng), 0.5f + next_random(rng), 1.0f},
+			    .ring = {0.3f + 0.5f * next_random(rng), 1.0f + 4.0f * next_random(rng), 6.2831853f * next_random(rng), 0.0f},
+			};
+			MaterialInstanceHandle instance = material_instance_create(ms, definitions[d], &params, sizeof(params), NULL, 0);
+			if (instance != MATERIAL_INVALID_HANDLE)
+				instances[instanceCount++] = instance;
+		}
+	}
+	if (instanceCount == 0)
+	{
+		printf("[Scene] No material instances, nothing to draw\n");
+		pass->drawCount = 0;
+		return;
+	}
+
+	pass->drawInstances = malloc((size_t)pass->drawCount * sizeof(MaterialInstanceHandle));
+	pass->drawMeshes = malloc((size_t)pass->drawCount * sizeof(MaterialMeshHandle));
+	for (u32 i = 0; i < pass->drawCount; ++i)
+	{
+		pass->drawInstances[i] = instances[(u32)(next_random(rng) * instanceCount)];
+		pass->drawMeshes[i] = meshes[(u32)(next_random(rng) * ARRAYSIZE(meshes))];
+	}
+	render_queue_init(&pass->queue, pass->drawCount);
+}
+
+void scene_pass_init(ScenePass* pass, const Application* app, ThreadCommandPools* pools, PipelineManager* pipelines, MaterialSystem* materials,
+    u32 drawCount, bool parallel)
+{
+	memset(pass, 0, sizeof(*pass));
+	pass->device = app->device;
+	pass->pools = pools;
+	pass->colorFormat = app->drawImage.imageFormat;
+	pass->parallel = parallel;
+	pass->materials = materials;
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+	    .offset = 0,
+	    .size = sizeof(SceneDraw),
+	};
+	pass->pipelineLayout = createPipelineLayout(pass->device, NULL, 0, &pcr, 1);
+	pass->pipelines = pipelines;
+	PipelineDesc desc = {
+	    .name = "scene_quad",
+	    .vertexShader = "compiledshaders/scene_quad.vert.spv",
+	    .fragmentShader = "compiledshaders/tri.frag.spv",
+	    .layout = pass->pipelineLayout,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+	    .cullMode = VK_CULL_MODE_NONE,
+	    .colorFormat = pass->colorFormat,
+	    .onDemand = materials != NULL, // material mode never asks for them
+	};
+	pass->opaquePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	// variant nobody needs for the first frame: compiled in the background, drawn square until then
+	desc.name = "scene_quad_round";
+	desc.fragmentShader = "compiledshaders/scene_quad.frag.spv";
+	desc.onDemand = true;
+	pass->roundPipeline = pipeline_register(pipelines, &desc, pass->opaquePipeline);
+
+	// confetti: small quads scattered over the screen
+	pass->drawCount = drawCount;
+	pass->roundFirst = drawCount - drawCount / 4;
+	pass->draws = malloc((size_t)drawCount * sizeof(SceneDraw));
+	u32 rng = 12345u;
+	for (u32 i = 0; i < drawCount; ++i)
+	{
+		SceneDraw* d = &pass->draws[i];
+		float size = 0.004f + 0.016f * next_random(&rng);
+		d->rect[0] = next_random(&rng) * 2.0f - 1.0f;
+		d->rect[1] = next_random(&rng) * 2.0f - 1.0f;
+		d->rect[2] = size;
+		d->rect[3] = size;
+		d->color[0] = next_random(&rng);
+		d->color[1] = next_random(&rng);
+		d->color[2] = next_random(&rng);
+		d->color[3] = 1.0f;
+	}
+
+	if (materials)
+		init_materials(pass, &rng);
+
+	pass->chunkCapacity = MAX((drawCount + SCENE_PASS_MIN_CHUNK - 1) / SCENE_PASS_MIN_CHUNK, 1u);
+	pass->chunkBuffers = malloc(pass->chunkCapacity * sizeof(VkCommandBuffer));
+	pass->chunkStats = malloc(pass->chunkCapacity * sizeof(RenderQueueStats));
+	printf("[Scene] %u draws%s, %s recording on %u threads\n", pass->drawCount, materials ? " of material instances" : "",
+	    parallel ? "parallel" : "serial", parallel ? job_thread_count() : 1);
+}
+
+void scene_pass_destroy(ScenePass* pass)
+{
+	vkDestroyPipelineLayout(pass->device, pass->pipelineLayout, NULL);
+	free(pass->draws);
+	free(pass->chunkBuffers);
+	free(pass->chunkStats);
+	if (pass->materials)
+	{
+		render_queue_destroy(&pass->queue);
+		free(pass->drawInstances);
+		free(pass->drawMeshes);
+	}
+}
+
+typedef struct SceneRecordJob
+{
+	ScenePass* pass;
+	u32 frameIndex;
+	u32 chunkSize;
+	VkPipeline opaque;
+	VkPipeline round;
+	VkExtent2D extent;
+	const VkCommandBufferInheritanceInfo* inheritance;
+} SceneRecordJob;
+
+static void record_chunk(void* data, u32 begin, u32 end)
+{
+	SceneRecordJob* job = (SceneRecordJob*)data;
+	ScenePass* pass = job->pass;
+	VkCommandBuffer cmd = thread_command_pools_begin_secondary(pass->pools, job->frameIndex, job->inheritance,
+	    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+
+	// secondaries inherit no state
+	VkViewport viewport = {0.0f, 0.0f, (float)job->extent.width, (float)job->extent.height, 0.0f, 1.0f};
+	VkRect2D scissor = {{0, 0}, job->extent};
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+	if (pass->materials)
+	{
+		RenderQueueStats* stats = &pass->chunkStats[begin / job->chunkSize];
+		memset(stats, 0, sizeof(*stats));
+		render_queue_record(&pass->queue, cmd, begin, end, stats);
+		VK_CHECK(vkEndCommandBuffer(cmd));
+		pass->chunkBuffers[begin / job->chunkSize] = cmd;
+		return;
+	}
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, begin < pass->roundFirst ? job->opaque : job->round);
+	for (u32 i = begin; i < end; ++i)
+	{
+		if (i == pass->roundFirst && i != begin)
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, job->round);
+		vkCmdPushConstants(cmd, pass->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SceneDraw), &pass->draws[i]);
+		vkCmdDraw(cmd, 4, 1, 0, 0);
+	}
+	VK_CHECK(vkEndCommandBuffer(cmd));
+	pass->chunkBuffers[begin / job->chunkSize] = cmd;
+}
+
+void scene_pass_record(ScenePass* pass, VkCommandBuffer cmd, u32 frameIndex, VkImageView target, VkExtent2D extent)
+{
+	double start = glfwGetTime();
+
+	VkPipeline opaque = VK_NULL_HANDLE;
+	VkPipeline round = VK_NULL_HANDLE;
+	u32 drawCount = 0;
+	double sortMs = 0.0;
+	if (!pass->materials)
+	{
+		// resolved once per frame on this thread; the round variant reports the opaque one until it is built
+		opaque = pipeline_get(pass->pipelines, pass->opaquePipeline);
+		round = pipeline_get(pass->pipelines, pass->roundPipeline);
+		drawCount = opaque ? pass->drawCount : 0;
+	}
+	else
+	{
+		// what culling would hand over each frame: unsorted draws, keyed and sorted here
+		MaterialGlobals globals = {
+		    .viewport = {(float)extent.width, (float)extent.height, 1.0f / (float)extent.width, 1.0f / (float)extent.height},
+		    .time = {(float)start},
+		};
+		material_system_begin_frame(pass->materials, frameIndex, &globals);
+		render_queue_reset(&pass->queue);
+		for (u32 i = 0; i < pass->drawCount; ++i)
+		{
+			// stand-in depth: screen height, so draws of one material go top to bottom
+			const SceneDraw* draw = &pass->draws[i];
+			material_submit(pass->materials, &pass->queue, frameIndex, 0, pass->drawInstances[i], pass->drawMeshes[i], draw->rect[1] * 0.5f + 0.5f, draw,
+			    sizeof(SceneDraw));
+		}
+		material_system_end_frame(pass->materials);
+		render_queue_sort(&pass->queue);
+		drawCount = pass->queue.count;
+		sortMs = (glfwGetTime() - start) * 1e3;
+	}
+
+	VkCommandBufferInheritanceRenderingInfo inheritanceRendering = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachmentFormats = &pass->colorFormat,
+	    .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+	};
+	VkCommandBufferInheritanceInfo inheritance = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+	    .pNext = &inheritanceRendering,
+	};
+
+	// a few chunks per thread so uneven thread start times even out; serial = one chunk
+	u32 chunkSize = drawCount;
+	if (pass->parallel)
+		chunkSize = MAX(drawCount / (job_thread_count() * 4), (u32)SCENE_PASS_MIN_CHUNK);
+	chunkSize = MAX(chunkSize, 1u);
+	u32 chunkCount = (drawCount + chunkSize - 1) / chunkSize;
+	assert(chunkCount <= pass->chunkCapacity);
+
+	SceneRecordJob job = {
+	    .pass = pass,
+	    .frameIndex = frameIndex,
+	    .chunkSize = chunkSize,
+	    .opaque = opaque,
+	    .round = round,
+	    .extent = extent,
+	    .inheritance = &inheritance,
+	};
+	if (pass->parallel)
+		job_parallel_for(drawCount, chunkSize, record_chunk, &job);
+	else if (drawCount > 0)
+		record_chunk(&job, 0, drawCount);
+
+	VkRenderingAttachmentInfo colorAttachment = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+	    .imageView = target,
+	    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+	    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+	    .clearValue = {.color = {.float32 = {0.02f, 0.02f, 0.03f, 1.0f}}},
+	};
+	VkRenderingInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+	    .flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT,
+	    .renderArea = {{0, 0}, extent},
+	    .layerCount = 1,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachments = &colorAttachment,
+	};
+	vkCmdBeginRendering(cmd, &renderingInfo);
+	if (drawCount > 0)
+		vkCmdExecuteCommands(cmd, chunkCount, pass->chunkBuffers);
+	vkCmdEndRendering(cmd);
+
+	pass->recordMsAccum += (glfwGetTime() - start) * 1e3;
+	pass->sortMsAccum += sortMs;
+	for (u32 i = 0; pass->materials && i < chunkCount; ++i)
+		render_queue_stats_add(&pass->statsAccum, &pass->chunkStats[i]);
+	if (++pass->recordFrames == SCENE_PASS_REPORT_FRAMES)
+	{
+		printf("[Scene] %u draws in %u chunks: %.3f ms/frame recording\n", pass->drawCount, chunkCount, pass->recordMsAccum / pass->recordFrames);
+		if (pass->materials)
+		{
+			const RenderQueueStats* s = &pass->statsAccum;
+			u32 n = pass->recordFrames;
+			printf("[Scene] per frame: %.3f ms submit + sort, %u draws; issued/skipped: %u/%u pipeline, %u/%u set, %u/%u buffer, %u/%u push\n",
+			    pass->sortMsAccum / n, s->draws / n, s->pipelineBinds / n, s->pipelineSkips / n, s->setBinds / n, s->setSkips / n, s->bufferBinds / n,
+			    s->bufferSkips / n, s->pushes / n, s->pushSkips / n);
+		}
+		pass->recordMsAccum = 0.0;
+		pass->sortMsAccum = 0.0;
+		memset(&pass->statsAccum, 0, sizeof(pass->statsAccum));
+		pass->recordFrames = 0;
+	}
+}
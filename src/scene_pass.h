@@ -0,0 +1,69 @@
+#ifndef SCENE_PASS_H
+#define SCENE_PASS_H
+
+#include "command_pools.h"
+#include "material.h"
+
+// Raster scene pass: drawCount small quads (one vkCmdDraw each) into drawImage with dynamic rendering
+// - draws are split into chunks recorded in parallel on the job system, each into a secondary
+//   from the recording thread's pool, then stitched in draw order with vkCmdExecuteCommands
+// - serial mode records the same draws into one secondary on the main thread for comparison
+// - the last quarter of the draws uses the on-demand "round" variant (scene_quad.frag), which
+//   falls back to the opaque pipeline until its background compile finishes
+// - material mode (--scene-materials) draws the same quads as meshes of material instances
+//   (material.h): the render queue is refilled and radix sorted every frame and each chunk
+//   records its range through the queue's state cache; issued and skipped binds per frame are
+//   reported next to the recording time
+
+// Matches the push constant block in scene_quad.vert and the Object block in material.vert
+typedef struct SceneDraw
+{
+	float rect[4]; // xy center, zw half extent, NDC
+	float color[4];
+} SceneDraw;
+
+typedef struct ScenePass
+{
+	VkDevice device;
+	ThreadCommandPools* pools;
+	VkFormat colorFormat;
+	VkPipelineLayout pipelineLayout;
+	PipelineManager* pipelines;
+	PipelineHandle opaquePipeline;
+	PipelineHandle roundPipeline;
+	u32 roundFirst; // first draw using roundPipeline
+
+	// material mode: per draw, an instance and a mesh; SceneDraw is the per-object block
+	MaterialSystem* materials; // NULL: push constant quads
+	MaterialInstanceHandle* drawInstances;
+	MaterialMeshHandle* drawMeshes;
+	RenderQueue queue;
+	RenderQueueStats* chunkStats;
+
+	SceneDraw* draws;
+	u32 drawCount;
+	bool parallel;
+
+	VkCommandBuffer* chunkBuffers; // this frame's secondaries, in draw order
+	u32 chunkCapacity;
+
+	// recording cost, printed every SCENE_PASS_REPORT_FRAMES frames
+	double recordMsAccum;
+	double sortMsAccum;
+	RenderQueueStats statsAccum;
+	u32 recordFrames;
+} ScenePass;
+
+#define SCENE_PASS_REPORT_FRAMES 256
+// smallest chunk worth a secondary + job
+#define SCENE_PASS_MIN_CHUNK 256
+
+// materials: NULL for the push constant quads, or a system to draw them as material instances
+void scene_pass_init(ScenePass* pass, const Application* app, ThreadCommandPools* pools, PipelineManager* pipelines, MaterialSystem* materials,
+    u32 drawCount, bool parallel);
+void scene_pass_destroy(ScenePass* pass);
+
+// Clears target and draws the scene. target must be in COLOR_ATTACHMENT_OPTIMAL.
+void scene_pass_record(ScenePass* pass, VkCommandBuffer cmd, u32 frameIndex, VkImageView target, VkExtent2D extent);
+
+#endif // SCENE_PASS_H
@@ -0,0 +1,134 @@
+#include "shader_archive.h"
+#include "main.h"
+#include "../external/c89atomic/c89atomic.h"
+#include <string.h>
+
+static struct
+{
+	MappedFile file;
+	const ShaderArchiveEntry* entries;
+	u32 count;
+	u64* overrides; // one slot per entry: an entry is overridden at most once, so it never fills up
+	volatile c89atomic_uint32 overrideCount;
+} archive;
+
+bool shader_archive_open(const char* path)
+{
+	shader_archive_close();
+	if (!map_file(path, &archive.file))
+	{
+		printf("[Shaders] no archive at %s, loading .spv files\n", path);
+		return false;
+	}
+
+	ShaderArchiveHeader header;
+	bool ok = archive.file.size >= sizeof(header);
+	if (ok)
+	{
+		memcpy(&header, archive.file.data, sizeof(header));
+		ok = header.magic == SHADER_ARCHIVE_MAGIC && header.version == SHADER_ARCHIVE_VERSION &&
+		     sizeof(header) + (u64)header.count * sizeof(ShaderArchiveEntry) <= archive.file.size;
+	}
+	const ShaderArchiveEntry* entries = (const ShaderArchiveEntry*)(archive.file.data + sizeof(ShaderArchiveHeader));
+	for (u32 i = 0; ok && i < header.count; ++i)
+	{
+		ok = entries[i].offset % 4 == 0 && entries[i].size % 4 == 0 && (u64)entries[i].offset + entries[i].size <= archive.file.size &&
+		     (i == 0 || entries[i - 1].nameHash < entries[i].nameHash);
+	}
+	if (!ok)
+	{
+		printf("[Shaders] %s is not a version %u archive, loading .spv files\n", path, SHADER_ARCHIVE_VERSION);
+		unmap_file(&archive.file);
+		return false;
+	}
+	archive.entries = entries;
+	archive.count = header.count;
+	archive.overrides = malloc(MAX(header.count, 1) * sizeof(u64));
+	printf("[Shaders] archive: %u modules, %zu KB\n", archive.count, archive.file.size / 1024);
+	return true;
+}
+
+void shader_archive_close(void)
+{
+	unmap_file(&archive.file);
+	archive.entries = NULL;
+	archive.count = 0;
+	free(archive.overrides);
+	archive.overrides = NULL;
+	c89atomic_store_explicit_32(&archive.overrideCount, 0, c89atomic_memory_order_relaxed);
+}
+
+const ShaderArchiveEntry* shader_archive_find(const char* path, const u32** code)
+{
+	if (archive.count == 0)
+		return NULL;
+	u64 hash = shader_archive_hash(path);
+	u32 overrideCount = c89atomic_load_explicit_32(&archive.overrideCount, c89atomic_memory_order_acquire);
+	for (u32 i = 0; i < overrideCount; ++i)
+	{
+		if (archive.overrides[i] == hash)
+			return NULL;
+	}
+
+	u32 lo = 0, hi = archive.count;
+	while (lo < hi)
+	{
+		u32 mid = lo + (hi - lo) / 2;
+		if (archive.entries[mid].nameHash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == archive.count || archive.entries[lo].nameHash != hash)
+		return NULL;
+	*code = (const u32*)(archive.file.data + archive.entries[lo].offset);
+	return &archive.entries[lo];
+}
+
+void shader_archive_override(const char* path)
+{
+	const u32* code;
+	if (!shader_archive_find(path, &code))
+		return;
+	// found, so not overridden yet: count < archive.count
+	u32 count = c89atomic_load_explicit_32(&archive.overrideCount, c89atomic_memory_order_relaxed);
+	archive.overrides[count] = shader_archive_hash(path);
+	// publishes the hash to lookups on job threads
+	c89atomic_store_explicit_32(&archive.overrideCount, count + 1, c89atomic_memory_order_release);
+}
+
+bool shader_reflect_local_size(const char* path, u32 localSize[3])
+{
+	localSize[0] = localSize[1] = localSize[2] = 1;
+	const u32* code;
+	const ShaderArchiveEntry* entry = shader_archive_find(path, &code);
+	if (entry)
+	{
+		if (entry->localSize[0] == 0)
+			return false;
+		memcpy(localSize, entry->localSize, sizeof(entry->localSize));
+		return true;
+	}
+
+	MappedFile file = {0};
+	if (!map_file(path, &file))
+		return false;
+	// words are 4 byte aligned in the page aligned mapping; skip the 5 word header
+	const u32* words = (const u32*)file.data;
+	size_t count = file.size / 4;
+	bool found = false;
+	for (size_t i = 5; i < count && !found;)
+	{
+		u32 op = words[i] & 0xffff, length = words[i] >> 16;
+		if (length == 0 || i + length > count)
+			break;
+		if (op == 16 && length >= 6 && words[i + 2] == 17) // OpExecutionMode LocalSize
+		{
+			memcpy(localSize, &words[i + 3], 3 * sizeof(u32));
+			found = true;
+		}
+		i += length;
+	}
+	unmap_file(&file);
+	return found;
+}
@@ -0,0 +1,61 @@
+#ifndef SHADER_ARCHIVE_H
+#define SHADER_ARCHIVE_H
+
+#include "types.h"
+#include <string.h>
+
+// Every compiled shader in one file, written by nob.c after glslc and mapped once at startup
+// - entries are sorted by the FNV-1a hash of the .spv path the code asks for
+//   ("compiledshaders/grad.comp.spv"), so a lookup is a binary search over the mapped header
+// - each SPIR-V blob starts 16 byte aligned: LoadShaderModule hands the mapped words straight to
+//   vkCreateShaderModule, with no read or copy
+// - per entry reflection: stage, descriptor binding count, compute workgroup size
+// - paths missing from the archive (or edited since, see shader_reload.h) load from their .spv;
+//   without an archive everything does
+
+// On-disk layout: ShaderArchiveHeader, ShaderArchiveEntry[count] sorted by nameHash, blobs
+#define SHADER_ARCHIVE_PATH "compiledshaders/shaders.spva"
+#define SHADER_ARCHIVE_MAGIC 0x41565053u // "SPVA"
+#define SHADER_ARCHIVE_VERSION 1
+#define SHADER_ARCHIVE_ALIGN 16
+
+typedef struct ShaderArchiveHeader
+{
+	u32 magic;
+	u32 version;
+	u32 count;
+	u32 reserved;
+} ShaderArchiveHeader;
+
+typedef struct ShaderArchiveEntry
+{
+	u64 nameHash;
+	u32 offset; // from the start of the file
+	u32 size;   // bytes, a multiple of 4
+	u32 stage;  // VkShaderStageFlagBits
+	u32 bindingCount;
+	u32 localSize[3]; // compute only
+	u32 reserved;
+} ShaderArchiveEntry;
+
+static inline u64 shader_archive_hash(const char* path)
+{
+	return fnv1a64(path, strlen(path));
+}
+
+// Maps the archive; false (and per-file loading) if it is missing or malformed
+bool shader_archive_open(const char* path);
+void shader_archive_close(void);
+
+// Entry for a .spv path, or NULL. *code points into the mapping until shader_archive_close.
+// Safe from any thread.
+const ShaderArchiveEntry* shader_archive_find(const char* path, const u32** code);
+
+// From now on path loads from its file (it was recompiled after the archive was written)
+void shader_archive_override(const char* path);
+
+// Default compute workgroup size of a .spv, from its archive entry or its file. False (and 1, 1, 1)
+// if it has none. Safe from any thread.
+bool shader_reflect_local_size(const char* path, u32 localSize[3]);
+
+#endif // SHADER_ARCHIVE_H
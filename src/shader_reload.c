@@ -0,0 +1,327 @@
+#define _POSIX_C_SOURCE 200809L // posix_spawnp
+#include "shader_reload.h"
+#include "shader_archive.h"
+#include "../external/SPIRV-Reflect/spirv_reflect.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <spawn.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#define SHADER_INTERFACE_MAX 64
+
+// What a hand written pipeline layout has to agree with
+typedef struct ShaderInterface
+{
+	u32 stage;
+	u32 bindingCount;
+	u32 bindings[SHADER_INTERFACE_MAX]; // set << 16 | binding, ascending
+	u32 types[SHADER_INTERFACE_MAX];    // VkDescriptorType
+	u32 counts[SHADER_INTERFACE_MAX];
+	u32 pushConstantSize;
+} ShaderInterface;
+
+static bool reflect_interface(const char* path, ShaderInterface* out)
+{
+	MappedFile file = {0};
+	if (!map_file(path, &file))
+		return false;
+	SpvReflectShaderModule module;
+	bool ok = spvReflectCreateShaderModule(file.size, file.data, &module) == SPV_REFLECT_RESULT_SUCCESS;
+	unmap_file(&file);
+	if (!ok)
+		return false;
+
+	memset(out, 0, sizeof(*out));
+	out->stage = (u32)module.shader_stage;
+	u32 count = 0;
+	ok = spvReflectEnumerateDescriptorBindings(&module, &count, NULL) == SPV_REFLECT_RESULT_SUCCESS && count <= SHADER_INTERFACE_MAX;
+	SpvReflectDescriptorBinding* bindings[SHADER_INTERFACE_MAX];
+	if (ok && count > 0)
+		ok = spvReflectEnumerateDescriptorBindings(&module, &count, bindings) == SPV_REFLECT_RESULT_SUCCESS;
+	for (u32 i = 0; ok && i < count; ++i)
+	{
+		// insertion sort: declaration order is not part of the interface
+		u32 key = bindings[i]->set << 16 | bindings[i]->binding;
+		u32 j = out->bindingCount++;
+		for (; j > 0 && out->bindings[j - 1] > key; --j)
+		{
+			out->bindings[j] = out->bindings[j - 1];
+			out->types[j] = out->types[j - 1];
+			out->counts[j] = out->counts[j - 1];
+		}
+		out->bindings[j] = key;
+		out->types[j] = (u32)bindings[i]->descriptor_type;
+		out->counts[j] = bindings[i]->count;
+	}
+
+	count = 0;
+	if (ok && spvReflectEnumeratePushConstantBlocks(&module, &count, NULL) == SPV_REFLECT_RESULT_SUCCESS && count > 0)
+	{
+		SpvReflectBlockVariable* blocks[4];
+		count = MIN(count, ARRAYSIZE(blocks));
+		if (spvReflectEnumeratePushConstantBlocks(&module, &count, blocks) == SPV_REFLECT_RESULT_SUCCESS)
+		{
+			for (u32 i = 0; i < count; ++i)
+				out->pushConstantSize = MAX(out->pushConstantSize, blocks[i]->offset + blocks[i]->size);
+		}
+	}
+	spvReflectDestroyShaderModule(&module);
+	return ok;
+}
+
+static bool interface_matches(const char* oldPath, const char* newPath, const char* name)
+{
+	ShaderInterface before, after;
+	if (!reflect_interface(oldPath, &before))
+		return true; // a new shader: nothing uses it yet
+	if (!reflect_interface(newPath, &after))
+	{
+		printf("[Shaders] %s: could not reflect the new module\n", name);
+		return false;
+	}
+	if (before.stage != after.stage || before.pushConstantSize != after.pushConstantSize || before.bindingCount != after.bindingCount)
+	{
+		printf("[Shaders] %s: push constants (%u -> %u bytes) or bindings (%u -> %u) changed, restart to pick it up\n", name,
+		    before.pushConstantSize, after.pushConstantSize, before.bindingCount, after.bindingCount);
+		return false;
+	}
+	for (u32 i = 0; i < before.bindingCount; ++i)
+	{
+		if (before.bindings[i] != after.bindings[i] || before.types[i] != after.types[i] || before.counts[i] != after.counts[i])
+		{
+			printf("[Shaders] %s: binding (set %u, binding %u) changed, restart to pick it up\n", name, before.bindings[i] >> 16,
+			    before.bindings[i] & 0xffff);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void compile_job(void* data)
+{
+	ShaderCompile* c = (ShaderCompile*)data;
+	char tmp[SHADER_RELOAD_PATH_MAX + 8];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", c->spv);
+	char* argv[] = {"glslc", "--target-env=vulkan1.3", c->source, "-o", tmp, NULL}; // as build.sh and nob.c
+	pid_t pid;
+	if (posix_spawnp(&pid, "glslc", NULL, NULL, argv, environ) != 0)
+	{
+		printf("[Shaders] glslc not found, can't reload %s\n", c->source);
+		return;
+	}
+	int status = 0;
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		// glslc printed the errors; the old module stays in use
+		remove(tmp);
+		return;
+	}
+	if (!interface_matches(c->spv, tmp, c->source) || rename(tmp, c->spv) != 0)
+	{
+		remove(tmp);
+		return;
+	}
+	c->ok = true;
+}
+
+static bool is_shader_source(const char* name)
+{
+	const char* dot = strrchr(name, '.');
+	if (!dot)
+		return false;
+	return strcmp(dot, ".vert") == 0 || strcmp(dot, ".frag") == 0 || strcmp(dot, ".comp") == 0 ||
+	       strcmp(dot, ".geom") == 0 || strcmp(dot, ".tesc") == 0 || strcmp(dot, ".tese") == 0;
+}
+
+static bool is_shader_include(const char* name)
+{
+	const char* dot = strrchr(name, '.');
+	return dot && strcmp(dot, ".glsl") == 0;
+}
+
+void shader_reload_init(ShaderReload* reload, PipelineManager* pipelines, const char* sourceDir, const char* spvDir)
+{
+	memset(reload, 0, sizeof(*reload));
+	reload->pipelines = pipelines;
+	snprintf(reload->sourceDir, sizeof(reload->sourceDir), "%s", sourceDir);
+	snprintf(reload->spvDir, sizeof(reload->spvDir), "%s", spvDir);
+	reload->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// editors either write in place or write elsewhere and rename over the file
+	if (reload->fd >= 0 && inotify_add_watch(reload->fd, sourceDir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(reload->fd);
+		reload->fd = -1;
+	}
+	if (reload->fd >= 0)
+		printf("[Shaders] watching %s/ for changes\n", sourceDir);
+	else
+		printf("[Shaders] can't watch %s/, hot reload disabled\n", sourceDir);
+}
+
+void shader_reload_destroy(ShaderReload* reload)
+{
+	job_wait(&reload->compiling);
+	if (reload->fd >= 0)
+		close(reload->fd);
+	reload->fd = -1;
+	free(reload->pending);
+	free(reload->batch);
+	reload->pending = NULL;
+	reload->batch = NULL;
+	reload->pendingCount = reload->pendingCapacity = 0;
+	reload->batchCount = reload->batchCapacity = 0;
+}
+
+static void add_pending(ShaderReload* reload, const char* name)
+{
+	for (u32 i = 0; i < reload->pendingCount; ++i)
+	{
+		if (strcmp(reload->pending[i], name) == 0)
+			return;
+	}
+	if (strlen(name) >= sizeof(reload->pending[0]))
+	{
+		printf("[Shaders] %s: name longer than %u characters, not reloaded\n", name, SHADER_RELOAD_NAME_MAX - 1);
+		return;
+	}
+	if (reload->pendingCount == reload->pendingCapacity)
+	{
+		u32 capacity = MAX(reload->pendingCapacity * 2, 16u);
+		void* grown = realloc(reload->pending, capacity * sizeof(reload->pending[0]));
+		if (!grown)
+		{
+			printf("[Shaders] out of memory queueing %s, not reloaded\n", name);
+			return;
+		}
+		reload->pending = grown;
+		reload->pendingCapacity = capacity;
+	}
+	snprintf(reload->pending[reload->pendingCount++], sizeof(reload->pending[0]), "%s", name);
+}
+
+// A shared .glsl has no .spv of its own: recompile every source that names it in an #include
+static void add_includers(ShaderReload* reload, const char* include)
+{
+	DIR* dir = opendir(reload->sourceDir);
+	if (!dir)
+		return;
+	char quoted[SHADER_RELOAD_NAME_MAX + 2];
+	snprintf(quoted, sizeof(quoted), "\"%s\"", include);
+	for (struct dirent* entry; (entry = readdir(dir));)
+	{
+		if (!is_shader_source(entry->d_name))
+			continue;
+		char path[SHADER_RELOAD_PATH_MAX * 2];
+		snprintf(path, sizeof(path), "%s/%s", reload->sourceDir, entry->d_name);
+		MappedFile file = {0};
+		if (!map_file(path, &file))
+			continue;
+		size_t length = strlen(quoted);
+		for (size_t i = 0; i + length <= file.size; ++i)
+		{
+			if (memcmp(file.data + i, quoted, length) == 0)
+			{
+				add_pending(reload, entry->d_name);
+				break;
+			}
+		}
+		unmap_file(&file);
+	}
+	closedir(dir);
+}
+
+void shader_reload_poll(ShaderReload* reload)
+{
+	if (reload->fd < 0)
+		return;
+
+	union
+	{
+		struct inotify_event event; // alignment
+		char bytes[4096];
+	} buffer;
+	for (;;)
+	{
+		ssize_t length = read(reload->fd, buffer.bytes, sizeof(buffer.bytes));
+		if (length <= 0)
+			break;
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const struct inotify_event* event = (const struct inotify_event*)(buffer.bytes + offset);
+			if (event->len > 0 && is_shader_source(event->name))
+				add_pending(reload, event->name);
+			else if (event->len > 0 && is_shader_include(event->name))
+				add_includers(reload, event->name);
+			offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+		}
+	}
+
+	if (reload->batchCount > 0)
+	{
+		if (!job_done(&reload->compiling))
+			return;
+		for (u32 i = 0; i < reload->batchCount; ++i)
+		{
+			if (!reload->batch[i].ok)
+				continue;
+			shader_archive_override(reload->batch[i].spv); // the archive still holds the old module
+			u32 rebuilt = pipeline_reload_shader(reload->pipelines, reload->batch[i].spv);
+			printf("[Shaders] %s reloaded, %u pipeline%s rebuilding\n", reload->batch[i].source, rebuilt, rebuilt == 1 ? "" : "s");
+		}
+		reload->batchCount = 0;
+	}
+
+	if (reload->pendingCount > reload->batchCapacity)
+	{
+		// nothing is in flight: the jobs of the last batch hold pointers into it
+		ShaderCompile* grown = realloc(reload->batch, reload->pendingCapacity * sizeof(ShaderCompile));
+		if (!grown)
+		{
+			printf("[Shaders] out of memory starting %u compiles, retrying next frame\n", reload->pendingCount);
+			return;
+		}
+		reload->batch = grown;
+		reload->batchCapacity = reload->pendingCapacity;
+	}
+	for (u32 i = 0; i < reload->pendingCount; ++i)
+	{
+		ShaderCompile* c = &reload->batch[reload->batchCount++];
+		memset(c, 0, sizeof(*c));
+		snprintf(c->source, sizeof(c->source), "%s/%s", reload->sourceDir, reload->pending[i]);
+		snprintf(c->spv, sizeof(c->spv), "%s/%s.spv", reload->spvDir, reload->pending[i]); // as build.sh / nob.c name it
+	}
+	reload->pendingCount = 0;
+	for (u32 i = 0; i < reload->batchCount; ++i)
+		job_run(compile_job, &reload->batch[i], &reload->compiling);
+}
+
+#else
+
+void shader_reload_init(ShaderReload* reload, PipelineManager* pipelines, const char* sourceDir, const char* spvDir)
+{
+	(void)spvDir;
+	memset(reload, 0, sizeof(*reload));
+	reload->pipelines = pipelines;
+	reload->fd = -1;
+	printf("[Shaders] hot reload needs inotify, not watching %s/\n", sourceDir);
+}
+
+void shader_reload_destroy(ShaderReload* reload)
+{
+	(void)reload;
+}
+
+void shader_reload_poll(ShaderReload* reload)
+{
+	(void)reload;
+}
+
+#endif
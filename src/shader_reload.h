@@ -0,0 +1,56 @@
+#ifndef SHADER_RELOAD_H
+#define SHADER_RELOAD_H
+
+#include "pipeline_manager.h"
+
+// Shader hot reload: edit a file in shaders/ and the pipelines using it are rebuilt while running
+// - inotify on the source directory, drained without blocking once per frame (Linux only; the
+//   watcher is a no-op elsewhere)
+// - each changed source is compiled by a glslc subprocess in its own job, to a temporary file
+//   next to its .spv, so a failed compile never touches the file the pipelines load
+// - the new SPIR-V is reflected and its descriptor bindings and push constant size compared
+//   with the .spv it replaces: the pipeline layouts are built by hand, so an interface change
+//   is reported and waits for a restart
+// - accepted modules replace their .spv and pipeline_reload_shader rebuilds the pipelines,
+//   which pipeline_manager_update swaps in at the next frame boundary
+// - a changed .glsl (shared code, no .spv of its own) queues every source that #includes it
+// - the changed and in flight lists grow as needed: saving every shader at once (a git checkout,
+//   a search and replace) queues them all instead of dropping the overflow
+
+#define SHADER_RELOAD_PATH_MAX 256
+#define SHADER_RELOAD_NAME_MAX 64
+
+typedef struct ShaderCompile
+{
+	char source[SHADER_RELOAD_PATH_MAX];
+	char spv[SHADER_RELOAD_PATH_MAX];
+	bool ok; // the .spv was replaced
+} ShaderCompile;
+
+typedef struct ShaderReload
+{
+	PipelineManager* pipelines;
+	char sourceDir[SHADER_RELOAD_PATH_MAX];
+	char spvDir[SHADER_RELOAD_PATH_MAX];
+	int fd; // inotify, -1 when not watching
+
+	// changed since the batch in flight started (file names)
+	char (*pending)[SHADER_RELOAD_NAME_MAX];
+	u32 pendingCount;
+	u32 pendingCapacity;
+	ShaderCompile* batch; // only reallocated while no compile is in flight
+	u32 batchCount;
+	u32 batchCapacity;
+	JobCounter compiling;
+} ShaderReload;
+
+// sourceDir: the .vert/.frag/.comp/... files; spvDir: where their <name>.spv live
+void shader_reload_init(ShaderReload* reload, PipelineManager* pipelines, const char* sourceDir, const char* spvDir);
+// Waits for the compiles in flight and frees the lists
+void shader_reload_destroy(ShaderReload* reload);
+
+// Main thread, once per frame before pipeline_manager_update: picks up changed files, starts
+// their compiles, and hands finished ones to the pipeline manager
+void shader_reload_poll(ShaderReload* reload);
+
+#endif // SHADER_RELOAD_H
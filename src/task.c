@@ -0,0 +1,382 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime, nanosleep
+#include "task.h"
+#include "task_zpl.h"
+#include "bvh.h"
+#include "texture.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../external/stb/stb_image_write.h"
+
+static TaskBackend taskBackend = TASK_BACKEND_NATIVE;
+static u32 taskWorkers; // zpl: its worker threads, the main thread only dispatches
+
+void task_system_init(TaskBackend backend, u32 workerCount)
+{
+	if (workerCount == 0)
+		workerCount = (u32)MAX(sysconf(_SC_NPROCESSORS_ONLN) - 1, 1L);
+	workerCount = MIN(workerCount, (u32)JOB_MAX_WORKERS);
+	taskBackend = backend;
+	if (backend == TASK_BACKEND_ZPL)
+	{
+		taskWorkers = workerCount;
+		task_zpl_init(workerCount);
+		printf("[Task] zpl jobs: %u worker threads\n", workerCount);
+	}
+	else
+	{
+		job_system_init(workerCount);
+	}
+}
+
+void task_system_shutdown(void)
+{
+	if (taskBackend == TASK_BACKEND_ZPL)
+		task_zpl_shutdown();
+	else
+		job_system_shutdown();
+	// back to running everything inline
+	taskBackend = TASK_BACKEND_NATIVE;
+	taskWorkers = 0;
+}
+
+TaskBackend task_backend(void)
+{
+	return taskBackend;
+}
+
+const char* task_backend_name(TaskBackend backend)
+{
+	static const char* names[TASK_BACKEND_COUNT] = {"native", "zpl"};
+	return backend < TASK_BACKEND_COUNT ? names[backend] : "unknown";
+}
+
+u32 task_thread_count(void)
+{
+	return taskBackend == TASK_BACKEND_ZPL ? taskWorkers : job_thread_count();
+}
+
+void task_submit(TaskFunc func, void* data, TaskGroup* group)
+{
+	if (taskBackend == TASK_BACKEND_ZPL)
+		task_zpl_submit(func, data, &group->counter.pending);
+	else
+		job_run(func, data, &group->counter);
+}
+
+bool task_done(const TaskGroup* group)
+{
+	return job_done(&group->counter);
+}
+
+void task_wait(TaskGroup* group)
+{
+	if (taskBackend == TASK_BACKEND_NATIVE)
+	{
+		job_wait(&group->counter);
+		return;
+	}
+	while (!job_done(&group->counter))
+		task_zpl_process();
+}
+
+void task_poll(void)
+{
+	if (taskBackend == TASK_BACKEND_ZPL)
+		task_zpl_process();
+}
+
+// --- Parallel for ---
+
+// Same scheme as job_parallel_for: helpers and the caller pull batches from a shared cursor
+typedef struct TaskRange
+{
+	JobRangeFunc func;
+	void* data;
+	u32 count;
+	u32 batchSize;
+	volatile c89atomic_uint32 next;
+} TaskRange;
+
+static void task_range(void* arg)
+{
+	TaskRange* range = (TaskRange*)arg;
+	for (;;)
+	{
+		u32 begin = c89atomic_fetch_add_32(&range->next, range->batchSize);
+		if (begin >= range->count)
+			break;
+		range->func(range->data, begin, MIN(begin + range->batchSize, range->count));
+	}
+}
+
+void task_parallel_for(u32 count, u32 batchSize, JobRangeFunc func, void* data)
+{
+	if (taskBackend == TASK_BACKEND_NATIVE)
+	{
+		job_parallel_for(count, batchSize, func, data);
+		return;
+	}
+	if (count == 0)
+		return;
+	if (batchSize == 0)
+		batchSize = MAX(count / ((taskWorkers + 1) * 8), 1u);
+
+	TaskRange range = {.func = func, .data = data, .count = count, .batchSize = batchSize, .next = 0};
+	u32 batches = (count + batchSize - 1) / batchSize;
+	u32 helpers = MIN(taskWorkers, batches - 1);
+	TaskGroup group = {0};
+	for (u32 i = 0; i < helpers; ++i)
+		task_submit(task_range, &range, &group);
+	task_range(&range);
+	task_wait(&group);
+}
+
+// --- Benchmark ---
+
+typedef struct TaskBenchResult
+{
+	double emptyNs;      // per task, submitted in rounds of 1024 and waited on
+	double hotUs[2];     // submit to start, back to back: p50, p99
+	double coldUs[2];    // submit to start after 1 ms idle: p50, p99
+	double bvhMs;        // per parallel build
+	double decodeMs;     // per burst of texture decodes
+	bool ok;
+} TaskBenchResult;
+
+static void empty_task(void* data)
+{
+	(void)data;
+}
+
+typedef struct LatencyProbe
+{
+	volatile c89atomic_uint32 started;
+	double startMs;
+} LatencyProbe;
+
+static void latency_task(void* data)
+{
+	LatencyProbe* probe = (LatencyProbe*)data;
+	probe->startMs = now_ms();
+	c89atomic_store_explicit_32(&probe->started, 1, c89atomic_memory_order_release);
+}
+
+static int compare_double(const void* a, const void* b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// p50 and p99 of how long a lone task waits for a worker. The main thread spins without
+// helping, so a worker has to pick it up.
+static void measure_latency(u32 samples, bool idleFirst, double out[2])
+{
+	double* us = malloc(samples * sizeof(double));
+	for (u32 i = 0; i < samples; ++i)
+	{
+		if (idleFirst)
+			nanosleep(&(struct timespec){0, 1000000}, NULL); // long enough for workers to go to sleep
+		LatencyProbe probe = {0};
+		TaskGroup group = {0};
+		double submitted = now_ms();
+		task_submit(latency_task, &probe, &group);
+		while (!c89atomic_load_explicit_32(&probe.started, c89atomic_memory_order_acquire))
+			task_poll();
+		task_wait(&group);
+		us[i] = (probe.startMs - submitted) * 1e3;
+	}
+	qsort(us, samples, sizeof(double), compare_double);
+	out[0] = us[samples / 2];
+	out[1] = us[MIN(samples * 99 / 100, samples - 1)];
+	free(us);
+}
+
+// The engine's own task work, prepared once and run on both backends
+typedef struct TaskBenchInputs
+{
+	// BVH build over the --bench-bvh mesh; the parallel build must match the serial one exactly
+	float* positions;
+	u32* indices;
+	u32 triangleCount;
+	Bvh reference;
+	// PNGs for the texture streamer's decode task, with the hash of each one's decoded mip chain
+	char (*pngPaths)[256];
+	u64* pngHashes;
+	u32 pngCount;
+	u64 decodedBytes;
+} TaskBenchInputs;
+
+typedef struct BenchDecode
+{
+	Texture texture;
+	bool ok;
+} BenchDecode;
+
+static void decode_png(void* data)
+{
+	BenchDecode* decode = (BenchDecode*)data;
+	decode->ok = texture_decode_image(&decode->texture);
+}
+
+static u64 decoded_hash(const Texture* tex)
+{
+	u64 h = FNV1A64_OFFSET;
+	for (u32 m = 0; m < tex->mipCount; ++m)
+		h = fnv1a64_append(h, tex->mipData[m], tex->mipBytes[m]);
+	return h;
+}
+
+static bool bvh_equal(const Bvh* a, const Bvh* b)
+{
+	return a->nodeCount == b->nodeCount && a->triangleCount == b->triangleCount &&
+	       memcmp(a->nodes, b->nodes, a->nodeCount * sizeof(BvhNode)) == 0 &&
+	       memcmp(a->triangles, b->triangles, a->triangleCount * sizeof(BvhTriangle)) == 0;
+}
+
+// Sizes 64 to 1024 (log-uniform, many small, a few big): a gradient with noise in the low bits,
+// so deflate has real work on both sides
+static bool prepare_inputs(TaskBenchInputs* in)
+{
+	memset(in, 0, sizeof(*in));
+	in->triangleCount = bvh_bench_mesh_create(1u << 20, &in->positions, &in->indices);
+	bvh_build(&in->reference, in->positions, in->indices, in->triangleCount, false);
+
+	const char* dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+	in->pngCount = 64;
+	in->pngPaths = malloc(in->pngCount * sizeof(in->pngPaths[0]));
+	in->pngHashes = malloc(in->pngCount * sizeof(u64));
+	u32 rng = 12345;
+	bool ok = true;
+	for (u32 i = 0; i < in->pngCount; ++i)
+	{
+		rng = rng * 1664525u + 1013904223u;
+		u32 size = (u32)(64.0 * pow(16.0, (double)(rng >> 8) / (double)(1u << 24)));
+		u8* pixels = malloc((size_t)size * size * 4);
+		for (u32 p = 0; p < size * size; ++p)
+		{
+			rng = rng * 1664525u + 1013904223u;
+			u32 x = p % size, y = p / size;
+			pixels[p * 4 + 0] = (u8)(x * 255 / size) ^ (u8)(rng >> 29);
+			pixels[p * 4 + 1] = (u8)(y * 255 / size) ^ (u8)(rng >> 26 & 7);
+			pixels[p * 4 + 2] = (u8)((x + y) * 127 / size);
+			pixels[p * 4 + 3] = 255;
+		}
+		snprintf(in->pngPaths[i], sizeof(in->pngPaths[i]), "%s/task_bench_%d_%u.png", dir, (int)getpid(), i);
+		ok = ok && stbi_write_png(in->pngPaths[i], (int)size, (int)size, 4, pixels, (int)size * 4);
+		free(pixels);
+
+		BenchDecode decode = {0};
+		snprintf(decode.texture.path, sizeof(decode.texture.path), "%s", in->pngPaths[i]);
+		decode_png(&decode);
+		ok = ok && decode.ok;
+		in->pngHashes[i] = decode.ok ? decoded_hash(&decode.texture) : 0;
+		for (u32 m = 0; m < decode.texture.mipCount; ++m)
+			in->decodedBytes += decode.texture.mipBytes[m];
+		free(decode.texture.decoded);
+	}
+	if (!ok)
+		printf("[Task] could not write and decode the benchmark PNGs in %s\n", dir);
+	return ok;
+}
+
+static void free_inputs(TaskBenchInputs* in)
+{
+	for (u32 i = 0; i < in->pngCount; ++i)
+		remove(in->pngPaths[i]);
+	free(in->pngPaths);
+	free(in->pngHashes);
+	bvh_destroy(&in->reference);
+	free(in->positions);
+	free(in->indices);
+}
+
+static TaskBenchResult run_backend(TaskBackend backend, u32 workerCount, const TaskBenchInputs* in)
+{
+	TaskBenchResult result = {.ok = true};
+	task_system_init(backend, workerCount);
+	const char* name = task_backend_name(backend);
+
+	// 1. empty tasks: pure submit + dispatch + completion cost
+	const u32 rounds = 1000, perRound = 1024;
+	double t0 = now_ms();
+	for (u32 r = 0; r < rounds; ++r)
+	{
+		TaskGroup group = {0};
+		for (u32 i = 0; i < perRound; ++i)
+			task_submit(empty_task, NULL, &group);
+		task_wait(&group);
+	}
+	result.emptyNs = (now_ms() - t0) * 1e6 / (rounds * perRound);
+	printf("[Task] %s: empty %.0f ns/task, %.1f M tasks/s\n", name, result.emptyNs, 1e3 / result.emptyNs);
+
+	// 2. latency, with the workers busy spinning and after they went idle
+	measure_latency(2000, false, result.hotUs);
+	measure_latency(500, true, result.coldUs);
+	printf("[Task] %s: submit to start %.1f / %.1f us hot, %.1f / %.1f us after idle (p50 / p99)\n", name, result.hotUs[0], result.hotUs[1],
+	    result.coldUs[0], result.coldUs[1]);
+
+	// 3. scene work: bvh_build's subtrees, from the calling thread like pathtracer_init does
+	const u32 buildRounds = 4;
+	t0 = now_ms();
+	for (u32 r = 0; r < buildRounds; ++r)
+	{
+		Bvh bvh;
+		bvh_build(&bvh, in->positions, in->indices, in->triangleCount, true);
+		result.ok = result.ok && bvh_equal(&bvh, &in->reference);
+		bvh_destroy(&bvh);
+	}
+	result.bvhMs = (now_ms() - t0) / buildRounds;
+	printf("[Task] %s: BVH build %u triangles, %.1f ms%s\n", name, in->triangleCount, result.bvhMs, result.ok ? "" : " MISMATCH");
+
+	// 4. asset loading: one texture decode task per PNG, submitted in one burst like a level load
+	const u32 decodeRounds = 4;
+	BenchDecode* decodes = calloc(in->pngCount, sizeof(BenchDecode));
+	double decodeMs = 0.0;
+	for (u32 r = 0; r < decodeRounds; ++r)
+	{
+		for (u32 i = 0; i < in->pngCount; ++i)
+		{
+			memset(&decodes[i], 0, sizeof(decodes[i]));
+			snprintf(decodes[i].texture.path, sizeof(decodes[i].texture.path), "%s", in->pngPaths[i]);
+		}
+		TaskGroup group = {0};
+		t0 = now_ms();
+		for (u32 i = 0; i < in->pngCount; ++i)
+			task_submit(decode_png, &decodes[i], &group);
+		task_wait(&group);
+		decodeMs += now_ms() - t0;
+		for (u32 i = 0; i < in->pngCount; ++i)
+		{
+			result.ok = result.ok && decodes[i].ok && decoded_hash(&decodes[i].texture) == in->pngHashes[i];
+			free(decodes[i].texture.decoded);
+		}
+	}
+	free(decodes);
+	result.decodeMs = decodeMs / decodeRounds;
+	printf("[Task] %s: %u PNG decodes + mips (%.1f MiB out) in %.2f ms%s\n", name, in->pngCount, (double)in->decodedBytes / (1 << 20),
+	    result.decodeMs, result.ok ? "" : " MISMATCH");
+
+	task_system_shutdown();
+	return result;
+}
+
+int task_benchmark(u32 workerCount)
+{
+	TaskBenchInputs inputs;
+	bool prepared = prepare_inputs(&inputs);
+	TaskBenchResult results[TASK_BACKEND_COUNT];
+	for (u32 b = 0; prepared && b < TASK_BACKEND_COUNT; ++b)
+		results[b] = run_backend((TaskBackend)b, workerCount, &inputs);
+	free_inputs(&inputs);
+	if (!prepared)
+		return 1;
+
+	const TaskBenchResult* n = &results[TASK_BACKEND_NATIVE];
+	const TaskBenchResult* z = &results[TASK_BACKEND_ZPL];
+	printf("[Task] zpl relative to native (>1: zpl slower): empty %.2fx, latency %.2fx hot / %.2fx idle, BVH build %.2fx, texture decode %.2fx\n",
+	    z->emptyNs / n->emptyNs, z->hotUs[0] / MAX(n->hotUs[0], 1e-3), z->coldUs[0] / MAX(n->coldUs[0], 1e-3), z->bvhMs / n->bvhMs,
+	    z->decodeMs / n->decodeMs);
+	return n->ok && z->ok ? 0 : 1;
+}
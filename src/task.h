@@ -0,0 +1,56 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "job.h"
+
+// Task API: submit / wait / parallel for over one of two thread pools, picked at init
+// - TASK_BACKEND_NATIVE is the job system (job.h): pthread workers with work-stealing deques,
+//   the waiting thread runs tasks too, and tasks may submit and wait on children
+// - TASK_BACKEND_ZPL is zpl's job system (external/zpl, task_zpl.c): one queue that the
+//   submitting thread hands out to idle workers; submit, wait and poll from the main thread only
+// - a TaskGroup counts its unfinished tasks; task_wait returns when it reaches zero, helping
+//   (native) or dispatching (zpl) meanwhile
+// - the engine's task-parallel work goes through this API: texture decodes (texture.c) and the
+//   BVH build's subtrees (bvh.c)
+// - --bench-tasks runs those same paths on both backends, plus scheduler overhead and latency,
+//   so the choice between them is measured rather than guessed
+
+typedef enum TaskBackend
+{
+	TASK_BACKEND_NATIVE,
+	TASK_BACKEND_ZPL,
+	TASK_BACKEND_COUNT,
+} TaskBackend;
+
+typedef void (*TaskFunc)(void* data);
+
+typedef struct TaskGroup
+{
+	JobCounter counter; // pending tasks, whichever backend runs them
+} TaskGroup;
+
+// workerCount 0 = one per core minus the main thread, at least one
+void task_system_init(TaskBackend backend, u32 workerCount);
+void task_system_shutdown(void);
+TaskBackend task_backend(void);
+const char* task_backend_name(TaskBackend backend);
+// Threads that execute tasks: the job threads (main included) for native, the workers for zpl
+u32 task_thread_count(void);
+
+// data must stay alive until the group is done; group may not be NULL
+void task_submit(TaskFunc func, void* data, TaskGroup* group);
+void task_wait(TaskGroup* group);
+bool task_done(const TaskGroup* group);
+// zpl only starts queued tasks when told to: call once per frame if tasks are left running
+// across frames. Nothing to do for the native backend.
+void task_poll(void);
+
+// Splits [0, count) into batches of batchSize (0 = picked from the thread count) and blocks
+// until all of them ran
+void task_parallel_for(u32 count, u32 batchSize, JobRangeFunc func, void* data);
+
+// Both backends on empty tasks, submit-to-start latency, a parallel BVH build and a burst of
+// PNG decodes through the texture streamer's decode path
+int task_benchmark(u32 workerCount);
+
+#endif // TASK_H
@@ -0,0 +1,88 @@
+#define ZPL_IMPL
+#define ZPL_NANO
+#define ZPL_ENABLE_THREADING
+#define ZPL_ENABLE_JOBS
+#include "../external/zpl/code/zpl.h"
+#include "task_zpl.h"
+#include <string.h>
+
+// zpl passes one pointer per job: the task, its data and its counter travel in a record. At most
+// TASK_ZPL_MAX_JOBS are queued plus one per worker handed out but not started, so twice the queue
+// limit always has a free one.
+#define TASK_ZPL_RECORDS (2 * TASK_ZPL_MAX_JOBS)
+
+typedef struct TaskZplRecord
+{
+	void (*func)(void*);
+	void* data;
+	volatile c89atomic_uint32* pending;
+	volatile c89atomic_uint32 busy; // claimed by submit, released once the worker copied it out
+} TaskZplRecord;
+
+static zpl_jobs_system taskPool;
+static TaskZplRecord taskRecords[TASK_ZPL_RECORDS];
+static uint32_t taskCursor; // submitting thread only
+static bool taskRunning;
+
+static void run_record(void* data)
+{
+	TaskZplRecord* record = (TaskZplRecord*)data;
+	void (*func)(void*) = record->func;
+	void* taskData = record->data;
+	volatile c89atomic_uint32* pending = record->pending;
+	c89atomic_store_explicit_32(&record->busy, 0, c89atomic_memory_order_release);
+	func(taskData);
+	c89atomic_fetch_sub_explicit_32(pending, 1, c89atomic_memory_order_release);
+}
+
+bool task_zpl_init(uint32_t workerCount)
+{
+	memset(taskRecords, 0, sizeof(taskRecords));
+	taskCursor = 0;
+	zpl_jobs_init_with_limit(&taskPool, zpl_heap_allocator(), workerCount, TASK_ZPL_MAX_JOBS);
+	taskRunning = true;
+	return true;
+}
+
+void task_zpl_shutdown(void)
+{
+	if (!taskRunning)
+		return;
+	while (!zpl_jobs_done(&taskPool))
+		zpl_jobs_process(&taskPool);
+	zpl_jobs_free(&taskPool);
+	taskRunning = false;
+}
+
+void task_zpl_submit(void (*func)(void*), void* data, volatile c89atomic_uint32* pending)
+{
+	c89atomic_fetch_add_32(pending, 1);
+	if (!taskRunning)
+	{
+		func(data);
+		c89atomic_fetch_sub_32(pending, 1);
+		return;
+	}
+
+	TaskZplRecord* record = &taskRecords[taskCursor++ % TASK_ZPL_RECORDS];
+	while (c89atomic_load_explicit_32(&record->busy, c89atomic_memory_order_acquire))
+		record = &taskRecords[taskCursor++ % TASK_ZPL_RECORDS];
+	record->func = func;
+	record->data = data;
+	record->pending = pending;
+	c89atomic_store_explicit_32(&record->busy, 1, c89atomic_memory_order_relaxed);
+
+	while (!zpl_jobs_enqueue(&taskPool, run_record, record))
+	{
+		zpl_jobs_process(&taskPool);
+		zpl_yield_thread();
+	}
+	// start it now if a worker is idle, rather than at the next wait
+	zpl_jobs_process(&taskPool);
+}
+
+void task_zpl_process(void)
+{
+	if (taskRunning)
+		zpl_jobs_process(&taskPool);
+}
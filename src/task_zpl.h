@@ -0,0 +1,23 @@
+#ifndef TASK_ZPL_H
+#define TASK_ZPL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../external/c89atomic/c89atomic.h"
+
+// zpl jobs backend of the task API (task.h), used by task.c only
+// - plain C types: zpl.h brings its own base types and short names, so task_zpl.c is the one
+//   translation unit that includes it and it includes nothing else from src/
+// - zpl workers only run what zpl_jobs_process hands them: the thread that submits (the main
+//   thread) has to keep calling task_zpl_process for queued tasks to start
+
+#define TASK_ZPL_MAX_JOBS 4096 // zpl's queue limit; a full queue is dispatched before enqueueing
+
+bool task_zpl_init(uint32_t workerCount);
+void task_zpl_shutdown(void);
+// Increments pending, decrements it once func returned
+void task_zpl_submit(void (*func)(void*), void* data, volatile c89atomic_uint32* pending);
+// Hands queued tasks to idle workers
+void task_zpl_process(void);
+
+#endif // TASK_ZPL_H
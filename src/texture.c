@@ -0,0 +1,640 @@
+#include "texture.h"
+#include <string.h>
+#include "../external/dds-ktx/dds-ktx.h"
+#include "../external/stb/stb_image.h"
+
+static u32 mip_dim(u32 dim, u32 mip)
+{
+	u32 d = dim >> mip;
+	return d ? d : 1;
+}
+
+static VkFormat ddsktx_to_vk_format(ddsktx_format format, bool srgb, u32* blockBytes)
+{
+	switch (format)
+	{
+	case DDSKTX_FORMAT_BC1:
+		*blockBytes = 8;
+		return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case DDSKTX_FORMAT_BC2:
+		*blockBytes = 16;
+		return srgb ? VK_FORMAT_BC2_SRGB_BLOCK : VK_FORMAT_BC2_UNORM_BLOCK;
+	case DDSKTX_FORMAT_BC3:
+		*blockBytes = 16;
+		return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case DDSKTX_FORMAT_BC4:
+		*blockBytes = 8;
+		return VK_FORMAT_BC4_UNORM_BLOCK;
+	case DDSKTX_FORMAT_BC5:
+		*blockBytes = 16;
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case DDSKTX_FORMAT_BC6H:
+		*blockBytes = 16;
+		return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+	case DDSKTX_FORMAT_BC7:
+		*blockBytes = 16;
+		return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	case DDSKTX_FORMAT_R8:
+		*blockBytes = 1;
+		return VK_FORMAT_R8_UNORM;
+	case DDSKTX_FORMAT_RG8:
+		*blockBytes = 2;
+		return VK_FORMAT_R8G8_UNORM;
+	case DDSKTX_FORMAT_RGBA8:
+		*blockBytes = 4;
+		return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	case DDSKTX_FORMAT_BGRA8:
+		*blockBytes = 4;
+		return srgb ? VK_FORMAT_B8G8R8A8_SRGB : VK_FORMAT_B8G8R8A8_UNORM;
+	case DDSKTX_FORMAT_R16:
+		*blockBytes = 2;
+		return VK_FORMAT_R16_UNORM;
+	case DDSKTX_FORMAT_RG16:
+		*blockBytes = 4;
+		return VK_FORMAT_R16G16_UNORM;
+	case DDSKTX_FORMAT_RGBA16:
+		*blockBytes = 8;
+		return VK_FORMAT_R16G16B16A16_UNORM;
+	case DDSKTX_FORMAT_R16F:
+		*blockBytes = 2;
+		return VK_FORMAT_R16_SFLOAT;
+	case DDSKTX_FORMAT_RG16F:
+		*blockBytes = 4;
+		return VK_FORMAT_R16G16_SFLOAT;
+	case DDSKTX_FORMAT_RGBA16F:
+		*blockBytes = 8;
+		return VK_FORMAT_R16G16B16A16_SFLOAT;
+	case DDSKTX_FORMAT_R32F:
+		*blockBytes = 4;
+		return VK_FORMAT_R32_SFLOAT;
+	case DDSKTX_FORMAT_RGB10A2:
+		*blockBytes = 4;
+		return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+	case DDSKTX_FORMAT_RG11B10F:
+		*blockBytes = 4;
+		return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+	default:
+		*blockBytes = 0;
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+static bool has_extension(const char* path, const char* ext)
+{
+	const char* dot = strrchr(path, '.');
+	if (!dot)
+		return false;
+	for (; *dot && *ext; ++dot, ++ext)
+	{
+		char c = *dot;
+		if (c >= 'A' && c <= 'Z')
+			c = (char)(c - 'A' + 'a');
+		if (c != *ext)
+			return false;
+	}
+	return *dot == 0 && *ext == 0;
+}
+
+// --- Container path: parse in place, mip pointers reference the mapping ---
+
+static bool parse_container(Texture* tex)
+{
+	if (!map_file(tex->path, &tex->file))
+		return false;
+
+	ddsktx_texture_info info = {0};
+	ddsktx_error err = {0};
+	if (!ddsktx_parse(&info, tex->file.data, (int)tex->file.size, &err))
+	{
+		fprintf(stderr, "[Texture] %s: %s\n", tex->path, err.msg);
+		return false;
+	}
+	if (info.flags & (DDSKTX_TEXTURE_FLAG_CUBEMAP | DDSKTX_TEXTURE_FLAG_VOLUME))
+	{
+		fprintf(stderr, "[Texture] %s: only 2D textures are streamed\n", tex->path);
+		return false;
+	}
+
+	tex->format = ddsktx_to_vk_format(info.format, (info.flags & DDSKTX_TEXTURE_FLAG_SRGB) != 0, &tex->blockBytes);
+	if (tex->format == VK_FORMAT_UNDEFINED)
+	{
+		fprintf(stderr, "[Texture] %s: unsupported format %s\n", tex->path, ddsktx_format_str(info.format));
+		return false;
+	}
+
+	tex->width = (u32)info.width;
+	tex->height = (u32)info.height;
+	tex->mipCount = MIN((u32)info.num_mips, TEXTURE_MAX_MIPS);
+	for (u32 m = 0; m < tex->mipCount; ++m)
+	{
+		ddsktx_sub_data sub;
+		ddsktx_get_sub(&info, &sub, tex->file.data, (int)tex->file.size, 0, 0, (int)m);
+		tex->mipData[m] = (const u8*)sub.buff;
+		tex->mipBytes[m] = (u32)sub.size_bytes;
+	}
+	return true;
+}
+
+// --- Image path: stb_image decode + box filtered mips, runs as a decode task ---
+
+bool texture_decode_image(Texture* tex)
+{
+	MappedFile file;
+	if (!map_file(tex->path, &file))
+		return false;
+
+	int w = 0, h = 0, n = 0;
+	stbi_uc* pixels = stbi_load_from_memory(file.data, (int)file.size, &w, &h, &n, 4);
+	unmap_file(&file);
+	if (!pixels)
+	{
+		fprintf(stderr, "[Texture] %s: %s\n", tex->path, stbi_failure_reason());
+		return false;
+	}
+
+	tex->width = (u32)w;
+	tex->height = (u32)h;
+	tex->format = VK_FORMAT_R8G8B8A8_SRGB; // stb path is meant for color textures
+	tex->blockBytes = 4;
+
+	u32 mipCount = 1;
+	while ((tex->width >> mipCount) || (tex->height >> mipCount))
+		mipCount++;
+	tex->mipCount = MIN(mipCount, TEXTURE_MAX_MIPS);
+
+	size_t total = 0;
+	for (u32 m = 0; m < tex->mipCount; ++m)
+		total += (size_t)mip_dim(tex->width, m) * mip_dim(tex->height, m) * 4;
+
+	tex->decoded = malloc(total);
+	memcpy(tex->decoded, pixels, (size_t)w * h * 4);
+	stbi_image_free(pixels);
+
+	u8* dst = tex->decoded;
+	for (u32 m = 0; m < tex->mipCount; ++m)
+	{
+		u32 mw = mip_dim(tex->width, m);
+		u32 mh = mip_dim(tex->height, m);
+		tex->mipData[m] = dst;
+		tex->mipBytes[m] = mw * mh * 4;
+
+		if (m > 0)
+		{
+			// 2x2 box from the previous level, edges clamp for odd sizes
+			const u8* src = tex->mipData[m - 1];
+			u32 pw = mip_dim(tex->width, m - 1);
+			u32 ph = mip_dim(tex->height, m - 1);
+			for (u32 y = 0; y < mh; ++y)
+			{
+				u32 y0 = MIN(y * 2, ph - 1), y1 = MIN(y * 2 + 1, ph - 1);
+				for (u32 x = 0; x < mw; ++x)
+				{
+					u32 x0 = MIN(x * 2, pw - 1), x1 = MIN(x * 2 + 1, pw - 1);
+					for (u32 c = 0; c < 4; ++c)
+					{
+						u32 sum = src[(y0 * pw + x0) * 4 + c] + src[(y0 * pw + x1) * 4 + c] +
+						          src[(y1 * pw + x0) * 4 + c] + src[(y1 * pw + x1) * 4 + c];
+						dst[(y * mw + x) * 4 + c] = (u8)((sum + 2) / 4);
+					}
+				}
+			}
+		}
+		dst += tex->mipBytes[m];
+	}
+	tex->residentMip = tex->mipCount;
+	return true;
+}
+
+static void decode_task(void* arg)
+{
+	TextureDecodeTask* task = (TextureDecodeTask*)arg;
+	TextureStreamer* ts = task->streamer;
+	Texture* tex = &ts->textures[task->handle];
+	bool ok = texture_decode_image(tex);
+
+	pthread_mutex_lock(&ts->mutex);
+	tex->state = ok ? TEXTURE_STATE_READY : TEXTURE_STATE_FAILED;
+	pthread_mutex_unlock(&ts->mutex);
+}
+
+// --- GPU side ---
+
+static void stage_barrier(VkCommandBuffer cmd, VkImage image,
+    VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkImageLayout oldLayout,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess, VkImageLayout newLayout)
+{
+	VkImageMemoryBarrier2 barrier = imageBarrier(image, srcStage, srcAccess, oldLayout, dstStage, dstAccess, newLayout,
+	    VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
+	pipelineBarrier(cmd, 0, 0, NULL, 1, &barrier);
+}
+
+#define TEXTURE_SAMPLE_STAGES (VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+
+static bool staging_alloc(TextureStreamer* ts, u64 size, u64* outOffset)
+{
+	u64 aligned = (ts->stagingHead + 15) & ~(u64)15; // BC blocks need 16 byte aligned offsets
+	if (aligned + size > ts->config.stagingBytesPerFrame)
+		return false;
+	*outOffset = ts->stagingBase + aligned;
+	ts->stagingHead = aligned + size;
+	return true;
+}
+
+static u64 levels_bytes(const Texture* tex, u32 first)
+{
+	u64 bytes = 0;
+	for (u32 m = first; m < tex->mipCount; ++m)
+		bytes += tex->mipBytes[m];
+	return bytes;
+}
+
+static u32 tail_base_mip(const TextureStreamer* ts, const Texture* tex)
+{
+	for (u32 m = 0; m < tex->mipCount; ++m)
+	{
+		if (MAX(mip_dim(tex->width, m), mip_dim(tex->height, m)) <= ts->config.tailMaxDim)
+			return m;
+	}
+	return tex->mipCount - 1;
+}
+
+static VkResult create_texture_image(TextureStreamer* ts, const Texture* tex, u32 baseMip,
+    VkImage* image, VmaAllocation* allocation, VkImageView* view, u64* bytes)
+{
+	VkImageCreateInfo imgInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+	    .imageType = VK_IMAGE_TYPE_2D,
+	    .format = tex->format,
+	    .extent = {mip_dim(tex->width, baseMip), mip_dim(tex->height, baseMip), 1},
+	    .mipLevels = tex->mipCount - baseMip,
+	    .arrayLayers = 1,
+	    .samples = VK_SAMPLE_COUNT_1_BIT,
+	    .tiling = VK_IMAGE_TILING_OPTIMAL,
+	    .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+	};
+	VmaAllocationCreateInfo allocInfo = {
+	    .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+	    // fail instead of silently spilling past the budget, the streamer handles it
+	    .flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT,
+	};
+
+	VmaAllocationInfo info;
+	VkResult res = vmaCreateImage(ts->allocator, &imgInfo, &allocInfo, image, allocation, &info);
+	if (res != VK_SUCCESS)
+		return res;
+
+	*view = createImageView(ts->device, *image, tex->format, VK_IMAGE_VIEW_TYPE_2D, 0, imgInfo.mipLevels, 0, 1);
+	*bytes = info.size;
+	return VK_SUCCESS;
+}
+
+static void retire_image(TextureStreamer* ts, VkImage image, VkImageView view, VmaAllocation allocation)
+{
+	if (ts->retiredCount == TEXTURE_MAX_RETIRED)
+	{
+		// Should not happen with sane per-frame limits; stall rather than leak
+		vkDeviceWaitIdle(ts->device);
+		for (u32 i = 0; i < ts->retiredCount; ++i)
+		{
+			vkDestroyImageView(ts->device, ts->retired[i].view, NULL);
+			vmaDestroyImage(ts->allocator, ts->retired[i].image, ts->retired[i].allocation);
+		}
+		ts->retiredCount = 0;
+	}
+	ts->retired[ts->retiredCount++] = (RetiredImage){image, view, allocation, ts->frameNumber};
+}
+
+// Copies `level` from the CPU mip chain into mip (level - imageBase) of image via the staging slice
+static bool upload_level(TextureStreamer* ts, VkCommandBuffer cmd, const Texture* tex, VkImage image, u32 imageBase, u32 level)
+{
+	u64 offset;
+	if (!staging_alloc(ts, tex->mipBytes[level], &offset))
+		return false;
+	memcpy(ts->stagingMapped + offset, tex->mipData[level], tex->mipBytes[level]);
+
+	VkBufferImageCopy region = {
+	    .bufferOffset = offset,
+	    .imageSubresource = {
+	        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+	        .mipLevel = level - imageBase,
+	        .baseArrayLayer = 0,
+	        .layerCount = 1,
+	    },
+	    .imageExtent = {mip_dim(tex->width, level), mip_dim(tex->height, level), 1},
+	};
+	vkCmdCopyBufferToImage(cmd, ts->staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	return true;
+}
+
+static bool make_tail_resident(TextureStreamer* ts, VkCommandBuffer cmd, Texture* tex)
+{
+	u32 base = tail_base_mip(ts, tex);
+	u64 bytes = levels_bytes(tex, base);
+	u64 available = ts->config.stagingBytesPerFrame - ts->stagingHead;
+	if (bytes + 16 * (tex->mipCount - base) > available)
+		return false; // try again next frame
+
+	VkImage image;
+	VmaAllocation allocation;
+	VkImageView view;
+	u64 imageBytes;
+	if (create_texture_image(ts, tex, base, &image, &allocation, &view, &imageBytes) != VK_SUCCESS)
+		return false;
+
+	stage_barrier(cmd, image,
+	    VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+	    VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	for (u32 m = base; m < tex->mipCount; ++m)
+		upload_level(ts, cmd, tex, image, base, m);
+	stage_barrier(cmd, image,
+	    VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	    TEXTURE_SAMPLE_STAGES, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	tex->image = image;
+	tex->allocation = allocation;
+	tex->view = view;
+	tex->residentMip = base;
+	tex->residentBytes = imageBytes;
+	tex->state = TEXTURE_STATE_RESIDENT;
+	ts->residentBytes += imageBytes;
+	return true;
+}
+
+// Reallocates the image so it holds [newBase, mipCount): shared levels are copied on the GPU,
+// a newly exposed finer level comes from staging. Works for growing and shrinking by any amount.
+static bool change_resident_mip(TextureStreamer* ts, VkCommandBuffer cmd, Texture* tex, u32 newBase)
+{
+	u32 oldBase = tex->residentMip;
+	if (newBase < oldBase)
+	{
+		u64 needed = levels_bytes(tex, newBase) - levels_bytes(tex, oldBase);
+		if (needed + 16 * (oldBase - newBase) > ts->config.stagingBytesPerFrame - ts->stagingHead)
+			return false;
+	}
+
+	VkImage image;
+	VmaAllocation allocation;
+	VkImageView view;
+	u64 imageBytes;
+	if (create_texture_image(ts, tex, newBase, &image, &allocation, &view, &imageBytes) != VK_SUCCESS)
+		return false;
+
+	VkImageMemoryBarrier2 toCopy[2] = {
+	    imageBarrier(image,
+	        VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+	        VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	        VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS),
+	    imageBarrier(tex->image,
+	        TEXTURE_SAMPLE_STAGES, 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	        VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	        VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS),
+	};
+	pipelineBarrier(cmd, 0, 0, NULL, 2, toCopy);
+
+	VkImageCopy regions[TEXTURE_MAX_MIPS];
+	u32 regionCount = 0;
+	for (u32 m = MAX(oldBase, newBase); m < tex->mipCount; ++m)
+	{
+		regions[regionCount++] = (VkImageCopy){
+		    .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, m - oldBase, 0, 1},
+		    .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, m - newBase, 0, 1},
+		    .extent = {mip_dim(tex->width, m), mip_dim(tex->height, m), 1},
+		};
+	}
+	vkCmdCopyImage(cmd, tex->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions);
+
+	for (u32 m = newBase; m < oldBase; ++m)
+		upload_level(ts, cmd, tex, image, newBase, m);
+
+	stage_barrier(cmd, image,
+	    VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	    TEXTURE_SAMPLE_STAGES, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	retire_image(ts, tex->image, tex->view, tex->allocation);
+	ts->residentBytes = ts->residentBytes - tex->residentBytes + imageBytes;
+	tex->image = image;
+	tex->allocation = allocation;
+	tex->view = view;
+	tex->residentMip = newBase;
+	tex->residentBytes = imageBytes;
+	return true;
+}
+
+static u64 compute_budget(TextureStreamer* ts)
+{
+	const VkPhysicalDeviceMemoryProperties* memProps;
+	vmaGetMemoryProperties(ts->allocator, &memProps);
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(ts->allocator, budgets);
+
+	// Largest device local heap; without VK_EXT_memory_budget VMA estimates 80% of the heap size
+	u64 heapBudget = 0, heapUsage = 0;
+	for (u32 i = 0; i < memProps->memoryHeapCount; ++i)
+	{
+		if ((memProps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && budgets[i].budget > heapBudget)
+		{
+			heapBudget = budgets[i].budget;
+			heapUsage = budgets[i].usage;
+		}
+	}
+
+	u64 otherUsage = heapUsage > ts->residentBytes ? heapUsage - ts->residentBytes : 0;
+	u64 headroom = heapBudget > otherUsage ? heapBudget - otherUsage : 0;
+	u64 budget = MIN((u64)((double)heapBudget * ts->config.heapBudgetFraction), headroom);
+	if (ts->config.budgetBytes)
+		budget = MIN(budget, ts->config.budgetBytes);
+	return budget;
+}
+
+TextureStreamerConfig texture_streamer_default_config(void)
+{
+	TextureStreamerConfig config = {
+	    .budgetBytes = 0,
+	    .heapBudgetFraction = 0.5f,
+	    .stagingBytesPerFrame = 32ull * 1024 * 1024,
+	    .tailMaxDim = 64,
+	};
+	return config;
+}
+
+void texture_streamer_init(TextureStreamer* ts, const Application* app, const TextureStreamerConfig* config)
+{
+	memset(ts, 0, sizeof(*ts));
+	ts->device = app->device;
+	ts->physicalDevice = app->physicaldevice;
+	ts->allocator = app->allocator;
+	ts->memoryBudgetSupported = app->memoryBudgetSupported;
+	ts->config = config ? *config : texture_streamer_default_config();
+
+	VkBufferCreateInfo bufferInfo = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+	    .size = ts->config.stagingBytesPerFrame * MAX_FRAMES_IN_FLIGHT,
+	    .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	};
+	VmaAllocationCreateInfo allocInfo = {
+	    .usage = VMA_MEMORY_USAGE_AUTO,
+	    .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+	};
+	VmaAllocationInfo info;
+	VK_CHECK(vmaCreateBuffer(ts->allocator, &bufferInfo, &allocInfo, &ts->staging.buffer, &ts->staging.allocation, &info));
+	ts->stagingMapped = (u8*)info.pMappedData;
+
+	pthread_mutex_init(&ts->mutex, NULL);
+
+	ts->budgetBytes = compute_budget(ts);
+	printf("[Texture] Streamer ready: budget %llu MB (%s), decoding on %u %s task threads\n",
+	    (unsigned long long)(ts->budgetBytes >> 20),
+	    ts->memoryBudgetSupported ? "VK_EXT_memory_budget" : "estimated",
+	    task_thread_count(), task_backend_name(task_backend()));
+}
+
+void texture_streamer_destroy(TextureStreamer* ts)
+{
+	// decodes still in flight write into textures[], let them land first
+	task_wait(&ts->decodeGroup);
+	pthread_mutex_destroy(&ts->mutex);
+
+	for (u32 i = 0; i < ts->retiredCount; ++i)
+	{
+		vkDestroyImageView(ts->device, ts->retired[i].view, NULL);
+		vmaDestroyImage(ts->allocator, ts->retired[i].image, ts->retired[i].allocation);
+	}
+	ts->retiredCount = 0;
+
+	for (u32 i = 0; i < ts->textureCount; ++i)
+	{
+		Texture* tex = &ts->textures[i];
+		if (tex->view)
+			vkDestroyImageView(ts->device, tex->view, NULL);
+		if (tex->image)
+			vmaDestroyImage(ts->allocator, tex->image, tex->allocation);
+		unmap_file(&tex->file);
+		free(tex->decoded);
+	}
+	ts->textureCount = 0;
+
+	if (ts->staging.buffer)
+		vmaDestroyBuffer(ts->allocator, ts->staging.buffer, ts->staging.allocation);
+}
+
+TextureHandle texture_load(TextureStreamer* ts, const char* path)
+{
+	if (ts->textureCount == TEXTURE_MAX_TEXTURES)
+		return TEXTURE_INVALID_HANDLE;
+
+	TextureHandle handle = ts->textureCount;
+	Texture* tex = &ts->textures[handle];
+	memset(tex, 0, sizeof(*tex));
+	snprintf(tex->path, sizeof(tex->path), "%s", path);
+	tex->requestedMip = UINT32_MAX; // tail only until the renderer asks for more
+
+	if (has_extension(path, ".dds") || has_extension(path, ".ktx"))
+	{
+		if (!parse_container(tex))
+		{
+			unmap_file(&tex->file);
+			return TEXTURE_INVALID_HANDLE;
+		}
+		tex->state = TEXTURE_STATE_READY;
+		tex->residentMip = tex->mipCount;
+		ts->textureCount++;
+		return handle;
+	}
+
+	ts->textureCount++;
+	tex->state = TEXTURE_STATE_DECODING;
+	ts->decodeTasks[handle] = (TextureDecodeTask){.streamer = ts, .handle = handle};
+	task_submit(decode_task, &ts->decodeTasks[handle], &ts->decodeGroup);
+	return handle;
+}
+
+void texture_request_mip(TextureStreamer* ts, TextureHandle handle, u32 mip)
+{
+	if (handle >= ts->textureCount)
+		return;
+	Texture* tex = &ts->textures[handle];
+	tex->requestedMip = mip;
+	tex->lastUsedFrame = ts->frameNumber;
+}
+
+VkImageView texture_view(const TextureStreamer* ts, TextureHandle handle)
+{
+	if (handle >= ts->textureCount)
+		return VK_NULL_HANDLE;
+	return ts->textures[handle].view;
+}
+
+void texture_streamer_update(TextureStreamer* ts, VkCommandBuffer cmd, u64 frameNumber)
+{
+	ts->frameNumber = frameNumber;
+	task_poll(); // zpl hands queued decodes to its workers only when asked
+	ts->stagingBase = (frameNumber % MAX_FRAMES_IN_FLIGHT) * ts->config.stagingBytesPerFrame;
+	ts->stagingHead = 0;
+
+	// 1. Images replaced MAX_FRAMES_IN_FLIGHT frames ago are no longer referenced
+	u32 kept = 0;
+	for (u32 i = 0; i < ts->retiredCount; ++i)
+	{
+		RetiredImage* r = &ts->retired[i];
+		if (r->frame + MAX_FRAMES_IN_FLIGHT <= frameNumber)
+		{
+			vkDestroyImageView(ts->device, r->view, NULL);
+			vmaDestroyImage(ts->allocator, r->image, r->allocation);
+		}
+		else
+		{
+			ts->retired[kept++] = *r;
+		}
+	}
+	ts->retiredCount = kept;
+
+	ts->budgetBytes = compute_budget(ts);
+
+	// 2. Mip tails for everything that finished decoding/parsing (cheap, always wins)
+	pthread_mutex_lock(&ts->mutex);
+	for (u32 i = 0; i < ts->textureCount; ++i)
+	{
+		Texture* tex = &ts->textures[i];
+		if (tex->state != TEXTURE_STATE_READY)
+			continue;
+		if (!make_tail_resident(ts, cmd, tex))
+			break;
+	}
+	pthread_mutex_unlock(&ts->mutex);
+
+	// 3. Over budget: least recently used textures drop their finest level
+	while (ts->residentBytes > ts->budgetBytes)
+	{
+		Texture* victim = NULL;
+		for (u32 i = 0; i < ts->textureCount; ++i)
+		{
+			Texture* tex = &ts->textures[i];
+			if (tex->state != TEXTURE_STATE_RESIDENT || tex->residentMip >= tail_base_mip(ts, tex))
+				continue;
+			if (!victim || tex->lastUsedFrame < victim->lastUsedFrame)
+				victim = tex;
+		}
+		if (!victim || !change_resident_mip(ts, cmd, victim, victim->residentMip + 1))
+			break;
+	}
+
+	// 4. Stream one finer level for recently used textures that want more, while it fits.
+	// Growth never crosses the budget so it cannot fight with eviction.
+	for (u32 i = 0; i < ts->textureCount; ++i)
+	{
+		Texture* tex = &ts->textures[i];
+		if (tex->state != TEXTURE_STATE_RESIDENT || tex->requestedMip >= tex->residentMip)
+			continue;
+		if (tex->lastUsedFrame + MAX_FRAMES_IN_FLIGHT < frameNumber)
+			continue;
+		u32 next = tex->residentMip - 1;
+		u64 growth = levels_bytes(tex, next) - levels_bytes(tex, tex->residentMip);
+		if (ts->residentBytes + growth > ts->budgetBytes)
+			continue;
+		if (!change_resident_mip(ts, cmd, tex, next))
+			break; // staging slice exhausted for this frame
+	}
+
+	if (ts->stagingHead)
+		vmaFlushAllocation(ts->allocator, ts->staging.allocation, ts->stagingBase, ts->stagingHead);
+}
@@ -0,0 +1,136 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "main.h"
+#include "task.h"
+#include <pthread.h>
+
+// Texture streaming
+// - DDS/KTX containers are mmapped and parsed in place (dds-ktx), mip data is memcpy'd
+//   straight from the mapping into the staging ring, never into an intermediate heap copy
+// - PNG/JPEG are decoded with stb_image in tasks (task.h), mips are built there too
+// - every texture first gets its mip tail (all mips <= tailMaxDim) uploaded, finer mips are
+//   streamed one level per request as the renderer asks for them via texture_request_mip
+// - resident texture memory is kept under a budget derived from VK_EXT_memory_budget;
+//   least recently used textures drop their finest mip when we go over
+
+#define TEXTURE_MAX_TEXTURES 1024
+#define TEXTURE_MAX_MIPS 16
+#define TEXTURE_MAX_RETIRED 256
+
+typedef u32 TextureHandle;
+#define TEXTURE_INVALID_HANDLE UINT32_MAX
+
+typedef enum TextureState
+{
+	TEXTURE_STATE_EMPTY = 0,
+	TEXTURE_STATE_DECODING, // queued for / running stb_image in a task
+	TEXTURE_STATE_READY,    // all mips addressable on the CPU, nothing uploaded yet
+	TEXTURE_STATE_RESIDENT, // at least the mip tail lives on the GPU
+	TEXTURE_STATE_FAILED,
+} TextureState;
+
+typedef struct Texture
+{
+	TextureState state;
+	char path[256];
+
+	VkFormat format;
+	u32 width;
+	u32 height;
+	u32 mipCount;
+	u32 blockBytes; // bytes per 4x4 block for BC formats, bytes per texel otherwise
+
+	// CPU side mip chain, either pointing into `file` or into `decoded`
+	const u8* mipData[TEXTURE_MAX_MIPS];
+	u32 mipBytes[TEXTURE_MAX_MIPS];
+	MappedFile file;
+	u8* decoded;
+
+	// GPU side: the image only holds levels [residentMip, mipCount)
+	VkImage image;
+	VmaAllocation allocation;
+	VkImageView view;
+	u32 residentMip;  // == mipCount while nothing is resident
+	u32 requestedMip; // finest mip the renderer asked for
+	u64 residentBytes;
+	u64 lastUsedFrame;
+} Texture;
+
+typedef struct TextureStreamerConfig
+{
+	u64 budgetBytes;          // hard cap for resident textures, 0 = only use the heap budget
+	float heapBudgetFraction; // share of the device-local heap budget textures may take
+	u64 stagingBytesPerFrame; // upload bandwidth per frame (one staging slice per frame in flight)
+	u32 tailMaxDim;           // mips with max(w,h) <= this are uploaded on first residency
+} TextureStreamerConfig;
+
+typedef struct RetiredImage
+{
+	VkImage image;
+	VkImageView view;
+	VmaAllocation allocation;
+	u64 frame; // frame the image was last referenced by a command buffer
+} RetiredImage;
+
+typedef struct TextureStreamer TextureStreamer;
+
+typedef struct TextureDecodeTask
+{
+	TextureStreamer* streamer;
+	TextureHandle handle;
+} TextureDecodeTask;
+
+struct TextureStreamer
+{
+	VkDevice device;
+	VkPhysicalDevice physicalDevice;
+	VmaAllocator allocator;
+	bool memoryBudgetSupported;
+	TextureStreamerConfig config;
+
+	Texture textures[TEXTURE_MAX_TEXTURES];
+	u32 textureCount;
+
+	// Persistently mapped staging ring, one slice per frame in flight
+	AllocatedBuffer staging;
+	u8* stagingMapped;
+	u64 stagingBase; // start of this frame's slice
+	u64 stagingHead; // bytes used in this frame's slice
+
+	RetiredImage retired[TEXTURE_MAX_RETIRED];
+	u32 retiredCount;
+
+	u64 residentBytes;
+	u64 budgetBytes; // effective budget computed in the last update
+	u64 frameNumber;
+
+	// stb_image decodes in flight as tasks; mutex guards their state changes
+	TextureDecodeTask decodeTasks[TEXTURE_MAX_TEXTURES];
+	TaskGroup decodeGroup;
+	pthread_mutex_t mutex;
+};
+
+TextureStreamerConfig texture_streamer_default_config(void);
+void texture_streamer_init(TextureStreamer* ts, const Application* app, const TextureStreamerConfig* config);
+void texture_streamer_destroy(TextureStreamer* ts);
+
+// Registers a texture. .dds/.ktx are parsed immediately from a mapping, everything else is queued
+// for stb_image. Returns TEXTURE_INVALID_HANDLE if the file cannot be opened or parsed.
+TextureHandle texture_load(TextureStreamer* ts, const char* path);
+
+// The task texture_load queues for PNG/JPEG: stb_image decode of tex->path plus its box filtered
+// mip chain into tex->decoded (free it). Needs no streamer or device; --bench-tasks calls it too.
+bool texture_decode_image(Texture* tex);
+
+// Tell the streamer the finest mip worth having this frame (0 = full resolution).
+void texture_request_mip(TextureStreamer* ts, TextureHandle handle, u32 mip);
+
+// Once per frame, after the frame fence was waited on: frees retired images, refreshes the budget,
+// evicts over budget, and records this frame's uploads into cmd.
+void texture_streamer_update(TextureStreamer* ts, VkCommandBuffer cmd, u64 frameNumber);
+
+// Current view (covers only resident mips) or VK_NULL_HANDLE while nothing is resident.
+VkImageView texture_view(const TextureStreamer* ts, TextureHandle handle);
+
+#endif // TEXTURE_H
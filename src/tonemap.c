@@ -0,0 +1,245 @@
+#include "tonemap.h"
+#include <string.h>
+
+// Matches `buffer Exposure` in the tonemap shaders
+#define TONEMAP_EXPOSURE_SIZE (2 * sizeof(float) + TONEMAP_HISTOGRAM_BINS * sizeof(u32))
+
+void tonemap_init(Tonemap* tm, const Application* app, PipelineManager* pipelines, TonemapOperator tonemapper)
+{
+	memset(tm, 0, sizeof(*tm));
+	tm->device = app->device;
+	tm->allocator = app->allocator;
+	tm->app = app;
+	tm->pipelines = pipelines;
+	tm->tonemapper = tonemapper;
+	tm->peakNits = 1000.0f;
+	tm->tonemapPipeline = PIPELINE_INVALID_HANDLE;
+	tm->exposurePipeline = PIPELINE_INVALID_HANDLE;
+
+	// the shader writes BGRA and 10-bit targets, which have no GLSL format qualifier
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(app->physicaldevice, &features);
+	tm->enabled = features.shaderStorageImageWriteWithoutFormat;
+	if (!tm->enabled)
+	{
+		printf("[Tonemap] No storage writes without format, presenting the HDR image unmapped\n");
+		return;
+	}
+
+	// 0: source (sampled), 1: target (storage), 2: exposure + histogram
+	VkDescriptorSetLayoutBinding bindings[3];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		if (i == 1)
+			type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		else if (i == 2)
+			type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = type,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(tm->device, &layoutInfo, NULL, &tm->setLayout));
+
+	// one set per frame in flight, rewritten every frame for the acquired swapchain image
+	VkDescriptorPoolSize poolSizes[] = {
+	    {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = MAX_FRAMES_IN_FLIGHT},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = MAX_FRAMES_IN_FLIGHT},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = MAX_FRAMES_IN_FLIGHT},
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = MAX_FRAMES_IN_FLIGHT,
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
+	    .pPoolSizes = poolSizes,
+	};
+	VK_CHECK(vkCreateDescriptorPool(tm->device, &poolInfo, NULL, &tm->descriptorPool));
+	VkDescriptorSetLayout setLayouts[MAX_FRAMES_IN_FLIGHT];
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		setLayouts[i] = tm->setLayout;
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = tm->descriptorPool,
+	    .descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+	    .pSetLayouts = setLayouts,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(tm->device, &allocInfo, tm->sets));
+
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_NEAREST,
+	    .minFilter = VK_FILTER_NEAREST,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	};
+	VK_CHECK(vkCreateSampler(tm->device, &samplerInfo, NULL, &tm->sampler));
+
+	tm->exposure = create_buffer(tm->allocator, TONEMAP_EXPOSURE_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	    VMA_MEMORY_USAGE_GPU_ONLY);
+
+	VkPushConstantRange pcr = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(TonemapPush),
+	};
+	tm->pipelineLayout = createPipelineLayout(tm->device, &tm->setLayout, 1, &pcr, 1);
+	// the subgroup-merged histogram needs ballot in compute, which Vulkan doesn't guarantee
+	VkSubgroupFeatureFlags merge = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT;
+	bool subgroupMerge = (app->computeSubgroupOps & merge) == merge;
+	if (!subgroupMerge)
+		printf("[Tonemap] No subgroup ballot in compute, histogram uses one shared atomic per pixel\n");
+	PipelineDesc desc = {
+	    .name = "tonemap",
+	    .computeShader = subgroupMerge ? "compiledshaders/tonemap.comp.spv" : "compiledshaders/tonemap_atomic.comp.spv",
+	    .layout = tm->pipelineLayout,
+	};
+	tm->tonemapPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "tonemap_exposure";
+	desc.computeShader = "compiledshaders/tonemap_exposure.comp.spv";
+	tm->exposurePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+}
+
+void tonemap_destroy(Tonemap* tm)
+{
+	if (!tm->enabled)
+		return;
+	vmaDestroyBuffer(tm->allocator, tm->exposure.buffer, tm->exposure.allocation);
+	vkDestroySampler(tm->device, tm->sampler, NULL);
+	vkDestroyPipelineLayout(tm->device, tm->pipelineLayout, NULL);
+	vkDestroyDescriptorPool(tm->device, tm->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(tm->device, tm->setLayout, NULL);
+}
+
+VkPipelineStageFlags2 tonemap_swapchain_stage(const Tonemap* tm)
+{
+	return tm->enabled && tm->app->swapchainStorage ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+}
+
+static void exposure_barrier(Tonemap* tm, VkCommandBuffer cmd, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess)
+{
+	VkBufferMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = srcStage,
+	    .srcAccessMask = srcAccess,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = tm->exposure.buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &barrier, 0, NULL);
+}
+
+static void tonemap_execute(VkCommandBuffer cmd, void* data)
+{
+	Tonemap* tm = (Tonemap*)data;
+	if (!tm->exposureInitialized)
+	{
+		// exposure 1 and no adapted luminance yet: the first histogram is taken as is
+		const float header[2] = {1.0f, 0.0f};
+		vkCmdFillBuffer(cmd, tm->exposure.buffer, 0, VK_WHOLE_SIZE, 0);
+		VkBufferMemoryBarrier2 fillToUpdate = {
+		    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		    .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		    .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .buffer = tm->exposure.buffer,
+		    .size = VK_WHOLE_SIZE,
+		};
+		pipelineBarrier(cmd, 0, 1, &fillToUpdate, 0, NULL);
+		vkCmdUpdateBuffer(cmd, tm->exposure.buffer, 0, sizeof(header), header);
+		exposure_barrier(tm, cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+		tm->exposureInitialized = true;
+	}
+	else
+	{
+		// last frame's exposure pass wrote the exposure and cleared the histogram
+		exposure_barrier(tm, cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	}
+
+	VkDescriptorSet set = tm->sets[tm->frameIndex];
+	VkDescriptorImageInfo imageInfos[2] = {
+	    {tm->sampler, render_graph_image_view(tm->graph, tm->source), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+	    {VK_NULL_HANDLE, render_graph_image_view(tm->graph, tm->target), VK_IMAGE_LAYOUT_GENERAL},
+	};
+	VkDescriptorBufferInfo bufferInfo = {tm->exposure.buffer, 0, VK_WHOLE_SIZE};
+	VkWriteDescriptorSet writes[3] = {
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &imageInfos[0]},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 1, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &imageInfos[1]},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 2, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .pBufferInfo = &bufferInfo},
+	};
+	vkUpdateDescriptorSets(tm->device, ARRAYSIZE(writes), writes, 0, NULL);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_get(tm->pipelines, tm->tonemapPipeline));
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, tm->pipelineLayout, 0, 1, &set, 0, NULL);
+	vkCmdPushConstants(cmd, tm->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TonemapPush), &tm->push);
+	vkCmdDispatch(cmd, ((u32)tm->push.size[0] + 15) / 16, ((u32)tm->push.size[1] + 15) / 16, 1);
+
+	// the histogram is complete once every group has flushed
+	exposure_barrier(tm, cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_get(tm->pipelines, tm->exposurePipeline));
+	vkCmdDispatch(cmd, 1, 1, 1);
+}
+
+RenderGraphImage tonemap_add_pass(Tonemap* tm, RenderGraph* graph, RenderGraphImage source, RenderGraphImage swapchain, VkExtent2D extent,
+    u32 frameIndex, float deltaTime)
+{
+	if (!tm->enabled || !pipeline_get(tm->pipelines, tm->tonemapPipeline) || !pipeline_get(tm->pipelines, tm->exposurePipeline))
+		return source;
+
+	const Application* app = tm->app;
+	TonemapEncoding encoding = TONEMAP_ENCODE_LINEAR;
+	float ditherBits = 8.0f;
+	if (app->swapchainStorage)
+	{
+		encoding = app->swapchainColorSpace == VK_COLOR_SPACE_HDR10_ST2084_EXT ? TONEMAP_ENCODE_HDR10 : TONEMAP_ENCODE_SRGB;
+		if (app->swapchainFormat == VK_FORMAT_A2B10G10R10_UNORM_PACK32 || app->swapchainFormat == VK_FORMAT_A2R10G10B10_UNORM_PACK32)
+			ditherBits = 10.0f;
+	}
+
+	tm->graph = graph;
+	tm->source = source;
+	tm->frameIndex = frameIndex;
+	tm->push = (TonemapPush){
+	    .size = {(i32)extent.width, (i32)extent.height},
+	    .tonemapper = tm->tonemapper,
+	    .encoding = encoding,
+	    .minLog2Luminance = -10.0f,
+	    .log2LuminanceRange = 16.0f,
+	    .deltaTime = deltaTime,
+	    .adaptationRate = 1.5f,
+	    .paperWhiteNits = 200.0f,
+	    .peakNits = tm->peakNits,
+	    .frame = (u32)app->frameNumber,
+	    .ditherBits = ditherBits,
+	};
+
+	if (app->swapchainStorage)
+	{
+		tm->target = swapchain;
+	}
+	else
+	{
+		// the blit into the sRGB swapchain does the encoding
+		RenderGraphImageDesc desc = {VK_FORMAT_R16G16B16A16_SFLOAT, extent.width, extent.height};
+		tm->target = render_graph_create_image(graph, "tonemapped", &desc);
+	}
+	RenderGraphPass pass = render_graph_add_pass(graph, "tonemap", tonemap_execute, tm);
+	render_graph_use(graph, pass, source, RG_USAGE_COMPUTE_SAMPLED);
+	render_graph_use(graph, pass, tm->target, RG_USAGE_COMPUTE_WRITE);
+	return tm->target;
+}
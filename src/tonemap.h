@@ -0,0 +1,88 @@
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+#include "pipeline_manager.h"
+#include "render_graph.h"
+
+// Output transform from the HDR image to the swapchain, replacing the plain blit
+// - tonemap.comp reads the image once and writes the swapchain once: exposure, ACES or AgX,
+//   dither, and the encoding swapchainColorSpace asks for (sRGB curve on UNORM, PQ on HDR10)
+// - the same dispatch builds a log luminance histogram (subgroup-merged bins where compute has
+//   subgroup ballot, tonemap_atomic.comp otherwise); tonemap_exposure.comp turns it into next
+//   frame's exposure, so auto-exposure costs no extra read of the image
+// - needs a compute-writable swapchain (app->swapchainStorage). Without one the pass writes a
+//   transient image that the caller blits, letting the sRGB format do the encoding; without
+//   storage writes at all (shaderStorageImageWriteWithoutFormat) it is off and the caller blits
+//   the HDR image as before
+
+#define TONEMAP_HISTOGRAM_BINS 256
+
+typedef enum TonemapOperator
+{
+	TONEMAP_ACES = 0,
+	TONEMAP_AGX,
+} TonemapOperator;
+
+typedef enum TonemapEncoding
+{
+	TONEMAP_ENCODE_SRGB = 0,   // UNORM target, the shader applies the sRGB curve
+	TONEMAP_ENCODE_LINEAR,     // sRGB-format target, the hardware applies it
+	TONEMAP_ENCODE_HDR10,      // Rec.2020 primaries, PQ
+} TonemapEncoding;
+
+// Matches the push constant block of tonemap.glsl and tonemap_exposure.comp
+typedef struct TonemapPush
+{
+	i32 size[2];
+	u32 tonemapper;
+	u32 encoding;
+	float minLog2Luminance;
+	float log2LuminanceRange;
+	float deltaTime;
+	float adaptationRate; // 1/s
+	float paperWhiteNits;
+	float peakNits;
+	u32 frame;
+	float ditherBits;
+} TonemapPush;
+
+typedef struct Tonemap
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	const Application* app;
+	PipelineManager* pipelines;
+	PipelineHandle tonemapPipeline;
+	PipelineHandle exposurePipeline;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet sets[MAX_FRAMES_IN_FLIGHT];
+	VkSampler sampler;
+	AllocatedBuffer exposure; // exposure, adapted luminance, histogram
+	bool exposureInitialized;
+	bool enabled;
+
+	TonemapOperator tonemapper;
+	float peakNits; // HDR10 only
+
+	// this frame's graph state, referenced by the pass callback until the graph executes
+	RenderGraph* graph;
+	RenderGraphImage source;
+	RenderGraphImage target;
+	TonemapPush push;
+	u32 frameIndex;
+} Tonemap;
+
+void tonemap_init(Tonemap* tm, const Application* app, PipelineManager* pipelines, TonemapOperator tonemapper);
+void tonemap_destroy(Tonemap* tm);
+
+// Stage the swapchain image is first touched at, for the acquire semaphore wait and the import
+VkPipelineStageFlags2 tonemap_swapchain_stage(const Tonemap* tm);
+
+// Adds the output transform of source (sampled). Returns the image the caller still has to blit
+// to the swapchain, or swapchain itself when the pass wrote it directly.
+RenderGraphImage tonemap_add_pass(Tonemap* tm, RenderGraph* graph, RenderGraphImage source, RenderGraphImage swapchain, VkExtent2D extent,
+    u32 frameIndex, float deltaTime);
+
+#endif // TONEMAP_H
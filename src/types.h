@@ -1,3 +1,5 @@
+#ifndef TYPES_H
+#define TYPES_H
 
 #define VK_NO_PROTOTYPES
 #include "../external/volk/volk.h"
@@ -7,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 #define u8 uint8_t
 #define u16 uint16_t
 #define u32 uint32_t
@@ -34,6 +37,84 @@
 		b = tmp; \
 	} while (0)
 
+// FNV-1a, 64-bit. fnv1a64_append continues from a previous result, so several ranges hash as one
+#define FNV1A64_OFFSET 0xcbf29ce484222325ull
+static inline u64 fnv1a64_append(u64 h, const void* data, size_t size)
+{
+	const u8* bytes = (const u8*)data;
+	for (size_t i = 0; i < size; ++i)
+		h = (h ^ bytes[i]) * 0x100000001b3ull;
+	return h;
+}
+
+static inline u64 fnv1a64(const void* data, size_t size)
+{
+	return fnv1a64_append(FNV1A64_OFFSET, data, size);
+}
+
+// IEEE half floats, for the mesh bake's uvs and the offline path tracer's RGBA16F readback
+
+// Round to nearest even, handles subnormals, overflow goes to infinity
+static inline u16 float_to_half(float f)
+{
+	u32 x;
+	memcpy(&x, &f, sizeof(x));
+	u32 sign = (x >> 16) & 0x8000;
+	u32 absx = x & 0x7fffffff;
+
+	if (absx >= 0x7f800000) // inf / nan
+		return (u16)(sign | 0x7c00 | (absx > 0x7f800000 ? 0x200 : 0));
+	if (absx >= 0x477ff000) // >= 65520 rounds past the largest half
+		return (u16)(sign | 0x7c00);
+	if (absx < 0x38800000) // below 2^-14: half subnormal
+	{
+		if (absx < 0x33000000) // below 2^-25 rounds to zero
+			return (u16)sign;
+		u32 e = absx >> 23;
+		u32 m = (absx & 0x7fffff) | 0x800000;
+		u32 shift = 126 - e;
+		u32 h = m >> shift;
+		u32 rem = m & ((1u << shift) - 1);
+		u32 halfway = 1u << (shift - 1);
+		if (rem > halfway || (rem == halfway && (h & 1)))
+			h++;
+		return (u16)(sign | h);
+	}
+	u32 h = (absx - 0x38000000) >> 13; // rebias exponent 127 -> 15
+	u32 rem = absx & 0x1fff;
+	if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+		h++;
+	return (u16)(sign | h);
+}
+
+static inline float half_to_float(u16 h)
+{
+	u32 sign = (u32)(h >> 15) << 31;
+	u32 exponent = (h >> 10) & 0x1f;
+	u32 mantissa = h & 0x3ff;
+	u32 bits;
+	if (exponent == 0x1f)
+		bits = sign | 0x7f800000u | (mantissa << 13); // inf/nan
+	else if (exponent != 0)
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	else if (mantissa == 0)
+		bits = sign;
+	else
+	{
+		// denormal: renormalize
+		exponent = 113;
+		while (!(mantissa & 0x400))
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+	}
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
 // 🐞 Debugging Helper
 #ifdef DEBUG
 #include <stdio.h>
@@ -696,3 +777,5 @@ static inline const char* vkColorSpaceToString(VkColorSpaceKHR cs)
 		return "UNKNOWN_FORMAT";
 	}
 }
+
+#endif // TYPES_H
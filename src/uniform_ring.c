@@ -0,0 +1,121 @@
+#include "uniform_ring.h"
+#include <string.h>
+
+void uniform_ring_init(UniformRing* ring, const Application* app, u32 capacity, VkShaderStageFlags stages)
+{
+	memset(ring, 0, sizeof(*ring));
+	ring->device = app->device;
+	ring->allocator = app->allocator;
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	// a power of two per the spec
+	ring->alignment = (u32)MAX(props.limits.minUniformBufferOffsetAlignment, (VkDeviceSize)16);
+	ring->capacity = (MAX(capacity, (u32)UNIFORM_RING_MAX_BLOCK) + ring->alignment - 1) & ~(ring->alignment - 1);
+
+	ring->buffer = create_buffer(ring->allocator, (size_t)ring->capacity + UNIFORM_RING_MAX_BLOCK, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	VK_CHECK(vmaMapMemory(ring->allocator, ring->buffer.allocation, (void**)&ring->mapped));
+
+	VkDescriptorSetLayoutBinding binding = {
+	    .binding = 0,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+	    .descriptorCount = 1,
+	    .stageFlags = stages,
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = 1,
+	    .pBindings = &binding,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(ring->device, &layoutInfo, NULL, &ring->layout));
+
+	VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = 1,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &poolSize,
+	};
+	VK_CHECK(vkCreateDescriptorPool(ring->device, &poolInfo, NULL, &ring->pool));
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = ring->pool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &ring->layout,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(ring->device, &allocInfo, &ring->set));
+
+	VkDescriptorBufferInfo bufferInfo = {ring->buffer.buffer, 0, UNIFORM_RING_MAX_BLOCK};
+	VkWriteDescriptorSet write = {
+	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+	    .dstSet = ring->set,
+	    .dstBinding = 0,
+	    .descriptorCount = 1,
+	    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+	    .pBufferInfo = &bufferInfo,
+	};
+	vkUpdateDescriptorSets(ring->device, 1, &write, 0, NULL);
+	printf("[UniformRing] %u KiB, %u-byte alignment\n", ring->capacity / 1024, ring->alignment);
+}
+
+void uniform_ring_destroy(UniformRing* ring)
+{
+	if (ring->refused > 0)
+		printf("[UniformRing] %u allocations refused, high water %u of %u bytes\n", ring->refused, ring->highWater, ring->capacity);
+	vkDestroyDescriptorPool(ring->device, ring->pool, NULL);
+	vkDestroyDescriptorSetLayout(ring->device, ring->layout, NULL);
+	vmaUnmapMemory(ring->allocator, ring->buffer.allocation);
+	vmaDestroyBuffer(ring->allocator, ring->buffer.buffer, ring->buffer.allocation);
+}
+
+void uniform_ring_begin_frame(UniformRing* ring, u32 frameIndex)
+{
+	// the fence says the GPU is done with everything this slot handed out last time
+	ring->used -= ring->frameUsed[frameIndex];
+	ring->frameUsed[frameIndex] = 0;
+	ring->frameIndex = frameIndex;
+}
+
+u32 uniform_ring_alloc(UniformRing* ring, u32 size, void** data)
+{
+	if (size > UNIFORM_RING_MAX_BLOCK)
+	{
+		ring->refused++;
+		return UNIFORM_RING_FULL;
+	}
+	// head only ever moves in aligned steps
+	u32 aligned = (MAX(size, 1u) + ring->alignment - 1) & ~(ring->alignment - 1);
+	u32 offset = ring->head;
+	u32 cost = aligned;
+	if (offset + aligned > ring->capacity)
+	{
+		// too little left before the end: skip it, it is released along with this frame
+		cost += ring->capacity - offset;
+		offset = 0;
+	}
+	if (ring->used + cost > ring->capacity)
+	{
+		ring->refused++;
+		return UNIFORM_RING_FULL;
+	}
+	ring->head = offset + aligned;
+	ring->used += cost;
+	ring->frameUsed[ring->frameIndex] += cost;
+	ring->highWater = MAX(ring->highWater, ring->used);
+	*data = ring->mapped + offset;
+	return offset;
+}
+
+u32 uniform_ring_push(UniformRing* ring, const void* data, u32 size)
+{
+	void* block;
+	u32 offset = uniform_ring_alloc(ring, size, &block);
+	if (offset != UNIFORM_RING_FULL)
+		memcpy(block, data, size);
+	return offset;
+}
+
+void uniform_ring_flush(UniformRing* ring)
+{
+	// a no-op on host coherent memory, which is what CPU_TO_GPU usually gets
+	vmaFlushAllocation(ring->allocator, ring->buffer.allocation, 0, VK_WHOLE_SIZE);
+}
@@ -0,0 +1,57 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "main.h"
+
+// Uniform ring: per-draw constants bump-allocated from one persistently mapped buffer and read
+// through one UNIFORM_BUFFER_DYNAMIC descriptor (materialdesign.txt, set 3)
+// - one buffer shared by the frames in flight and used as a ring: allocations advance a head in
+//   minUniformBufferOffsetAlignment steps and wrap to the start when a block would run off the end
+// - every allocation belongs to the frame that made it; uniform_ring_begin_frame, called after
+//   the frame slot's fence wait, releases what the slot's previous frame allocated. Frames retire
+//   in order, so the released bytes are always the oldest ones at the tail
+// - a full ring refuses the allocation (UNIFORM_RING_FULL) rather than overwrite blocks the GPU
+//   may still read; the high water mark says how big it should have been
+// - the descriptor set is written once, UNIFORM_RING_MAX_BLOCK bytes from offset 0: a draw binds
+//   it with its block's offset as the dynamic offset, nothing is allocated or written per draw
+// - not thread safe: allocate on the thread that records the frame's draws
+
+#define UNIFORM_RING_MAX_BLOCK 256 // descriptor range: the largest block one allocation holds
+#define UNIFORM_RING_FULL UINT32_MAX
+
+typedef struct UniformRing
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	AllocatedBuffer buffer; // capacity + UNIFORM_RING_MAX_BLOCK, so the range at any offset fits
+	u8* mapped;
+	u32 capacity;
+	u32 alignment; // minUniformBufferOffsetAlignment
+	u32 head;
+	u32 used; // bytes held by frames in flight, wrap padding included
+	u32 frameUsed[MAX_FRAMES_IN_FLIGHT];
+	u32 frameIndex;
+	u32 highWater; // most bytes in use at once
+	u32 refused;   // allocations that did not fit, since init
+
+	VkDescriptorSetLayout layout; // binding 0: UNIFORM_BUFFER_DYNAMIC
+	VkDescriptorPool pool;
+	VkDescriptorSet set;
+} UniformRing;
+
+// stages: the shader stages that read the blocks
+void uniform_ring_init(UniformRing* ring, const Application* app, u32 capacity, VkShaderStageFlags stages);
+void uniform_ring_destroy(UniformRing* ring);
+
+// Releases the slot's previous allocations; call after the frame's fence wait
+void uniform_ring_begin_frame(UniformRing* ring, u32 frameIndex);
+
+// size bytes (at most UNIFORM_RING_MAX_BLOCK) for the current frame: returns the dynamic offset
+// and points *data at the mapped block, or UNIFORM_RING_FULL
+u32 uniform_ring_alloc(UniformRing* ring, u32 size, void** data);
+// uniform_ring_alloc and copy data in
+u32 uniform_ring_push(UniformRing* ring, const void* data, u32 size);
+// Makes the blocks written so far visible to the device; call before submitting the frame
+void uniform_ring_flush(UniformRing* ring);
+
+#endif // UNIFORM_RING_H
@@ -0,0 +1,423 @@
+#include "water.h"
+#include <math.h>
+#include <string.h>
+
+static AllocatedImage create_map(const Application* app, u32 n)
+{
+	AllocatedImage map = {
+	    .imageExtent = {n, n, 1},
+	    .imageFormat = VK_FORMAT_R16G16B16A16_SFLOAT,
+	};
+	VkImageCreateInfo imgInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+	    .imageType = VK_IMAGE_TYPE_2D,
+	    .format = map.imageFormat,
+	    .extent = map.imageExtent,
+	    .mipLevels = 1,
+	    .arrayLayers = WATER_CASCADES,
+	    .samples = VK_SAMPLE_COUNT_1_BIT,
+	    .tiling = VK_IMAGE_TILING_OPTIMAL,
+	    .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	};
+	VmaAllocationCreateInfo allocInfo = {
+	    .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+	    .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	};
+	VK_CHECK(vmaCreateImage(app->allocator, &imgInfo, &allocInfo, &map.image, &map.allocation, NULL));
+	map.imageView = createImageView(app->device, map.image, map.imageFormat, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, 1, 0, WATER_CASCADES);
+	return map;
+}
+
+static VkFormat pick_depth_format(VkPhysicalDevice physicalDevice)
+{
+	// one of the two is always supported as a depth attachment
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_D32_SFLOAT, &props);
+	if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		return VK_FORMAT_D32_SFLOAT;
+	return VK_FORMAT_X8_D24_UNORM_PACK32;
+}
+
+void water_init(Water* water, const Application* app, PipelineManager* pipelines, u32 n)
+{
+	memset(water, 0, sizeof(*water));
+	water->device = app->device;
+	water->allocator = app->allocator;
+	water->pipelines = pipelines;
+	water->colorFormat = app->drawImage.imageFormat;
+	water->depthFormat = pick_depth_format(app->physicaldevice);
+	water->gridSpacing = 0.25f;
+	water->sim = (WaterSimPush){
+	    .n = n,
+	    .cascades = WATER_CASCADES,
+	    .choppiness = 1.2f,
+	    .patchSizes = {250.0f, 37.0f, 9.0f, 1.0f},
+	    .windDirection = {0.8f, 0.6f},
+	    .windSpeed = 12.0f,
+	    .amplitude = 1.5e-3f,
+	    .foamBias = 0.6f,
+	    .foamDecay = 0.8f,
+	    .foamGain = 2.0f,
+	};
+
+	fft_init(&water->fft, app, pipelines);
+
+	// simulation: 0 spectrum, 1 fields, 2 displacement map, 3 normal map
+	VkDescriptorSetLayoutBinding simBindings[4];
+	for (u32 i = 0; i < ARRAYSIZE(simBindings); ++i)
+	{
+		simBindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = i < 2 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(simBindings),
+	    .pBindings = simBindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(water->device, &layoutInfo, NULL, &water->simSetLayout));
+
+	// drawing: 0 displacement (vertex), 1 normals + foam (fragment)
+	VkDescriptorSetLayoutBinding drawBindings[2] = {
+	    {.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_VERTEX_BIT},
+	    {.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT},
+	};
+	layoutInfo.bindingCount = ARRAYSIZE(drawBindings);
+	layoutInfo.pBindings = drawBindings;
+	VK_CHECK(vkCreateDescriptorSetLayout(water->device, &layoutInfo, NULL, &water->drawSetLayout));
+
+	VkDescriptorPoolSize poolSizes[] = {
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 2},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 2},
+	    {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 2},
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = 2,
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
+	    .pPoolSizes = poolSizes,
+	};
+	VK_CHECK(vkCreateDescriptorPool(water->device, &poolInfo, NULL, &water->descriptorPool));
+	VkDescriptorSetLayout setLayouts[2] = {water->simSetLayout, water->drawSetLayout};
+	VkDescriptorSet sets[2];
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = water->descriptorPool,
+	    .descriptorSetCount = 2,
+	    .pSetLayouts = setLayouts,
+	};
+	VK_CHECK(vkAllocateDescriptorSets(water->device, &allocInfo, sets));
+	water->simSet = sets[0];
+	water->drawSet = sets[1];
+
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_LINEAR,
+	    .minFilter = VK_FILTER_LINEAR,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+	};
+	VK_CHECK(vkCreateSampler(water->device, &samplerInfo, NULL, &water->sampler));
+
+	size_t grid = (size_t)n * n * WATER_CASCADES;
+	water->spectrum = create_buffer(water->allocator, grid * 4 * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	water->fields = create_buffer(water->allocator, grid * 4 * 2 * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	water->scratch = create_buffer(water->allocator, grid * 4 * 2 * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	water->displacement = create_map(app, n);
+	water->normals = create_map(app, n);
+	water->planReady = fft_create_plan(&water->fft, &water->plan, n, WATER_CASCADES * 4, water->fields.buffer, water->scratch.buffer);
+
+	VkDescriptorBufferInfo bufferInfos[2] = {
+	    {water->spectrum.buffer, 0, VK_WHOLE_SIZE},
+	    {water->fields.buffer, 0, VK_WHOLE_SIZE},
+	};
+	VkDescriptorImageInfo imageInfos[4] = {
+	    {VK_NULL_HANDLE, water->displacement.imageView, VK_IMAGE_LAYOUT_GENERAL},
+	    {VK_NULL_HANDLE, water->normals.imageView, VK_IMAGE_LAYOUT_GENERAL},
+	    {water->sampler, water->displacement.imageView, VK_IMAGE_LAYOUT_GENERAL},
+	    {water->sampler, water->normals.imageView, VK_IMAGE_LAYOUT_GENERAL},
+	};
+	VkWriteDescriptorSet writes[6];
+	for (u32 i = 0; i < 2; ++i)
+		writes[i] = (VkWriteDescriptorSet){.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = water->simSet, .dstBinding = i, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .pBufferInfo = &bufferInfos[i]};
+	for (u32 i = 0; i < 2; ++i)
+		writes[2 + i] = (VkWriteDescriptorSet){.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = water->simSet, .dstBinding = 2 + i, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &imageInfos[i]};
+	for (u32 i = 0; i < 2; ++i)
+		writes[4 + i] = (VkWriteDescriptorSet){.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = water->drawSet, .dstBinding = i, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &imageInfos[2 + i]};
+	vkUpdateDescriptorSets(water->device, ARRAYSIZE(writes), writes, 0, NULL);
+
+	VkPushConstantRange simRange = {
+	    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    .offset = 0,
+	    .size = sizeof(WaterSimPush),
+	};
+	water->simLayout = createPipelineLayout(water->device, &water->simSetLayout, 1, &simRange, 1);
+	VkPushConstantRange drawRange = {
+	    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+	    .offset = 0,
+	    .size = sizeof(WaterDrawPush),
+	};
+	water->drawLayout = createPipelineLayout(water->device, &water->drawSetLayout, 1, &drawRange, 1);
+
+	PipelineDesc desc = {
+	    .name = "water_spectrum",
+	    .computeShader = "compiledshaders/water_spectrum.comp.spv",
+	    .layout = water->simLayout,
+	};
+	water->spectrumPipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "water_evolve";
+	desc.computeShader = "compiledshaders/water_evolve.comp.spv";
+	water->evolvePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	desc.name = "water_assemble";
+	desc.computeShader = "compiledshaders/water_assemble.comp.spv";
+	water->assemblePipeline = pipeline_register(pipelines, &desc, PIPELINE_INVALID_HANDLE);
+	PipelineDesc drawDesc = {
+	    .name = "water",
+	    .vertexShader = "compiledshaders/water.vert.spv",
+	    .fragmentShader = "compiledshaders/water.frag.spv",
+	    .layout = water->drawLayout,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	    .cullMode = VK_CULL_MODE_NONE, // seen from below too
+	    .colorFormat = water->colorFormat,
+	    .depthFormat = water->depthFormat,
+	};
+	water->drawPipeline = pipeline_register(pipelines, &drawDesc, PIPELINE_INVALID_HANDLE);
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicaldevice, &props);
+	water->timestampPeriod = props.limits.timestampComputeAndGraphics ? props.limits.timestampPeriod : 0.0f;
+	if (water->timestampPeriod > 0.0f)
+	{
+		VkQueryPoolCreateInfo queryInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+		    .queryCount = MAX_FRAMES_IN_FLIGHT * 2,
+		};
+		VK_CHECK(vkCreateQueryPool(water->device, &queryInfo, NULL, &water->timestamps));
+	}
+	printf("[Water] %u cascades of %ux%u, %u clipmap levels of %u^2 quads\n", WATER_CASCADES, n, n, WATER_GRID_LEVELS, WATER_GRID_QUADS);
+}
+
+void water_destroy(Water* water)
+{
+	if (water->timestamps)
+		vkDestroyQueryPool(water->device, water->timestamps, NULL);
+	vkDestroyImageView(water->device, water->normals.imageView, NULL);
+	vmaDestroyImage(water->allocator, water->normals.image, water->normals.allocation);
+	vkDestroyImageView(water->device, water->displacement.imageView, NULL);
+	vmaDestroyImage(water->allocator, water->displacement.image, water->displacement.allocation);
+	vmaDestroyBuffer(water->allocator, water->scratch.buffer, water->scratch.allocation);
+	vmaDestroyBuffer(water->allocator, water->fields.buffer, water->fields.allocation);
+	vmaDestroyBuffer(water->allocator, water->spectrum.buffer, water->spectrum.allocation);
+	vkDestroySampler(water->device, water->sampler, NULL);
+	vkDestroyPipelineLayout(water->device, water->drawLayout, NULL);
+	vkDestroyPipelineLayout(water->device, water->simLayout, NULL);
+	vkDestroyDescriptorPool(water->device, water->descriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(water->device, water->drawSetLayout, NULL);
+	vkDestroyDescriptorSetLayout(water->device, water->simSetLayout, NULL);
+	fft_destroy(&water->fft);
+}
+
+static void buffer_barrier(VkCommandBuffer cmd, VkBuffer buffer)
+{
+	VkBufferMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	    .buffer = buffer,
+	    .size = VK_WHOLE_SIZE,
+	};
+	pipelineBarrier(cmd, 0, 1, &barrier, 0, NULL);
+}
+
+void water_simulate(Water* water, VkCommandBuffer cmd, u32 frameIndex, float time, float deltaTime)
+{
+	PipelineManager* pm = water->pipelines;
+	VkPipeline spectrum = pipeline_get(pm, water->spectrumPipeline);
+	VkPipeline evolve = pipeline_get(pm, water->evolvePipeline);
+	VkPipeline assemble = pipeline_get(pm, water->assemblePipeline);
+	if (!water->planReady || !spectrum || !evolve || !assemble || !pipeline_get(pm, water->fft.rowPipeline) || !pipeline_get(pm, water->fft.transposePipeline))
+		return;
+
+	u32 firstQuery = frameIndex * 2;
+	if (water->timestamps)
+	{
+		vkCmdResetQueryPool(cmd, water->timestamps, firstQuery, 2);
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, water->timestamps, firstQuery);
+	}
+
+	VkImageMemoryBarrier2 maps[2];
+	if (!water->spectrumReady)
+	{
+		// foam starts from nothing
+		const VkImage images[2] = {water->displacement.image, water->normals.image};
+		for (u32 i = 0; i < 2; ++i)
+			maps[i] = imageBarrier(images[i], VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_CLEAR_BIT,
+			    VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+		pipelineBarrier(cmd, 0, 0, NULL, 2, maps);
+		VkClearColorValue zero = {{0.0f, 0.0f, 0.0f, 0.0f}};
+		VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, WATER_CASCADES};
+		for (u32 i = 0; i < 2; ++i)
+			vkCmdClearColorImage(cmd, images[i], VK_IMAGE_LAYOUT_GENERAL, &zero, 1, &range);
+		for (u32 i = 0; i < 2; ++i)
+			maps[i] = imageBarrier(images[i], VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+			    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			    VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	}
+	else
+	{
+		// last frame's draw still samples the maps, and its simulation used the buffers
+		const VkImage images[2] = {water->displacement.image, water->normals.image};
+		for (u32 i = 0; i < 2; ++i)
+			maps[i] = imageBarrier(images[i],
+			    VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			    VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	}
+	pipelineBarrier(cmd, 0, 0, NULL, 2, maps);
+
+	water->sim.time = time;
+	water->sim.deltaTime = deltaTime;
+	u32 n = water->sim.n;
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, water->simLayout, 0, 1, &water->simSet, 0, NULL);
+	vkCmdPushConstants(cmd, water->simLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(WaterSimPush), &water->sim);
+	if (!water->spectrumReady)
+	{
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, spectrum);
+		vkCmdDispatch(cmd, (n + 15) / 16, (n + 15) / 16, WATER_CASCADES);
+		buffer_barrier(cmd, water->spectrum.buffer);
+		water->spectrumReady = true;
+	}
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, evolve);
+	vkCmdDispatch(cmd, (n + 15) / 16, (n + 15) / 16, WATER_CASCADES);
+	buffer_barrier(cmd, water->fields.buffer);
+
+	fft_record(&water->fft, cmd, &water->plan, FFT_INVERSE);
+
+	// the FFT bound its own layout: rebind ours
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, assemble);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, water->simLayout, 0, 1, &water->simSet, 0, NULL);
+	vkCmdPushConstants(cmd, water->simLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(WaterSimPush), &water->sim);
+	vkCmdDispatch(cmd, (n + 15) / 16, (n + 15) / 16, WATER_CASCADES);
+
+	const VkImage images[2] = {water->displacement.image, water->normals.image};
+	for (u32 i = 0; i < 2; ++i)
+		maps[i] = imageBarrier(images[i], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+		    VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+		    VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	pipelineBarrier(cmd, 0, 0, NULL, 2, maps);
+
+	if (water->timestamps)
+	{
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, water->timestamps, firstQuery + 1);
+		water->timestampsWritten[frameIndex] = true;
+	}
+}
+
+static void normalize3(float v[3])
+{
+	float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (len > 0.0f)
+	{
+		v[0] /= len;
+		v[1] /= len;
+		v[2] /= len;
+	}
+}
+
+static void cross3(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void water_draw(Water* water, VkCommandBuffer cmd, VkImageView target, VkImageView depth, VkExtent2D extent, const PathTracerCamera* camera)
+{
+	VkRenderingAttachmentInfo colorAttachment = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+	    .imageView = target,
+	    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+	    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+	    .clearValue = {.color = {.float32 = {0.55f, 0.65f, 0.75f, 1.0f}}}, // water.frag's horizon
+	};
+	VkRenderingAttachmentInfo depthAttachment = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+	    .imageView = depth,
+	    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+	    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+	    .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+	    .clearValue = {.depthStencil = {1.0f, 0}},
+	};
+	VkRenderingInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+	    .renderArea = {{0, 0}, extent},
+	    .layerCount = 1,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachments = &colorAttachment,
+	    .pDepthAttachment = &depthAttachment,
+	};
+	vkCmdBeginRendering(cmd, &renderingInfo);
+
+	VkPipeline pipeline = pipeline_get(water->pipelines, water->drawPipeline);
+	if (pipeline && water->spectrumReady)
+	{
+		float forward[3] = {camera->target[0] - camera->position[0], camera->target[1] - camera->position[1], camera->target[2] - camera->position[2]};
+		normalize3(forward);
+		const float worldUp[3] = {0.0f, 1.0f, 0.0f};
+		float right[3], up[3];
+		cross3(forward, worldUp, right);
+		normalize3(right);
+		cross3(right, forward, up);
+		WaterDrawPush push = {
+		    .cameraPosition = {camera->position[0], camera->position[1], camera->position[2], tanf(camera->fovY * 0.5f)},
+		    .cameraRight = {right[0], right[1], right[2], (float)extent.width / (float)extent.height},
+		    .cameraUp = {up[0], up[1], up[2], 0.1f},
+		    .cameraForward = {forward[0], forward[1], forward[2], 20000.0f},
+		    .gridSpacing = water->gridSpacing,
+		    .gridQuads = WATER_GRID_QUADS,
+		    .cascades = WATER_CASCADES,
+		    .time = water->sim.time,
+		};
+		memcpy(push.patchSizes, water->sim.patchSizes, sizeof(push.patchSizes));
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		VkViewport viewport = {0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f};
+		VkRect2D scissor = {{0, 0}, extent};
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, water->drawLayout, 0, 1, &water->drawSet, 0, NULL);
+		vkCmdPushConstants(cmd, water->drawLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(WaterDrawPush), &push);
+		vkCmdDraw(cmd, WATER_GRID_QUADS * WATER_GRID_QUADS * 6, WATER_GRID_LEVELS, 0, 0);
+	}
+	vkCmdEndRendering(cmd);
+}
+
+void water_collect_timings(Water* water, u32 frameIndex)
+{
+	if (!water->timestamps || !water->timestampsWritten[frameIndex])
+		return;
+	water->timestampsWritten[frameIndex] = false;
+	u64 ticks[2];
+	if (vkGetQueryPoolResults(water->device, water->timestamps, frameIndex * 2, 2, sizeof(ticks), ticks, sizeof(u64),
+	        VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+	water->lastGpuMs = (double)(ticks[1] - ticks[0]) * water->timestampPeriod * 1e-6;
+	water->gpuMsAccum += water->lastGpuMs;
+	if (++water->gpuFrames == WATER_REPORT_FRAMES)
+	{
+		printf("[Water] simulation %ux%u x%u cascades: %.3f ms GPU\n", water->sim.n, water->sim.n, WATER_CASCADES, water->gpuMsAccum / water->gpuFrames);
+		water->gpuMsAccum = 0.0;
+		water->gpuFrames = 0;
+	}
+}
@@ -0,0 +1,109 @@
+#ifndef WATER_H
+#define WATER_H
+
+#include "fft.h"
+#include "pathtracer.h"
+
+// FFT ocean (Tessendorf): simulated in compute, drawn as a clipmap grid into the draw image
+// - water_spectrum.comp: Phillips spectrum per cascade, once; each cascade keeps its own band
+//   of wavenumbers so the patches (WATER_CASCADES sizes, metres apart) add up to one ocean
+// - water_evolve.comp: spectrum at time t, packed as 4 complex fields per cascade (8 real maps)
+// - fft.h: one batched inverse 2D FFT over all cascades and fields
+// - water_assemble.comp: displacement (xyz + Jacobian) and normal (slopes + foam) maps, rgba16f
+//   2D arrays with a layer per cascade; foam accumulates where the surface folds and decays
+// - water.vert / water.frag: clipmap levels around the camera, displaced by every cascade,
+//   shaded in linear HDR so the post chain and tonemap treat it like the path traced image
+// - the simulation's GPU time is printed every WATER_REPORT_FRAMES frames
+
+#define WATER_CASCADES 3
+#define WATER_DEFAULT_SIZE 256
+#define WATER_GRID_QUADS 128 // per clipmap level side, even
+#define WATER_GRID_LEVELS 8
+#define WATER_REPORT_FRAMES 256
+
+// Matches the push constant block of the water compute shaders
+typedef struct WaterSimPush
+{
+	u32 n;
+	u32 cascades;
+	float time;
+	float choppiness;
+	float patchSizes[4];
+	float windDirection[2];
+	float windSpeed; // m/s
+	float amplitude; // Phillips constant
+	float foamBias;  // Jacobian below which foam appears
+	float foamDecay; // 1/s
+	float foamGain;
+	float deltaTime;
+} WaterSimPush;
+
+// Matches the push constant block of water.vert / water.frag
+typedef struct WaterDrawPush
+{
+	float cameraPosition[4]; // w: tan(fovY / 2)
+	float cameraRight[4];    // w: aspect
+	float cameraUp[4];       // w: near
+	float cameraForward[4];  // w: far
+	float patchSizes[4];
+	float gridSpacing;
+	u32 gridQuads;
+	u32 cascades;
+	float time;
+} WaterDrawPush;
+
+typedef struct Water
+{
+	VkDevice device;
+	VmaAllocator allocator;
+	PipelineManager* pipelines;
+	Fft fft;
+	FftPlan plan;
+	bool planReady;
+
+	PipelineHandle spectrumPipeline;
+	PipelineHandle evolvePipeline;
+	PipelineHandle assemblePipeline;
+	PipelineHandle drawPipeline;
+	VkDescriptorSetLayout simSetLayout;
+	VkDescriptorSetLayout drawSetLayout;
+	VkPipelineLayout simLayout;
+	VkPipelineLayout drawLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet simSet;
+	VkDescriptorSet drawSet;
+	VkSampler sampler;
+
+	AllocatedBuffer spectrum; // vec4 per k and cascade
+	AllocatedBuffer fields;   // 4 complex grids per cascade, transformed in place
+	AllocatedBuffer scratch;
+	AllocatedImage displacement;
+	AllocatedImage normals;
+	bool spectrumReady;
+
+	VkFormat colorFormat;
+	VkFormat depthFormat;
+	WaterSimPush sim;
+	float gridSpacing;
+
+	VkQueryPool timestamps; // 2 per frame in flight
+	float timestampPeriod;
+	bool timestampsWritten[MAX_FRAMES_IN_FLIGHT];
+	double gpuMsAccum;
+	u32 gpuFrames;
+	double lastGpuMs;
+} Water;
+
+// n: FFT size per cascade, a power of two in [FFT_MIN_N, FFT_MAX_N]
+void water_init(Water* water, const Application* app, PipelineManager* pipelines, u32 n);
+void water_destroy(Water* water);
+
+// Advances the ocean to time and rewrites the maps. Records compute work: call outside rendering.
+void water_simulate(Water* water, VkCommandBuffer cmd, u32 frameIndex, float time, float deltaTime);
+// Clears target (COLOR_ATTACHMENT_OPTIMAL) and depth (water->depthFormat, DEPTH_ATTACHMENT_OPTIMAL)
+// and draws the surface seen from camera
+void water_draw(Water* water, VkCommandBuffer cmd, VkImageView target, VkImageView depth, VkExtent2D extent, const PathTracerCamera* camera);
+// Call after the frame's fence wait
+void water_collect_timings(Water* water, u32 frameIndex);
+
+#endif // WATER_H
@@ -0,0 +1,403 @@
+#include "world_stream.h"
+#include "job.h"
+#include <math.h>
+#include <string.h>
+#include "../external/librg/code/librg.h"
+
+// the streamer's own librg entity and owner: ids past every world entity
+#define WORLD_STREAM_OWNER 1
+
+WorldStreamConfig world_stream_default_config(float worldSize, u32 maxEntities)
+{
+	return (WorldStreamConfig){
+	    .worldSize = worldSize,
+	    .maxEntities = maxEntities,
+	    .instanceCapacity = 16384,
+	    .innerRadius = 4,
+	    .outerRadius = 6,
+	    .uploadBudget = 256 * 1024,
+	};
+}
+
+void world_stream_init(WorldStream* ws, const Application* app, TextureStreamer* textures, const WorldStreamConfig* config)
+{
+	memset(ws, 0, sizeof(*ws));
+	ws->allocator = app->allocator;
+	ws->textures = textures;
+	ws->config = *config;
+	ws->config.outerRadius = MAX(ws->config.outerRadius, ws->config.innerRadius);
+
+	u16 chunks = (u16)MIN(ceilf(config->worldSize / WORLD_STREAM_CHUNK_SIZE), 65535.0f);
+	librg_world* world = librg_world_create();
+	librg_config_chunksize_set(world, WORLD_STREAM_CHUNK_SIZE, WORLD_STREAM_CHUNK_SIZE, WORLD_STREAM_CHUNK_SIZE);
+	librg_config_chunkamount_set(world, chunks, chunks, 1);
+	librg_config_chunkoffset_set(world, LIBRG_OFFSET_MID, LIBRG_OFFSET_MID, LIBRG_OFFSET_MID);
+	// the camera: ours, so queries are made around it
+	librg_entity_track(world, config->maxEntities);
+	librg_entity_owner_set(world, config->maxEntities, WORLD_STREAM_OWNER);
+	librg_entity_chunk_set(world, config->maxEntities, librg_chunk_from_realpos(world, 0.0, 0.0, 0.0));
+	ws->world = world;
+
+	ws->entities = malloc((size_t)config->maxEntities * sizeof(WorldEntity));
+	ws->resident = malloc((size_t)config->instanceCapacity * sizeof(u32));
+	ws->queryResults = malloc(((size_t)config->maxEntities + 1) * sizeof(i64));
+	ws->candidates = malloc((size_t)config->maxEntities * sizeof(WorldCandidate));
+
+	ws->instances = create_buffer(ws->allocator, (size_t)config->instanceCapacity * sizeof(WorldInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	    VMA_MEMORY_USAGE_CPU_TO_GPU);
+	VK_CHECK(vmaMapMemory(ws->allocator, ws->instances.allocation, (void**)&ws->instancesMapped));
+	ws->freeSlots = malloc((size_t)config->instanceCapacity * sizeof(u32));
+	ws->retiredSlots = malloc((size_t)config->instanceCapacity * sizeof(WorldRetiredSlot));
+	// highest first, so slots are handed out from 0
+	for (u32 i = 0; i < config->instanceCapacity; ++i)
+		ws->freeSlots[i] = config->instanceCapacity - 1 - i;
+	ws->freeCount = config->instanceCapacity;
+	printf("[World] %.0f units, %u x %u chunks, stream in at %u, out beyond %u chunks, %u instance slots\n", config->worldSize, chunks, chunks,
+	    ws->config.innerRadius, ws->config.outerRadius, config->instanceCapacity);
+}
+
+static void free_mesh(WorldStream* ws, WorldMesh* mesh)
+{
+	vmaDestroyBuffer(ws->allocator, mesh->vertices.buffer, mesh->vertices.allocation);
+	vmaDestroyBuffer(ws->allocator, mesh->indices.buffer, mesh->indices.allocation);
+	mesh->resident = false;
+	ws->stats.meshBytes -= mesh->vertexBytes + mesh->indexCount * sizeof(u16);
+	ws->stats.meshesResident--;
+}
+
+void world_stream_destroy(WorldStream* ws)
+{
+	for (u32 i = 0; i < ws->meshCount; ++i)
+	{
+		if (ws->meshes[i].resident)
+			free_mesh(ws, &ws->meshes[i]);
+	}
+	vmaUnmapMemory(ws->allocator, ws->instances.allocation);
+	vmaDestroyBuffer(ws->allocator, ws->instances.buffer, ws->instances.allocation);
+	librg_world_destroy((librg_world*)ws->world);
+	free(ws->entities);
+	free(ws->resident);
+	free(ws->queryResults);
+	free(ws->candidates);
+	free(ws->freeSlots);
+	free(ws->retiredSlots);
+}
+
+u32 world_stream_add_mesh(WorldStream* ws, const void* vertexData, u32 vertexBytes, const u16* indexData, u32 indexCount)
+{
+	if (ws->meshCount == WORLD_STREAM_MAX_MESHES)
+		return UINT32_MAX;
+	ws->meshes[ws->meshCount] = (WorldMesh){
+	    .vertexData = vertexData,
+	    .indexData = indexData,
+	    .vertexBytes = vertexBytes,
+	    .indexCount = indexCount,
+	};
+	return ws->meshCount++;
+}
+
+u32 world_stream_add_entity(WorldStream* ws, const float position[3], float scale, const float color[4], u32 mesh, TextureHandle texture)
+{
+	float half = ws->config.worldSize * 0.5f;
+	if (ws->entityCount == ws->config.maxEntities || mesh >= ws->meshCount || fabsf(position[0]) >= half || fabsf(position[1]) >= half)
+		return UINT32_MAX;
+	u32 index = ws->entityCount++;
+	WorldEntity* e = &ws->entities[index];
+	*e = (WorldEntity){
+	    .position = {position[0], position[1], position[2]},
+	    .scale = scale,
+	    .color = {color[0], color[1], color[2], color[3]},
+	    .mesh = mesh,
+	    .texture = texture,
+	    .slot = WORLD_STREAM_NO_SLOT,
+	    .seenFrame = UINT64_MAX,
+	};
+	librg_world* world = (librg_world*)ws->world;
+	librg_entity_track(world, index);
+	librg_entity_chunk_set(world, index, librg_chunk_from_realpos(world, position[0], position[1], 0.0));
+	return index;
+}
+
+// --- Streaming ---
+
+static void stream_out(WorldStream* ws, u32 index)
+{
+	WorldEntity* e = &ws->entities[index];
+	// in-flight frames may still read the slot
+	ws->retiredSlots[ws->retiredCount++] = (WorldRetiredSlot){e->slot, ws->frame};
+	e->slot = WORLD_STREAM_NO_SLOT;
+	u32 last = ws->resident[--ws->residentCount];
+	ws->resident[e->residentIndex] = last;
+	ws->entities[last].residentIndex = e->residentIndex;
+
+	WorldMesh* mesh = &ws->meshes[e->mesh];
+	if (--mesh->refs == 0)
+		mesh->releasedFrame = ws->frame;
+	ws->stats.streamedOut++;
+}
+
+// create_buffer stops on allocation failure (VK_CHECK), so there is no partial upload to undo
+static void upload_mesh(WorldStream* ws, WorldMesh* mesh)
+{
+	u32 indexBytes = mesh->indexCount * sizeof(u16);
+	mesh->vertices = create_buffer(ws->allocator, mesh->vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	mesh->indices = create_buffer(ws->allocator, indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	void* mapped;
+	VK_CHECK(vmaMapMemory(ws->allocator, mesh->vertices.allocation, &mapped));
+	memcpy(mapped, mesh->vertexData, mesh->vertexBytes);
+	vmaFlushAllocation(ws->allocator, mesh->vertices.allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(ws->allocator, mesh->vertices.allocation);
+	VK_CHECK(vmaMapMemory(ws->allocator, mesh->indices.allocation, &mapped));
+	memcpy(mapped, mesh->indexData, indexBytes);
+	vmaFlushAllocation(ws->allocator, mesh->indices.allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(ws->allocator, mesh->indices.allocation);
+	mesh->resident = true;
+	ws->stats.meshBytes += mesh->vertexBytes + indexBytes;
+	ws->stats.meshesResident++;
+}
+
+static void stream_in(WorldStream* ws, u32 index)
+{
+	WorldEntity* e = &ws->entities[index];
+	ws->meshes[e->mesh].refs++;
+	e->slot = ws->freeSlots[--ws->freeCount];
+	e->residentIndex = ws->residentCount;
+	ws->resident[ws->residentCount++] = index;
+	ws->instancesMapped[e->slot] = (WorldInstance){
+	    .position = {e->position[0], e->position[1], e->position[2], e->scale},
+	    .color = {e->color[0], e->color[1], e->color[2], e->color[3]},
+	};
+	ws->stats.streamedIn++;
+}
+
+static int compare_candidates(const void* a, const void* b)
+{
+	float x = ((const WorldCandidate*)a)->distance, y = ((const WorldCandidate*)b)->distance;
+	return (x > y) - (x < y);
+}
+
+// Entities within radius chunks of the camera, written to queryResults
+static u32 query(WorldStream* ws, u8 radius)
+{
+	size_t amount = (size_t)ws->entityCount + 1;
+	i32 missed = librg_world_query((librg_world*)ws->world, WORLD_STREAM_OWNER, radius, ws->queryResults, &amount);
+	if (missed > 0)
+		printf("[World] query at radius %u dropped %d entities\n", radius, missed);
+	return (u32)amount;
+}
+
+void world_stream_update(WorldStream* ws, const float camera[3], u64 frameNumber)
+{
+	ws->frame = frameNumber;
+	WorldStreamStats* stats = &ws->stats;
+	stats->streamedIn = stats->streamedOut = stats->deferred = 0;
+	stats->uploadedBytes = 0;
+
+	// what the GPU has finished with: slots retired MAX_FRAMES_IN_FLIGHT frames ago, unused meshes
+	u32 keep = 0;
+	for (u32 i = 0; i < ws->retiredCount; ++i)
+	{
+		if (ws->retiredSlots[i].frame + MAX_FRAMES_IN_FLIGHT <= frameNumber)
+			ws->freeSlots[ws->freeCount++] = ws->retiredSlots[i].slot;
+		else
+			ws->retiredSlots[keep++] = ws->retiredSlots[i];
+	}
+	ws->retiredCount = keep;
+	for (u32 i = 0; i < ws->meshCount; ++i)
+	{
+		WorldMesh* mesh = &ws->meshes[i];
+		if (mesh->resident && mesh->refs == 0 && mesh->releasedFrame + MAX_FRAMES_IN_FLIGHT <= frameNumber)
+			free_mesh(ws, mesh);
+	}
+
+	librg_world* world = (librg_world*)ws->world;
+	u32 cameraId = ws->config.maxEntities;
+	librg_entity_chunk_set(world, cameraId, librg_chunk_from_realpos(world, camera[0], camera[1], 0.0));
+
+	// out: resident entities the outer query no longer returns
+	u32 count = query(ws, ws->config.outerRadius);
+	for (u32 i = 0; i < count; ++i)
+	{
+		i64 id = ws->queryResults[i];
+		if (id >= 0 && id < (i64)ws->entityCount)
+			ws->entities[id].seenFrame = frameNumber;
+	}
+	for (u32 i = ws->residentCount; i-- > 0;)
+	{
+		u32 index = ws->resident[i];
+		if (ws->entities[index].seenFrame != frameNumber)
+			stream_out(ws, index);
+	}
+
+	// in: the inner query's non-resident entities, nearest first, within budget
+	count = query(ws, ws->config.innerRadius);
+	u32 candidateCount = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		i64 id = ws->queryResults[i];
+		if (id < 0 || id >= (i64)ws->entityCount || ws->entities[id].slot != WORLD_STREAM_NO_SLOT)
+			continue;
+		const WorldEntity* e = &ws->entities[id];
+		float dx = e->position[0] - camera[0], dy = e->position[1] - camera[1], dz = e->position[2] - camera[2];
+		ws->candidates[candidateCount++] = (WorldCandidate){dx * dx + dy * dy + dz * dz, (u32)id};
+	}
+	qsort(ws->candidates, candidateCount, sizeof(WorldCandidate), compare_candidates);
+	for (u32 i = 0; i < candidateCount; ++i)
+	{
+		u32 index = ws->candidates[i].entity;
+		WorldMesh* mesh = &ws->meshes[ws->entities[index].mesh];
+		u64 cost = sizeof(WorldInstance) + (mesh->resident ? 0 : mesh->vertexBytes + mesh->indexCount * sizeof(u16));
+		if (ws->freeCount == 0 || (stats->uploadedBytes > 0 && stats->uploadedBytes + cost > ws->config.uploadBudget))
+		{
+			stats->deferred = candidateCount - i;
+			break;
+		}
+		if (!mesh->resident)
+			upload_mesh(ws, mesh);
+		stream_in(ws, index);
+		stats->uploadedBytes += cost;
+	}
+	if (stats->streamedIn > 0)
+		vmaFlushAllocation(ws->allocator, ws->instances.allocation, 0, VK_WHOLE_SIZE);
+	stats->resident = ws->residentCount;
+
+	// textures: the finest mip any resident user wants, a level coarser per doubling of distance
+	// past two chunks
+	if (!ws->textures)
+		return;
+	memset(ws->textureMips, 0xff, sizeof(ws->textureMips));
+	const float nearDistance = 2.0f * WORLD_STREAM_CHUNK_SIZE;
+	for (u32 i = 0; i < ws->residentCount; ++i)
+	{
+		const WorldEntity* e = &ws->entities[ws->resident[i]];
+		if (e->texture >= TEXTURE_MAX_TEXTURES)
+			continue;
+		float dx = e->position[0] - camera[0], dy = e->position[1] - camera[1];
+		float distance = sqrtf(dx * dx + dy * dy);
+		u32 mip = distance > nearDistance ? (u32)log2f(distance / nearDistance) : 0;
+		ws->textureMips[e->texture] = MIN(ws->textureMips[e->texture], mip);
+	}
+	for (u32 t = 0; t < TEXTURE_MAX_TEXTURES; ++t)
+	{
+		if (ws->textureMips[t] != UINT32_MAX)
+			texture_request_mip(ws->textures, t, ws->textureMips[t]);
+	}
+}
+
+// --- Benchmark ---
+
+#define WORLD_BENCH_MESHES 8
+
+typedef struct WorldBenchResult
+{
+	double residentAvg;
+	u32 residentPeak;
+	u32 slotsPeak; // resident + retired
+	u64 meshBytesPeak;
+	double uploadAvg;
+	u64 uploadPeak;
+	double deferredAvg;
+	double updateMs;
+} WorldBenchResult;
+
+// Same density whatever the size: about one entity per 64 square units
+static WorldBenchResult run_world(const Application* app, u32 entityCount, float pathRadius, u32 frames)
+{
+	float size = sqrtf((float)entityCount) * 8.0f;
+	WorldStreamConfig config = world_stream_default_config(size, entityCount);
+	WorldStream* ws = malloc(sizeof(WorldStream));
+	world_stream_init(ws, app, NULL, &config);
+
+	// fans of 16 to 2048 vertices: meshes big enough to show against the upload budget
+	float* vertexData[WORLD_BENCH_MESHES];
+	u16* indexData[WORLD_BENCH_MESHES];
+	for (u32 m = 0; m < WORLD_BENCH_MESHES; ++m)
+	{
+		u32 vertices = 16u << m;
+		u32 indexCount = (vertices - 2) * 3;
+		vertexData[m] = malloc(vertices * 3 * sizeof(float));
+		indexData[m] = malloc(indexCount * sizeof(u16));
+		for (u32 v = 0; v < vertices; ++v)
+		{
+			float a = 6.2831853f * (float)v / (float)vertices;
+			vertexData[m][v * 3 + 0] = cosf(a);
+			vertexData[m][v * 3 + 1] = sinf(a);
+			vertexData[m][v * 3 + 2] = 0.0f;
+		}
+		for (u32 t = 0; t < vertices - 2; ++t)
+		{
+			indexData[m][t * 3 + 0] = 0;
+			indexData[m][t * 3 + 1] = (u16)(t + 1);
+			indexData[m][t * 3 + 2] = (u16)(t + 2);
+		}
+		world_stream_add_mesh(ws, vertexData[m], vertices * 3 * sizeof(float), indexData[m], indexCount);
+	}
+
+	u32 rng = 0x9e3779b9u;
+	for (u32 i = 0; i < entityCount; ++i)
+	{
+		float r[4];
+		for (u32 k = 0; k < 4; ++k)
+		{
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			r[k] = (float)(rng >> 8) / (float)(1u << 24);
+		}
+		float position[3] = {(r[0] - 0.5f) * size * 0.999f, (r[1] - 0.5f) * size * 0.999f, 0.0f};
+		float color[4] = {r[2], r[3], 1.0f - r[2], 1.0f};
+		// mostly small meshes, the odd big one
+		u32 mesh = (u32)(r[3] * r[3] * r[3] * WORLD_BENCH_MESHES);
+		world_stream_add_entity(ws, position, 0.5f + r[2], color, MIN(mesh, (u32)WORLD_BENCH_MESHES - 1), TEXTURE_INVALID_HANDLE);
+	}
+
+	// one lap of a circle at 4 units per frame, the same path in every world
+	WorldBenchResult result = {0};
+	double updateMs = 0.0;
+	for (u32 f = 0; f < frames; ++f)
+	{
+		float angle = 4.0f * (float)f / pathRadius;
+		float camera[3] = {pathRadius * cosf(angle), pathRadius * sinf(angle), 0.0f};
+		double t0 = now_ms();
+		world_stream_update(ws, camera, f + 1);
+		updateMs += now_ms() - t0;
+		const WorldStreamStats* s = &ws->stats;
+		result.residentAvg += s->resident;
+		result.residentPeak = MAX(result.residentPeak, s->resident);
+		result.slotsPeak = MAX(result.slotsPeak, ws->residentCount + ws->retiredCount);
+		result.meshBytesPeak = MAX(result.meshBytesPeak, s->meshBytes);
+		result.uploadAvg += (double)s->uploadedBytes;
+		result.uploadPeak = MAX(result.uploadPeak, s->uploadedBytes);
+		result.deferredAvg += s->deferred;
+	}
+	result.residentAvg /= frames;
+	result.uploadAvg /= frames;
+	result.deferredAvg /= frames;
+	result.updateMs = updateMs / frames;
+	printf("[World] %u entities: resident %.0f avg / %u peak, %u slots peak, %.1f KiB meshes peak, upload %.1f KiB avg / %.1f KiB peak per frame, "
+	       "%.1f deferred avg, %.3f ms/update\n",
+	    entityCount, result.residentAvg, result.residentPeak, result.slotsPeak, (double)result.meshBytesPeak / 1024.0, result.uploadAvg / 1024.0,
+	    (double)result.uploadPeak / 1024.0, result.deferredAvg, result.updateMs);
+
+	world_stream_destroy(ws);
+	free(ws);
+	for (u32 m = 0; m < WORLD_BENCH_MESHES; ++m)
+	{
+		free(vertexData[m]);
+		free(indexData[m]);
+	}
+	return result;
+}
+
+int world_stream_benchmark(const Application* app, u32 entityCount)
+{
+	entityCount = MAX(entityCount, 1024u);
+	// a path that fits the smaller world with the outer radius to spare
+	float pathRadius = MAX(sqrtf((float)entityCount) * 8.0f * 0.5f - 8.0f * WORLD_STREAM_CHUNK_SIZE, 4.0f * WORLD_STREAM_CHUNK_SIZE);
+	u32 frames = (u32)(6.2831853f * pathRadius / 4.0f);
+	WorldBenchResult small = run_world(app, entityCount, pathRadius, frames);
+	WorldBenchResult large = run_world(app, entityCount * 4, pathRadius, frames);
+	printf("[World] 4x the entities: %.2fx resident, %.2fx slots, %.2fx upload per frame\n", large.residentAvg / MAX(small.residentAvg, 1.0),
+	    (double)large.slotsPeak / MAX(small.slotsPeak, 1u), large.uploadAvg / MAX(small.uploadAvg, 1.0));
+	return 0;
+}
@@ -0,0 +1,139 @@
+#ifndef WORLD_STREAM_H
+#define WORLD_STREAM_H
+
+#include "texture.h"
+
+// World streaming: librg chunk queries decide which entities have GPU data
+// - every entity is tracked by librg (external/librg) in WORLD_STREAM_CHUNK_SIZE chunks; a camera
+//   entity owned by the streamer follows the camera and librg_world_query returns the entities
+//   within a chunk radius of it
+// - hysteresis: entities stream in within innerRadius chunks and out only beyond outerRadius, so
+//   an entity near the edge does not flip every time the camera wobbles
+// - streaming in costs an instance slot and, for the first user of a mesh, the mesh; candidates
+//   are taken nearest first until the per-frame upload budget is spent, the rest wait a frame
+// - meshes are reference counted by resident entities and freed once unused, after the frames in
+//   flight that may still draw them
+// - instance data lives in one persistently mapped buffer of fixed slots; a released slot is
+//   reused only MAX_FRAMES_IN_FLIGHT frames later, so no in-flight frame sees it rewritten
+// - textures stay with the texture streamer: each frame the finest mip any resident entity wants
+//   (from its distance) is requested, and the streamer's budget and LRU do the rest
+// - GPU memory and instances per frame follow the view radius, not the world size: --bench-world
+//   flies the same radius over two worlds of the same density and 4x the area
+
+#define WORLD_STREAM_CHUNK_SIZE 32 // world units per chunk side
+#define WORLD_STREAM_MAX_MESHES 256
+#define WORLD_STREAM_NO_SLOT UINT32_MAX
+
+// One instance slot, as instanced draws read it
+typedef struct WorldInstance
+{
+	float position[4]; // xyz world, w scale
+	float color[4];
+} WorldInstance;
+
+typedef struct WorldEntity
+{
+	float position[3];
+	float scale;
+	float color[4];
+	u32 mesh;
+	TextureHandle texture; // TEXTURE_INVALID_HANDLE: untextured
+	u32 slot;              // instance slot while resident, WORLD_STREAM_NO_SLOT otherwise
+	u32 residentIndex;     // position in WorldStream.resident
+	u64 seenFrame;         // last frame the outer query returned it
+} WorldEntity;
+
+typedef struct WorldMesh
+{
+	const void* vertexData; // caller's, kept for every later stream in
+	const u16* indexData;
+	u32 vertexBytes;
+	u32 indexCount;
+	AllocatedBuffer vertices; // while resident
+	AllocatedBuffer indices;
+	u32 refs;          // resident entities using it
+	u64 releasedFrame; // refs reached zero; freed MAX_FRAMES_IN_FLIGHT frames later
+	bool resident;
+} WorldMesh;
+
+typedef struct WorldRetiredSlot
+{
+	u32 slot;
+	u64 frame;
+} WorldRetiredSlot;
+
+typedef struct WorldCandidate
+{
+	float distance; // squared, to the camera
+	u32 entity;
+} WorldCandidate;
+
+typedef struct WorldStreamConfig
+{
+	float worldSize; // square side, centred on the origin
+	u32 maxEntities;
+	u32 instanceCapacity;
+	u8 innerRadius; // chunks: stream in
+	u8 outerRadius; // chunks: stream out beyond
+	u64 uploadBudget; // bytes per frame, meshes + instance data; the nearest candidate always goes
+} WorldStreamConfig;
+
+typedef struct WorldStreamStats
+{
+	u32 resident;
+	u32 streamedIn;
+	u32 streamedOut;
+	u32 deferred; // in range, waiting for budget or a slot
+	u64 uploadedBytes;
+	u64 meshBytes; // resident
+	u32 meshesResident;
+} WorldStreamStats;
+
+typedef struct WorldStream
+{
+	VmaAllocator allocator;
+	TextureStreamer* textures; // may be NULL
+	WorldStreamConfig config;
+	void* world; // librg_world
+	u64 frame;
+
+	WorldEntity* entities;
+	u32 entityCount;
+	WorldMesh meshes[WORLD_STREAM_MAX_MESHES];
+	u32 meshCount;
+
+	AllocatedBuffer instances; // [instanceCapacity] WorldInstance, storage buffer
+	WorldInstance* instancesMapped;
+	u32* freeSlots;
+	u32 freeCount;
+	WorldRetiredSlot* retiredSlots; // oldest first
+	u32 retiredCount;
+
+	u32* resident; // entity indices holding a slot: what a renderer draws
+	u32 residentCount;
+
+	// per update scratch
+	i64* queryResults;
+	WorldCandidate* candidates;
+	u32 textureMips[TEXTURE_MAX_TEXTURES];
+
+	WorldStreamStats stats; // last update
+} WorldStream;
+
+WorldStreamConfig world_stream_default_config(float worldSize, u32 maxEntities);
+// textures may be NULL when no entity is textured
+void world_stream_init(WorldStream* ws, const Application* app, TextureStreamer* textures, const WorldStreamConfig* config);
+void world_stream_destroy(WorldStream* ws);
+
+// vertexData and indexData stay owned by the caller and must outlive the stream
+u32 world_stream_add_mesh(WorldStream* ws, const void* vertexData, u32 vertexBytes, const u16* indexData, u32 indexCount);
+// UINT32_MAX when full or outside the world
+u32 world_stream_add_entity(WorldStream* ws, const float position[3], float scale, const float color[4], u32 mesh, TextureHandle texture);
+
+// Once per frame after the fence wait: follows the camera, streams in and out, requests textures
+void world_stream_update(WorldStream* ws, const float camera[3], u64 frameNumber);
+
+// --bench-world: resident set, memory and uploads over two world sizes
+int world_stream_benchmark(const Application* app, u32 entityCount);
+
+#endif // WORLD_STREAM_H